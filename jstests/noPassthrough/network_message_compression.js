@@ -0,0 +1,53 @@
+// Tests that a shell and a mongod which both support a message compressor negotiate it in isMaster
+// and exchange compressed messages, and that a shell which offers no compressor is served
+// uncompressed.
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod({setParameter: {networkMessageCompressors: "zlib,snappy"}});
+    assert.neq(null, conn, "mongod failed to start with networkMessageCompressors");
+
+    function getCompressionStats() {
+        var status = assert.commandWorked(conn.adminCommand({serverStatus: 1}));
+        return status.network.compression;
+    }
+
+    function runShell(compressors) {
+        var args = ["mongo", "--port", conn.port];
+        if (compressors) {
+            args.push("--networkMessageCompressors", compressors);
+        }
+        args.push("--eval", "(" + function() {
+            var coll = db.getSiblingDB("test").network_message_compression;
+            var doc = {payload: new Array(10000).join("x")};
+            for (var i = 0; i < 10; i++) {
+                assert.writeOK(coll.insert(doc));
+            }
+            assert.eq(10, coll.find().itcount());
+        }.toString() + ")();");
+        assert.eq(0, runMongoProgram.apply(null, args));
+    }
+
+    var before = getCompressionStats();
+    assert(before.hasOwnProperty("zlib"), tojson(before));
+    assert(before.hasOwnProperty("snappy"), tojson(before));
+
+    // A shell which offers no compressor is never sent a compressed reply.
+    runShell(null);
+    assert.eq(before, getCompressionStats());
+
+    // The first compressor the shell offers which the server supports is used in both directions.
+    runShell("snappy,zlib");
+    var after = getCompressionStats();
+    assert.gt(
+        after.snappy.decompressor.bytesOut, before.snappy.decompressor.bytesOut, tojson(after));
+    assert.gt(after.snappy.compressor.bytesIn, before.snappy.compressor.bytesIn, tojson(after));
+    assert.eq(before.zlib, after.zlib, tojson(after));
+
+    // Compressed messages are smaller than the documents they carry.
+    assert.lt(after.snappy.decompressor.bytesIn - before.snappy.decompressor.bytesIn,
+              after.snappy.decompressor.bytesOut - before.snappy.decompressor.bytesOut,
+              tojson(after));
+
+    MongoRunner.stopMongod(conn);
+}());
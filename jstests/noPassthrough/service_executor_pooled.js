@@ -0,0 +1,82 @@
+// Tests that mongod and mongos serve many concurrent connections when they run requests on a
+// bounded pool of worker threads, and that serverStatus reports where those connections are.
+(function() {
+    'use strict';
+
+    var kMaxThreads = 4;
+    var kNumShells = 8;
+
+    function checkServerStatus(conn, executor) {
+        var status = assert.commandWorked(conn.adminCommand({serverStatus: 1}));
+        var section = status.serviceExecutor;
+        assert.eq(executor, section.executor, tojson(section));
+        assert.gte(section.sessionsIdle, 0, tojson(section));
+        assert.gte(section.sessionsQueued, 0, tojson(section));
+        // This connection is running the serverStatus command.
+        assert.gte(section.sessionsRunning, 1, tojson(section));
+        if (executor === "pooled") {
+            assert.eq(kMaxThreads, section.maxThreads, tojson(section));
+        }
+        return section;
+    }
+
+    function clientWork(shell) {
+        var coll = db.getSiblingDB("test").pooled;
+        for (var j = 0; j < 200; j++) {
+            assert.writeOK(coll.insert({shell: shell, j: j}));
+            assert.eq(j + 1, coll.count({shell: shell}));
+        }
+    }
+
+    function runConcurrentClients(conn) {
+        var testDB = conn.getDB("test");
+        testDB.pooled.drop();
+
+        // More clients than worker threads, each issuing many requests and holding its
+        // connection open in between.
+        var shells = [];
+        for (var i = 0; i < kNumShells; i++) {
+            var code = '(' + clientWork.toString() + ')(' + i + ');';
+            shells.push(startParallelShell(code, conn.port));
+        }
+
+        shells.forEach(function(join) {
+            join();
+        });
+        assert.eq(kNumShells * 200, testDB.pooled.count());
+    }
+
+    var options = {
+        setParameter: {serviceExecutor: "pooled", serviceExecutorMaxThreads: kMaxThreads}
+    };
+
+    var mongod = MongoRunner.runMongod(options);
+    assert.neq(null, mongod, "mongod failed to start with the pooled service executor");
+    checkServerStatus(mongod, "pooled");
+    runConcurrentClients(mongod);
+
+    // Idle connections do not hold a worker thread, so there can be more of them than workers.
+    var idleConns = [];
+    for (var i = 0; i < kMaxThreads * 2; i++) {
+        var conn = new Mongo(mongod.host);
+        assert.commandWorked(conn.adminCommand({ping: 1}));
+        idleConns.push(conn);
+    }
+    assert.soon(function() {
+        return checkServerStatus(mongod, "pooled").sessionsIdle >= idleConns.length;
+    });
+    idleConns.forEach(function(conn) {
+        assert.commandWorked(conn.adminCommand({ping: 1}));
+    });
+    MongoRunner.stopMongod(mongod);
+
+    // The default is a thread per connection.
+    mongod = MongoRunner.runMongod({});
+    checkServerStatus(mongod, "synchronous");
+    MongoRunner.stopMongod(mongod);
+
+    var st = new ShardingTest({shards: 1, mongos: 1, other: {mongosOptions: options}});
+    checkServerStatus(st.s, "pooled");
+    runConcurrentClients(st.s);
+    st.stop();
+}());
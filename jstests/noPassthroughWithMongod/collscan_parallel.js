@@ -0,0 +1,75 @@
+// Tests that a filtered collection scan returns the same results, in the same order, whether it
+// evaluates its filter on one thread or on several.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var coll = db.collscan_parallel;
+    coll.drop();
+
+    var originalThreads =
+        assert
+            .commandWorked(
+                admin.runCommand({getParameter: 1, internalQueryExecCollectionScanThreads: 1}))
+            .internalQueryExecCollectionScanThreads;
+
+    function setThreads(threads) {
+        assert.commandWorked(
+            admin.runCommand({setParameter: 1, internalQueryExecCollectionScanThreads: threads}));
+    }
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 5000; i++) {
+        bulk.insert({_id: i, a: i % 97, b: {c: i % 5, d: [i % 3, i % 7]}, s: "str" + (i % 11)});
+    }
+    assert.writeOK(bulk.execute());
+
+    var filters = [
+        {a: {$lt: 10}},
+        {"b.d": 2, s: {$in: ["str1", "str3"]}},
+        {$or: [{a: 5}, {"b.c": {$gte: 4}}]},
+        {s: /^str1/},
+        {a: {$gt: 1000}},
+    ];
+
+    function runFind(filter, direction) {
+        return coll.find(filter).sort({$natural: direction}).toArray();
+    }
+
+    function runAggregate(filter) {
+        return coll.aggregate([{$match: filter}, {$group: {_id: "$a", count: {$sum: 1}}}])
+            .toArray()
+            .sort(function(x, y) {
+                return x._id - y._id;
+            });
+    }
+
+    try {
+        filters.forEach(function(filter) {
+            setThreads(1);
+            var expectedForward = runFind(filter, 1);
+            var expectedBackward = runFind(filter, -1);
+            var expectedAggregate = runAggregate(filter);
+
+            setThreads(4);
+            assert.eq(expectedForward, runFind(filter, 1), tojson(filter));
+            assert.eq(expectedBackward, runFind(filter, -1), tojson(filter));
+            assert.eq(expectedAggregate, runAggregate(filter), tojson(filter));
+
+            // Results must not depend on how many batches the cursor returns them in.
+            assert.eq(expectedForward, coll.find(filter).batchSize(7).toArray(), tojson(filter));
+
+            var explain = coll.find(filter).explain("executionStats");
+            var stage = explain.executionStats.executionStages;
+            assert.eq("PARALLEL_COLLSCAN", stage.stage, tojson(explain));
+            assert.eq(4, stage.threads, tojson(explain));
+            assert.eq(5000, stage.docsExamined, tojson(explain));
+        });
+
+        // $where cannot be evaluated concurrently, so it always uses an ordinary collection scan.
+        var explain = coll.find({$where: "this.a < 3"}).explain();
+        assert.eq("COLLSCAN", explain.queryPlanner.winningPlan.stage, tojson(explain));
+    } finally {
+        setThreads(originalThreads);
+    }
+}());
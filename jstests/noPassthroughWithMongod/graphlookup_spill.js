@@ -0,0 +1,77 @@
+// Tests that $graphLookup spills the documents it has found to disk when allowDiskUse is set and
+// its memory limit is reached, and that it returns the same results as when it fits in memory,
+// however many values it puts in each query of the 'from' collection.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var local = db.graphlookup_spill_local;
+    var foreign = db.graphlookup_spill_foreign;
+    local.drop();
+    foreign.drop();
+
+    function getParam(name) {
+        var cmd = {getParameter: 1};
+        cmd[name] = 1;
+        var res = assert.commandWorked(admin.runCommand(cmd));
+        return res[name];
+    }
+
+    function setParams(params) {
+        assert.commandWorked(admin.runCommand(Object.extend({setParameter: 1}, params)));
+    }
+
+    var originalBatchSize = getParam("internalGraphLookupBatchSize");
+    var originalMaxMemory = getParam("internalGraphLookupMaxMemoryBytes");
+
+    // A tree in which each node has three children, with documents large enough that the whole
+    // tree does not fit in 1MB.
+    var kNumNodes = 1000;
+    var padding = new Array(4 * 1024).join("x");
+    var bulk = foreign.initializeUnorderedBulkOp();
+    for (var i = 0; i < kNumNodes; i++) {
+        bulk.insert({_id: i, parent: Math.floor((i - 1) / 3), padding: padding});
+    }
+    assert.writeOK(bulk.execute());
+    assert.writeOK(local.insert({_id: 0, start: 0}));
+
+    var pipeline = [
+        {
+          $graphLookup: {
+              from: foreign.getName(),
+              startWith: "$start",
+              connectFromField: "_id",
+              connectToField: "parent",
+              as: "descendants",
+              depthField: "depth"
+          }
+        },
+        {$unwind: "$descendants"},
+        {$project: {_id: "$descendants._id", depth: "$descendants.depth"}},
+        {$sort: {_id: 1}}
+    ];
+
+    function run(allowDiskUse) {
+        return local.aggregate(pipeline, {allowDiskUse: allowDiskUse}).toArray();
+    }
+
+    try {
+        var expected = run(false);
+        // Every node but the root is a descendant of the root.
+        assert.eq(kNumNodes - 1, expected.length);
+
+        setParams({internalGraphLookupMaxMemoryBytes: 1024 * 1024});
+        assert.commandFailedWithCode(
+            db.runCommand({aggregate: local.getName(), pipeline: pipeline, cursor: {}}), 40099);
+
+        [1, 7, 1000].forEach(function(batchSize) {
+            setParams({internalGraphLookupBatchSize: batchSize});
+            assert.eq(expected, run(true), "batch size " + batchSize);
+        });
+    } finally {
+        setParams({
+            internalGraphLookupBatchSize: originalBatchSize,
+            internalGraphLookupMaxMemoryBytes: originalMaxMemory
+        });
+    }
+}());
@@ -0,0 +1,81 @@
+// Tests that an unsorted $group returns the same results whether it groups its input on one thread
+// or partitions it across several, including when it only partitions the input left after grouping
+// some of it on one thread.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var coll = db.group_parallel;
+    coll.drop();
+
+    var originalParallelism =
+        assert.commandWorked(admin.runCommand({getParameter: 1, internalGroupParallelism: 1}))
+            .internalGroupParallelism;
+    var originalMinDocs =
+        assert.commandWorked(admin.runCommand({getParameter: 1, internalGroupParallelMinDocs: 1}))
+            .internalGroupParallelMinDocs;
+
+    function setParallelism(parallelism, minDocs) {
+        assert.commandWorked(admin.runCommand({
+            setParameter: 1,
+            internalGroupParallelism: parallelism,
+            internalGroupParallelMinDocs: minDocs
+        }));
+    }
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 5000; i++) {
+        bulk.insert({
+            _id: i,
+            a: i % 97,
+            b: {c: i % 5, d: [i % 3, i % 7]},
+            s: "str" + (i % 11),
+            n: (i % 13 === 0) ? null : i
+        });
+    }
+    assert.writeOK(bulk.execute());
+
+    var pipelines = [
+        [{$group: {_id: "$a", count: {$sum: 1}, total: {$sum: "$n"}}}],
+        [{$group: {_id: {c: "$b.c", s: "$s"}, ids: {$push: "$_id"}, first: {$first: "$_id"}}}],
+        [{$group: {_id: "$b.d", max: {$max: "$n"}, min: {$min: "$n"}, last: {$last: "$_id"}}}],
+        [{$group: {_id: "$n", avg: {$avg: "$a"}}}],
+        [{$group: {_id: null, distinct: {$addToSet: "$s"}}}],
+        [{$group: {_id: "$b.c", docs: {$push: "$$ROOT"}}}],
+        [
+          {$match: {a: {$lt: 50}}},
+          {$unwind: "$b.d"},
+          {$group: {_id: "$b.d", sub: {$push: "$b"}, count: {$sum: 1}}}
+        ],
+        [{$group: {_id: "$a", count: {$sum: 1}}}, {$group: {_id: "$count", n: {$sum: 1}}}],
+    ];
+
+    function runPipeline(pipeline) {
+        return coll.aggregate(pipeline.concat([{$sort: {_id: 1}}])).toArray().map(function(doc) {
+            // $addToSet does not define the order of its results.
+            if (doc.distinct) {
+                doc.distinct.sort();
+            }
+            return doc;
+        });
+    }
+
+    try {
+        pipelines.forEach(function(pipeline) {
+            setParallelism(1, originalMinDocs);
+            var expected = runPipeline(pipeline);
+
+            [2, 3, 8].forEach(function(parallelism) {
+                [0, 1000].forEach(function(minDocs) {
+                    setParallelism(parallelism, minDocs);
+                    assert.eq(expected,
+                              runPipeline(pipeline),
+                              "parallelism " + parallelism + ", minDocs " + minDocs + ": " +
+                                  tojson(pipeline));
+                });
+            });
+        });
+    } finally {
+        setParallelism(originalParallelism, originalMinDocs);
+    }
+}());
@@ -0,0 +1,55 @@
+// Tests that foreground index builds produce the same indexes whether keys are generated by one
+// thread or by several.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var coll = db.index_build_parallel;
+    coll.drop();
+
+    function setMaxIndexBuildThreads(n) {
+        assert.commandWorked(admin.runCommand({setParameter: 1, maxIndexBuildThreads: n}));
+    }
+
+    var original =
+        assert.commandWorked(admin.runCommand({getParameter: 1, maxIndexBuildThreads: 1}))
+            .maxIndexBuildThreads;
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 10000; i++) {
+        bulk.insert({_id: i, a: i % 97, b: [i % 3, i % 5], c: (i % 2 === 0) ? i : undefined});
+    }
+    assert.writeOK(bulk.execute());
+
+    var specs = [
+        {key: {a: 1}, options: {}},
+        {key: {b: 1, a: -1}, options: {}},
+        {key: {c: 1}, options: {partialFilterExpression: {c: {$exists: true}}}},
+    ];
+
+    function buildAndRead(threads) {
+        setMaxIndexBuildThreads(threads);
+        var results = [];
+        specs.forEach(function(spec) {
+            assert.commandWorked(coll.createIndex(spec.key, spec.options));
+            results.push(coll.find().hint(spec.key).returnKey().toArray());
+            results.push(coll.find().hint(spec.key).showRecordId().toArray().length);
+        });
+        assert.commandWorked(coll.validate(true));
+        assert.commandWorked(coll.dropIndexes());
+        return results;
+    }
+
+    try {
+        var expected = buildAndRead(1);
+        assert.eq(expected, buildAndRead(4));
+
+        // A duplicate key found by any thread fails the build.
+        setMaxIndexBuildThreads(4);
+        assert.commandFailedWithCode(coll.createIndex({a: 1}, {unique: true}),
+                                     ErrorCodes.DuplicateKey);
+        assert.eq(1, coll.getIndexes().length);
+    } finally {
+        setMaxIndexBuildThreads(original);
+    }
+}());
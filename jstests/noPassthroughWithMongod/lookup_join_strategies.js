@@ -0,0 +1,120 @@
+// Tests that $lookup returns the same results whether it queries the foreign collection once per
+// input document, once per block of input documents, or joins against an in-memory copy of the
+// foreign collection.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var local = db.lookup_join_strategies_local;
+    var foreign = db.lookup_join_strategies_foreign;
+    local.drop();
+    foreign.drop();
+
+    function getParam(name) {
+        var cmd = {getParameter: 1};
+        cmd[name] = 1;
+        var res = assert.commandWorked(admin.runCommand(cmd));
+        return res[name];
+    }
+
+    function setParams(params) {
+        assert.commandWorked(admin.runCommand(Object.extend({setParameter: 1}, params)));
+    }
+
+    var originalBatchSize = getParam("internalLookupBatchSize");
+    var originalMaxBytes = getParam("internalLookupInMemoryHashMaxBytes");
+
+    var values = [
+        1,
+        NumberLong(1),
+        2.0,
+        "a",
+        "b",
+        null,
+        [1, 2],
+        [],
+        [null],
+        {x: 1},
+        /a/,
+        [/a/, "b"],
+        [[1, 2], 3]
+    ];
+
+    for (var i = 0; i < 250; i++) {
+        var localDoc = {_id: i, a: values[i % values.length], nested: {a: i % 7}};
+        if (i % 11 === 0) {
+            delete localDoc.a;
+        }
+        assert.writeOK(local.insert(localDoc));
+    }
+
+    for (var i = 0; i < 100; i++) {
+        var foreignDoc = {_id: i, b: values[(i * 3) % values.length], c: {b: [i % 7, i % 5]}};
+        if (i % 13 === 0) {
+            delete foreignDoc.b;
+        }
+        assert.writeOK(foreign.insert(foreignDoc));
+    }
+
+    var pipelines = [
+        [{$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}}],
+        [{
+           $lookup:
+               {from: foreign.getName(), localField: "nested.a", foreignField: "c.b", as: "joined"}
+        }],
+        [
+          {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}},
+          {$unwind: {path: "$joined", includeArrayIndex: "idx"}}
+        ],
+        [
+          {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}},
+          {$unwind: {path: "$joined", preserveNullAndEmptyArrays: true}}
+        ],
+        [
+          {$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}},
+          {$unwind: "$joined"},
+          {$match: {"joined._id": {$gte: 50}}}
+        ],
+    ];
+
+    function runPipeline(pipeline) {
+        // Sort the joined arrays so that results do not depend on the order in which foreign
+        // documents were returned.
+        return local.aggregate(pipeline.concat([{$sort: {_id: 1, "joined._id": 1}}]))
+            .toArray()
+            .map(function(doc) {
+                if (Array.isArray(doc.joined)) {
+                    doc.joined.sort(function(x, y) {
+                        return x._id - y._id;
+                    });
+                }
+                return doc;
+            });
+    }
+
+    try {
+        pipelines.forEach(function(pipeline) {
+            // One query per input document.
+            setParams({internalLookupBatchSize: 1});
+            var expected = runPipeline(pipeline);
+
+            // One query per block of input documents.
+            setParams({internalLookupBatchSize: 17, internalLookupInMemoryHashMaxBytes: 0});
+            assert.eq(expected, runPipeline(pipeline), tojson(pipeline));
+
+            // The whole foreign collection joined in memory.
+            setParams(
+                {internalLookupBatchSize: 17, internalLookupInMemoryHashMaxBytes: 1024 * 1024});
+            assert.eq(expected, runPipeline(pipeline), tojson(pipeline));
+
+            // The foreign collection is too large to hold in memory.
+            setParams({internalLookupBatchSize: 17, internalLookupInMemoryHashMaxBytes: 100});
+            assert.eq(expected, runPipeline(pipeline), tojson(pipeline));
+        });
+    } finally {
+        setParams({
+            internalLookupBatchSize: originalBatchSize,
+            internalLookupInMemoryHashMaxBytes: originalMaxBytes
+        });
+    }
+}());
@@ -0,0 +1,106 @@
+// Tests that the server-wide cache of $lookup and $graphLookup results is used across queries, and
+// that writes to the foreign collection invalidate it.
+(function() {
+    "use strict";
+
+    var admin = db.getSiblingDB("admin");
+    var local = db.lookup_results_cache_local;
+    var foreign = db.lookup_results_cache_foreign;
+    local.drop();
+    foreign.drop();
+
+    function getParam(name) {
+        var cmd = {getParameter: 1};
+        cmd[name] = 1;
+        var res = assert.commandWorked(admin.runCommand(cmd));
+        return res[name];
+    }
+
+    function setParams(params) {
+        assert.commandWorked(admin.runCommand(Object.extend({setParameter: 1}, params)));
+    }
+
+    function getCacheStats() {
+        return assert.commandWorked(db.serverStatus()).lookupResultsCache;
+    }
+
+    var originalCacheMaxBytes = getParam("internalLookupResultsCacheMaxBytes");
+    var originalBatchSize = getParam("internalLookupBatchSize");
+
+    for (var i = 0; i < 100; i++) {
+        assert.writeOK(local.insert({_id: i, a: i % 10}));
+    }
+    for (var i = 0; i < 10; i++) {
+        assert.writeOK(foreign.insert({_id: i, b: i, next: i + 1}));
+    }
+
+    var lookupPipeline =
+        [{$lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}}];
+    var graphLookupPipeline = [
+        {$match: {_id: 1}},
+        {
+          $graphLookup: {
+              from: foreign.getName(),
+              startWith: "$a",
+              connectFromField: "next",
+              connectToField: "b",
+              as: "reachable"
+          }
+        }
+    ];
+
+    function countJoined() {
+        var count = 0;
+        local.aggregate(lookupPipeline).forEach(function(doc) {
+            count += doc.joined.length;
+        });
+        return count;
+    }
+
+    function countReachable() {
+        return local.aggregate(graphLookupPipeline).toArray()[0].reachable.length;
+    }
+
+    try {
+        assert.eq(0, getCacheStats().maxBytes);
+
+        // Join in memory, so that $lookup reads the whole foreign collection.
+        setParams({internalLookupResultsCacheMaxBytes: 1024 * 1024, internalLookupBatchSize: 17});
+
+        assert.eq(100, countJoined());
+        var stats = getCacheStats();
+        assert.gt(stats.inserts, 0, tojson(stats));
+
+        // The second run is answered from the cache.
+        assert.eq(100, countJoined());
+        assert.gt(getCacheStats().hits, stats.hits, tojson(getCacheStats()));
+
+        // A write to the foreign collection is seen by the next query.
+        assert.writeOK(foreign.remove({_id: 0}));
+        assert.gt(getCacheStats().invalidations, stats.invalidations, tojson(getCacheStats()));
+        assert.eq(90, countJoined());
+
+        assert.eq(9, countReachable());
+        stats = getCacheStats();
+        assert.eq(9, countReachable());
+        assert.gt(getCacheStats().hits, stats.hits, tojson(getCacheStats()));
+
+        assert.writeOK(foreign.update({_id: 5}, {$set: {next: -1}}));
+        assert.eq(5, countReachable());
+        assert.writeOK(foreign.insert({_id: 0, b: 0, next: 1}));
+        assert.eq(5, countReachable());
+
+        // Disabling the cache discards its contents.
+        setParams({internalLookupResultsCacheMaxBytes: 0});
+        stats = getCacheStats();
+        assert.eq(0, stats.entries, tojson(stats));
+        assert.eq(0, stats.bytes, tojson(stats));
+        assert.eq(100, countJoined());
+        assert.eq(stats.inserts, getCacheStats().inserts, tojson(getCacheStats()));
+    } finally {
+        setParams({
+            internalLookupResultsCacheMaxBytes: originalCacheMaxBytes,
+            internalLookupBatchSize: originalBatchSize
+        });
+    }
+}());
@@ -0,0 +1,58 @@
+/**
+ * Tests that initial sync clones the documents and indexes of every collection when several
+ * collections are cloned at once.
+ */
+
+(function() {
+    "use strict";
+
+    var name = 'initial_sync_parallel_clone';
+    var replSet = new ReplSetTest({
+        name: name,
+        nodes: [{}, {rsConfig: {arbiterOnly: true}}],
+    });
+
+    replSet.startSet();
+    replSet.initiate();
+    var primary = replSet.getPrimary();
+
+    var dbNames = ['test1', 'test2'];
+    var numCollections = 5;
+    var numDocs = 200;
+    dbNames.forEach(function(dbName) {
+        for (var i = 0; i < numCollections; i++) {
+            var coll = primary.getDB(dbName).getCollection('coll' + i);
+            var bulk = coll.initializeUnorderedBulkOp();
+            for (var j = 0; j < numDocs; j++) {
+                bulk.insert({_id: j, x: j % 10, y: 'doc' + j});
+            }
+            assert.writeOK(bulk.execute());
+            assert.commandWorked(coll.createIndex({x: 1}));
+            assert.commandWorked(coll.createIndex({y: 1, x: -1}, {unique: true}));
+        }
+    });
+
+    var secondary = replSet.add({setParameter: {initialSyncCloneConcurrency: 3}});
+    secondary.setSlaveOk();
+    replSet.reInitiate();
+    replSet.awaitSecondaryNodes();
+    replSet.awaitReplication();
+
+    // Progress is only reported while an initial sync is in progress.
+    var status = assert.commandWorked(secondary.adminCommand({replSetGetStatus: 1}));
+    assert(!status.hasOwnProperty('initialSyncStatus'), tojson(status));
+
+    dbNames.forEach(function(dbName) {
+        for (var i = 0; i < numCollections; i++) {
+            var primaryColl = primary.getDB(dbName).getCollection('coll' + i);
+            var secondaryColl = secondary.getDB(dbName).getCollection('coll' + i);
+            assert.eq(numDocs, secondaryColl.find().itcount(), secondaryColl.getFullName());
+            assert.eq(primaryColl.getIndexes().length,
+                      secondaryColl.getIndexes().length,
+                      tojson(secondaryColl.getIndexes()));
+            assert.eq(numDocs / 10, secondaryColl.find({x: 3}).hint({x: 1}).itcount());
+        }
+    });
+
+    replSet.stopSet();
+})();
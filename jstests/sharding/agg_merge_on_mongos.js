@@ -0,0 +1,52 @@
+// Tests that aggregations whose merging half runs on mongos return the same results as when the
+// merge runs on a shard, and that the merge is reported on mongos in explain output.
+(function() {
+    "use strict";
+
+    var st = new ShardingTest({shards: 2, mongos: 1});
+    var mongosDB = st.s.getDB("agg_merge_on_mongos");
+    var coll = mongosDB.coll;
+
+    assert.commandWorked(mongosDB.adminCommand({enableSharding: mongosDB.getName()}));
+    st.ensurePrimaryShard(mongosDB.getName(), "shard0000");
+    assert.commandWorked(
+        mongosDB.adminCommand({shardCollection: coll.getFullName(), key: {_id: 1}}));
+    assert.commandWorked(mongosDB.adminCommand({split: coll.getFullName(), middle: {_id: 0}}));
+    assert.commandWorked(mongosDB.adminCommand(
+        {moveChunk: coll.getFullName(), find: {_id: 0}, to: "shard0001"}));
+
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = -500; i < 500; i++) {
+        var doc = {_id: i, a: i % 13, b: "str" + (i % 7)};
+        if (i % 17 === 0) {
+            delete doc.a;
+        }
+        bulk.insert(doc);
+    }
+    assert.writeOK(bulk.execute());
+
+    var pipelines = [
+        [{$sort: {a: 1, _id: -1}}],
+        [{$sort: {a: -1, b: 1, _id: 1}}, {$limit: 25}],
+        [{$match: {a: {$gte: 5}}}, {$sort: {b: 1, _id: 1}}, {$skip: 10}, {$limit: 100}],
+        [{$group: {_id: "$a", total: {$sum: "$_id"}}}, {$sort: {_id: 1}}],
+        [{$sort: {_id: 1}}, {$project: {a: 1}}, {$limit: 300}],
+    ];
+
+    pipelines.forEach(function(pipeline) {
+        // allowDiskUse forces the merge to run on a shard.
+        var expected = coll.aggregate(pipeline, {allowDiskUse: true}).toArray();
+        assert.eq(expected, coll.aggregate(pipeline).toArray(), tojson(pipeline));
+        assert.eq(expected, coll.aggregate(pipeline, {cursor: {batchSize: 7}}).toArray());
+        var res = mongosDB.runCommand({aggregate: coll.getName(), pipeline: pipeline});
+        assert.commandWorked(res);
+        assert.eq(expected, res.result);
+
+        var explain = coll.aggregate(pipeline, {explain: true});
+        assert.eq(true, explain.mergeOnRouter, tojson(explain));
+        explain = coll.aggregate(pipeline, {explain: true, allowDiskUse: true});
+        assert.eq(false, explain.mergeOnRouter, tojson(explain));
+    });
+
+    st.stop();
+}());
@@ -768,6 +768,8 @@ StatusWith<executor::RemoteCommandResponse> initWireVersion(DBClientConnection*
             bob.append("hostInfo", sb.str());
         }
 
+        conn->port().getCompressorManager().clientBegin(&bob);
+
         Date_t start{Date_t::now()};
         auto result =
             conn->runCommandWithMetadata("admin", "isMaster", rpc::makeEmptyMetadata(), bob.done());
@@ -781,6 +783,8 @@ StatusWith<executor::RemoteCommandResponse> initWireVersion(DBClientConnection*
             conn->setWireVersions(minWireVersion, maxWireVersion);
         }
 
+        conn->port().getCompressorManager().clientFinish(isMasterObj);
+
         return executor::RemoteCommandResponse{
             std::move(isMasterObj), result->getMetadata().getOwned(), finish - start};
 
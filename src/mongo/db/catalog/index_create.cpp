@@ -47,13 +47,17 @@
 #include "mongo/db/operation_context.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/fail_point.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/progress_meter.h"
+#include "mongo/util/queue.h"
 #include "mongo/util/quick_exit.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
@@ -64,6 +68,20 @@ using std::endl;
 MONGO_FP_DECLARE(crashAfterStartingIndexBuild);
 MONGO_FP_DECLARE(hangAfterStartingIndexBuild);
 
+// The most threads a single foreground index build uses to generate and sort keys. A value of 1
+// disables parallel key generation.
+MONGO_EXPORT_SERVER_PARAMETER(maxIndexBuildThreads, int, 4);
+
+namespace {
+
+// Documents are handed to the key generating threads in batches of this many, and collections with
+// fewer documents than this are indexed serially.
+const size_t kIndexBuildBatchSize = 1000;
+
+using IndexBuildBatch = std::vector<std::pair<BSONObj, RecordId>>;
+
+}  // namespace
+
 /**
  * On rollback sets MultiIndexBlock::_needToCleanup to true.
  */
@@ -252,65 +270,71 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
         exec->setYieldPolicy(PlanExecutor::WRITE_CONFLICT_RETRY_ONLY, _collection);
     }
 
-    Snapshotted<BSONObj> objToIndex;
-    RecordId loc;
-    PlanExecutor::ExecState state;
-    int retries = 0;  // non-zero when retrying our last document.
-    while (retries ||
-           (PlanExecutor::ADVANCED == (state = exec->getNextSnapshotted(&objToIndex, &loc)))) {
-        try {
-            if (_allowInterruption)
-                _txn->checkForInterrupt();
-
-            // Make sure we are working with the latest version of the document.
-            if (objToIndex.snapshotId() != _txn->recoveryUnit()->getSnapshotId() &&
-                !_collection->findDoc(_txn, loc, &objToIndex)) {
-                // doc was deleted so don't index it.
+    const size_t numWorkers = _numInsertWorkers(numRecords);
+    if (numWorkers > 1) {
+        log() << "building index using " << numWorkers << " threads";
+        _insertAllDocumentsUsingWorkers(exec.get(), numWorkers, progress.get(), &n);
+    } else {
+        Snapshotted<BSONObj> objToIndex;
+        RecordId loc;
+        PlanExecutor::ExecState state;
+        int retries = 0;  // non-zero when retrying our last document.
+        while (retries ||
+               (PlanExecutor::ADVANCED == (state = exec->getNextSnapshotted(&objToIndex, &loc)))) {
+            try {
+                if (_allowInterruption)
+                    _txn->checkForInterrupt();
+
+                // Make sure we are working with the latest version of the document.
+                if (objToIndex.snapshotId() != _txn->recoveryUnit()->getSnapshotId() &&
+                    !_collection->findDoc(_txn, loc, &objToIndex)) {
+                    // doc was deleted so don't index it.
+                    retries = 0;
+                    continue;
+                }
+
+                // Done before insert so we can retry document if it WCEs.
+                progress->setTotalWhileRunning(_collection->numRecords(_txn));
+
+                WriteUnitOfWork wunit(_txn);
+                Status ret = insert(objToIndex.value(), loc);
+                if (_buildInBackground)
+                    exec->saveState();
+                if (ret.isOK()) {
+                    wunit.commit();
+                } else if (dupsOut && ret.code() == ErrorCodes::DuplicateKey) {
+                    // If dupsOut is non-null, we should only fail the specific insert that
+                    // led to a DuplicateKey rather than the whole index build.
+                    dupsOut->insert(loc);
+                } else {
+                    // Fail the index build hard.
+                    return ret;
+                }
+                if (_buildInBackground)
+                    exec->restoreState();  // Handles any WCEs internally.
+
+                // Go to the next document
+                progress->hit();
+                n++;
                 retries = 0;
-                continue;
-            }
+            } catch (const WriteConflictException& wce) {
+                CurOp::get(_txn)->debug().writeConflicts++;
+                retries++;  // logAndBackoff expects this to be 1 on first call.
+                wce.logAndBackoff(retries, "index creation", _collection->ns().ns());
 
-            // Done before insert so we can retry document if it WCEs.
-            progress->setTotalWhileRunning(_collection->numRecords(_txn));
-
-            WriteUnitOfWork wunit(_txn);
-            Status ret = insert(objToIndex.value(), loc);
-            if (_buildInBackground)
+                // Can't use WRITE_CONFLICT_RETRY_LOOP macros since we need to save/restore exec
+                // around call to abandonSnapshot.
                 exec->saveState();
-            if (ret.isOK()) {
-                wunit.commit();
-            } else if (dupsOut && ret.code() == ErrorCodes::DuplicateKey) {
-                // If dupsOut is non-null, we should only fail the specific insert that
-                // led to a DuplicateKey rather than the whole index build.
-                dupsOut->insert(loc);
-            } else {
-                // Fail the index build hard.
-                return ret;
-            }
-            if (_buildInBackground)
+                _txn->recoveryUnit()->abandonSnapshot();
                 exec->restoreState();  // Handles any WCEs internally.
-
-            // Go to the next document
-            progress->hit();
-            n++;
-            retries = 0;
-        } catch (const WriteConflictException& wce) {
-            CurOp::get(_txn)->debug().writeConflicts++;
-            retries++;  // logAndBackoff expects this to be 1 on first call.
-            wce.logAndBackoff(retries, "index creation", _collection->ns().ns());
-
-            // Can't use WRITE_CONFLICT_RETRY_LOOP macros since we need to save/restore exec
-            // around call to abandonSnapshot.
-            exec->saveState();
-            _txn->recoveryUnit()->abandonSnapshot();
-            exec->restoreState();  // Handles any WCEs internally.
+            }
         }
-    }
 
-    uassert(28550,
-            "Unable to complete index build due to collection scan failure: " +
-                WorkingSetCommon::toStatusString(objToIndex.value()),
-            state == PlanExecutor::IS_EOF);
+        uassert(28550,
+                "Unable to complete index build due to collection scan failure: " +
+                    WorkingSetCommon::toStatusString(objToIndex.value()),
+                state == PlanExecutor::IS_EOF);
+    }
 
     // Need the index build to hang before the progress meter is marked as finished so we can
     // reliably check that the index build has actually started in js tests.
@@ -331,6 +355,137 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
     return Status::OK();
 }
 
+size_t MultiIndexBlock::_numInsertWorkers(long long numRecords) const {
+    // Background builds yield and must see concurrent writes, and indexes which are not built in
+    // bulk are written directly, so neither can have their keys generated out of band.
+    if (_buildInBackground) {
+        return 1;
+    }
+    for (auto&& index : _indexes) {
+        if (!index.bulk) {
+            return 1;
+        }
+    }
+
+    const long long maxWorkers = std::max(1, maxIndexBuildThreads.load());
+    const long long numBatches = numRecords / static_cast<long long>(kIndexBuildBatchSize);
+    return static_cast<size_t>(std::max(1LL, std::min(maxWorkers, numBatches)));
+}
+
+void MultiIndexBlock::_insertAllDocumentsUsingWorkers(PlanExecutor* exec,
+                                                      size_t numWorkers,
+                                                      ProgressMeter* progress,
+                                                      unsigned long long* numScanned) {
+    invariant(numWorkers > 1);
+
+    // bulks[w][i] is the BulkBuilder of worker 'w' for '_indexes[i]'. Each worker gets an equal
+    // share of the memory a single BulkBuilder would have used.
+    std::vector<std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>>> bulks(numWorkers);
+    for (auto&& workerBulks : bulks) {
+        for (auto&& index : _indexes) {
+            invariant(index.bulk);
+            workerBulks.push_back(
+                index.real->initiateBulk(IndexAccessMethod::kBulkMaxMemoryUsageBytes / numWorkers));
+        }
+    }
+
+    // A null batch tells a worker to exit.
+    BlockingQueue<std::shared_ptr<IndexBuildBatch>> queue(2 * numWorkers);
+
+    stdx::mutex errorMutex;
+    Status firstError = Status::OK();
+    AtomicWord<bool> failed(false);
+
+    auto work = [&](std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>>* workerBulks) {
+        while (auto batch = queue.blockingPop()) {
+            // Keep draining the queue after a failure so that the scanning thread never blocks.
+            if (failed.load()) {
+                continue;
+            }
+            try {
+                for (auto&& doc : *batch) {
+                    for (size_t i = 0; i < _indexes.size(); i++) {
+                        if (_indexes[i].filterExpression &&
+                            !_indexes[i].filterExpression->matchesBSON(doc.first)) {
+                            continue;
+                        }
+                        // Key generation does not use the OperationContext, which is not safe to
+                        // share with this thread.
+                        int64_t unused;
+                        uassertStatusOK((*workerBulks)[i]->insert(
+                            nullptr, doc.first, doc.second, _indexes[i].options, &unused));
+                    }
+                }
+            } catch (const DBException& ex) {
+                stdx::lock_guard<stdx::mutex> lk(errorMutex);
+                if (firstError.isOK()) {
+                    firstError = ex.toStatus();
+                }
+                failed.store(true);
+            }
+        }
+    };
+
+    std::vector<stdx::thread> workers;
+    auto stopWorkers = [&] {
+        for (size_t w = 0; w < workers.size(); w++) {
+            queue.push(nullptr);
+        }
+        for (auto&& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    };
+    ON_BLOCK_EXIT(stopWorkers);
+
+    for (size_t w = 0; w < numWorkers; w++) {
+        workers.emplace_back(work, &bulks[w]);
+    }
+
+    auto batch = std::make_shared<IndexBuildBatch>();
+    batch->reserve(kIndexBuildBatchSize);
+
+    BSONObj objToIndex;
+    RecordId loc;
+    PlanExecutor::ExecState state = PlanExecutor::IS_EOF;
+    while (!failed.load() &&
+           PlanExecutor::ADVANCED == (state = exec->getNext(&objToIndex, &loc))) {
+        if (_allowInterruption)
+            _txn->checkForInterrupt();
+
+        batch->emplace_back(objToIndex.getOwned(), loc);
+        if (batch->size() == kIndexBuildBatchSize) {
+            queue.push(batch);
+            batch = std::make_shared<IndexBuildBatch>();
+            batch->reserve(kIndexBuildBatchSize);
+            progress->setTotalWhileRunning(_collection->numRecords(_txn));
+        }
+
+        progress->hit();
+        (*numScanned)++;
+    }
+
+    if (!failed.load()) {
+        uassert(28550,
+                "Unable to complete index build due to collection scan failure: " +
+                    WorkingSetCommon::toStatusString(objToIndex),
+                state == PlanExecutor::IS_EOF);
+    }
+
+    if (!batch->empty()) {
+        queue.push(batch);
+    }
+    stopWorkers();
+    uassertStatusOK(firstError);
+
+    for (size_t i = 0; i < _indexes.size(); i++) {
+        _indexes[i].bulk = std::move(bulks[0][i]);
+        for (size_t w = 1; w < numWorkers; w++) {
+            _indexes[i].bulk->merge(std::move(bulks[w][i]));
+        }
+    }
+}
+
 Status MultiIndexBlock::insert(const BSONObj& doc, const RecordId& loc) {
     for (size_t i = 0; i < _indexes.size(); i++) {
         if (_indexes[i].filterExpression && !_indexes[i].filterExpression->matchesBSON(doc)) {
@@ -46,6 +46,8 @@ class BackgroundOperation;
 class BSONObj;
 class Collection;
 class OperationContext;
+class PlanExecutor;
+class ProgressMeter;
 
 /**
  * Builds one or more indexes.
@@ -201,6 +203,25 @@ private:
         InsertDeleteOptions options;
     };
 
+    /**
+     * Returns how many threads should generate keys for a collection of about 'numRecords'
+     * documents. Returns 1 unless every index is built in bulk in the foreground.
+     */
+    size_t _numInsertWorkers(long long numRecords) const;
+
+    /**
+     * Scans the collection with 'exec' on this thread and hands the documents in batches to
+     * 'numWorkers' threads, each of which generates keys into its own BulkBuilder for every index.
+     * Those are merged into the BulkBuilders of '_indexes' before returning, so doneInserting()
+     * sorts the keys of all workers together. Only valid when every index is built in bulk.
+     *
+     * Throws on failure, as the serial scan in insertAllDocumentsInCollection() does.
+     */
+    void _insertAllDocumentsUsingWorkers(PlanExecutor* exec,
+                                         size_t numWorkers,
+                                         ProgressMeter* progress,
+                                         unsigned long long* numScanned);
+
     std::vector<IndexToBuild> _indexes;
 
     std::unique_ptr<BackgroundOperation> _backgroundOperation;
@@ -90,6 +90,21 @@ public:
      */
     static void destroy();
 
+    /**
+     * Detaches the Client stored in TLS for the current thread and returns it, so that it can be
+     * attached to another thread with setCurrent(). The current thread must have a Client.
+     *
+     * Used by servers which run each connection on whichever pooled thread is free when it sends
+     * its next request.
+     */
+    static ServiceContext::UniqueClient releaseCurrent();
+
+    /**
+     * Attaches 'client' to the current thread, which must not already have a Client, and names the
+     * thread after it.
+     */
+    static void setCurrent(ServiceContext::UniqueClient client);
+
     std::string clientAddress(bool includePort = false) const;
     const std::string& desc() const {
         return _desc;
@@ -166,7 +181,8 @@ private:
     const std::string _desc;
 
     // OS id of the thread, which owns this client
-    const stdx::thread::id _threadId;
+    // The thread the Client is attached to. Protected by the Client's lock.
+    stdx::thread::id _threadId;
 
     // > 0 for things "conn", 0 otherwise
     const ConnectionId _connectionId;
@@ -112,6 +112,36 @@ BSONObj fixindex(const string& newDbName, BSONObj o) {
     return res;
 }
 
+namespace {
+
+/**
+ * The locks under which cloned documents are inserted: the global lock, or with
+ * CloneOptions::collectionLocksOnly an intent lock on the database and an exclusive lock on the
+ * collection.
+ */
+class CloneInsertLocks {
+    MONGO_DISALLOW_COPYING(CloneInsertLocks);
+
+public:
+    CloneInsertLocks(OperationContext* txn, const NamespaceString& nss, bool collectionLocksOnly)
+        : _scopedXact(txn, collectionLocksOnly ? MODE_IX : MODE_X) {
+        if (collectionLocksOnly) {
+            _dbLock.emplace(txn->lockState(), nss.db(), MODE_IX);
+            _collectionLock.emplace(txn->lockState(), nss.ns(), MODE_X);
+        } else {
+            _globalWriteLock.emplace(txn->lockState());
+        }
+    }
+
+private:
+    ScopedTransaction _scopedXact;
+    boost::optional<Lock::GlobalWrite> _globalWriteLock;
+    boost::optional<Lock::DBLock> _dbLock;
+    boost::optional<Lock::CollectionLock> _collectionLock;
+};
+
+}  // namespace
+
 Cloner::Cloner() {}
 
 struct Cloner::Fun {
@@ -121,8 +151,8 @@ struct Cloner::Fun {
         invariant(from_collection.coll() != "system.indexes");
 
         // XXX: can probably take dblock instead
-        unique_ptr<ScopedTransaction> scopedXact(new ScopedTransaction(txn, MODE_X));
-        unique_ptr<Lock::GlobalWrite> globalWriteLock(new Lock::GlobalWrite(txn->lockState()));
+        unique_ptr<CloneInsertLocks> locks(
+            new CloneInsertLocks(txn, to_collection, _opts.collectionLocksOnly));
         uassert(ErrorCodes::NotMaster,
                 str::stream() << "Not primary while cloning collection " << from_collection.ns()
                               << " to "
@@ -131,12 +161,23 @@ struct Cloner::Fun {
                     repl::getGlobalReplicationCoordinator()->canAcceptWritesFor(to_collection));
 
         // Make sure database still exists after we resume from the temp release
-        Database* db = dbHolder().openDb(txn, _dbName);
+        Database* db = nullptr;
+        if (_opts.collectionLocksOnly) {
+            db = dbHolder().get(txn, _dbName);
+            uassert(40151,
+                    str::stream() << "Database " << _dbName << " dropped while cloning",
+                    db != NULL);
+        } else {
+            db = dbHolder().openDb(txn, _dbName);
+        }
 
         bool createdCollection = false;
         Collection* collection = NULL;
 
         collection = db->getCollection(to_collection);
+        uassert(40152,
+                str::stream() << "Collection " << to_collection.ns() << " dropped while cloning",
+                collection || !_opts.collectionLocksOnly);
         if (!collection) {
             massert(17321,
                     str::stream() << "collection dropped during clone [" << to_collection.ns()
@@ -165,13 +206,11 @@ struct Cloner::Fun {
                 }
                 txn->checkForInterrupt();
 
-                scopedXact.reset();
-                globalWriteLock.reset();
+                locks.reset();
 
                 CurOp::get(txn)->yielded();
 
-                scopedXact.reset(new ScopedTransaction(txn, MODE_X));
-                globalWriteLock.reset(new Lock::GlobalWrite(txn->lockState()));
+                locks.reset(new CloneInsertLocks(txn, to_collection, _opts.collectionLocksOnly));
 
                 // Check if everything is still all right.
                 if (txn->writesAreReplicated()) {
@@ -233,6 +272,10 @@ struct Cloner::Fun {
                 saveLast = time(0);
             }
         }
+
+        if (_opts.onDocumentsCopied) {
+            _opts.onDocumentsCopied(numSeen);
+        }
     }
 
     time_t lastLog;
@@ -294,7 +337,8 @@ void Cloner::copyIndexes(OperationContext* txn,
                          const BSONObj& from_opts,
                          const NamespaceString& to_collection,
                          bool masterSameProcess,
-                         bool slaveOk) {
+                         bool slaveOk,
+                         bool collectionLocksOnly) {
     LOG(2) << "\t\t copyIndexes " << from_collection << " to " << to_collection << " on "
            << _conn->getServerAddress();
 
@@ -324,9 +368,23 @@ void Cloner::copyIndexes(OperationContext* txn,
 
     // We are under lock here again, so reload the database in case it may have disappeared
     // during the temp release
-    Database* db = dbHolder().openDb(txn, toDBName);
+    Database* db = nullptr;
+    if (collectionLocksOnly) {
+        // MMAPv1 writes the new indexes to the database's namespace file.
+        invariant(supportsDocLocking());
+        db = dbHolder().get(txn, toDBName);
+        uassert(40153,
+                str::stream() << "database " << toDBName << " dropped while copying indexes",
+                db);
+    } else {
+        db = dbHolder().openDb(txn, toDBName);
+    }
 
     Collection* collection = db->getCollection(to_collection);
+    uassert(40154,
+            str::stream() << "collection " << to_collection.ns()
+                          << " dropped while copying indexes",
+            collection || !collectionLocksOnly);
     if (!collection) {
         MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
             txn->checkForInterrupt();
@@ -673,7 +731,8 @@ Status Cloner::copyDb(OperationContext* txn,
                         collection.getObjectField("options"),
                         to_name,
                         masterSameProcess,
-                        opts.slaveOk);
+                        opts.slaveOk,
+                        opts.collectionLocksOnly);
         }
     }
 
@@ -36,6 +36,7 @@
 #include "mongo/base/disallow_copying.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/s/catalog/catalog_manager.h"
+#include "mongo/stdx/functional.h"
 
 namespace mongo {
 
@@ -103,7 +104,8 @@ private:
                      const BSONObj& from_opts,
                      const NamespaceString& to_ns,
                      bool masterSameProcess,
-                     bool slaveOk);
+                     bool slaveOk,
+                     bool collectionLocksOnly = false);
 
     struct Fun;
     std::unique_ptr<DBClientBase> _conn;
@@ -121,6 +123,13 @@ private:
  *                if it has so that we don't block the mongos that initiated the command.
  *  createCollections - When 'true', will fetch a list of collections from the remote and create
  *                them.  When 'false', assumes collections have already been created ahead of time.
+ *  collectionLocksOnly - When 'true', documents and indexes are written holding an intent lock on
+ *                the database and an exclusive lock on the collection instead of the global lock,
+ *                so that several collections can be cloned at once. The caller must hold the same
+ *                locks, and the database and collections must already exist. Indexes may only be
+ *                copied this way on storage engines which support document-level locking.
+ *  onDocumentsCopied - If set, called after each batch of documents is inserted with the number
+ *                of documents copied into the collection so far.
  */
 struct CloneOptions {
     std::string fromDB;
@@ -134,6 +143,9 @@ struct CloneOptions {
     bool syncIndexes = true;
     bool checkForCatalogChange = false;
     bool createCollections = true;
+    bool collectionLocksOnly = false;
+
+    stdx::function<void(long long)> onDocumentsCopied;
 };
 
 }  // namespace mongo
@@ -50,6 +50,7 @@
 #include "mongo/util/log.h"
 #include "mongo/util/net/hostname_canonicalization_worker.h"
 #include "mongo/util/net/listen.h"
+#include "mongo/util/net/message_compressor_registry.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
@@ -286,11 +287,30 @@ public:
     BSONObj generateSection(OperationContext* txn, const BSONElement& configElement) const {
         BSONObjBuilder b;
         networkCounter.append(b);
+        {
+            BSONObjBuilder compression(b.subobjStart("compression"));
+            MessageCompressorRegistry::get().appendStats(&compression);
+        }
         return b.obj();
     }
 
 } network;
 
+class ServiceExecutor : public ServerStatusSection {
+public:
+    ServiceExecutor() : ServerStatusSection("serviceExecutor") {}
+    virtual bool includeByDefault() const {
+        return true;
+    }
+
+    BSONObj generateSection(OperationContext* txn, const BSONElement& configElement) const {
+        BSONObjBuilder b;
+        serviceExecutorCounter.append(b);
+        return b.obj();
+    }
+
+} serviceExecutor;
+
 #ifdef MONGO_CONFIG_SSL
 class Security : public ServerStatusSection {
 public:
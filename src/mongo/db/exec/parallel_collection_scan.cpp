@@ -0,0 +1,367 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/exec/parallel_collection_scan.h"
+
+#include <algorithm>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/record_fetcher.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
+
+namespace mongo {
+
+using std::unique_ptr;
+using stdx::make_unique;
+
+// static
+const char* ParallelCollectionScan::kStageType = "PARALLEL_COLLSCAN";
+const size_t ParallelCollectionScan::kRecordsPerChunk = 256;
+const size_t ParallelCollectionScan::kMaxBufferedBytes = 16 * 1024 * 1024;
+
+namespace {
+
+/**
+ * Returns the thread pool shared by all parallel collection scans. The pool is intentionally
+ * leaked, so that it is never destroyed while a query is still using it during shutdown.
+ */
+ThreadPool* getFilterThreadPool() {
+    static ThreadPool* pool = [] {
+        ThreadPool::Options options;
+        options.poolName = "ParallelCollectionScan";
+        options.minThreads = 0;
+        options.maxThreads = 64;
+        auto newPool = new ThreadPool(options);
+        newPool->startup();
+        return newPool;
+    }();
+    return pool;
+}
+
+}  // namespace
+
+ParallelCollectionScan::ParallelCollectionScan(OperationContext* txn,
+                                               const CollectionScanParams& params,
+                                               WorkingSet* workingSet,
+                                               const MatchExpression* filter,
+                                               size_t numThreads)
+    : PlanStage(kStageType, txn),
+      _workingSet(workingSet),
+      _filter(filter),
+      _params(params),
+      _numThreads(std::max(numThreads, size_t(1))),
+      _isDead(false),
+      _cursorExhausted(false),
+      _bufferedBytes(0),
+      _wsidForFetch(_workingSet->allocate()) {
+    invariant(_filter);
+    invariant(!_params.tailable);
+    invariant(_params.maxScan == 0);
+    invariant(_params.start.isNull());
+
+    // Explain reports the direction of the collection scan and the number of threads used.
+    _specificStats.direction = params.direction;
+    _specificStats.threads = _numThreads;
+}
+
+PlanStage::StageState ParallelCollectionScan::doWork(WorkingSetID* out) {
+    if (_isDead) {
+        Status status(ErrorCodes::CappedPositionLost,
+                      "ParallelCollectionScan died due to position in capped collection being "
+                      "deleted.");
+        *out = WorkingSetCommon::allocateStatusMember(_workingSet, status);
+        return PlanStage::DEAD;
+    }
+
+    if (!_results.empty()) {
+        return returnNextResult(out);
+    }
+
+    if (!_cursorExhausted) {
+        StageState state = fillBuffer(out);
+        if (PlanStage::NEED_TIME != state) {
+            return state;
+        }
+    }
+
+    if (!_buffer.empty()) {
+        filterBuffer();
+        return PlanStage::NEED_TIME;
+    }
+
+    if (_cursorExhausted) {
+        _commonStats.isEOF = true;
+        return PlanStage::IS_EOF;
+    }
+
+    return PlanStage::NEED_TIME;
+}
+
+PlanStage::StageState ParallelCollectionScan::fillBuffer(WorkingSetID* out) {
+    const size_t maxRecords = _numThreads * kRecordsPerChunk;
+
+    const bool needToMakeCursor = !_cursor;
+    try {
+        if (needToMakeCursor) {
+            const bool forward = _params.direction == CollectionScanParams::FORWARD;
+            _cursor = _params.collection->getCursor(getOpCtx(), forward);
+        }
+
+        while (_buffer.size() < maxRecords && _bufferedBytes < kMaxBufferedBytes) {
+            // See if the record we're about to access is in memory. If not, pass a fetch request
+            // up.
+            if (auto fetcher = _cursor->fetcherForNext()) {
+                WorkingSetMember* member = _workingSet->get(_wsidForFetch);
+                member->setFetcher(fetcher.release());
+                *out = _wsidForFetch;
+                return PlanStage::NEED_YIELD;
+            }
+
+            boost::optional<Record> record = _cursor->next();
+            if (!record) {
+                _cursorExhausted = true;
+                break;
+            }
+
+            // The document must outlive the cursor's current position, since it is filtered and
+            // returned after the cursor has moved on and possibly yielded.
+            BSONObj obj = record->data.releaseToBson().getOwned();
+            _bufferedBytes += obj.objsize();
+            _buffer.push_back(
+                {record->id, {getOpCtx()->recoveryUnit()->getSnapshotId(), std::move(obj)}, false});
+        }
+    } catch (const WriteConflictException& wce) {
+        // Leave us in a state to try again next time.
+        if (needToMakeCursor)
+            _cursor.reset();
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_YIELD;
+    }
+
+    return PlanStage::NEED_TIME;
+}
+
+void ParallelCollectionScan::filterBuffer() {
+    const size_t numRecords = _buffer.size();
+    const size_t chunkSize = (numRecords + _numThreads - 1) / _numThreads;
+
+    // Each chunk only writes to its own range of 'matched', so no synchronization is needed
+    // other than waiting for all of the chunks to finish.
+    std::vector<char> matched(numRecords, 0);
+    auto filterChunk = [this, &matched](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            matched[i] = _filter->matchesBSON(_buffer[i].obj.value());
+        }
+    };
+
+    stdx::mutex mutex;
+    stdx::condition_variable chunkDone;
+    size_t chunksRemaining = 0;
+    Status firstError = Status::OK();
+
+    ThreadPool* pool = getFilterThreadPool();
+    for (size_t begin = chunkSize; begin < numRecords; begin += chunkSize) {
+        const size_t end = std::min(begin + chunkSize, numRecords);
+        {
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            ++chunksRemaining;
+        }
+
+        Status scheduled = pool->schedule([&, begin, end] {
+            Status status = Status::OK();
+            try {
+                filterChunk(begin, end);
+            } catch (...) {
+                status = exceptionToStatus();
+            }
+
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            if (!status.isOK() && firstError.isOK()) {
+                firstError = status;
+            }
+            if (--chunksRemaining == 0) {
+                chunkDone.notify_one();
+            }
+        });
+
+        if (!scheduled.isOK()) {
+            // The pool is shutting down, so filter the chunk on this thread instead.
+            {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                --chunksRemaining;
+            }
+            filterChunk(begin, end);
+        }
+    }
+
+    // This thread filters the first chunk itself. The other chunks reference local state, so we
+    // must wait for them to finish even if filtering the first chunk fails.
+    Status ownChunkStatus = Status::OK();
+    try {
+        filterChunk(0, std::min(chunkSize, numRecords));
+    } catch (...) {
+        ownChunkStatus = exceptionToStatus();
+    }
+
+    {
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        chunkDone.wait(lk, [&] { return chunksRemaining == 0; });
+    }
+
+    uassertStatusOK(ownChunkStatus);
+    uassertStatusOK(firstError);
+
+    _specificStats.docsTested += numRecords;
+    for (size_t i = 0; i < numRecords; ++i) {
+        if (matched[i]) {
+            _results.push_back(std::move(_buffer[i]));
+        }
+    }
+    _buffer.clear();
+    _bufferedBytes = 0;
+}
+
+PlanStage::StageState ParallelCollectionScan::returnNextResult(WorkingSetID* out) {
+    BufferedRecord result = std::move(_results.front());
+    _results.pop_front();
+
+    if (result.needsFetch) {
+        // The record was modified after it passed the filter, so it must be fetched and filtered
+        // again. If it has since been deleted, it is simply not returned.
+        try {
+            if (!_params.collection->findDoc(getOpCtx(), result.id, &result.obj)) {
+                return PlanStage::NEED_TIME;
+            }
+        } catch (const WriteConflictException& wce) {
+            // Try the fetch again after yielding.
+            _results.push_front(std::move(result));
+            *out = WorkingSet::INVALID_ID;
+            return PlanStage::NEED_YIELD;
+        }
+
+        ++_specificStats.docsTested;
+        if (!_filter->matchesBSON(result.obj.value())) {
+            return PlanStage::NEED_TIME;
+        }
+    }
+
+    WorkingSetID id = _workingSet->allocate();
+    WorkingSetMember* member = _workingSet->get(id);
+    member->recordId = result.id;
+    member->obj = std::move(result.obj);
+    _workingSet->transitionToRecordIdAndObj(id);
+
+    *out = id;
+    return PlanStage::ADVANCED;
+}
+
+bool ParallelCollectionScan::isEOF() {
+    return _commonStats.isEOF || _isDead;
+}
+
+void ParallelCollectionScan::doInvalidate(OperationContext* txn,
+                                          const RecordId& id,
+                                          InvalidationType type) {
+    // Deletions can harm the underlying RecordCursor so we must pass them down.
+    if (INVALIDATION_DELETION == type && _cursor) {
+        _cursor->invalidate(txn, id);
+    }
+
+    // Buffered records hold a copy of the document, so a deleted record must be dropped and a
+    // mutated record must be fetched again before it is returned.
+    auto invalidateRecord = [&](BufferedRecord& record) {
+        if (record.id == id) {
+            record.needsFetch = true;
+        }
+    };
+    auto isInvalidated = [&](const BufferedRecord& record) { return record.id == id; };
+
+    if (INVALIDATION_DELETION == type) {
+        _buffer.erase(std::remove_if(_buffer.begin(), _buffer.end(), isInvalidated),
+                      _buffer.end());
+        _results.erase(std::remove_if(_results.begin(), _results.end(), isInvalidated),
+                       _results.end());
+    } else {
+        std::for_each(_buffer.begin(), _buffer.end(), invalidateRecord);
+        std::for_each(_results.begin(), _results.end(), invalidateRecord);
+    }
+}
+
+void ParallelCollectionScan::doSaveState() {
+    if (_cursor) {
+        _cursor->save();
+    }
+}
+
+void ParallelCollectionScan::doRestoreState() {
+    if (_cursor) {
+        if (!_cursor->restore()) {
+            _isDead = true;
+        }
+    }
+}
+
+void ParallelCollectionScan::doDetachFromOperationContext() {
+    if (_cursor)
+        _cursor->detachFromOperationContext();
+}
+
+void ParallelCollectionScan::doReattachToOperationContext() {
+    if (_cursor)
+        _cursor->reattachToOperationContext(getOpCtx());
+}
+
+unique_ptr<PlanStageStats> ParallelCollectionScan::getStats() {
+    // Add a BSON representation of the filter to the stats tree.
+    if (NULL != _filter) {
+        BSONObjBuilder bob;
+        _filter->serialize(&bob);
+        _commonStats.filter = bob.obj();
+    }
+
+    unique_ptr<PlanStageStats> ret =
+        make_unique<PlanStageStats>(_commonStats, STAGE_PARALLEL_COLLSCAN);
+    ret->specific = make_unique<ParallelCollectionScanStats>(_specificStats);
+    return ret;
+}
+
+const SpecificStats* ParallelCollectionScan::getSpecificStats() const {
+    return &_specificStats;
+}
+
+}  // namespace mongo
@@ -0,0 +1,155 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "mongo/db/exec/collection_scan_common.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/record_id.h"
+#include "mongo/db/storage/snapshot.h"
+
+namespace mongo {
+
+class SeekableRecordCursor;
+class WorkingSet;
+class OperationContext;
+
+/**
+ * Scans over a whole collection like CollectionScan, but evaluates the filter on several threads.
+ *
+ * Records are read from the storage engine on the thread running the query, since record cursors
+ * are tied to its recovery unit. They are copied into a buffer of up to 'numThreads' chunks, the
+ * chunks are filtered concurrently on a shared thread pool (the calling thread takes one chunk
+ * itself), and the matching documents are then returned in the order in which they were read.
+ *
+ * The filter must be safe to evaluate concurrently, so it may not contain $where or use a
+ * collator. Tailable scans, 'maxScan' and a start RecordId are not supported.
+ */
+class ParallelCollectionScan final : public PlanStage {
+public:
+    ParallelCollectionScan(OperationContext* txn,
+                           const CollectionScanParams& params,
+                           WorkingSet* workingSet,
+                           const MatchExpression* filter,
+                           size_t numThreads);
+
+    StageState doWork(WorkingSetID* out) final;
+    bool isEOF() final;
+
+    void doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) final;
+    void doSaveState() final;
+    void doRestoreState() final;
+    void doDetachFromOperationContext() final;
+    void doReattachToOperationContext() final;
+
+    StageType stageType() const final {
+        return STAGE_PARALLEL_COLLSCAN;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final;
+
+    const SpecificStats* getSpecificStats() const final;
+
+    static const char* kStageType;
+
+    // The number of records read for each thread before the buffer is filtered.
+    static const size_t kRecordsPerChunk;
+
+    // Stop filling the buffer early once the records in it reach this many bytes.
+    static const size_t kMaxBufferedBytes;
+
+private:
+    /**
+     * A record read from the collection. 'obj' is owned, so it remains valid across yields.
+     */
+    struct BufferedRecord {
+        RecordId id;
+        Snapshotted<BSONObj> obj;
+
+        // Set if the record was modified after it was read, in which case it must be fetched and
+        // filtered again before being returned.
+        bool needsFetch;
+    };
+
+    /**
+     * Reads records from the cursor into '_buffer' until it is full or the cursor is exhausted.
+     * Returns NEED_YIELD, with '*out' set appropriately, if the storage engine asked us to yield;
+     * the records read so far are kept and filling resumes on the next call.
+     */
+    StageState fillBuffer(WorkingSetID* out);
+
+    /**
+     * Filters the records in '_buffer', using the thread pool, and moves the matching records to
+     * '_results'.
+     */
+    void filterBuffer();
+
+    /**
+     * Returns the first record in '_results', fetching and filtering it again if it was modified
+     * since it was read.
+     */
+    StageState returnNextResult(WorkingSetID* out);
+
+    // WorkingSet is not owned by us.
+    WorkingSet* _workingSet;
+
+    // The filter is not owned by us.
+    const MatchExpression* _filter;
+
+    std::unique_ptr<SeekableRecordCursor> _cursor;
+
+    CollectionScanParams _params;
+
+    const size_t _numThreads;
+
+    bool _isDead;
+
+    bool _cursorExhausted;
+
+    // Records read from the cursor but not yet filtered, and the total size of their documents.
+    std::vector<BufferedRecord> _buffer;
+    size_t _bufferedBytes;
+
+    // Records which passed the filter, in the order they were read.
+    std::deque<BufferedRecord> _results;
+
+    // We allocate a working set member with this id on construction of the stage. It gets used for
+    // all fetch requests. This should only be used for passing up the Fetcher for a NEED_YIELD, and
+    // should remain in the INVALID state.
+    const WorkingSetID _wsidForFetch;
+
+    // Stats
+    ParallelCollectionScanStats _specificStats;
+};
+
+}  // namespace mongo
@@ -208,6 +208,25 @@ struct CollectionScanStats : public SpecificStats {
     int direction;
 };
 
+struct ParallelCollectionScanStats : public SpecificStats {
+    ParallelCollectionScanStats() : docsTested(0), direction(1), threads(1) {}
+
+    SpecificStats* clone() const final {
+        ParallelCollectionScanStats* specific = new ParallelCollectionScanStats(*this);
+        return specific;
+    }
+
+    // How many documents did we check against our filter?
+    size_t docsTested;
+
+    // >0 if we're traversing the collection forwards. <0 if we're traversing it
+    // backwards.
+    int direction;
+
+    // How many threads the filter is evaluated on.
+    size_t threads;
+};
+
 struct CountStats : public SpecificStats {
     CountStats() : nCounted(0), nSkipped(0), recordStoreCount(false) {}
 
@@ -58,6 +58,11 @@ SortStage::WorkingSetComparator::WorkingSetComparator(BSONObj p) : pattern(p) {}
 
 bool SortStage::WorkingSetComparator::operator()(const SortableDataItem& lhs,
                                                  const SortableDataItem& rhs) const {
+    if (!lhs.keyString.empty() && !rhs.keyString.empty()) {
+        // The KeyStrings already end with the RecordId.
+        return lhs.keyString < rhs.keyString;
+    }
+
     // False means ignore field names.
     int result = lhs.sortKey.woCompare(rhs.sortKey, pattern, false);
     if (0 != result) {
@@ -77,6 +82,7 @@ SortStage::SortStage(OperationContext* opCtx,
       _pattern(params.pattern),
       _limit(params.limit),
       _sorted(false),
+      _keyStringBuilder(KeyString::Version::V1),
       _resultIterator(_data.end()),
       _memUsage(0) {
     _children.emplace_back(child);
@@ -84,11 +90,9 @@ SortStage::SortStage(OperationContext* opCtx,
     BSONObj sortComparator = FindCommon::transformSortSpec(_pattern);
     _sortKeyComparator = stdx::make_unique<WorkingSetComparator>(sortComparator);
 
-    // If limit > 1, we need to initialize _dataSet here to maintain ordered set of data items while
-    // fetching from the child stage.
-    if (_limit > 1) {
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        _dataSet.reset(new SortableDataItemSet(cmp));
+    // An Ordering holds one bit per field.
+    if (sortComparator.nFields() <= 32) {
+        _keyStringOrdering = Ordering::make(sortComparator);
     }
 }
 
@@ -148,6 +152,7 @@ PlanStage::StageState SortStage::doWork(WorkingSetID* out) {
                 item.recordId = member->recordId;
             }
 
+            encodeSortKey(&item);
             addToBuffer(item);
 
             return PlanStage::NEED_TIME;
@@ -235,6 +240,32 @@ const SpecificStats* SortStage::getSpecificStats() const {
     return &_specificStats;
 }
 
+void SortStage::encodeSortKey(SortableDataItem* item) {
+    // Beyond this size the type bits of a KeyString may not fit in its fixed-size buffer. Such keys
+    // are compared as BSON instead.
+    if (!_keyStringOrdering ||
+        item->sortKey.objsize() > static_cast<int>(KeyString::TypeBits::kMaxKeyBytes)) {
+        return;
+    }
+
+    // KeyString encoding requires the empty field names of index keys, but keys which include the
+    // text score name that field.
+    BSONObj sortKey = item->sortKey;
+    for (auto&& elem : sortKey) {
+        if (*elem.fieldName()) {
+            BSONObjBuilder unnamed;
+            for (auto&& keyElem : item->sortKey) {
+                unnamed.appendAs(keyElem, "");
+            }
+            sortKey = unnamed.obj();
+            break;
+        }
+    }
+
+    _keyStringBuilder.resetToKey(sortKey, *_keyStringOrdering, item->recordId);
+    item->keyString.assign(_keyStringBuilder.getBuffer(), _keyStringBuilder.getSize());
+}
+
 /**
  * addToBuffer() and sortBuffer() work differently based on the
  * configured limit. addToBuffer() is also responsible for
@@ -250,26 +281,27 @@ const SpecificStats* SortStage::getSpecificStats() const {
  *                     Updates memory usage if item was replaced.
  *     sortBuffer() - Does nothing.
  * limit > 1:
- *     addToBuffer() - Does not update vector. Adds item to set.
- *                     If size of set exceeds limit, remove item from set
- *                     with lowest key. Updates memory usage accordingly.
- *     sortBuffer() - Copies items from set to vectors.
+ *     addToBuffer() - Adds item to the max-heap in the vector.
+ *                     If size of heap exceeds limit, remove item from heap
+ *                     with highest key. Updates memory usage accordingly.
+ *     sortBuffer() - Sorts the heap in place.
  */
 void SortStage::addToBuffer(const SortableDataItem& item) {
     // Holds ID of working set member to be freed at end of this function.
     WorkingSetID wsidToFree = WorkingSet::INVALID_ID;
 
     WorkingSetMember* member = _ws->get(item.wsid);
+    const size_t itemMemUsage = member->getMemUsage() + item.keyString.size();
     if (_limit == 0) {
         // Ensure that the BSONObj underlying the WorkingSetMember is owned in case we yield.
         member->makeObjOwnedIfNeeded();
         _data.push_back(item);
-        _memUsage += member->getMemUsage();
+        _memUsage += itemMemUsage;
     } else if (_limit == 1) {
         if (_data.empty()) {
             member->makeObjOwnedIfNeeded();
             _data.push_back(item);
-            _memUsage = member->getMemUsage();
+            _memUsage = itemMemUsage;
             return;
         }
         wsidToFree = item.wsid;
@@ -279,36 +311,33 @@ void SortStage::addToBuffer(const SortableDataItem& item) {
             wsidToFree = _data[0].wsid;
             member->makeObjOwnedIfNeeded();
             _data[0] = item;
-            _memUsage = member->getMemUsage();
+            _memUsage = itemMemUsage;
         }
     } else {
-        // Update data item set instead of vector
+        const WorkingSetComparator& cmp = *_sortKeyComparator;
+
         // Limit not reached - insert and return
-        vector<SortableDataItem>::size_type limit(_limit);
-        if (_dataSet->size() < limit) {
+        if (_data.size() < _limit) {
             member->makeObjOwnedIfNeeded();
-            _dataSet->insert(item);
-            _memUsage += member->getMemUsage();
+            _data.push_back(item);
+            std::push_heap(_data.begin(), _data.end(), cmp);
+            _memUsage += itemMemUsage;
             return;
         }
-        // Limit will be exceeded - compare with item with lowest key
-        // If new item does not have a lower key value than last item,
-        // do nothing.
+
+        // Limit will be exceeded - compare with the item with the highest key, at the front of the
+        // heap. If new item does not have a lower key value, do nothing.
         wsidToFree = item.wsid;
-        SortableDataItemSet::const_iterator lastItemIt = --(_dataSet->end());
-        const SortableDataItem& lastItem = *lastItemIt;
-        const WorkingSetComparator& cmp = *_sortKeyComparator;
-        if (cmp(item, lastItem)) {
-            _memUsage -= _ws->get(lastItem.wsid)->getMemUsage();
-            _memUsage += member->getMemUsage();
+        if (cmp(item, _data.front())) {
+            // Move the highest item to the back, where the new item replaces it.
+            std::pop_heap(_data.begin(), _data.end(), cmp);
+            SortableDataItem& lastItem = _data.back();
+            _memUsage -= _ws->get(lastItem.wsid)->getMemUsage() + lastItem.keyString.size();
+            _memUsage += itemMemUsage;
             wsidToFree = lastItem.wsid;
-            // According to std::set iterator validity rules,
-            // it does not matter which of erase()/insert() happens first.
-            // Here, we choose to erase first to release potential resources
-            // used by the last item and to keep the scope of the iterator to a minimum.
-            _dataSet->erase(lastItemIt);
             member->makeObjOwnedIfNeeded();
-            _dataSet->insert(item);
+            lastItem = item;
+            std::push_heap(_data.begin(), _data.end(), cmp);
         }
     }
 
@@ -331,12 +360,8 @@ void SortStage::sortBuffer() {
         // Buffer contains either 0 or 1 item so it is already in a sorted state.
         return;
     } else {
-        // Set already contains items in sorted order, so we simply copy the items
-        // from the set to the vector.
-        // Release the memory for the set after the copy.
-        vector<SortableDataItem> newData(_dataSet->begin(), _dataSet->end());
-        _data.swap(newData);
-        _dataSet.reset();
+        const WorkingSetComparator& cmp = *_sortKeyComparator;
+        std::sort_heap(_data.begin(), _data.end(), cmp);
     }
 }
 
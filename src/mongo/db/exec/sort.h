@@ -28,7 +28,8 @@
 
 #pragma once
 
-#include <set>
+#include <boost/optional.hpp>
+#include <string>
 #include <vector>
 
 #include "mongo/db/exec/plan_stage.h"
@@ -37,6 +38,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/index_bounds.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/platform/unordered_map.h"
 
 namespace mongo {
@@ -122,11 +124,15 @@ private:
         // RecordId to break sortKey ties.
         // See sorta.js.
         RecordId recordId;
+        // (sortKey, recordId) encoded as a KeyString in the order given by the sort pattern, so
+        // that two items can be compared with memcmp(). Empty if the key could not be encoded.
+        std::string keyString;
     };
 
-    // Comparison object for data buffers (vector and set). Items are compared on (sortKey, loc).
-    // This is also how the items are ordered in the indices. Keys are compared using
-    // BSONObj::woCompare() with RecordId as a tie-breaker.
+    // Comparison object for the data buffer. Items are compared on (sortKey, loc). This is also
+    // how the items are ordered in the indices. Items are compared by their KeyStrings when both
+    // have one, and otherwise keys are compared using BSONObj::woCompare() with RecordId as a
+    // tie-breaker. KeyStrings are ordered the same way, so the two comparisons may be mixed.
     //
     // We are comparing keys generated by the SortKeyGenerator, which are already ordered with
     // respect the collation. Therefore, we explicitly avoid comparing using a collator here.
@@ -139,16 +145,19 @@ private:
     };
 
     /**
-     * Inserts one item into data buffer (vector or set).
-     * If limit is exceeded, remove item with lowest key.
+     * Fills in 'item->keyString' from its sort key and RecordId, if the key can be encoded.
+     */
+    void encodeSortKey(SortableDataItem* item);
+
+    /**
+     * Inserts one item into data buffer.
+     * If limit is exceeded, remove item with highest key.
      */
     void addToBuffer(const SortableDataItem& item);
 
     /**
      * Sorts data buffer.
      * Assumes no more items will be added to buffer.
-     * If data is stored in set, copy set
-     * contents to vector and clear set.
      */
     void sortBuffer();
 
@@ -156,16 +165,21 @@ private:
     // Initialization follows sort key generator
     std::unique_ptr<WorkingSetComparator> _sortKeyComparator;
 
+    // The ordering used to encode sort keys as KeyStrings. Not set if the sort pattern has too many
+    // fields to be described by an Ordering, in which case no keys are encoded.
+    boost::optional<Ordering> _keyStringOrdering;
+
+    // Reused to encode each sort key, to avoid allocating a buffer per key.
+    KeyString _keyStringBuilder;
+
     // The data we buffer and sort.
     // _data will contain sorted data when all data is gathered
     // and sorted.
-    // When _limit is greater than 1 and not all data has been gathered from child stage,
-    // _dataSet is used instead to maintain an ordered set of the incomplete data set.
-    // When the data set is complete, we copy the items from _dataSet to _data which will
-    // be used to provide the results of this stage through _resultIterator.
+    // When _limit is greater than 1 and not all data has been gathered from child stage, _data is
+    // kept as a max-heap of at most _limit items, so that the item with the highest key, which is
+    // the one to drop when a lower one arrives, is always at the front. Only the working set
+    // members of those _limit items are kept alive.
     std::vector<SortableDataItem> _data;
-    typedef std::set<SortableDataItem, WorkingSetComparator> SortableDataItemSet;
-    std::unique_ptr<SortableDataItemSet> _dataSet;
 
     // Iterates through _data post-sort returning it.
     std::vector<SortableDataItem>::iterator _resultIterator;
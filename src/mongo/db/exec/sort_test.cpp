@@ -300,6 +300,66 @@ TEST_F(SortStageTest, SortDescendingWithLimitOfOne) {
         "{a: -1}", nullptr, "{}", 1, "{input: [{a: 2}, {a: 1}, {a: 3}]}", "{output: [{a: 3}]}");
 }
 
+//
+// Sorting on compound keys
+// Keys are compared by their KeyString encodings, which must order values of mixed types and
+// directions the same way as BSONObj::woCompare().
+//
+
+TEST_F(SortStageTest, SortCompoundMixedDirections) {
+    testWork("{a: 1, b: -1}",
+             nullptr,
+             "{}",
+             0,
+             "{input: [{a: 2, b: 'x'}, {a: 1, b: 2}, {a: 2, b: 'y'}, {a: 1.5, b: 1}, "
+             "{a: 1, b: 3}]}",
+             "{output: [{a: 1, b: 3}, {a: 1, b: 2}, {a: 1.5, b: 1}, {a: 2, b: 'y'}, "
+             "{a: 2, b: 'x'}]}");
+}
+
+TEST_F(SortStageTest, SortMixedTypes) {
+    testWork("{a: 1}",
+             nullptr,
+             "{}",
+             0,
+             "{input: [{a: 'b'}, {a: {c: 1}}, {a: 2.5}, {a: null}, {a: 'a'}, {a: -1}, "
+             "{a: {$minKey: 1}}]}",
+             "{output: [{a: {$minKey: 1}}, {a: null}, {a: -1}, {a: 2.5}, {a: 'a'}, {a: 'b'}, "
+             "{a: {c: 1}}]}");
+}
+
+TEST_F(SortStageTest, SortCompoundMixedDirectionsWithLimit) {
+    testWork("{a: -1, b: 1}",
+             nullptr,
+             "{}",
+             3,
+             "{input: [{a: 1, b: 1}, {a: 3, b: 2}, {a: 2, b: 1}, {a: 3, b: 1}, {a: 2, b: 0}]}",
+             "{output: [{a: 3, b: 1}, {a: 3, b: 2}, {a: 2, b: 0}]}");
+}
+
+TEST_F(SortStageTest, SortKeysTooLargeToEncodeWithLimit) {
+    // Keys over the KeyString size limit are compared as BSON, including against encoded keys.
+    const std::string large(2000, 'z');
+    BSONArrayBuilder input;
+    input.append(BSON("a" << ("c" + large)));
+    input.append(BSON("a"
+                      << "d"));
+    input.append(BSON("a" << ("a" + large)));
+    input.append(BSON("a"
+                      << "b"));
+    BSONArrayBuilder output;
+    output.append(BSON("a" << ("a" + large)));
+    output.append(BSON("a"
+                       << "b"));
+    output.append(BSON("a" << ("c" + large)));
+    testWork("{a: 1}",
+             nullptr,
+             "{}",
+             3,
+             BSON("input" << input.arr()).jsonString().c_str(),
+             BSON("output" << output.arr()).jsonString().c_str());
+}
+
 TEST_F(SortStageTest, SortAscendingWithCollation) {
     CollatorInterfaceMock collator(CollatorInterfaceMock::MockType::kReverseString);
     testWork("{a: 1}",
@@ -28,6 +28,7 @@
 
 #include "mongo/db/index/btree_key_generator.h"
 
+#include <algorithm>
 #include <boost/optional.hpp>
 
 #include "mongo/bson/bsonobjbuilder.h"
@@ -35,6 +36,8 @@
 #include "mongo/db/field_ref.h"
 #include "mongo/db/query/collation/collation_index_key.h"
 #include "mongo/db/query/collation/collator_interface.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -52,12 +55,55 @@ const BSONElement nullElt = nullObj.firstElement();
 const BSONObj undefinedObj = BSON("" << BSONUndefined);
 const BSONElement undefinedElt = undefinedObj.firstElement();
 
+// A KeyBuffer which has grown beyond this many bytes releases its memory when cleared, so that one
+// document with very many keys does not pin memory for the life of the thread.
+const int kMaxRetainedKeyBufferBytes = 64 * 1024;
+
 }  // namespace
 
+// Used by the BSONObjSet overload of getKeys(), so that generating keys for a document allocates
+// only the keys themselves.
+TSP_DEFINE(BtreeKeyGenerator::KeyBuffer, threadKeyBuffer);
+
+struct BtreeKeyGenerator::Frame {
+    std::vector<const char*> fieldNames;
+    std::vector<BSONElement> fixed;
+
+    // Scratch space for BtreeKeyGeneratorV1::getKeysImplWithArray().
+    std::vector<size_t> arrIdxs;
+    std::vector<boost::optional<size_t>> arrComponents;
+    std::vector<PositionalPathInfo> subPositionalInfo;
+};
+
+BtreeKeyGenerator::KeyBuffer::KeyBuffer() : _buf(0) {}
+
+BtreeKeyGenerator::KeyBuffer::~KeyBuffer() = default;
+
+void BtreeKeyGenerator::KeyBuffer::clear() {
+    _buf.reset(kMaxRetainedKeyBufferBytes);
+    _offsets.clear();
+}
+
+BtreeKeyGenerator::Frame& BtreeKeyGenerator::frameAt(KeyBuffer* keys, size_t depth) {
+    while (keys->_frames.size() <= depth) {
+        keys->_frames.push_back(stdx::make_unique<Frame>());
+    }
+    return *keys->_frames[depth];
+}
+
+BufBuilder& BtreeKeyGenerator::newKey(KeyBuffer* keys) {
+    keys->_offsets.push_back(keys->_buf.len());
+    return keys->_buf;
+}
+
+void BtreeKeyGenerator::appendKey(KeyBuffer* keys, const BSONObj& key) {
+    newKey(keys).appendBuf(key.objdata(), key.objsize());
+}
+
 BtreeKeyGenerator::BtreeKeyGenerator(std::vector<const char*> fieldNames,
                                      std::vector<BSONElement> fixed,
                                      bool isSparse)
-    : _fieldNames(fieldNames), _isSparse(isSparse), _fixed(fixed) {
+    : _fieldNames(fieldNames), _fixed(fixed), _isSparse(isSparse) {
     BSONObjBuilder nullKeyBuilder;
     for (size_t i = 0; i < fieldNames.size(); ++i) {
         nullKeyBuilder.appendNull("");
@@ -70,11 +116,21 @@ BtreeKeyGenerator::BtreeKeyGenerator(std::vector<const char*> fieldNames,
 void BtreeKeyGenerator::getKeys(const BSONObj& obj,
                                 BSONObjSet* keys,
                                 MultikeyPaths* multikeyPaths) const {
-    // '_fieldNames' and '_fixed' are passed by value so that they can be mutated as part of the
-    // getKeys call.  :|
-    getKeysImpl(_fieldNames, _fixed, obj, keys, multikeyPaths);
+    KeyBuffer* buffer = threadKeyBuffer.getMake();
+    getKeys(obj, buffer, multikeyPaths);
+    for (size_t i = 0; i < buffer->size(); ++i) {
+        keys->insert((*buffer)[i].getOwned());
+    }
+    buffer->clear();
+}
+
+void BtreeKeyGenerator::getKeys(const BSONObj& obj,
+                                KeyBuffer* keys,
+                                MultikeyPaths* multikeyPaths) const {
+    keys->clear();
+    getKeysImpl(obj, keys, multikeyPaths);
     if (keys->empty() && !_isSparse) {
-        keys->insert(_nullKey);
+        appendKey(keys, _nullKey);
     }
 }
 
@@ -89,26 +145,36 @@ BtreeKeyGeneratorV0::BtreeKeyGeneratorV0(std::vector<const char*> fieldNames,
                                          bool isSparse)
     : BtreeKeyGenerator(fieldNames, fixed, isSparse) {}
 
-void BtreeKeyGeneratorV0::getKeysImpl(std::vector<const char*> fieldNames,
-                                      std::vector<BSONElement> fixed,
-                                      const BSONObj& obj,
-                                      BSONObjSet* keys,
+void BtreeKeyGeneratorV0::getKeysImpl(const BSONObj& obj,
+                                      KeyBuffer* keys,
                                       MultikeyPaths* multikeyPaths) const {
     if (_isIdIndex) {
         // we special case for speed
         BSONElement e = obj["_id"];
         if (e.eoo()) {
-            keys->insert(_nullKey);
+            appendKey(keys, _nullKey);
         } else {
             int size = e.size() + 5 /* bson over head*/ - 3 /* remove _id string */;
-            BSONObjBuilder b(size);
+            BSONObjBuilder b(newKey(keys));
             b.appendAs(e, "");
-            keys->insert(b.obj());
-            invariant(keys->begin()->objsize() == size);
+            invariant(b.done().objsize() == size);
         }
         return;
     }
 
+    Frame& frame = frameAt(keys, 0);
+    frame.fieldNames = _fieldNames;
+    frame.fixed = _fixed;
+    getKeysImplAtDepth(0, obj, keys);
+}
+
+void BtreeKeyGeneratorV0::getKeysImplAtDepth(size_t depth,
+                                             const BSONObj& obj,
+                                             KeyBuffer* keys) const {
+    Frame& frame = frameAt(keys, depth);
+    std::vector<const char*>& fieldNames = frame.fieldNames;
+    std::vector<BSONElement>& fixed = frame.fixed;
+
     BSONElement arrElt;
     unsigned arrIdx = ~0;
     unsigned numNotFound = 0;
@@ -163,23 +229,23 @@ void BtreeKeyGeneratorV0::getKeysImpl(std::vector<const char*> fieldNames,
     if (allFound) {
         if (arrElt.eoo()) {
             // no terminal array element to expand
-            BSONObjBuilder b(_sizeTracker);
+            BSONObjBuilder b(newKey(keys));
             for (std::vector<BSONElement>::iterator i = fixed.begin(); i != fixed.end(); ++i)
                 b.appendAs(*i, "");
-            keys->insert(b.obj());
+            b.done();
         } else {
             // terminal array element to expand, so generate all keys
             BSONObjIterator i(arrElt.embeddedObject());
             if (i.more()) {
                 while (i.more()) {
-                    BSONObjBuilder b(_sizeTracker);
+                    BSONObjBuilder b(newKey(keys));
                     for (unsigned j = 0; j < fixed.size(); ++j) {
                         if (j == arrIdx)
                             b.appendAs(i.next(), "");
                         else
                             b.appendAs(fixed[j], "");
                     }
-                    keys->insert(b.obj());
+                    b.done();
                 }
             } else if (fixed.size() > 1) {
                 insertArrayNull = true;
@@ -190,10 +256,13 @@ void BtreeKeyGeneratorV0::getKeysImpl(std::vector<const char*> fieldNames,
         verify(!arrElt.eoo());
         BSONObjIterator i(arrElt.embeddedObject());
         if (i.more()) {
+            Frame& child = frameAt(keys, depth + 1);
             while (i.more()) {
                 BSONElement e = i.next();
                 if (e.type() == Object) {
-                    getKeysImpl(fieldNames, fixed, e.embeddedObject(), keys, multikeyPaths);
+                    child.fieldNames = fieldNames;
+                    child.fixed = fixed;
+                    getKeysImplAtDepth(depth + 1, e.embeddedObject(), keys);
                 }
             }
         } else {
@@ -203,7 +272,7 @@ void BtreeKeyGeneratorV0::getKeysImpl(std::vector<const char*> fieldNames,
 
     if (insertArrayNull) {
         // x : [] - need to insert undefined
-        BSONObjBuilder b(_sizeTracker);
+        BSONObjBuilder b(newKey(keys));
         for (unsigned j = 0; j < fixed.size(); ++j) {
             if (j == arrIdx) {
                 b.appendUndefined("");
@@ -215,7 +284,7 @@ void BtreeKeyGeneratorV0::getKeysImpl(std::vector<const char*> fieldNames,
                     b.appendAs(e, "");
             }
         }
-        keys->insert(b.obj());
+        b.done();
     }
 }
 
@@ -237,7 +306,8 @@ BSONElement BtreeKeyGeneratorV1::extractNextElement(const BSONObj& obj,
                                                     const PositionalPathInfo& positionalInfo,
                                                     const char** field,
                                                     bool* arrayNestedArray) const {
-    std::string firstField = mongoutils::str::before(*field, '.');
+    StringData fieldName(*field);
+    StringData firstField = fieldName.substr(0, fieldName.find('.'));
     bool haveObjField = !obj.getField(firstField).eoo();
     BSONElement arrField = positionalInfo.positionallyIndexedElt;
 
@@ -265,26 +335,28 @@ BSONElement BtreeKeyGeneratorV1::extractNextElement(const BSONObj& obj,
     return BSONElement();
 }
 
-void BtreeKeyGeneratorV1::_getKeysArrEltFixed(std::vector<const char*>* fieldNames,
-                                              std::vector<BSONElement>* fixed,
+void BtreeKeyGeneratorV1::_getKeysArrEltFixed(size_t depth,
                                               const BSONElement& arrEntry,
-                                              BSONObjSet* keys,
+                                              KeyBuffer* keys,
                                               unsigned numNotFound,
                                               const BSONElement& arrObjElt,
-                                              const std::set<size_t>& arrIdxs,
                                               bool mayExpandArrayUnembedded,
                                               const std::vector<PositionalPathInfo>& positionalInfo,
                                               MultikeyPaths* multikeyPaths) const {
+    const Frame& frame = frameAt(keys, depth);
+    Frame& child = frameAt(keys, depth + 1);
+    child.fieldNames = frame.fieldNames;
+    child.fixed = frame.fixed;
+
     // Set up any terminal array values.
-    for (const auto idx : arrIdxs) {
-        if (*(*fieldNames)[idx] == '\0') {
-            (*fixed)[idx] = mayExpandArrayUnembedded ? arrEntry : arrObjElt;
+    for (const auto idx : frame.arrIdxs) {
+        if (*child.fieldNames[idx] == '\0') {
+            child.fixed[idx] = mayExpandArrayUnembedded ? arrEntry : arrObjElt;
         }
     }
 
     // Recurse.
-    getKeysImplWithArray(*fieldNames,
-                         *fixed,
+    getKeysImplWithArray(depth + 1,
                          arrEntry.type() == Object ? arrEntry.embeddedObject() : BSONObj(),
                          keys,
                          numNotFound,
@@ -292,20 +364,18 @@ void BtreeKeyGeneratorV1::_getKeysArrEltFixed(std::vector<const char*>* fieldNam
                          multikeyPaths);
 }
 
-void BtreeKeyGeneratorV1::getKeysImpl(std::vector<const char*> fieldNames,
-                                      std::vector<BSONElement> fixed,
-                                      const BSONObj& obj,
-                                      BSONObjSet* keys,
+void BtreeKeyGeneratorV1::getKeysImpl(const BSONObj& obj,
+                                      KeyBuffer* keys,
                                       MultikeyPaths* multikeyPaths) const {
     if (_isIdIndex) {
         // we special case for speed
         BSONElement e = obj["_id"];
         if (e.eoo()) {
-            keys->insert(_nullKey);
+            appendKey(keys, _nullKey);
         } else {
-            BSONObjBuilder b;
+            BSONObjBuilder b(newKey(keys));
             CollationIndexKey::collationAwareIndexKeyAppend(e, _collator, &b);
-            keys->insert(b.obj());
+            b.done();
         }
 
         // The {_id: 1} index can never be multikey because the _id field isn't allowed to be an
@@ -318,24 +388,32 @@ void BtreeKeyGeneratorV1::getKeysImpl(std::vector<const char*> fieldNames,
 
     if (multikeyPaths) {
         invariant(multikeyPaths->empty());
-        multikeyPaths->resize(fieldNames.size());
+        multikeyPaths->resize(_fieldNames.size());
     }
-    getKeysImplWithArray(fieldNames, fixed, obj, keys, 0, _emptyPositionalInfo, multikeyPaths);
+
+    Frame& frame = frameAt(keys, 0);
+    frame.fieldNames = _fieldNames;
+    frame.fixed = _fixed;
+    getKeysImplWithArray(0, obj, keys, 0, _emptyPositionalInfo, multikeyPaths);
 }
 
 void BtreeKeyGeneratorV1::getKeysImplWithArray(
-    std::vector<const char*> fieldNames,
-    std::vector<BSONElement> fixed,
+    size_t depth,
     const BSONObj& obj,
-    BSONObjSet* keys,
+    KeyBuffer* keys,
     unsigned numNotFound,
     const std::vector<PositionalPathInfo>& positionalInfo,
     MultikeyPaths* multikeyPaths) const {
+    Frame& frame = frameAt(keys, depth);
+    std::vector<const char*>& fieldNames = frame.fieldNames;
+    std::vector<BSONElement>& fixed = frame.fixed;
+
     BSONElement arrElt;
 
-    // A set containing the position of any indexed fields in the key pattern that traverse through
-    // the 'arrElt' array value.
-    std::set<size_t> arrIdxs;
+    // The positions of any indexed fields in the key pattern that traverse through
+    // the 'arrElt' array value, in increasing order.
+    std::vector<size_t>& arrIdxs = frame.arrIdxs;
+    arrIdxs.clear();
 
     // A vector with size equal to the number of elements in the index key pattern. Each element in
     // the vector, if initialized, refers to the component within the indexed field that traverses
@@ -357,7 +435,8 @@ void BtreeKeyGeneratorV1::getKeysImplWithArray(
     // path "a.b" causes the index to be multikey, but the key pattern "a.b.0" only indexes the
     // first element of the array, so we'd have a
     // std::vector<boost::optional<size_t>>{{1U}, boost::none}.
-    std::vector<boost::optional<size_t>> arrComponents(fieldNames.size());
+    std::vector<boost::optional<size_t>>& arrComponents = frame.arrComponents;
+    arrComponents.assign(fieldNames.size(), boost::none);
 
     bool mayExpandArrayUnembedded = true;
     for (size_t i = 0; i < fieldNames.size(); ++i) {
@@ -377,7 +456,7 @@ void BtreeKeyGeneratorV1::getKeysImplWithArray(
             fieldNames[i] = "";
             numNotFound++;
         } else if (e.type() == Array) {
-            arrIdxs.insert(i);
+            arrIdxs.push_back(i);
             if (arrElt.eoo()) {
                 // we only expand arrays on a single path -- track the path here
                 arrElt = e;
@@ -399,20 +478,18 @@ void BtreeKeyGeneratorV1::getKeysImplWithArray(
         if (_isSparse && numNotFound == fieldNames.size()) {
             return;
         }
-        BSONObjBuilder b(_sizeTracker);
+        BSONObjBuilder b(newKey(keys));
         for (std::vector<BSONElement>::iterator i = fixed.begin(); i != fixed.end(); ++i) {
             CollationIndexKey::collationAwareIndexKeyAppend(*i, _collator, &b);
         }
-        keys->insert(b.obj());
+        b.done();
     } else if (arrElt.embeddedObject().firstElement().eoo()) {
         // Empty array, so set matching fields to undefined.
-        _getKeysArrEltFixed(&fieldNames,
-                            &fixed,
+        _getKeysArrEltFixed(depth,
                             undefinedElt,
                             keys,
                             numNotFound,
                             arrElt,
-                            arrIdxs,
                             true,
                             _emptyPositionalInfo,
                             multikeyPaths);
@@ -423,9 +500,11 @@ void BtreeKeyGeneratorV1::getKeysImplWithArray(
         // and then traverse the remainder of the field path up front. This prevents us from
         // having to look up the indexed element again on each recursive call (i.e. once per
         // array element).
-        std::vector<PositionalPathInfo> subPositionalInfo(fixed.size());
+        std::vector<PositionalPathInfo>& subPositionalInfo = frame.subPositionalInfo;
+        subPositionalInfo.assign(fixed.size(), PositionalPathInfo());
         for (size_t i = 0; i < fieldNames.size(); ++i) {
-            const bool fieldIsArray = arrIdxs.find(i) != arrIdxs.end();
+            const bool fieldIsArray =
+                std::find(arrIdxs.begin(), arrIdxs.end(), i) != arrIdxs.end();
 
             if (*fieldNames[i] == '\0') {
                 // We've reached the end of the path.
@@ -489,13 +568,11 @@ void BtreeKeyGeneratorV1::getKeysImplWithArray(
         // Generate a key for each element of the indexed array.
         size_t nArrObjFields = 0;
         for (const auto arrObjElem : arrObj) {
-            _getKeysArrEltFixed(&fieldNames,
-                                &fixed,
+            _getKeysArrEltFixed(depth,
                                 arrObjElem,
                                 keys,
                                 numNotFound,
                                 arrElt,
-                                arrIdxs,
                                 mayExpandArrayUnembedded,
                                 subPositionalInfo,
                                 multikeyPaths);
@@ -28,9 +28,10 @@
 
 #pragma once
 
-#include <set>
+#include <memory>
 #include <vector>
 
+#include "mongo/base/disallow_copying.h"
 #include "mongo/db/index/multikey_paths.h"
 #include "mongo/db/jsobj.h"
 
@@ -44,6 +45,8 @@ class CollatorInterface;
  */
 class BtreeKeyGenerator {
 public:
+    class KeyBuffer;
+
     BtreeKeyGenerator(std::vector<const char*> fieldNames,
                       std::vector<BSONElement> fixed,
                       bool isSparse);
@@ -52,59 +55,16 @@ public:
 
     void getKeys(const BSONObj& obj, BSONObjSet* keys, MultikeyPaths* multikeyPaths) const;
 
-    static const int ParallelArraysCode;
-
-protected:
-    // These are used by the getKeysImpl(s) below.
-    std::vector<const char*> _fieldNames;
-    bool _isIdIndex;
-    bool _isSparse;
-    BSONObj _nullKey;  // a full key with all fields null
-    BSONSizeTracker _sizeTracker;
-
-private:
-    virtual void getKeysImpl(std::vector<const char*> fieldNames,
-                             std::vector<BSONElement> fixed,
-                             const BSONObj& obj,
-                             BSONObjSet* keys,
-                             MultikeyPaths* multikeyPaths) const = 0;
-
-    std::vector<BSONElement> _fixed;
-};
-
-class BtreeKeyGeneratorV0 : public BtreeKeyGenerator {
-public:
-    BtreeKeyGeneratorV0(std::vector<const char*> fieldNames,
-                        std::vector<BSONElement> fixed,
-                        bool isSparse);
-
-    virtual ~BtreeKeyGeneratorV0() {}
-
-private:
     /**
-     * Generates the index keys for the document 'obj' and stores them in the set 'keys'.
-     *
-     * It isn't possible to create a v0 index, so it's unnecessary to track the prefixes of the
-     * indexed fields that cause the index to be mulitkey. This function therefore ignores its
-     * 'multikeyPaths' parameter.
+     * Generates the index keys for the document 'obj' into 'keys', replacing its previous contents.
+     * Unlike the BSONObjSet overload, the keys are left in the order in which they were generated
+     * and are not deduplicated.
      */
-    void getKeysImpl(std::vector<const char*> fieldNames,
-                     std::vector<BSONElement> fixed,
-                     const BSONObj& obj,
-                     BSONObjSet* keys,
-                     MultikeyPaths* multikeyPaths) const final;
-};
-
-class BtreeKeyGeneratorV1 : public BtreeKeyGenerator {
-public:
-    BtreeKeyGeneratorV1(std::vector<const char*> fieldNames,
-                        std::vector<BSONElement> fixed,
-                        bool isSparse,
-                        const CollatorInterface* collator);
+    void getKeys(const BSONObj& obj, KeyBuffer* keys, MultikeyPaths* multikeyPaths) const;
 
-    virtual ~BtreeKeyGeneratorV1() {}
+    static const int ParallelArraysCode;
 
-private:
+protected:
     /**
      * Stores info regarding traversal of a positional path. A path through a document is
      * considered positional if this path element names an array element. Generally this means
@@ -160,12 +120,122 @@ private:
     };
 
     /**
-     * Generates the index keys for the document 'obj' and stores them in the set 'keys'.
+     * The field names and values being extracted at one level of the recursion through the arrays
+     * of a document, along with scratch space for that level. Frames are owned by a KeyBuffer so
+     * that their vectors keep their capacity from one document to the next.
+     */
+    struct Frame;
+
+    /**
+     * Returns the frame for recursion depth 'depth' in 'keys', creating it if necessary. Frames
+     * never move once created.
+     */
+    static Frame& frameAt(KeyBuffer* keys, size_t depth);
+
+    /**
+     * Starts a new key at the end of 'keys'. The caller must build exactly one object into the
+     * returned buffer using a BSONObjBuilder.
+     */
+    static BufBuilder& newKey(KeyBuffer* keys);
+
+    static void appendKey(KeyBuffer* keys, const BSONObj& key);
+
+    // These are used by the getKeysImpl(s) below.
+    std::vector<const char*> _fieldNames;
+    std::vector<BSONElement> _fixed;
+    bool _isIdIndex;
+    bool _isSparse;
+    BSONObj _nullKey;  // a full key with all fields null
+
+private:
+    virtual void getKeysImpl(const BSONObj& obj,
+                             KeyBuffer* keys,
+                             MultikeyPaths* multikeyPaths) const = 0;
+};
+
+/**
+ * A reusable container for the keys of one document. The keys are stored back to back in a single
+ * buffer, and the scratch space used while generating them is kept here too, so generating keys
+ * into a KeyBuffer that is reused across documents stops allocating memory once it has grown to
+ * fit them.
+ */
+class BtreeKeyGenerator::KeyBuffer {
+    MONGO_DISALLOW_COPYING(KeyBuffer);
+
+public:
+    KeyBuffer();
+    ~KeyBuffer();
+
+    size_t size() const {
+        return _offsets.size();
+    }
+
+    bool empty() const {
+        return _offsets.empty();
+    }
+
+    /**
+     * Returns the i-th key. The key is not owned, and remains valid until this KeyBuffer is
+     * cleared or keys are generated into it again.
+     */
+    BSONObj operator[](size_t i) const {
+        return BSONObj(_buf.buf() + _offsets[i]);
+    }
+
+    /**
+     * Removes all keys. Memory is kept for reuse, unless an unusually large document has grown the
+     * buffer beyond what is worth keeping.
+     */
+    void clear();
+
+private:
+    friend class BtreeKeyGenerator;
+
+    BufBuilder _buf;
+    std::vector<int> _offsets;
+    std::vector<std::unique_ptr<Frame>> _frames;
+};
+
+class BtreeKeyGeneratorV0 : public BtreeKeyGenerator {
+public:
+    BtreeKeyGeneratorV0(std::vector<const char*> fieldNames,
+                        std::vector<BSONElement> fixed,
+                        bool isSparse);
+
+    virtual ~BtreeKeyGeneratorV0() {}
+
+private:
+    /**
+     * Generates the index keys for the document 'obj' and appends them to 'keys'.
      *
-     * @param fieldNames - fields to index, may be postfixes in recursive calls
-     * @param fixed - values that have already been identified for their index fields
-     * @param obj - object from which keys should be extracted, based on names in fieldNames
-     * @param keys - set where index keys are written
+     * It isn't possible to create a v0 index, so it's unnecessary to track the prefixes of the
+     * indexed fields that cause the index to be mulitkey. This function therefore ignores its
+     * 'multikeyPaths' parameter.
+     */
+    void getKeysImpl(const BSONObj& obj,
+                     KeyBuffer* keys,
+                     MultikeyPaths* multikeyPaths) const final;
+
+    /**
+     * Generates the keys for 'obj' using the field names and values in the frame at 'depth', and
+     * recurses one level deeper for each object in an array along a non-terminal path.
+     */
+    void getKeysImplAtDepth(size_t depth, const BSONObj& obj, KeyBuffer* keys) const;
+};
+
+class BtreeKeyGeneratorV1 : public BtreeKeyGenerator {
+public:
+    BtreeKeyGeneratorV1(std::vector<const char*> fieldNames,
+                        std::vector<BSONElement> fixed,
+                        bool isSparse,
+                        const CollatorInterface* collator);
+
+    virtual ~BtreeKeyGeneratorV1() {}
+
+private:
+
+    /**
+     * Generates the index keys for the document 'obj' and appends them to 'keys'.
      *
      * If the 'multikeyPaths' pointer is non-null, then it must point to an empty vector. If this
      * index type supports tracking path-level multikey information, then this function resizes
@@ -173,19 +243,19 @@ private:
      * element with the prefixes of the indexed field that would cause this index to be multikey as
      * a result of inserting 'keys'.
      */
-    void getKeysImpl(std::vector<const char*> fieldNames,
-                     std::vector<BSONElement> fixed,
-                     const BSONObj& obj,
-                     BSONObjSet* keys,
+    void getKeysImpl(const BSONObj& obj,
+                     KeyBuffer* keys,
                      MultikeyPaths* multikeyPaths) const final;
 
     /**
      * This recursive method does the heavy-lifting for getKeysImpl().
+     *
+     * The fields to index, which may be postfixes in recursive calls, and the values that have
+     * already been identified for them are taken from the frame at 'depth' in 'keys'.
      */
-    void getKeysImplWithArray(std::vector<const char*> fieldNames,
-                              std::vector<BSONElement> fixed,
+    void getKeysImplWithArray(size_t depth,
                               const BSONObj& obj,
-                              BSONObjSet* keys,
+                              KeyBuffer* keys,
                               unsigned numNotFound,
                               const std::vector<PositionalPathInfo>& positionalInfo,
                               MultikeyPaths* multikeyPaths) const;
@@ -227,17 +297,16 @@ private:
                                    bool* arrayNestedArray) const;
 
     /**
-     * Sets extracted elements in 'fixed' for field paths that we have traversed to the end.
+     * Copies the frame at 'depth' to the frame at 'depth + 1' and sets extracted elements in its
+     * 'fixed' for field paths that we have traversed to the end.
      *
      * Then calls getKeysImplWithArray() recursively.
      */
-    void _getKeysArrEltFixed(std::vector<const char*>* fieldNames,
-                             std::vector<BSONElement>* fixed,
+    void _getKeysArrEltFixed(size_t depth,
                              const BSONElement& arrEntry,
-                             BSONObjSet* keys,
+                             KeyBuffer* keys,
                              unsigned numNotFound,
                              const BSONElement& arrObjElt,
-                             const std::set<size_t>& arrIdxs,
                              bool mayExpandArrayUnembedded,
                              const std::vector<PositionalPathInfo>& positionalInfo,
                              MultikeyPaths* multikeyPaths) const;
@@ -38,6 +38,7 @@
 #include "mongo/db/query/collation/collator_interface_mock.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 using namespace mongo;
 using std::unique_ptr;
@@ -127,6 +128,29 @@ bool testKeygen(const BSONObj& kp,
         log() << "Expected: " << dumpMultikeyPaths(expectedMultikeyPaths) << ", "
               << "Actual: " << dumpMultikeyPaths(actualMultikeyPaths);
     }
+    if (!match) {
+        return false;
+    }
+
+    //
+    // Step 4: check that generating the keys into a KeyBuffer produces the same keys, and that
+    // reusing the KeyBuffer for another document replaces them.
+    //
+    BtreeKeyGenerator::KeyBuffer keyBuffer;
+    keyGen->getKeys(fromjson("{a: [98, 99], b: 'other'}"), &keyBuffer, nullptr);
+
+    MultikeyPaths bufferMultikeyPaths;
+    keyGen->getKeys(obj, &keyBuffer, &bufferMultikeyPaths);
+    BSONObjSet bufferKeys;
+    for (size_t i = 0; i < keyBuffer.size(); ++i) {
+        bufferKeys.insert(keyBuffer[i].getOwned());
+    }
+
+    match = (expectedKeys == bufferKeys) && (expectedMultikeyPaths == bufferMultikeyPaths);
+    if (!match) {
+        log() << "Expected: " << dumpKeyset(expectedKeys) << ", "
+              << "Actual from KeyBuffer: " << dumpKeyset(bufferKeys);
+    }
 
     return match;
 }
@@ -1092,4 +1116,101 @@ TEST(BtreeKeyGeneratorTest, CollatorDoesNotAffectNestedArrayKeys) {
         testKeygen(keyPattern, genKeysFrom, expectedKeys, expectedMultikeyPaths, false, &collator));
 }
 
+TEST(BtreeKeyGeneratorTest, KeyBufferKeepsDuplicatesInGenerationOrder) {
+    BtreeKeyGeneratorV1 keyGen({"a", "b"}, {BSONElement(), BSONElement()}, false, nullptr);
+    BtreeKeyGenerator::KeyBuffer keys;
+    keyGen.getKeys(fromjson("{a: [3, 1, 3], b: 'x'}"), &keys, nullptr);
+    ASSERT_EQUALS(3U, keys.size());
+    ASSERT_EQUALS(fromjson("{'': 3, '': 'x'}"), keys[0]);
+    ASSERT_EQUALS(fromjson("{'': 1, '': 'x'}"), keys[1]);
+    ASSERT_EQUALS(fromjson("{'': 3, '': 'x'}"), keys[2]);
+
+    // The BSONObjSet overload deduplicates the same keys.
+    BSONObjSet keySet;
+    keyGen.getKeys(fromjson("{a: [3, 1, 3], b: 'x'}"), &keySet, nullptr);
+    ASSERT_EQUALS(2U, keySet.size());
+}
+
+TEST(BtreeKeyGeneratorTest, KeyBufferIsReusableAfterParallelArraysError) {
+    BtreeKeyGeneratorV1 keyGen({"a", "b"}, {BSONElement(), BSONElement()}, false, nullptr);
+    BtreeKeyGenerator::KeyBuffer keys;
+    ASSERT_THROWS_CODE(keyGen.getKeys(fromjson("{a: [1, 2], b: [3, 4]}"), &keys, nullptr),
+                       UserException,
+                       BtreeKeyGenerator::ParallelArraysCode);
+
+    keyGen.getKeys(fromjson("{a: 1, b: 2}"), &keys, nullptr);
+    ASSERT_EQUALS(1U, keys.size());
+    ASSERT_EQUALS(fromjson("{'': 1, '': 2}"), keys[0]);
+}
+
+TEST(BtreeKeyGeneratorTest, KeyBufferWithV0KeyGenerator) {
+    BtreeKeyGeneratorV0 keyGen({"a.b"}, {BSONElement()}, false);
+    BtreeKeyGenerator::KeyBuffer keys;
+    keyGen.getKeys(fromjson("{a: [{b: 1}, {b: [2, 3]}, {c: 4}]}"), &keys, nullptr);
+
+    BSONObjSet actualKeys;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        actualKeys.insert(keys[i].getOwned());
+    }
+    BSONObjSet expectedKeys;
+    keyGen.getKeys(fromjson("{a: [{b: 1}, {b: [2, 3]}, {c: 4}]}"), &expectedKeys, nullptr);
+    ASSERT_EQUALS(expectedKeys.size(), actualKeys.size());
+    ASSERT(expectedKeys == actualKeys);
+    ASSERT(actualKeys.count(fromjson("{'': 1}")));
+    ASSERT(actualKeys.count(fromjson("{'': 3}")));
+}
+
+// Not a correctness test: reports how quickly keys are generated for compound and multikey key
+// patterns, into a BSONObjSet and into a reused KeyBuffer.
+TEST(BtreeKeyGeneratorTest, KeyGenerationThroughput) {
+    const int kIterations = 20000;
+
+    struct Case {
+        const char* name;
+        BSONObj keyPattern;
+        BSONObj doc;
+    };
+    const std::vector<Case> cases{
+        {"compound", fromjson("{a: 1, b: 1, 'c.d': 1}"), fromjson("{a: 1, b: 'xyz', c: {d: 2.5}}")},
+        {"multikey", fromjson("{a: 1, b: 1}"), fromjson("{a: [1, 2, 3, 4, 5, 6, 7, 8], b: 'x'}")},
+        {"nested multikey",
+         fromjson("{'a.b': 1, 'a.c': 1}"),
+         fromjson("{a: [{b: 1, c: 2}, {b: 3, c: 4}, {b: 5, c: 6}, {b: 7, c: 8}]}")},
+    };
+
+    for (auto&& c : cases) {
+        vector<const char*> fieldNames;
+        vector<BSONElement> fixed;
+        for (auto&& elt : c.keyPattern) {
+            fieldNames.push_back(elt.fieldName());
+            fixed.push_back(BSONElement());
+        }
+        BtreeKeyGeneratorV1 keyGen(fieldNames, fixed, false, nullptr);
+
+        size_t numKeys = 0;
+        Timer setTimer;
+        for (int i = 0; i < kIterations; ++i) {
+            BSONObjSet keys;
+            MultikeyPaths multikeyPaths;
+            keyGen.getKeys(c.doc, &keys, &multikeyPaths);
+            numKeys += keys.size();
+        }
+        const long long setMicros = std::max(1LL, setTimer.micros());
+
+        BtreeKeyGenerator::KeyBuffer buffer;
+        Timer bufferTimer;
+        for (int i = 0; i < kIterations; ++i) {
+            MultikeyPaths multikeyPaths;
+            keyGen.getKeys(c.doc, &buffer, &multikeyPaths);
+            numKeys += buffer.size();
+        }
+        const long long bufferMicros = std::max(1LL, bufferTimer.micros());
+
+        ASSERT_GREATER_THAN(numKeys, 0U);
+        log() << "key generation for " << c.name << " key pattern " << c.keyPattern << ": "
+              << (kIterations * 1000000LL / setMicros) << " docs/sec into a BSONObjSet, "
+              << (kIterations * 1000000LL / bufferMicros) << " docs/sec into a KeyBuffer";
+    }
+}
+
 }  // namespace
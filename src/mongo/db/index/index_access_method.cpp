@@ -384,17 +384,25 @@ Status IndexAccessMethod::compact(OperationContext* txn) {
     return this->_newInterface->compact(txn);
 }
 
-std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk() {
-    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor));
+const size_t IndexAccessMethod::kBulkMaxMemoryUsageBytes;
+
+std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk(
+    size_t maxMemoryUsageBytes) {
+    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor, maxMemoryUsageBytes));
 }
 
 IndexAccessMethod::BulkBuilder::BulkBuilder(const IndexAccessMethod* index,
-                                            const IndexDescriptor* descriptor)
+                                            const IndexDescriptor* descriptor,
+                                            size_t maxMemoryUsageBytes)
     : _sorter(Sorter::make(
+          // Keys are sorted and spilled in the background while the collection is scanned, and
+          // are merged at most 64 runs at a time.
           SortOptions()
               .TempDir(storageGlobalParams.dbpath + "/_tmp")
               .ExtSortAllowed()
-              .MaxMemoryUsageBytes(100 * 1024 * 1024),
+              .MaxMemoryUsageBytes(maxMemoryUsageBytes)
+              .Parallel()
+              .MaxMergeFanIn(64),
           BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version()))),
       _real(index) {}
 
@@ -432,6 +440,30 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
     return Status::OK();
 }
 
+void IndexAccessMethod::BulkBuilder::merge(std::unique_ptr<BulkBuilder> other) {
+    invariant(other->_real == _real);
+
+    _keysInserted += other->_keysInserted;
+    _everGeneratedMultipleKeys = _everGeneratedMultipleKeys || other->_everGeneratedMultipleKeys;
+
+    if (!other->_indexMultikeyPaths.empty()) {
+        if (_indexMultikeyPaths.empty()) {
+            _indexMultikeyPaths = std::move(other->_indexMultikeyPaths);
+        } else {
+            invariant(_indexMultikeyPaths.size() == other->_indexMultikeyPaths.size());
+            for (size_t i = 0; i < _indexMultikeyPaths.size(); ++i) {
+                _indexMultikeyPaths[i].insert(other->_indexMultikeyPaths[i].begin(),
+                                              other->_indexMultikeyPaths[i].end());
+            }
+        }
+    }
+
+    _mergedSorters.push_back(std::move(other->_sorter));
+    for (auto&& sorter : other->_mergedSorters) {
+        _mergedSorters.push_back(std::move(sorter));
+    }
+}
+
 
 Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      std::unique_ptr<BulkBuilder> bulk,
@@ -440,7 +472,36 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      set<RecordId>* dupsToDrop) {
     Timer timer;
 
-    std::unique_ptr<BulkBuilder::Sorter::Iterator> i(bulk->_sorter->done());
+    std::unique_ptr<BulkBuilder::Sorter::Iterator> i;
+    if (bulk->_mergedSorters.empty()) {
+        i.reset(bulk->_sorter->done());
+    } else {
+        // Merge the keys of every BulkBuilder that was merged into this one.
+        std::vector<std::shared_ptr<BulkBuilder::Sorter::Iterator>> iters;
+        iters.emplace_back(bulk->_sorter->done());
+        for (auto&& sorter : bulk->_mergedSorters) {
+            iters.emplace_back(sorter->done());
+        }
+        i.reset(BulkBuilder::Sorter::Iterator::merge(
+            iters,
+            SortOptions(),
+            BtreeExternalSortComparison(_descriptor->keyPattern(), _descriptor->version())));
+    }
+
+    SorterStats sortStats = bulk->_sorter->stats();
+    for (auto&& sorter : bulk->_mergedSorters) {
+        const SorterStats stats = sorter->stats();
+        sortStats.numRuns += stats.numRuns;
+        sortStats.spilledBytes += stats.spilledBytes;
+        sortStats.numMergePasses += stats.numMergePasses;
+        sortStats.mergeMillis += stats.mergeMillis;
+    }
+    if (sortStats.numRuns > 0) {
+        LOG(timer.seconds() > 10 ? 0 : 1) << "\t external sort spilled " << sortStats.numRuns
+                                          << " runs (" << sortStats.spilledBytes << " bytes) in "
+                                          << sortStats.numMergePasses << " merge passes, taking "
+                                          << sortStats.mergeMillis << "ms to finish";
+    }
 
     stdx::unique_lock<Client> lk(*txn->getClient());
     ProgressMeterHolder pm(*txn->setMessage_inlock("Index Bulk Build: (2/3) btree bottom up",
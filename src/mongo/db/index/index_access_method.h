@@ -206,14 +206,25 @@ public:
                       const InsertDeleteOptions& options,
                       int64_t* numInserted);
 
+        /**
+         * Takes over the keys inserted into 'other', which must have been initiated on the same
+         * index, so that commitBulk() merges them with the keys inserted into this BulkBuilder.
+         * Used to combine BulkBuilders that were filled concurrently.
+         */
+        void merge(std::unique_ptr<BulkBuilder> other);
+
     private:
         friend class IndexAccessMethod;
 
         using Sorter = mongo::Sorter<BSONObj, RecordId>;
 
-        BulkBuilder(const IndexAccessMethod* index, const IndexDescriptor* descriptor);
+        BulkBuilder(const IndexAccessMethod* index,
+                    const IndexDescriptor* descriptor,
+                    size_t maxMemoryUsageBytes);
 
         std::unique_ptr<Sorter> _sorter;
+        // Sorters taken over from other BulkBuilders by merge().
+        std::vector<std::unique_ptr<Sorter>> _mergedSorters;
         const IndexAccessMethod* _real;
         int64_t _keysInserted = 0;
 
@@ -232,8 +243,13 @@ public:
      * This can return NULL, meaning bulk mode is not available.
      *
      * It is only legal to initiate bulk when the index is new and empty.
+     *
+     * 'maxMemoryUsageBytes' bounds the memory used to sort keys before spilling them to disk.
      */
-    std::unique_ptr<BulkBuilder> initiateBulk();
+    std::unique_ptr<BulkBuilder> initiateBulk(
+        size_t maxMemoryUsageBytes = kBulkMaxMemoryUsageBytes);
+
+    static const size_t kBulkMaxMemoryUsageBytes = 100 * 1024 * 1024;
 
     /**
      * Call this when you are ready to finish your bulk work.
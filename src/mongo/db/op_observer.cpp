@@ -35,6 +35,7 @@
 #include "mongo/db/commands/dbhash.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/pipeline/lookup_results_cache.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/s/collection_sharding_state.h"
 #include "mongo/scripting/engine.h"
@@ -43,6 +44,40 @@ namespace mongo {
 
 using std::vector;
 
+namespace {
+
+/**
+ * Discards the cached $lookup results for 'nss' once the current write commits. Invalidating only
+ * at commit, rather than now, also discards any results read and cached before the write became
+ * visible.
+ */
+void invalidateLookupResults(OperationContext* txn, const NamespaceString& nss) {
+    if (!LookupResultsCache::get().isEnabled()) {
+        return;
+    }
+
+    if (!txn->lockState()->inAWriteUnitOfWork()) {
+        LookupResultsCache::get().invalidate(nss);
+        return;
+    }
+    txn->recoveryUnit()->onCommit([nss] { LookupResultsCache::get().invalidate(nss); });
+}
+
+void invalidateLookupResultsForDatabase(OperationContext* txn, const std::string& dbName) {
+    if (!LookupResultsCache::get().isEnabled()) {
+        return;
+    }
+
+    if (!txn->lockState()->inAWriteUnitOfWork()) {
+        LookupResultsCache::get().invalidateDatabase(dbName);
+        return;
+    }
+    txn->recoveryUnit()->onCommit(
+        [dbName] { LookupResultsCache::get().invalidateDatabase(dbName); });
+}
+
+}  // namespace
+
 void OpObserver::onCreateIndex(OperationContext* txn,
                                const std::string& ns,
                                BSONObj indexDoc,
@@ -80,6 +115,7 @@ void OpObserver::onInserts(OperationContext* txn,
     if (strstr(ns, ".system.js")) {
         Scope::storedFuncMod(txn);
     }
+    invalidateLookupResults(txn, nss);
 }
 
 void OpObserver::onUpdate(OperationContext* txn, const OplogUpdateEntryArgs& args) {
@@ -101,6 +137,7 @@ void OpObserver::onUpdate(OperationContext* txn, const OplogUpdateEntryArgs& arg
     if (strstr(args.ns.c_str(), ".system.js")) {
         Scope::storedFuncMod(txn);
     }
+    invalidateLookupResults(txn, NamespaceString(args.ns));
 }
 
 OpObserver::DeleteState OpObserver::aboutToDelete(OperationContext* txn,
@@ -138,6 +175,7 @@ void OpObserver::onDelete(OperationContext* txn,
     if (ns.coll() == "system.js") {
         Scope::storedFuncMod(txn);
     }
+    invalidateLookupResults(txn, ns);
 }
 
 void OpObserver::onOpMessage(OperationContext* txn, const BSONObj& msgObj) {
@@ -184,6 +222,7 @@ void OpObserver::onDropDatabase(OperationContext* txn, const std::string& dbName
 
     getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
     logOpForDbHash(txn, dbName.c_str());
+    invalidateLookupResultsForDatabase(txn, dbName);
 }
 
 void OpObserver::onDropCollection(OperationContext* txn, const NamespaceString& collectionName) {
@@ -197,6 +236,7 @@ void OpObserver::onDropCollection(OperationContext* txn, const NamespaceString&
 
     getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
     logOpForDbHash(txn, dbName.c_str());
+    invalidateLookupResults(txn, collectionName);
 }
 
 void OpObserver::onDropIndex(OperationContext* txn,
@@ -224,6 +264,8 @@ void OpObserver::onRenameCollection(OperationContext* txn,
 
     getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
     logOpForDbHash(txn, dbName.c_str());
+    invalidateLookupResults(txn, fromCollection);
+    invalidateLookupResults(txn, toCollection);
 }
 
 void OpObserver::onApplyOps(OperationContext* txn,
@@ -248,6 +290,7 @@ void OpObserver::onConvertToCapped(OperationContext* txn,
 
     getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
     logOpForDbHash(txn, dbName.c_str());
+    invalidateLookupResults(txn, collectionName);
 }
 
 void OpObserver::onEmptyCapped(OperationContext* txn, const NamespaceString& collectionName) {
@@ -261,6 +304,7 @@ void OpObserver::onEmptyCapped(OperationContext* txn, const NamespaceString& col
 
     getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
     logOpForDbHash(txn, dbName.c_str());
+    invalidateLookupResults(txn, collectionName);
 }
 
 }  // namespace mongo
@@ -44,7 +44,89 @@ using std::vector;
 
 const DocumentStorage DocumentStorage::kEmptyDoc;
 
+namespace {
+bool isMetadataFieldName(StringData fieldName) {
+    return !fieldName.empty() && fieldName[0] == '$' &&
+        (fieldName == Document::metaFieldTextScore || fieldName == Document::metaFieldRandVal ||
+         fieldName == Document::metaFieldSortKey);
+}
+}  // namespace
+
+DocumentStorage::DocumentStorage(const BSONObj& bson, BSONObj owner, bool stripMetadata)
+    : DocumentStorage() {
+    invariant(owner.isOwned());
+    _bson = bson;
+    _bsonOwner = std::move(owner);
+    _bsonIt = _bson.objdata() + sizeof(int32_t);
+    _stripMetadata = stripMetadata;
+    _isExactlyBson = true;
+
+    if (_stripMetadata) {
+        // Metadata is read up front, since it is not looked up by name.
+        BSONObjIterator it(_bson);
+        while (it.more()) {
+            BSONElement elem(it.next());
+            auto fieldName = elem.fieldNameStringData();
+            if (!isMetadataFieldName(fieldName)) {
+                continue;
+            }
+
+            if (fieldName == Document::metaFieldTextScore) {
+                setTextScore(elem.Double());
+            } else if (fieldName == Document::metaFieldRandVal) {
+                setRandMetaField(elem.Double());
+            } else {
+                setSortKeyMetaField(elem.Obj());
+            }
+            _isExactlyBson = false;
+        }
+    }
+}
+
+Position DocumentStorage::loadNextField() {
+    invariant(_bsonIt);
+
+    BSONElement elem(_bsonIt);
+    if (elem.eoo()) {
+        _bsonIt = NULL;
+        return Position();
+    }
+    _bsonIt += elem.size();
+
+    auto fieldName = elem.fieldNameStringData();
+    if (_stripMetadata && isMetadataFieldName(fieldName)) {
+        return Position();
+    }
+
+    const Position pos = getNextPosition();
+    if (elem.type() == Object) {
+        // Sub-documents share the buffer of this document and are converted lazily as well.
+        appendField(fieldName) =
+            Value(Document(new DocumentStorage(elem.embeddedObject(), _bsonOwner, false)));
+    } else {
+        appendField(fieldName) = Value(elem);
+    }
+    return pos;
+}
+
 Position DocumentStorage::findField(StringData requested) const {
+    Position pos = findFieldLoaded(requested);
+    if (pos.found() || MONGO_likely(!_bsonIt)) {
+        return pos;
+    }
+
+    // Convert fields of the backing BSON until we find the requested one.
+    DocumentStorage* self = const_cast<DocumentStorage*>(this);
+    while (_bsonIt) {
+        pos = self->loadNextField();
+        if (pos.found() && getField(pos).nameSD() == requested) {
+            return pos;
+        }
+    }
+    return Position();
+}
+
+Position DocumentStorage::findFieldLoaded(StringData requested) const {
     int reqSize = requested.size();  // get size calculation out of the way if needed
 
     if (_numFields >= HASH_TAB_MIN) {  // hash lookup
@@ -61,7 +143,7 @@ Position DocumentStorage::findField(StringData requested) const {
             pos = elem.nextCollision;
         }
     } else {  // linear scan
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        for (DocumentStorageIterator it = iteratorLoaded(); !it.atEnd(); it.advance()) {
             if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
                 return it.position();
             }
@@ -184,12 +266,17 @@ void DocumentStorage::reserveFields(size_t expectedFields) {
 intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
     intrusive_ptr<DocumentStorage> out(new DocumentStorage());
 
+    // The clone does not keep the backing BSON, so it needs all of the fields.
+    loadAllFields();
+
     // Make a copy of the buffer.
     // It is very important that the positions of each field are the same after cloning.
-    const size_t bufferBytes = (_bufferEnd + hashTabBytes()) - _buffer;
-    out->_buffer = new char[bufferBytes];
-    out->_bufferEnd = out->_buffer + (_bufferEnd - _buffer);
-    memcpy(out->_buffer, _buffer, bufferBytes);
+    if (_buffer) {
+        const size_t bufferBytes = (_bufferEnd + hashTabBytes()) - _buffer;
+        out->_buffer = new char[bufferBytes];
+        out->_bufferEnd = out->_buffer + (_bufferEnd - _buffer);
+        memcpy(out->_buffer, _buffer, bufferBytes);
+    }
 
     // Copy remaining fields
     out->_usedBytes = _usedBytes;
@@ -198,6 +285,7 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
     out->_metaFields = _metaFields;
     out->_textScore = _textScore;
     out->_randVal = _randVal;
+    out->_sortKey = _sortKey;
 
     // Tell values that they have been memcpyed (updates ref counts)
     for (DocumentStorageIterator it = out->iteratorAll(); !it.atEnd(); it.advance()) {
@@ -210,7 +298,7 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
 DocumentStorage::~DocumentStorage() {
     std::unique_ptr<char[]> deleteBufferAtScopeEnd(_buffer);
 
-    for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+    for (DocumentStorageIterator it = iteratorLoaded(); !it.atEnd(); it.advance()) {
         it->val.~Value();  // explicit destructor call
     }
 }
@@ -245,12 +333,22 @@ BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d
 }
 
 void Document::toBson(BSONObjBuilder* pBuilder) const {
+    if (storage().isExactlyBson()) {
+        pBuilder->appendElements(storage().getBson());
+        return;
+    }
+
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
         *pBuilder << it->nameSD() << it->val;
     }
 }
 
 BSONObj Document::toBson() const {
+    if (storage().isExactlyBson()) {
+        // This is free if the backing BSON is the whole of its buffer.
+        return storage().getBson().getOwned();
+    }
+
     BSONObjBuilder bb;
     toBson(&bb);
     return bb.obj();
@@ -258,14 +356,21 @@ BSONObj Document::toBson() const {
 
 const StringData Document::metaFieldTextScore("$textScore", StringData::LiteralTag());
 const StringData Document::metaFieldRandVal("$randVal", StringData::LiteralTag());
+const StringData Document::metaFieldSortKey("$sortKey", StringData::LiteralTag());
 
 BSONObj Document::toBsonWithMetaData() const {
+    if (!hasTextScore() && !hasRandMetaField() && !hasSortKeyMetaField()) {
+        return toBson();
+    }
+
     BSONObjBuilder bb;
     toBson(&bb);
     if (hasTextScore())
         bb.append(metaFieldTextScore, getTextScore());
     if (hasRandMetaField())
         bb.append(metaFieldRandVal, getRandMetaField());
+    if (hasSortKeyMetaField())
+        bb.append(metaFieldSortKey, getSortKeyMetaField());
     return bb.obj();
 }
 
@@ -283,6 +388,9 @@ Document Document::fromBsonWithMetaData(const BSONObj& bson) {
             } else if (fieldName == metaFieldRandVal) {
                 md.setRandMetaField(elem.Double());
                 continue;
+            } else if (fieldName == metaFieldSortKey) {
+                md.setSortKeyMetaField(elem.Obj());
+                continue;
             }
         }
 
@@ -293,6 +401,33 @@ Document Document::fromBsonWithMetaData(const BSONObj& bson) {
     return md.freeze();
 }
 
+Document Document::wrapBsonWithMetaData(BSONObj bson) {
+    bson = bson.getOwned();
+    return Document(new DocumentStorage(bson, bson, true));
+}
+
+namespace {
+void loadLazyFieldsInValue(const Value& val) {
+    if (val.getType() == Object) {
+        val.getDocument().loadLazyFields();
+    } else if (val.getType() == Array) {
+        for (auto&& elem : val.getArray()) {
+            loadLazyFieldsInValue(elem);
+        }
+    }
+}
+}  // namespace
+
+void Document::loadLazyFields() const {
+    if (!_storage) {
+        return;
+    }
+
+    for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
+        loadLazyFieldsInValue(it->val);
+    }
+}
+
 MutableDocument::MutableDocument(size_t expectedFields)
     : _storageHolder(NULL), _storage(_storageHolder) {
     if (expectedFields) {
@@ -364,8 +499,10 @@ size_t Document::getApproximateSize() const {
 
     size_t size = sizeof(DocumentStorage);
     size += storage().allocatedBytes();
+    size += storage().bsonBytes();
 
-    for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
+    // Don't convert any fields just to measure them.
+    for (DocumentStorageIterator it = storage().iteratorLoaded(); !it.atEnd(); it.advance()) {
         size += it->val.getApproximateSize();
         size -= sizeof(Value);  // already accounted for above
     }
@@ -452,6 +589,10 @@ void Document::serializeForSorter(BufBuilder& buf) const {
         buf.appendNum(char(DocumentStorage::MetaType::RAND_VAL + 1));
         buf.appendNum(getRandMetaField());
     }
+    if (hasSortKeyMetaField()) {
+        buf.appendNum(char(DocumentStorage::MetaType::SORT_KEY + 1));
+        getSortKeyMetaField().serializeForSorter(buf);
+    }
     buf.appendNum(char(0));
 }
 
@@ -468,6 +609,9 @@ Document Document::deserializeForSorter(BufReader& buf, const SorterDeserializeS
             doc.setTextScore(buf.read<LittleEndian<double>>());
         } else if (marker == char(DocumentStorage::MetaType::RAND_VAL) + 1) {
             doc.setRandMetaField(buf.read<LittleEndian<double>>());
+        } else if (marker == char(DocumentStorage::MetaType::SORT_KEY) + 1) {
+            doc.setSortKeyMetaField(
+                BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings()));
         } else {
             uasserted(28744, "Unrecognized marker, unable to deserialize buffer");
         }
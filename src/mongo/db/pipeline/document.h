@@ -178,6 +178,24 @@ public:
      */
     static Document fromBsonWithMetaData(const BSONObj& bson);
 
+    /**
+     * Like fromBsonWithMetaData, but rather than converting every field up front, keeps a reference
+     * to 'bson' and converts its fields into Values as they are first looked up. Until the
+     * Document is modified, toBson() returns 'bson' itself. Makes an owned copy of 'bson' if it is
+     * not already owned.
+     *
+     * Prefer this for wide documents of which only a few fields are likely to be read.
+     */
+    static Document wrapBsonWithMetaData(BSONObj bson);
+
+    /**
+     * Converts any fields of this Document, and of the Documents nested within it, which are still
+     * backed by BSON. Since lookups on a lazily-converted Document modify its storage, a Document
+     * which may share storage with others must have this called before it is handed to another
+     * thread to read.
+     */
+    void loadLazyFields() const;
+
     // Support BSONObjBuilder and BSONArrayBuilder "stream" API
     friend BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d);
 
@@ -216,6 +234,18 @@ public:
         return storage().getRandMetaField();
     }
 
+    /**
+     * The key by which a shard's $sort ordered this document, attached when the shard's sorted
+     * output is merged by mongos. Has one unnamed field per component of the sort.
+     */
+    static const StringData metaFieldSortKey;  // "$sortKey"
+    bool hasSortKeyMetaField() const {
+        return storage().hasSortKeyMetaField();
+    }
+    BSONObj getSortKeyMetaField() const {
+        return storage().getSortKeyMetaField();
+    }
+
     /// members for Sorter
     struct SorterDeserializeSettings {};  // unused
     void serializeForSorter(BufBuilder& buf) const;
@@ -233,6 +263,7 @@ public:
     }
 
 private:
+    friend class DocumentStorage;
     friend class FieldIterator;
     friend class ValueStorage;
     friend class MutableDocument;
@@ -447,6 +478,10 @@ public:
         storage().setRandMetaField(val);
     }
 
+    void setSortKeyMetaField(BSONObj sortKey) {
+        storage().setSortKeyMetaField(std::move(sortKey));
+    }
+
     /** Convert to a read-only document and release reference.
      *
      *  Call this to indicate that you are done with this Document and will
@@ -497,7 +532,13 @@ private:
             return clonedStorage();
 
         // This function exists to ensure this is safe
-        return const_cast<DocumentStorage&>(*storagePtr());
+        DocumentStorage& ownedStorage = const_cast<DocumentStorage&>(*storagePtr());
+
+        // Storage which is still backed by BSON must stop being so before it is modified.
+        if (MONGO_unlikely(ownedStorage.hasBson()))
+            ownedStorage.releaseBson();
+
+        return ownedStorage;
     }
     DocumentStorage& newStorage() {
         reset(new DocumentStorage);
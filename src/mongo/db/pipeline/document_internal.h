@@ -33,6 +33,7 @@
 #include <bitset>
 #include <boost/intrusive_ptr.hpp>
 
+#include "mongo/bson/bsonobj.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/util/intrusive_counter.h"
 
@@ -178,7 +179,14 @@ private:
     bool _includeMissing;
 };
 
-/// Storage class used by both Document and MutableDocument
+/** Storage class used by both Document and MutableDocument
+ *
+ *  Storage may be backed by a BSONObj, in which case the BSON fields are converted into
+ *  ValueElements lazily, in order, as they are looked up. Any operation which exposes the
+ *  ValueElements directly (iteration, cloning, modification) first converts all remaining fields,
+ *  so ValueElement references are never invalidated by lazy conversion. Because lookups may convert
+ *  fields, a lazily-converted storage must not be read from multiple threads concurrently.
+ */
 class DocumentStorage : public RefCountable {
 public:
     DocumentStorage()
@@ -189,13 +197,25 @@ public:
           _hashTabMask(0),
           _metaFields(),
           _textScore(0),
-          _randVal(0) {}
+          _randVal(0),
+          _bsonIt(NULL),
+          _stripMetadata(false),
+          _isExactlyBson(false) {}
+
+    /**
+     * Creates storage backed by 'bson', whose fields are only converted when first looked up.
+     * 'owner' must be owned and must contain 'bson', and is used to keep its buffer alive. If
+     * 'stripMetadata' is true, top-level fields with metadata names are read as metadata rather
+     * than as fields, as in Document::fromBsonWithMetaData().
+     */
+    DocumentStorage(const BSONObj& bson, BSONObj owner, bool stripMetadata);
 
     ~DocumentStorage();
 
     enum MetaType : char {
         TEXT_SCORE,
         RAND_VAL,
+        SORT_KEY,
 
         NUM_FIELDS
     };
@@ -206,6 +226,7 @@ public:
 
     size_t size() const {
         // can't use _numFields because it includes removed Fields
+        loadAllFields();
         size_t count = 0;
         for (DocumentStorageIterator it = iterator(); !it.atEnd(); it.advance())
             count++;
@@ -220,6 +241,51 @@ public:
     /// Returns the position of the named field (may be missing) or Position()
     Position findField(StringData name) const;
 
+    /// Converts any fields of the backing BSON which have not yet been looked up.
+    void loadAllFields() const {
+        while (MONGO_unlikely(_bsonIt != NULL)) {
+            const_cast<DocumentStorage*>(this)->loadNextField();
+        }
+    }
+
+    /**
+     * True if this storage was created from BSON and its fields are still exactly the fields of
+     * that BSON, in which case getBson() can be used in place of serializing the fields.
+     */
+    bool isExactlyBson() const {
+        return _isExactlyBson;
+    }
+
+    /// The BSON this storage was created from. Only meaningful if isExactlyBson().
+    const BSONObj& getBson() const {
+        return _bson;
+    }
+
+    /// True if this storage was created from BSON and has not been modified since.
+    bool hasBson() const {
+        return _bsonOwner.isOwned();
+    }
+
+    /**
+     * Returns the number of bytes of backing BSON held by this storage, which may include fields
+     * that have already been converted. Sub-documents sharing the buffer of their parent report 0
+     * so that the buffer is only counted once.
+     */
+    size_t bsonBytes() const {
+        return hasBson() && _bson.objdata() == _bsonOwner.objdata() ? _bson.objsize() : 0;
+    }
+
+    /**
+     * Converts all remaining fields and drops the backing BSON. Must be called before this storage
+     * is modified.
+     */
+    void releaseBson() {
+        loadAllFields();
+        _bson = BSONObj();
+        _bsonOwner = BSONObj();
+        _isExactlyBson = false;
+    }
+
     // Document uses these
     const ValueElement& getField(Position pos) const {
         verify(pos.found());
@@ -254,11 +320,21 @@ public:
 
     /// This skips missing values
     DocumentStorageIterator iterator() const {
+        loadAllFields();
         return DocumentStorageIterator(_firstElement, end(), false);
     }
 
     /// This includes missing values
     DocumentStorageIterator iteratorAll() const {
+        loadAllFields();
+        return DocumentStorageIterator(_firstElement, end(), true);
+    }
+
+    /**
+     * This includes missing values, but only those fields which have been converted from the
+     * backing BSON so far. The iterator is invalidated if any further fields are converted.
+     */
+    DocumentStorageIterator iteratorLoaded() const {
         return DocumentStorageIterator(_firstElement, end(), true);
     }
 
@@ -280,6 +356,9 @@ public:
         if (source.hasRandMetaField()) {
             setRandMetaField(source.getRandMetaField());
         }
+        if (source.hasSortKeyMetaField()) {
+            setSortKeyMetaField(source.getSortKeyMetaField());
+        }
     }
 
     bool hasTextScore() const {
@@ -304,6 +383,17 @@ public:
         _randVal = val;
     }
 
+    bool hasSortKeyMetaField() const {
+        return _metaFields.test(MetaType::SORT_KEY);
+    }
+    BSONObj getSortKeyMetaField() const {
+        return _sortKey;
+    }
+    void setSortKeyMetaField(BSONObj sortKey) {
+        _metaFields.set(MetaType::SORT_KEY);
+        _sortKey = sortKey.getOwned();
+    }
+
 private:
     /// Same as lastElement->next() or firstElement() if empty.
     const ValueElement* end() const {
@@ -313,6 +403,15 @@ private:
     /// Allocates space in _buffer. Copies existing data if there is any.
     void alloc(unsigned newSize);
 
+    /// Returns the position of the named field among those already converted, or Position().
+    Position findFieldLoaded(StringData name) const;
+
+    /**
+     * Converts the next field of the backing BSON, returning its position. Returns Position() if
+     * there are no more fields, or if the next field was metadata.
+     */
+    Position loadNextField();
+
     /// Call after adding field to _buffer and increasing _numFields
     void addFieldToHashTable(Position pos);
 
@@ -348,7 +447,7 @@ private:
     /// Adds all fields to the hash table
     void rehash() {
         hashTabInit();
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance())
+        for (DocumentStorageIterator it = iteratorLoaded(); !it.atEnd(); it.advance())
             addFieldToHashTable(it.position());
     }
 
@@ -385,6 +484,16 @@ private:
     std::bitset<MetaType::NUM_FIELDS> _metaFields;
     double _textScore;
     double _randVal;
+    BSONObj _sortKey;
+
+    // The BSON this storage was created from, if any, and the owned BSONObj which keeps its buffer
+    // alive. '_bsonIt' points at the first field of '_bson' which has not yet been converted, or is
+    // NULL once all fields have been.
+    BSONObj _bson;
+    BSONObj _bsonOwner;
+    const char* _bsonIt;
+    bool _stripMetadata;
+    bool _isExactlyBson;
     // When adding a field, make sure to update clone() method
 
     // Defined in document.cpp
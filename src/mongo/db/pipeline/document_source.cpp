@@ -77,6 +77,18 @@ const char* DocumentSource::getSourceName() const {
     return unknown;
 }
 
+bool DocumentSource::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+    batch->clear();
+    while (batch->size() < maxDocs) {
+        boost::optional<Document> next = getNext();
+        if (!next) {
+            break;
+        }
+        batch->push_back(std::move(*next));
+    }
+    return !batch->empty();
+}
+
 void DocumentSource::setSource(DocumentSource* pTheSource) {
     verify(!isValidInitialSource());
     verify(!pSource);
@@ -48,6 +48,7 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/lookup_join_table.h"
 #include "mongo/db/pipeline/lookup_set_cache.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/pipeline/value.h"
@@ -93,6 +94,21 @@ public:
      */
     virtual boost::optional<Document> getNext() = 0;
 
+    /**
+     * Replaces the contents of 'batch' with up to 'maxDocs' of the next Documents, in the order
+     * getNext() would have returned them. Returns false, leaving 'batch' empty, only at EOF. A
+     * batch may hold fewer than 'maxDocs' Documents even if there are more to come.
+     *
+     * The default implementation calls getNext() until the batch is full. Stages which can produce
+     * several results more cheaply than one at a time, or which consume all of their input before
+     * producing anything, override this to avoid the per-document call overhead. Callers may mix
+     * calls to getNext() and getNextBatch() freely.
+     */
+    virtual bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize);
+
+    /** The number of Documents stages request at a time when consuming input in batches. */
+    static const size_t kDefaultBatchSize = 128;
+
     /**
      * Inform the source that it is no longer needed and may release its resources.  After
      * dispose() is called the source must still be able to handle iteration requests, but may
@@ -326,6 +342,19 @@ public:
 
         virtual bool hasUniqueIdIndex(const NamespaceString& ns) const = 0;
 
+        /**
+         * Returns true if the collection 'ns' exists and has a non-simple default collation.
+         * Queries issued through directClient() against such a collection compare strings using
+         * that collation.
+         */
+        virtual bool hasNonSimpleDefaultCollation(const NamespaceString& ns) = 0;
+
+        /**
+         * Returns true if queries issued through directClient() read from the majority committed
+         * snapshot, as they do under readConcern "majority", rather than the latest data.
+         */
+        virtual bool isReadingFromMajorityCommittedSnapshot() = 0;
+
         // Add new methods as needed.
     };
 
@@ -357,6 +386,7 @@ public:
     // virtuals from DocumentSource
     ~DocumentSourceCursor() final;
     boost::optional<Document> getNext() final;
+    bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize) final;
     const char* getSourceName() const final;
     BSONObjSet getOutputSorts() final {
         return _outputSorts;
@@ -476,6 +506,7 @@ public:
     GetDepsReturn getDependencies(DepsTracker* deps) const final;
     Value serialize(bool explain = false) const final;
     boost::optional<Document> getNext() final;
+    bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize) final;
     void dispose() final;
     const char* getSourceName() const final;
     BSONObjSet getOutputSorts() final;
@@ -545,11 +576,41 @@ private:
     void initialize();
 
     /**
-     * Spill groups map to disk and returns an iterator to the file. Note: Since a sorted $group
-     * does not exhaust the previous stage before returning, and thus does not maintain as large a
-     * store of documents at any one time, only an unsorted group can spill to disk.
+     * Takes over from the unsorted case of initialize() once it has grouped enough input, and
+     * groups the rest, starting with 'batch', on 'numPartitions' shared worker threads. Each input
+     * document is sent to the partition chosen by the hash of its group key, so every group is
+     * owned by exactly one partition, which holds its own groups map and spills to its own files.
+     * The partitions' groups are then merged into those already in 'groups' and 'sortedFiles',
+     * whose accumulators use 'memoryUsageBytes' of the memory limit.
      */
-    std::shared_ptr<Sorter<Value, Value>::Iterator> spill();
+    void initializeParallel(
+        size_t numPartitions,
+        std::vector<Document> batch,
+        std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles,
+        int memoryUsageBytes);
+    class Partition;
+
+    /**
+     * Sets up the output of an unsorted $group, once all of its input has been consumed. If
+     * anything spilled, the output is the merge of 'sortedFiles', which must hold every group in
+     * input order, since the merge keeps the file order for equal _ids. Otherwise it is 'groups'.
+     */
+    void prepareOutput(std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles);
+
+    /**
+     * Adds the ROOT document of 'vars', whose group key is 'id', to the accumulators for that
+     * group in 'groupsMap', creating them if necessary, and updates '*memoryUsageBytes'. Returns
+     * true if a new group was created.
+     */
+    bool accumulate(const Value& id, Variables* vars, GroupsMap* groupsMap, int* memoryUsageBytes);
+
+    /**
+     * Spill 'groupsToSpill' to disk, leaving it empty, and returns an iterator to the file. Note:
+     * Since a sorted $group does not exhaust the previous stage before returning, and thus does not
+     * maintain as large a store of documents at any one time, only an unsorted group can spill to
+     * disk.
+     */
+    std::shared_ptr<Sorter<Value, Value>::Iterator> spill(GroupsMap* groupsToSpill) const;
 
     Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
@@ -582,6 +643,8 @@ private:
     bool _doingMerge;
     int _maxMemoryUsageBytes;
     std::unique_ptr<Variables> _variables;
+    // The size of '_variables', since each partition of a parallel $group needs its own.
+    size_t _numVariables;
     std::vector<std::string> _idFieldNames;  // used when id is a document
     std::vector<boost::intrusive_ptr<Expression>> _idExpressions;
 
@@ -606,6 +669,14 @@ private:
     std::pair<Value, Value> _firstPartOfNextGroup;
     // Only used when '_sorted' is true.
     boost::optional<Document> _firstDocOfNextGroup;
+
+    // Only filled in once a parallel $group has consumed its input, for explain.
+    struct PartitionStats {
+        long long docsProcessed;
+        long long groupsInMemory;
+        long long spills;
+    };
+    std::vector<PartitionStats> _partitionStats;
 };
 
 /**
@@ -638,6 +709,7 @@ class DocumentSourceMatch final : public DocumentSource {
 public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
+    bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize) final;
     const char* getSourceName() const final;
     Value serialize(bool explain = false) const final;
     boost::intrusive_ptr<DocumentSource> optimize() final;
@@ -740,6 +812,9 @@ private:
 
     void addDependencies(DepsTracker* deps) const;
 
+    /** Returns true if 'input' matches the filter of this stage. */
+    bool matches(const Document& input) const;
+
     std::unique_ptr<MatchExpression> _expression;
 
     // Cache the dependencies so that we know what fields we need to serialize to BSON for matching.
@@ -910,6 +985,7 @@ class DocumentSourceProject final : public DocumentSource {
 public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
+    bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize) final;
     const char* getSourceName() const final;
     /**
      * Attempt to move a subsequent $skip or $limit stage before the $project, thus reducing the
@@ -944,6 +1020,9 @@ private:
     DocumentSourceProject(const boost::intrusive_ptr<ExpressionContext>& pExpCtx,
                           const boost::intrusive_ptr<ExpressionObject>& exprObj);
 
+    /** Returns the result of applying the projection to 'input'. */
+    Document applyProjection(const Document& input);
+
     // configuration state
     std::unique_ptr<Variables> _variables;
     boost::intrusive_ptr<ExpressionObject> pEO;
@@ -1127,6 +1206,7 @@ class DocumentSourceSort final : public DocumentSource, public SplittableDocumen
 public:
     // virtuals from DocumentSource
     boost::optional<Document> getNext() final;
+    bool getNextBatch(std::vector<Document>* batch, size_t maxDocs = kDefaultBatchSize) final;
     const char* getSourceName() const final;
     void serializeToArray(std::vector<Value>& array, bool explain = false) const final;
 
@@ -1163,6 +1243,30 @@ public:
     /// Write out a Document whose contents are the sort key.
     Document serializeSortKey(bool explain) const;
 
+    /**
+     * Returns the pattern by which the "$sortKey" metadata this stage attaches to its output is
+     * ordered: one unnamed field per component of the sort, 1 if it is ascending and -1 if it is
+     * descending. Comparing two such sort keys as BSON with this pattern orders them as this stage
+     * orders the documents they were taken from.
+     */
+    BSONObj getSortKeyMetaFieldPattern() const;
+
+    /**
+     * Returns true if this stage merges the output of a $sort which ran on each shard.
+     */
+    bool isMergingPresorted() const {
+        return _mergingPresorted;
+    }
+
+    /**
+     * Tells this stage that its input already arrives in its sort order, as when the query system
+     * provides the sort from an index. The stage then only applies its limit, and attaches sort
+     * keys for mongos if mongos is merging its output.
+     */
+    void setInputIsPresorted() {
+        _inputIsPresorted = true;
+    }
+
     /**
       Create a sorting DocumentSource from BSON.
 
@@ -1236,6 +1340,15 @@ private:
     // This is used to merge pre-sorted results from a DocumentSourceMergeCursors.
     class IteratorFromCursor;
 
+    // This is used when the input is already in sorted order: on mongos, where the input has been
+    // merged by sort key, and when the query system provides the sort.
+    class IteratorFromSource;
+
+    /**
+     * Streams the input, which must already be in sorted order, to '_output', applying the limit.
+     */
+    void populateFromPresortedSource();
+
     /* these two parallel each other */
     typedef std::vector<boost::intrusive_ptr<Expression>> SortKey;
     SortKey vSortKey;
@@ -1244,6 +1357,13 @@ private:
     /// Extracts the fields in vSortKey from the Document;
     Value extractKey(const Document& d) const;
 
+    /**
+     * Returns the next document from '_output'. If mongos is merging the output of this stage,
+     * attaches the document's sort key as metadata, in the form described by
+     * getSortKeyMetaFieldPattern().
+     */
+    Document nextFromOutput();
+
     /// Compare two Values according to the specified sort key.
     int compare(const Value& lhs, const Value& rhs) const;
 
@@ -1275,7 +1395,12 @@ private:
 
     bool _done;
     bool _mergingPresorted;
+    bool _inputIsPresorted = false;
     std::unique_ptr<MySorter> _sorter;
+
+    // Set if '_sorter' reads the documents added to it from other threads, in which case their
+    // fields must all be converted from BSON before they are added.
+    bool _sorterIsParallel = false;
     std::unique_ptr<MySorter::Iterator> _output;
 };
 
@@ -1539,8 +1664,61 @@ private:
         invariant(false);
     }
 
+    /**
+     * The ways in which input documents can be joined with the foreign collection.
+     */
+    enum class JoinStrategy {
+        // Query the foreign collection once per input document.
+        kNestedLoop,
+        // Query the foreign collection once per block of input documents, using an $in over the
+        // block's local field values, and probe the results with each input document.
+        kBatchedIn,
+        // Load the entire (filtered) foreign collection into a LookupJoinTable once, and probe it
+        // with each input document.
+        kInMemoryHash,
+    };
+
+    static const char* joinStrategyName(JoinStrategy strategy);
+
     boost::optional<Document> unwindResult();
 
+    /**
+     * Moves on to the next input document, placing it in '_input' and preparing the foreign
+     * documents it joins with so that they can be retrieved with moreForeignResults() and
+     * nextForeignResult(). Returns false if there are no more input documents.
+     */
+    bool advanceInput();
+
+    bool moreForeignResults();
+    BSONObj nextForeignResult();
+
+    /**
+     * Returns the next input document which has not yet been joined, or boost::none if the source
+     * is exhausted.
+     */
+    boost::optional<Document> nextInputFromSource();
+
+    /**
+     * Pulls a block of input documents from the source and joins each of them with the foreign
+     * collection according to '_strategy', placing the results in '_joinedBlock'. May switch
+     * '_strategy' to kNestedLoop, in which case '_joinedBlock' is left empty and the input
+     * documents are returned to '_pendingInputs'.
+     */
+    void joinNextBlock();
+
+    /**
+     * Attempts to read all documents of the foreign collection which pass '_additionalFilter' into
+     * '_foreignTable'. Returns false, leaving '_foreignTable' empty, if they do not fit within the
+     * memory limit for the in-memory hash join. The documents are taken from, and added to, the
+     * LookupResultsCache when it is enabled.
+     */
+    bool loadForeignTable();
+
+    /**
+     * Joins 'input' against the documents in 'table'.
+     */
+    std::vector<BSONObj> probe(const LookupJoinTable& table, const Document& input);
+
     NamespaceString _fromNs;
     FieldPath _as;
     FieldPath _localField;
@@ -1556,6 +1734,29 @@ private:
     std::unique_ptr<DBClientCursor> _cursor;
     long long _cursorIndex = 0;
     boost::optional<Document> _input;
+
+    // The number of input documents joined at a time by the batched strategies.
+    const size_t _batchSize;
+    JoinStrategy _strategy;
+    bool _strategyChosen = false;
+
+    // Foreign documents joined with '_input' when '_strategy' is not kNestedLoop.
+    std::vector<BSONObj> _foreignResults;
+    size_t _foreignResultsIndex = 0;
+
+    // Input documents which have been joined but not yet returned, with their foreign documents.
+    std::deque<std::pair<Document, std::vector<BSONObj>>> _joinedBlock;
+
+    // Input documents pulled from the source which still need to be joined.
+    std::deque<Document> _pendingInputs;
+
+    // The filtered foreign collection, when '_strategy' is kInMemoryHash.
+    LookupJoinTable _foreignTable;
+
+    // Execution statistics, reported in explain output once the stage has started executing.
+    long long _foreignQueries = 0;
+    long long _probes = 0;
+    long long _probeHits = 0;
 };
 
 class DocumentSourceGraphLookUp final : public DocumentSource, public DocumentSourceNeedsMongod {
@@ -1604,14 +1805,27 @@ private:
     }
 
     /**
-     * Prepare the query to execute on the 'from' collection, using the contents of '_frontier'.
-     *
-     * Fills 'cached' with any values that were retrieved from the cache.
-     *
-     * Returns boost::none if no query is necessary, i.e., all values were retrieved from the cache.
-     * Otherwise, returns a query object.
+     * Removes from '_frontier' any values whose results are in the cache, or in the
+     * LookupResultsCache if '_useResultsCache' is set, and fills 'cached' with those results.
+     */
+    void retrieveCachedValues(BSONObjSet* cached);
+
+    /**
+     * Adds the results of a query for the values in ['begin', 'end') to the LookupResultsCache, one
+     * entry per value, unless the 'from' collection has changed since 'generation'.
+     */
+    void addToResultsCache(std::unordered_set<Value, Value::Hash>::const_iterator begin,
+                           std::unordered_set<Value, Value::Hash>::const_iterator end,
+                           const std::vector<BSONObj>& results,
+                           uint64_t generation);
+
+    /**
+     * Returns a query to execute on the 'from' collection for the values starting at '*it', of the
+     * form {connectToField: {$in: [...]}}. At most internalGraphLookupBatchSize values are put in
+     * one query, keeping its index bounds small; '*it' is advanced past the values used.
      */
-    boost::optional<BSONObj> constructQuery(BSONObjSet* cached);
+    BSONObj constructQuery(std::unordered_set<Value, Value::Hash>::const_iterator* it,
+                           std::unordered_set<Value, Value::Hash>::const_iterator end);
 
     /**
      * If we have internalized a $unwind, getNext() dispatches to this function.
@@ -1639,10 +1853,24 @@ private:
 
     /**
      * Assert that '_visited' and '_frontier' have not exceeded the maximum meory usage, and then
-     * evict from '_cache' until this source is using less than '_maxMemoryUsageBytes'.
+     * evict from '_cache' until this source is using less than '_maxMemoryUsageBytes'. If
+     * allowDiskUse was specified, the documents in '_visited' are first spilled to disk.
      */
     void checkMemoryUsage();
 
+    /**
+     * Writes the documents in '_visited' to a sorted file, keeping only their '_id' values in
+     * memory in '_spilledIds'.
+     */
+    void spillVisited();
+
+    /**
+     * Removes and returns one of the documents found by the current search, first from '_visited'
+     * and then from the files written by spillVisited(). Returns boost::none once all of them have
+     * been returned.
+     */
+    boost::optional<BSONObj> nextVisited();
+
     /**
      * Process 'result', adding it to '_visited' with the given 'depth', and updating '_frontier'
      * with the object's 'connectTo' values.
@@ -1660,7 +1888,7 @@ private:
     boost::optional<FieldPath> _depthField;
     boost::optional<long long> _maxDepth;
 
-    size_t _maxMemoryUsageBytes = 100 * 1024 * 1024;
+    const size_t _maxMemoryUsageBytes;
 
     // Track memory usage to ensure we don't exceed '_maxMemoryUsageBytes'.
     size_t _visitedUsageBytes = 0;
@@ -1673,10 +1901,23 @@ private:
     // document from the foreign collection, value is the document itself.
     std::unordered_map<Value, BSONObj, Value::Hash> _visited;
 
+    const bool _extSortAllowed;
+
+    // The '_id' values of nodes which were discovered for the current input and then spilled to
+    // disk. Only used during the breadth-first search; counted in '_visitedUsageBytes'.
+    std::unordered_set<Value, Value::Hash> _spilledIds;
+
+    // The documents spilled from '_visited', one sorted file per spill, not yet returned.
+    std::deque<std::shared_ptr<Sorter<Value, BSONObj>::Iterator>> _spilledVisited;
+
     // Caches query results to avoid repeating any work. This structure is maintained across calls
     // to getNext().
     LookupSetCache _cache;
 
+    // Whether the current search may use the server-wide LookupResultsCache, which is shared with
+    // other queries.
+    bool _useResultsCache = false;
+
     // When we have internalized a $unwind, we must keep track of the input document, since we will
     // need it for multiple "getNext()" calls.
     boost::optional<Document> _input;
@@ -30,6 +30,9 @@
 
 #include "mongo/db/pipeline/document_source.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/working_set_common.h"
@@ -69,6 +72,26 @@ boost::optional<Document> DocumentSourceCursor::getNext() {
     return out;
 }
 
+bool DocumentSourceCursor::getNextBatch(std::vector<Document>* batch, size_t maxDocs) {
+    pExpCtx->checkForInterrupt();
+
+    batch->clear();
+    if (_currentBatch.empty()) {
+        loadBatch();
+
+        if (_currentBatch.empty())  // exhausted the cursor
+            return false;
+    }
+
+    // Hand over as much of the current batch as fits, without going back to the PlanExecutor.
+    const auto end = _currentBatch.begin() + std::min(maxDocs, _currentBatch.size());
+    batch->insert(batch->end(),
+                  std::make_move_iterator(_currentBatch.begin()),
+                  std::make_move_iterator(end));
+    _currentBatch.erase(_currentBatch.begin(), end);
+    return !batch->empty();
+}
+
 void DocumentSourceCursor::dispose() {
     // Can't call in to PlanExecutor or ClientCursor registries from this function since it
     // will be called when an agg cursor is killed which would cause a deadlock.
@@ -101,7 +124,8 @@ void DocumentSourceCursor::loadBatch() {
             } else if (_dependencies) {
                 _currentBatch.push_back(_dependencies->extractFields(obj));
             } else {
-                _currentBatch.push_back(Document::fromBsonWithMetaData(obj));
+                // Fields are only converted if a later stage looks them up.
+                _currentBatch.push_back(Document::wrapBsonWithMetaData(obj));
             }
 
             if (_limit) {
@@ -36,7 +36,9 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/lookup_results_cache.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/stdx/memory.h"
 
 namespace mongo {
@@ -48,6 +50,15 @@ namespace dps = ::mongo::dotted_path_support;
 
 REGISTER_DOCUMENT_SOURCE(graphLookup, DocumentSourceGraphLookUp::createFromBson);
 
+// The most values of the frontier which $graphLookup puts in the $in of a single query on the
+// 'from' collection. Each query's index bounds, and the query itself, grow with this number.
+MONGO_EXPORT_SERVER_PARAMETER(internalGraphLookupBatchSize, int, 1000);
+
+// The memory $graphLookup may use for the documents it has found and the values it has yet to
+// search for, beyond which it spills found documents to disk if allowDiskUse is set, and otherwise
+// fails.
+MONGO_EXPORT_SERVER_PARAMETER(internalGraphLookupMaxMemoryBytes, int, 100 * 1024 * 1024);
+
 const char* DocumentSourceGraphLookUp::getSourceName() const {
     return "$graphLookup";
 }
@@ -71,11 +82,9 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNext() {
     performSearch();
 
     std::vector<Value> results;
-    while (!_visited.empty()) {
+    while (auto result = nextVisited()) {
         // Remove elements one at a time to avoid consuming more memory.
-        auto it = _visited.begin();
-        results.push_back(Value(it->second));
-        _visited.erase(it);
+        results.push_back(Value(std::move(*result)));
     }
 
     MutableDocument output(*_input);
@@ -83,7 +92,7 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNext() {
 
     _visitedUsageBytes = 0;
 
-    invariant(_visited.empty());
+    invariant(_visited.empty() && _spilledVisited.empty());
 
     return output.freeze();
 }
@@ -94,7 +103,9 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
     // If the unwind is not preserving empty arrays, we might have to process multiple inputs before
     // we get one that will produce an output.
     while (true) {
-        if (_visited.empty()) {
+        auto result = nextVisited();
+        const bool isNewInput = !result;
+        if (isNewInput) {
             // No results are left for the current input, so we should move on to the next one and
             // perform a new search.
             if (!(_input = pSource->getNext())) {
@@ -105,10 +116,11 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
             performSearch();
             _visitedUsageBytes = 0;
             _outputIndex = 0;
+            result = nextVisited();
         }
         MutableDocument unwound(*_input);
 
-        if (_visited.empty()) {
+        if (!result) {
             if ((*_unwind)->preserveNullAndEmptyArrays()) {
                 // Since "preserveNullAndEmptyArrays" was specified, output a document even though
                 // we had no result.
@@ -122,27 +134,54 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
                 continue;
             }
         } else {
-            auto it = _visited.begin();
-            unwound.setNestedField(_as, Value(it->second));
+            unwound.setNestedField(_as, Value(std::move(*result)));
             if (indexPath) {
                 unwound.setNestedField(*indexPath, Value(_outputIndex));
                 ++_outputIndex;
             }
-            _visited.erase(it);
         }
 
         return unwound.freeze();
     }
 }
 
+boost::optional<BSONObj> DocumentSourceGraphLookUp::nextVisited() {
+    if (!_visited.empty()) {
+        auto it = _visited.begin();
+        BSONObj result = std::move(it->second);
+        _visited.erase(it);
+        return result;
+    }
+
+    while (!_spilledVisited.empty()) {
+        auto& spilled = _spilledVisited.front();
+        if (spilled->more()) {
+            return spilled->next().second.getOwned();
+        }
+        _spilledVisited.pop_front();
+    }
+    return boost::none;
+}
+
 void DocumentSourceGraphLookUp::dispose() {
     _cache.clear();
     _frontier.clear();
     _visited.clear();
+    _spilledIds.clear();
+    _spilledVisited.clear();
     pSource->dispose();
 }
 
 void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
+    // Documents deleted from a capped collection to make room are not reported to the OpObserver,
+    // and the per-value results below are grouped without regard to the collection's collation, so
+    // neither kind of collection is cached across queries. The cache holds the latest data, so
+    // reads from the majority committed snapshot neither use nor fill it.
+    auto& resultsCache = LookupResultsCache::get();
+    _useResultsCache = resultsCache.isEnabled() && !_mongod->isCapped(_from) &&
+        !_mongod->hasNonSimpleDefaultCollation(_from) &&
+        !_mongod->isReadingFromMajorityCommittedSnapshot();
+
     long long depth = 0;
     bool shouldPerformAnotherQuery;
     do {
@@ -150,7 +189,7 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
 
         // Check whether each key in the frontier exists in the cache or needs to be queried.
         BSONObjSet cached;
-        auto query = constructQuery(&cached);
+        retrieveCachedValues(&cached);
 
         std::unordered_set<Value, Value::Hash> queried;
         _frontier.swap(queried);
@@ -165,17 +204,28 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
             checkMemoryUsage();
         }
 
-        if (query) {
-            // Query for all keys that were in the frontier and not in the cache, populating
-            // '_frontier' for the next iteration of search.
-            unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_from.ns(), *query);
+        // Query for all keys that were in the frontier and not in the cache, one batch at a time,
+        // populating '_frontier' for the next iteration of search.
+        auto batchStart = queried.cbegin();
+        while (batchStart != queried.cend()) {
+            const auto batchBegin = batchStart;
+            BSONObj query = constructQuery(&batchStart, queried.cend());
+            const uint64_t generation = _useResultsCache ? resultsCache.getGeneration(_from) : 0;
+            unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_from.ns(), query);
 
             // Iterate the cursor.
+            std::vector<BSONObj> results;
             while (cursor->more()) {
-                BSONObj result = cursor->nextSafe();
+                BSONObj result = cursor->nextSafe().getOwned();
                 shouldPerformAnotherQuery =
-                    addToVisitedAndFrontier(result.getOwned(), depth) || shouldPerformAnotherQuery;
+                    addToVisitedAndFrontier(result, depth) || shouldPerformAnotherQuery;
                 addToCache(result, queried);
+                if (_useResultsCache) {
+                    results.push_back(std::move(result));
+                }
+            }
+            if (_useResultsCache) {
+                addToResultsCache(batchBegin, batchStart, results, generation);
             }
             checkMemoryUsage();
         }
@@ -186,6 +236,13 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
 
     _frontier.clear();
     _frontierUsageBytes = 0;
+
+    // The documents found are all in '_visited' or spilled, so their '_id' values are no longer
+    // needed.
+    for (auto&& id : _spilledIds) {
+        _visitedUsageBytes -= id.getApproximateSize();
+    }
+    _spilledIds.clear();
 }
 
 namespace {
@@ -197,12 +254,28 @@ BSONObj addDepthFieldToObject(const std::string& field, long long depth, BSONObj
     return bob.obj();
 }
 
+/**
+ * Returns the key under which the LookupResultsCache holds the results of searching the 'from'
+ * collection for 'value', which is the query $graphLookup would run for 'value' alone.
+ */
+BSONObj resultsCacheKey(const std::string& connectToField, const Value& value) {
+    BSONObjBuilder key;
+    BSONObjBuilder query(key.subobjStart("graphLookup"));
+    BSONObjBuilder subobj(query.subobjStart(connectToField));
+    BSONArrayBuilder in(subobj.subarrayStart("$in"));
+    in << value;
+    in.doneFast();
+    subobj.doneFast();
+    query.doneFast();
+    return key.obj();
+}
+
 }  // namespace
 
 bool DocumentSourceGraphLookUp::addToVisitedAndFrontier(BSONObj result, long long depth) {
     Value _id = Value(result.getField("_id"));
 
-    if (_visited.find(_id) != _visited.end()) {
+    if (_visited.find(_id) != _visited.end() || _spilledIds.find(_id) != _spilledIds.end()) {
         // We've already seen this object, don't repeat any work.
         return false;
     }
@@ -267,13 +340,27 @@ void DocumentSourceGraphLookUp::addToCache(const BSONObj& result,
     }
 }
 
-boost::optional<BSONObj> DocumentSourceGraphLookUp::constructQuery(BSONObjSet* cached) {
+void DocumentSourceGraphLookUp::retrieveCachedValues(BSONObjSet* cached) {
     // Add any cached values to 'cached' and remove them from '_frontier'.
     for (auto it = _frontier.begin(); it != _frontier.end();) {
+        bool found = false;
         if (auto entry = _cache[*it]) {
             for (auto&& obj : *entry) {
                 cached->insert(obj);
             }
+            found = true;
+        } else if (_useResultsCache) {
+            auto results = LookupResultsCache::get().find(
+                _from, resultsCacheKey(_connectToField.getPath(false), *it));
+            if (results) {
+                for (auto&& obj : *results) {
+                    cached->insert(obj);
+                }
+                found = true;
+            }
+        }
+
+        if (found) {
             size_t valueSize = it->getApproximateSize();
             it = _frontier.erase(it);
 
@@ -285,20 +372,74 @@ boost::optional<BSONObj> DocumentSourceGraphLookUp::constructQuery(BSONObjSet* c
             it = std::next(it);
         }
     }
+}
+
+void DocumentSourceGraphLookUp::addToResultsCache(
+    std::unordered_set<Value, Value::Hash>::const_iterator begin,
+    std::unordered_set<Value, Value::Hash>::const_iterator end,
+    const std::vector<BSONObj>& results,
+    uint64_t generation) {
+    // Every value queried for gets an entry, even if nothing matched it. A result is added under
+    // each queried value it was found by, using the same rules as addToCache(). Those rules do not
+    // account for documents matched by a null, a regex or an array as a whole, so results for such
+    // values are not cached.
+    std::unordered_map<Value, std::vector<BSONObj>, Value::Hash> resultsByValue;
+    for (auto it = begin; it != end; ++it) {
+        if (!it->nullish() && !it->isArray() && it->getType() != RegEx) {
+            resultsByValue[*it];
+        }
+    }
+
+    auto addResult = [&resultsByValue](const Value& value, const BSONObj& result) {
+        auto entry = resultsByValue.find(value);
+        if (entry != resultsByValue.end()) {
+            entry->second.push_back(result);
+        }
+    };
+
+    for (auto&& result : results) {
+        BSONElementSet cacheByValues;
+        dps::extractAllElementsAlongPath(result, _connectToField.getPath(false), cacheByValues);
+
+        for (auto&& elem : cacheByValues) {
+            Value cacheBy(elem);
+            if (cacheBy.isArray()) {
+                for (auto&& val : cacheBy.getArray()) {
+                    addResult(val, result);
+                }
+            } else if (!cacheBy.missing()) {
+                addResult(cacheBy, result);
+            }
+        }
+    }
+
+    auto& resultsCache = LookupResultsCache::get();
+    for (auto&& entry : resultsByValue) {
+        resultsCache.insert(_from,
+                            resultsCacheKey(_connectToField.getPath(false), entry.first),
+                            generation,
+                            std::move(entry.second));
+    }
+}
+
+BSONObj DocumentSourceGraphLookUp::constructQuery(
+    std::unordered_set<Value, Value::Hash>::const_iterator* it,
+    std::unordered_set<Value, Value::Hash>::const_iterator end) {
+    const int batchSize = std::max(internalGraphLookupBatchSize.load(), 1);
 
     // Create a query of the form {_connectToField: {$in: [...]}}.
     BSONObjBuilder query;
     BSONObjBuilder subobj(query.subobjStart(_connectToField.getPath(false)));
     BSONArrayBuilder in(subobj.subarrayStart("$in"));
 
-    for (auto&& value : _frontier) {
-        in << value;
+    for (int i = 0; i < batchSize && *it != end; ++i, ++*it) {
+        in << **it;
     }
 
     in.doneFast();
     subobj.doneFast();
 
-    return _frontier.empty() ? boost::none : boost::optional<BSONObj>(query.obj());
+    return query.obj();
 }
 
 void DocumentSourceGraphLookUp::performSearch() {
@@ -351,13 +492,58 @@ BSONObjSet DocumentSourceGraphLookUp::getOutputSorts() {
 }
 
 void DocumentSourceGraphLookUp::checkMemoryUsage() {
-    // TODO SERVER-23980: Implement spilling to disk if allowDiskUse is specified.
+    if (_extSortAllowed && (_visitedUsageBytes + _frontierUsageBytes) >= _maxMemoryUsageBytes) {
+        spillVisited();
+    }
+
     uassert(40099,
-            "$graphLookup reached maximum memory consumption",
+            _extSortAllowed ? "$graphLookup reached maximum memory consumption"
+                            : "$graphLookup reached maximum memory consumption. Pass "
+                              "allowDiskUse:true to opt in to spilling to disk.",
             (_visitedUsageBytes + _frontierUsageBytes) < _maxMemoryUsageBytes);
     _cache.evictDownTo(_maxMemoryUsageBytes - _frontierUsageBytes - _visitedUsageBytes);
 }
 
+namespace {
+
+class SpillComparator {
+public:
+    typedef std::pair<Value, BSONObj> Data;
+    int operator()(const Data& lhs, const Data& rhs) const {
+        return Value::compare(lhs.first, rhs.first);
+    }
+};
+
+}  // namespace
+
+void DocumentSourceGraphLookUp::spillVisited() {
+    if (_visited.empty()) {
+        return;
+    }
+
+    // Write the documents in order of '_id', so that each file is a sorted run.
+    std::vector<std::pair<Value, BSONObj>> toSpill;
+    toSpill.reserve(_visited.size());
+    for (auto&& entry : _visited) {
+        toSpill.emplace_back(entry.first, std::move(entry.second));
+    }
+    _visited.clear();
+    std::sort(toSpill.begin(), toSpill.end(), [](const auto& lhs, const auto& rhs) {
+        return SpillComparator()(lhs, rhs) < 0;
+    });
+
+    SortedFileWriter<Value, BSONObj> writer(SortOptions().TempDir(pExpCtx->tempDir));
+    for (auto&& entry : toSpill) {
+        writer.addAlreadySorted(entry.first, entry.second);
+
+        // The '_id' stays in memory, and is still counted in '_visitedUsageBytes'.
+        _visitedUsageBytes -= static_cast<size_t>(entry.second.objsize());
+        _spilledIds.insert(std::move(entry.first));
+    }
+
+    _spilledVisited.emplace_back(writer.done());
+}
+
 void DocumentSourceGraphLookUp::serializeToArray(std::vector<Value>& array, bool explain) const {
     // Serialize default options.
     MutableDocument spec(DOC("from" << _from.coll() << "as" << _as.getPath(false)
@@ -412,7 +598,9 @@ DocumentSourceGraphLookUp::DocumentSourceGraphLookUp(
       _connectToField(std::move(connectToField)),
       _startWith(std::move(startWith)),
       _depthField(depthField),
-      _maxDepth(maxDepth) {}
+      _maxDepth(maxDepth),
+      _maxMemoryUsageBytes(std::max(internalGraphLookupMaxMemoryBytes.load(), 0)),
+      _extSortAllowed(expCtx->extSortAllowed && !expCtx->inRouter) {}
 
 intrusive_ptr<DocumentSource> DocumentSourceGraphLookUp::createFromBson(
     BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& expCtx) {
@@ -499,3 +687,6 @@ intrusive_ptr<DocumentSource> DocumentSourceGraphLookUp::createFromBson(
     return std::move(newSource);
 }
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
@@ -26,8 +26,13 @@
 *    it in the license file.
 */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
 #include "mongo/platform/basic.h"
 
+#include <deque>
+#include <set>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
@@ -35,6 +40,13 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/log.h"
 
 namespace mongo {
 
@@ -45,6 +57,132 @@ using std::vector;
 
 REGISTER_DOCUMENT_SOURCE(group, DocumentSourceGroup::createFromBson);
 
+namespace {
+// The number of threads an unsorted $group uses to group its input. 1 groups on the thread running
+// the aggregation.
+MONGO_EXPORT_SERVER_PARAMETER(internalGroupParallelism, int, 1);
+
+// Upper bound on internalGroupParallelism.
+const int kMaxGroupParallelism = 64;
+
+// The number of input documents an unsorted $group groups on the thread running the aggregation
+// before it spreads the rest of its input across worker threads. Smaller inputs are never worth
+// the cost of handing documents to other threads.
+MONGO_EXPORT_SERVER_PARAMETER(internalGroupParallelMinDocs, int, 10000);
+
+// The memory an unsorted $group may use for its groups before it spills them to disk, or fails if
+// it is not allowed to.
+MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceGroupMaxMemoryBytes, int, 100 * 1024 * 1024);
+
+// The number of worker threads shared by all parallel $groups in the process.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(internalGroupMaxWorkerThreads, int, 16);
+
+/**
+ * The worker threads shared by all parallel $groups. A $group reserves a ticket for each of its
+ * partitions before scheduling them, and the pool has a thread for every ticket, so a scheduled
+ * partition never waits behind the partitions of another $group.
+ */
+class GroupWorkerPool {
+    MONGO_DISALLOW_COPYING(GroupWorkerPool);
+
+public:
+    static GroupWorkerPool* get() {
+        // Never destroyed, since partitions may still be running at exit.
+        static GroupWorkerPool* pool =
+            new GroupWorkerPool(std::max(1, internalGroupMaxWorkerThreads));
+        return pool;
+    }
+
+    /**
+     * Reserves up to 'wanted' workers without waiting for any, and returns how many were reserved.
+     */
+    size_t reserve(size_t wanted) {
+        size_t reserved = 0;
+        while (reserved < wanted && _tickets.tryAcquire()) {
+            ++reserved;
+        }
+        return reserved;
+    }
+
+    void release(size_t workers) {
+        for (size_t i = 0; i < workers; ++i) {
+            _tickets.release();
+        }
+    }
+
+    ThreadPool* threads() {
+        return &_threads;
+    }
+
+private:
+    static ThreadPool::Options makeOptions(int numThreads) {
+        ThreadPool::Options options;
+        options.poolName = "GroupWorkers";
+        options.threadNamePrefix = "groupWorker-";
+        options.minThreads = 0;
+        options.maxThreads = numThreads;
+        return options;
+    }
+
+    explicit GroupWorkerPool(int numThreads)
+        : _tickets(numThreads), _threads(makeOptions(numThreads)) {
+        _threads.startup();
+    }
+
+    TicketHolder _tickets;
+    ThreadPool _threads;
+};
+
+/**
+ * The workers reserved by one parallel $group, which are returned to the pool on destruction.
+ */
+class GroupWorkerReservation {
+    MONGO_DISALLOW_COPYING(GroupWorkerReservation);
+
+public:
+    explicit GroupWorkerReservation(size_t wanted)
+        : _numWorkers(GroupWorkerPool::get()->reserve(wanted)) {}
+
+    ~GroupWorkerReservation() {
+        GroupWorkerPool::get()->release(_numWorkers);
+    }
+
+    size_t numWorkers() const {
+        return _numWorkers;
+    }
+
+private:
+    const size_t _numWorkers;
+};
+
+/**
+ * Returns a copy of 'input' holding only its top-level fields named in 'fields', fully converted
+ * from BSON. Input documents may share lazily converted sub-documents, which must not be converted
+ * by several partitions at once; copying only what the accumulators read keeps that conversion
+ * proportional to the fields they use rather than to the whole document.
+ */
+Document extractFieldsForWorker(const Document& input, const std::set<std::string>& fields) {
+    MutableDocument output(fields.size());
+    for (auto&& field : fields) {
+        Value value = input[field];
+        if (!value.missing()) {
+            output.addField(field, std::move(value));
+        }
+    }
+    output.copyMetaDataFrom(input);
+
+    Document doc = output.freeze();
+    doc.loadLazyFields();
+    return doc;
+}
+
+// The number of input documents sent to a partition of a parallel $group at a time.
+const size_t kPartitionChunkSize = 128;
+
+// The number of chunks which may be waiting for a partition before the input thread blocks.
+const size_t kMaxQueuedChunksPerPartition = 4;
+}  // namespace
+
 const char* DocumentSourceGroup::getSourceName() const {
     return "$group";
 }
@@ -68,6 +206,28 @@ boost::optional<Document> DocumentSourceGroup::getNext() {
     }
 }
 
+bool DocumentSourceGroup::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+    if (!_initialized)
+        initialize();
+
+    // Only the in-memory results can be returned more cheaply in bulk.
+    if (_spilled || _streaming) {
+        return DocumentSource::getNextBatch(batch, maxDocs);
+    }
+
+    pExpCtx->checkForInterrupt();
+
+    batch->clear();
+    while (batch->size() < maxDocs) {
+        boost::optional<Document> out = getNextStandard();
+        if (!out) {
+            break;
+        }
+        batch->push_back(std::move(*out));
+    }
+    return !batch->empty();
+}
+
 boost::optional<Document> DocumentSourceGroup::getNextSpilled() {
     // We aren't streaming, and we have spilled to disk.
     if (!_sorterIterator)
@@ -217,6 +377,18 @@ Value DocumentSourceGroup::serialize(bool explain) const {
     if (explain && findRelevantInputSort()) {
         return Value(DOC("$streamingGroup" << insides.freeze()));
     }
+
+    if (explain && !_partitionStats.empty()) {
+        vector<Value> partitions;
+        for (auto&& stats : _partitionStats) {
+            partitions.push_back(Value(DOC("docsProcessed" << stats.docsProcessed
+                                                           << "groupsInMemory"
+                                                           << stats.groupsInMemory
+                                                           << "spills"
+                                                           << stats.spills)));
+        }
+        return Value(DOC(getSourceName() << insides.freeze() << "partitions" << partitions));
+    }
     return Value(DOC(getSourceName() << insides.freeze()));
 }
 
@@ -243,7 +415,8 @@ intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
 DocumentSourceGroup::DocumentSourceGroup(const intrusive_ptr<ExpressionContext>& pExpCtx)
     : DocumentSource(pExpCtx),
       _doingMerge(false),
-      _maxMemoryUsageBytes(100 * 1024 * 1024),
+      _maxMemoryUsageBytes(internalDocumentSourceGroupMaxMemoryBytes.load()),
+      _numVariables(0),
       _inputSort(BSONObj()),
       _streaming(false),
       _initialized(false),
@@ -335,7 +508,8 @@ intrusive_ptr<DocumentSource> DocumentSourceGroup::createFromBson(
 
     uassert(15955, "a group specification must include an _id", !pGroup->_idExpressions.empty());
 
-    pGroup->_variables.reset(new Variables(idGenerator.getIdCount()));
+    pGroup->_numVariables = idGenerator.getIdCount();
+    pGroup->_variables.reset(new Variables(pGroup->_numVariables));
 
     return pGroup;
 }
@@ -454,80 +628,84 @@ void DocumentSourceGroup::initialize() {
 
     dassert(numAccumulators == vpExpression.size());
 
+    // Once this $group has grouped 'parallelMinDocs' documents itself, it tries to spread the rest
+    // of its input across 'parallelism' worker threads.
+    int parallelism = std::min(internalGroupParallelism.load(), kMaxGroupParallelism);
+    const long long parallelMinDocs = internalGroupParallelMinDocs.load();
+    long long docsGrouped = 0;
+
     // pushed to on spill()
     vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
     int memoryUsageBytes = 0;
 
     // This loop consumes all input from pSource and buckets it based on pIdExpression.
-    while (boost::optional<Document> input = pSource->getNext()) {
-        if (memoryUsageBytes > _maxMemoryUsageBytes) {
-            uassert(16945,
-                    "Exceeded memory limit for $group, but didn't allow external sort."
-                    " Pass allowDiskUse:true to opt in.",
-                    _extSortAllowed);
-            sortedFiles.push_back(spill());
-            memoryUsageBytes = 0;
+    vector<Document> batch;
+    while (pSource->getNextBatch(&batch)) {
+        if (parallelism > 1 && docsGrouped >= parallelMinDocs) {
+            GroupWorkerReservation workers(parallelism);
+            if (workers.numWorkers() > 1) {
+                initializeParallel(workers.numWorkers(),
+                                   std::move(batch),
+                                   std::move(sortedFiles),
+                                   memoryUsageBytes);
+                return;
+            }
+
+            // The shared workers are busy with other $groups, so group the rest here.
+            LOG(1) << "$group could not reserve worker threads, grouping serially";
+            parallelism = 1;
         }
+        docsGrouped += batch.size();
+
+        for (auto&& input : batch) {
+            if (memoryUsageBytes > _maxMemoryUsageBytes) {
+                uassert(16945,
+                        "Exceeded memory limit for $group, but didn't allow external sort."
+                        " Pass allowDiskUse:true to opt in.",
+                        _extSortAllowed);
+                sortedFiles.push_back(spill(&groups));
+                memoryUsageBytes = 0;
+            }
 
-        _variables->setRoot(*input);
+            _variables->setRoot(input);
 
-        /* get the _id value */
-        Value id = computeId(_variables.get());
+            /* get the _id value */
+            Value id = computeId(_variables.get());
 
-        /*
-          Look for the _id value in the map; if it's not there, add a
-          new entry with a blank accumulator.
-        */
-        const size_t oldSize = groups.size();
-        vector<intrusive_ptr<Accumulator>>& group = groups[id];
-        const bool inserted = groups.size() != oldSize;
+            const bool inserted = accumulate(id, _variables.get(), &groups, &memoryUsageBytes);
 
-        if (inserted) {
-            memoryUsageBytes += id.getApproximateSize();
+            // We are done with the ROOT document so release it.
+            _variables->clearRoot();
 
-            // Add the accumulators
-            group.reserve(numAccumulators);
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group.push_back(vpAccumulatorFactory[i]());
-            }
-        } else {
-            for (size_t i = 0; i < numAccumulators; i++) {
-                // subtract old mem usage. New usage added back after processing.
-                memoryUsageBytes -= group[i]->memUsageForSorter();
+            if (kDebugBuild && !storageGlobalParams.readOnly) {
+                // In debug mode, spill every time we have a duplicate id to stress merge logic.
+                if (!inserted  // is a dup
+                    &&
+                    !pExpCtx->inRouter  // can't spill to disk in router
+                    &&
+                    !_extSortAllowed  // don't change behavior when testing external sort
+                    &&
+                    sortedFiles.size() < 20  // don't open too many FDs
+                    ) {
+                    sortedFiles.push_back(spill(&groups));
+                }
             }
         }
+    }
 
-        /* tickle all the accumulators for the group we found */
-        dassert(numAccumulators == group.size());
-        for (size_t i = 0; i < numAccumulators; i++) {
-            group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-            memoryUsageBytes += group[i]->memUsageForSorter();
-        }
-
-        // We are done with the ROOT document so release it.
-        _variables->clearRoot();
-
-        if (kDebugBuild && !storageGlobalParams.readOnly) {
-            // In debug mode, spill every time we have a duplicate id to stress merge logic.
-            if (!inserted  // is a dup
-                &&
-                !pExpCtx->inRouter  // can't spill to disk in router
-                &&
-                !_extSortAllowed  // don't change behavior when testing external sort
-                &&
-                sortedFiles.size() < 20  // don't open too many FDs
-                ) {
-                sortedFiles.push_back(spill());
-            }
-        }
+    if (!sortedFiles.empty() && !groups.empty()) {
+        sortedFiles.push_back(spill(&groups));
     }
+    prepareOutput(std::move(sortedFiles));
+}
+
+void DocumentSourceGroup::prepareOutput(
+    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles) {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
 
     // These blocks do any final steps necessary to prepare to output results.
     if (!sortedFiles.empty()) {
         _spilled = true;
-        if (!groups.empty()) {
-            sortedFiles.push_back(spill());
-        }
 
         // We won't be using groups again so free its memory.
         GroupsMap().swap(groups);
@@ -549,10 +727,303 @@ void DocumentSourceGroup::initialize() {
     }
 }
 
-shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
+bool DocumentSourceGroup::accumulate(const Value& id,
+                                     Variables* vars,
+                                     GroupsMap* groupsMap,
+                                     int* memoryUsageBytes) {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
+
+    /*
+      Look for the _id value in the map; if it's not there, add a
+      new entry with a blank accumulator.
+    */
+    const size_t oldSize = groupsMap->size();
+    vector<intrusive_ptr<Accumulator>>& group = (*groupsMap)[id];
+    const bool inserted = groupsMap->size() != oldSize;
+
+    if (inserted) {
+        *memoryUsageBytes += id.getApproximateSize();
+
+        // Add the accumulators
+        group.reserve(numAccumulators);
+        for (size_t i = 0; i < numAccumulators; i++) {
+            group.push_back(vpAccumulatorFactory[i]());
+        }
+    } else {
+        for (size_t i = 0; i < numAccumulators; i++) {
+            // subtract old mem usage. New usage added back after processing.
+            *memoryUsageBytes -= group[i]->memUsageForSorter();
+        }
+    }
+
+    /* tickle all the accumulators for the group we found */
+    dassert(numAccumulators == group.size());
+    for (size_t i = 0; i < numAccumulators; i++) {
+        group[i]->process(vpExpression[i]->evaluate(vars), _doingMerge);
+        *memoryUsageBytes += group[i]->memUsageForSorter();
+    }
+
+    return inserted;
+}
+
+/**
+ * One partition of a parallel $group: a task on a shared worker thread which accumulates the input
+ * documents sent to it into its own groups map, spilling to its own files if the map exceeds its
+ * share of the memory limit.
+ *
+ * The group key of each document is computed by the input thread, which needs it to choose the
+ * partition. The worker only evaluates the accumulator expressions, which are not modified during
+ * execution and so may be evaluated by several partitions at once.
+ */
+class DocumentSourceGroup::Partition {
+    MONGO_DISALLOW_COPYING(Partition);
+
+public:
+    using Chunk = vector<std::pair<Value, Document>>;
+
+    Partition(DocumentSourceGroup* group, int maxMemoryUsageBytes)
+        : _group(group),
+          _maxMemoryUsageBytes(maxMemoryUsageBytes),
+          _variables(group->_numVariables) {}
+
+    ~Partition() {
+        // If the input thread failed, don't bother with the rest of the queued input.
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _queue.clear();
+        _inputDone = true;
+        _notEmpty.notify_one();
+        _done.wait(lk, [&] { return !_started || _finished; });
+    }
+
+    /**
+     * Schedules this partition on 'workers', which must have a thread reserved for it.
+     */
+    void start(ThreadPool* workers) {
+        uassertStatusOK(workers->schedule([this] { run(); }));
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _started = true;
+    }
+
+    /**
+     * Queues 'chunk' for this partition, waiting if too many chunks are already queued. Throws if
+     * the partition has failed, since the rest of its input would be ignored.
+     */
+    void push(Chunk chunk) {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _notFull.wait(lk, [&] {
+            return _queue.size() < kMaxQueuedChunksPerPartition || !_status.isOK();
+        });
+        uassertStatusOK(_status);
+        _queue.push_back(std::move(chunk));
+        _notEmpty.notify_one();
+    }
+
+    /** Signals that no more input will be pushed. */
+    void finishInput() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _inputDone = true;
+        _notEmpty.notify_one();
+    }
+
+    /**
+     * Waits for the partition to process all of its input, then returns whether it succeeded.
+     * Must be called after start() and finishInput().
+     */
+    Status waitForCompletion() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _done.wait(lk, [&] { return _finished; });
+        return _status;
+    }
+
+    GroupsMap groups;
+    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
+    PartitionStats stats = {0, 0, 0};
+
+private:
+    void run() {
+        while (true) {
+            Chunk chunk;
+            {
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                _notEmpty.wait(lk, [&] { return !_queue.empty() || _inputDone; });
+                if (_queue.empty()) {
+                    break;
+                }
+                chunk = std::move(_queue.front());
+                _queue.pop_front();
+                _notFull.notify_one();
+            }
+
+            try {
+                process(chunk);
+            } catch (...) {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _status = exceptionToStatus();
+                _queue.clear();
+                _notFull.notify_one();
+                break;
+            }
+        }
+
+        // The partition may be destroyed as soon as '_finished' is seen, so this must be the last
+        // use of its members.
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        stats.groupsInMemory = groups.size();
+        _finished = true;
+        _done.notify_all();
+    }
+
+    void process(const Chunk& chunk) {
+        for (auto&& input : chunk) {
+            if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+                uassert(16945,
+                        "Exceeded memory limit for $group, but didn't allow external sort."
+                        " Pass allowDiskUse:true to opt in.",
+                        _group->_extSortAllowed);
+                sortedFiles.push_back(_group->spill(&groups));
+                ++stats.spills;
+                _memoryUsageBytes = 0;
+            }
+
+            _variables.setRoot(input.second);
+            _group->accumulate(input.first, &_variables, &groups, &_memoryUsageBytes);
+            _variables.clearRoot();
+            ++stats.docsProcessed;
+        }
+    }
+
+    DocumentSourceGroup* const _group;
+    const int _maxMemoryUsageBytes;
+    int _memoryUsageBytes = 0;
+    Variables _variables;
+
+    // Protects the members below.
+    stdx::mutex _mutex;
+    stdx::condition_variable _notEmpty;
+    stdx::condition_variable _notFull;
+    stdx::condition_variable _done;
+    std::deque<Chunk> _queue;
+    bool _inputDone = false;
+    bool _started = false;
+    bool _finished = false;
+    Status _status = Status::OK();
+};
+
+void DocumentSourceGroup::initializeParallel(
+    size_t numPartitions,
+    vector<Document> batch,
+    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles,
+    int memoryUsageBytes) {
+    // The groups already built on this thread stay here, so the partitions share what is left of
+    // the memory limit.
+    const int partitionMemoryUsageBytes =
+        std::max(0, _maxMemoryUsageBytes - memoryUsageBytes) / static_cast<int>(numPartitions);
+
+    // The partitions only need the top-level fields that the accumulators read, unless one of them
+    // reads the whole document.
+    DepsTracker deps;
+    for (auto&& expression : vpExpression) {
+        expression->addDependencies(&deps);
+    }
+    std::set<std::string> fieldsForWorkers;
+    for (auto&& field : deps.fields) {
+        fieldsForWorkers.insert(FieldPath(field).getFieldName(0));
+    }
+
+    // Destroying the partitions, including on error, waits for their tasks to stop.
+    vector<std::unique_ptr<Partition>> partitions;
+    for (size_t i = 0; i < numPartitions; ++i) {
+        partitions.push_back(stdx::make_unique<Partition>(this, partitionMemoryUsageBytes));
+        partitions.back()->start(GroupWorkerPool::get()->threads());
+    }
+
+    vector<Partition::Chunk> pending(numPartitions);
+    do {
+        for (auto&& input : batch) {
+            _variables->setRoot(input);
+            Value id = computeId(_variables.get());
+            _variables->clearRoot();
+
+            Document forWorker;
+            if (deps.needWholeDocument) {
+                input.loadLazyFields();
+                forWorker = std::move(input);
+            } else {
+                forWorker = extractFieldsForWorker(input, fieldsForWorkers);
+            }
+
+            const size_t partition = Value::Hash()(id) % numPartitions;
+            pending[partition].emplace_back(std::move(id), std::move(forWorker));
+            if (pending[partition].size() >= kPartitionChunkSize) {
+                partitions[partition]->push(std::move(pending[partition]));
+                pending[partition].clear();
+            }
+        }
+    } while (pSource->getNextBatch(&batch));
+
+    for (size_t i = 0; i < numPartitions; ++i) {
+        if (!pending[i].empty()) {
+            partitions[i]->push(std::move(pending[i]));
+        }
+        partitions[i]->finishInput();
+    }
+
+    size_t partitionSpills = 0;
+    for (auto&& partition : partitions) {
+        uassertStatusOK(partition->waitForCompletion());
+        _partitionStats.push_back(partition->stats);
+        partitionSpills += partition->sortedFiles.size();
+    }
+
+    LOG(1) << "parallel $group processed its input in " << numPartitions << " partitions, which "
+           << "spilled to disk " << partitionSpills << " times";
+
+    // The partitions hold disjoint sets of groups, but each may overlap with the groups built on
+    // this thread before the input was partitioned. If anything spilled, all groups come out of
+    // the sorted merge, which returns the values of equal _ids in the order of their files. So the
+    // files must follow the input: the spills made on this thread, then 'groups', then the spills
+    // of each partition followed by its remaining groups. Otherwise merge the partitions into
+    // 'groups', after the input that was grouped here.
+    if (!sortedFiles.empty() || partitionSpills > 0) {
+        if (!groups.empty()) {
+            sortedFiles.push_back(spill(&groups));
+        }
+        for (auto&& partition : partitions) {
+            sortedFiles.insert(
+                sortedFiles.end(), partition->sortedFiles.begin(), partition->sortedFiles.end());
+            if (!partition->groups.empty()) {
+                sortedFiles.push_back(spill(&partition->groups));
+            }
+        }
+    } else {
+        for (auto&& partition : partitions) {
+            for (auto&& partitionGroup : partition->groups) {
+                auto it = groups.find(partitionGroup.first);
+                if (it == groups.end()) {
+                    groups.insert(std::move(partitionGroup));
+                    continue;
+                }
+
+                for (size_t i = 0; i < it->second.size(); ++i) {
+                    it->second[i]->process(
+                        partitionGroup.second[i]->getValue(/*toBeMerged=*/true),
+                        /*merging=*/true);
+                }
+            }
+            GroupsMap().swap(partition->groups);
+        }
+    }
+
+    prepareOutput(std::move(sortedFiles));
+}
+
+shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill(
+    GroupsMap* groupsToSpill) const {
     vector<const GroupsMap::value_type*> ptrs;  // using pointers to speed sorting
-    ptrs.reserve(groups.size());
-    for (GroupsMap::const_iterator it = groups.begin(), end = groups.end(); it != end; ++it) {
+    ptrs.reserve(groupsToSpill->size());
+    for (GroupsMap::const_iterator it = groupsToSpill->begin(), end = groupsToSpill->end();
+         it != end;
+         ++it) {
         ptrs.push_back(&*it);
     }
 
@@ -584,7 +1055,7 @@ shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
             break;
     }
 
-    groups.clear();
+    groupsToSpill->clear();
 
     return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
 }
@@ -852,7 +1323,8 @@ intrusive_ptr<DocumentSource> DocumentSourceGroup::getMergeSource() {
                                 ExpressionFieldPath::parse("$$ROOT." + vFieldName[i], vps));
     }
 
-    pMerger->_variables.reset(new Variables(idGenerator.getIdCount()));
+    pMerger->_numVariables = idGenerator.getIdCount();
+    pMerger->_variables.reset(new Variables(pMerger->_numVariables));
 
     return pMerger;
 }
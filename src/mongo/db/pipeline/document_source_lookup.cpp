@@ -26,24 +26,52 @@
  *    it in the license file.
  */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
 #include "mongo/platform/basic.h"
 
 #include "document_source.h"
 
+#include <unordered_set>
+
 #include "mongo/base/init.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/expression_algo.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/extensions_callback_noop.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/lookup_results_cache.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/log.h"
 
 namespace mongo {
 
 using boost::intrusive_ptr;
 using std::vector;
 
+// The number of input documents $lookup joins using a single query against the foreign collection.
+// A value of 1 or less makes $lookup query the foreign collection once per input document.
+MONGO_EXPORT_SERVER_PARAMETER(internalLookupBatchSize, int, 100);
+
+// The maximum number of bytes of foreign documents $lookup will hold in memory in order to join its
+// input without any further queries. 0 disables this strategy.
+MONGO_EXPORT_SERVER_PARAMETER(internalLookupInMemoryHashMaxBytes, int, 16 * 1024 * 1024);
+
+namespace {
+
+// The maximum number of bytes of foreign documents fetched for a single block of input documents.
+// Blocks whose results exceed this are joined one input document at a time instead.
+const size_t kMaxBatchedResultBytes = 100 * 1024 * 1024;
+
+// The maximum number of bytes of local field values placed in the $in of a single batched query.
+const size_t kMaxBatchedQueryBytes = BSONObjMaxUserSize / 2;
+
+}  // namespace
+
 DocumentSourceLookUp::DocumentSourceLookUp(NamespaceString fromNs,
                                            std::string as,
                                            std::string localField,
@@ -54,7 +82,10 @@ DocumentSourceLookUp::DocumentSourceLookUp(NamespaceString fromNs,
       _as(std::move(as)),
       _localField(std::move(localField)),
       _foreignField(foreignField),
-      _foreignFieldFieldName(std::move(foreignField)) {}
+      _foreignFieldFieldName(std::move(foreignField)),
+      _batchSize(std::max(internalLookupBatchSize.load(), 1)),
+      _strategy(_batchSize > 1 ? JoinStrategy::kBatchedIn : JoinStrategy::kNestedLoop),
+      _foreignTable(_foreignFieldFieldName) {}
 
 REGISTER_DOCUMENT_SOURCE(lookup, DocumentSourceLookUp::createFromBson);
 
@@ -83,8 +114,45 @@ BSONObj buildEqualityOrQuery(const std::string& fieldName, const vector<Value>&
     return orBuilder.obj();
 }
 
+/**
+ * Constructs a query of the following shape:
+ *  {$and: [{'fieldName': {$in: [values...]}}, <additionalFilter>]}
+ *
+ * If any of 'values' is a regex, an $or of equality predicates is used instead, since a regex
+ * inside of an $in is not treated as an equality comparison.
+ */
+BSONObj buildBatchedQuery(const std::string& fieldName,
+                          const vector<Value>& values,
+                          const BSONObj& additionalFilter) {
+    const bool containsRegex = std::any_of(
+        values.begin(), values.end(), [](const Value& val) { return val.getType() == RegEx; });
+
+    BSONObjBuilder query;
+    BSONArrayBuilder andObj(query.subarrayStart("$and"));
+    if (containsRegex) {
+        andObj.append(buildEqualityOrQuery(fieldName, values));
+    } else {
+        andObj.append(BSON(fieldName << BSON("$in" << Value(values))));
+    }
+    andObj.append(additionalFilter);
+    andObj.doneFast();
+    return query.obj();
+}
+
 }  // namespace
 
+const char* DocumentSourceLookUp::joinStrategyName(JoinStrategy strategy) {
+    switch (strategy) {
+        case JoinStrategy::kNestedLoop:
+            return "nestedLoop";
+        case JoinStrategy::kBatchedIn:
+            return "batchedIn";
+        case JoinStrategy::kInMemoryHash:
+            return "inMemoryHash";
+    }
+    MONGO_UNREACHABLE;
+}
+
 boost::optional<Document> DocumentSourceLookUp::getNext() {
     pExpCtx->checkForInterrupt();
 
@@ -98,39 +166,275 @@ boost::optional<Document> DocumentSourceLookUp::getNext() {
                                 ->getQuery();
     }
 
+    if (!_strategyChosen) {
+        // The batched strategies compare values without a collation, so they cannot be used to join
+        // with a collection whose queries would compare strings using its default collation.
+        if (_strategy != JoinStrategy::kNestedLoop &&
+            _mongod->hasNonSimpleDefaultCollation(_fromNs)) {
+            _strategy = JoinStrategy::kNestedLoop;
+        }
+        _strategyChosen = true;
+    }
+
     if (_handlingUnwind) {
         return unwindResult();
     }
 
-    boost::optional<Document> input = pSource->getNext();
-    if (!input)
+    if (!advanceInput())
         return {};
 
     // If we have not absorbed a $unwind, we cannot absorb a $match. If we have absorbed a $unwind,
     // '_handlingUnwind' would be set to true, and we would not have made it here.
     invariant(!_matchSrc);
 
-    BSONObj query = queryForInput(*input, _localField, _foreignFieldFieldName, BSONObj());
-    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), query);
-
     std::vector<Value> results;
     int objsize = 0;
-    while (cursor->more()) {
-        BSONObj result = cursor->nextSafe();
+    while (moreForeignResults()) {
+        BSONObj result = nextForeignResult();
         objsize += result.objsize();
         uassert(4568,
                 str::stream() << "Total size of documents in " << _fromNs.coll() << " matching "
-                              << query
+                              << queryForInput(
+                                     *_input, _localField, _foreignFieldFieldName, BSONObj())
                               << " exceeds maximum document size",
                 objsize <= BSONObjMaxInternalSize);
         results.push_back(Value(result));
     }
 
-    MutableDocument output(std::move(*input));
+    MutableDocument output(std::move(*_input));
     output.setNestedField(_as, Value(std::move(results)));
     return output.freeze();
 }
 
+boost::optional<Document> DocumentSourceLookUp::nextInputFromSource() {
+    if (!_pendingInputs.empty()) {
+        Document input = std::move(_pendingInputs.front());
+        _pendingInputs.pop_front();
+        return input;
+    }
+    return pSource->getNext();
+}
+
+bool DocumentSourceLookUp::advanceInput() {
+    _cursor.reset();
+    _foreignResults.clear();
+    _foreignResultsIndex = 0;
+
+    if (_strategy != JoinStrategy::kNestedLoop && _joinedBlock.empty()) {
+        joinNextBlock();
+    }
+
+    if (_strategy == JoinStrategy::kNestedLoop && _joinedBlock.empty()) {
+        _input = nextInputFromSource();
+        if (!_input)
+            return false;
+
+        BSONObj filter = _additionalFilter.value_or(BSONObj());
+        _cursor = _mongod->directClient()->query(
+            _fromNs.ns(), queryForInput(*_input, _localField, _foreignFieldFieldName, filter));
+        ++_foreignQueries;
+        return true;
+    }
+
+    if (_joinedBlock.empty()) {
+        _input = boost::none;
+        return false;
+    }
+
+    _input = std::move(_joinedBlock.front().first);
+    _foreignResults = std::move(_joinedBlock.front().second);
+    _joinedBlock.pop_front();
+    return true;
+}
+
+bool DocumentSourceLookUp::moreForeignResults() {
+    if (_cursor) {
+        return _cursor->more();
+    }
+    return _foreignResultsIndex < _foreignResults.size();
+}
+
+BSONObj DocumentSourceLookUp::nextForeignResult() {
+    if (_cursor) {
+        return _cursor->nextSafe();
+    }
+    invariant(_foreignResultsIndex < _foreignResults.size());
+    return _foreignResults[_foreignResultsIndex++];
+}
+
+void DocumentSourceLookUp::joinNextBlock() {
+    invariant(_strategy != JoinStrategy::kNestedLoop);
+    invariant(_joinedBlock.empty());
+
+    // Pull the next block of input documents, collecting the distinct values of their local fields.
+    std::vector<Document> inputs;
+    std::unordered_set<Value, Value::Hash> localValues;
+    size_t localValuesBytes = 0;
+    while (inputs.size() < _batchSize && localValuesBytes < kMaxBatchedQueryBytes) {
+        boost::optional<Document> input = nextInputFromSource();
+        if (!input)
+            break;
+
+        Value localValue = input->getNestedField(_localField);
+        if (localValue.missing()) {
+            localValue = Value(BSONNULL);
+        }
+
+        auto addLocalValue = [&](const Value& value) {
+            if (localValues.insert(value).second) {
+                localValuesBytes += value.getApproximateSize();
+            }
+        };
+        if (localValue.isArray()) {
+            for (auto&& elem : localValue.getArray()) {
+                addLocalValue(elem);
+            }
+        } else {
+            addLocalValue(localValue);
+        }
+
+        inputs.push_back(std::move(*input));
+    }
+
+    if (inputs.empty()) {
+        return;
+    }
+
+    // The first time through, if the input is large enough to fill a block, see whether the foreign
+    // collection is small enough to be joined entirely in memory.
+    if (_strategy == JoinStrategy::kBatchedIn && _foreignQueries == 0 &&
+        inputs.size() == _batchSize && loadForeignTable()) {
+        _strategy = JoinStrategy::kInMemoryHash;
+    }
+
+    if (_strategy == JoinStrategy::kInMemoryHash) {
+        for (auto&& input : inputs) {
+            auto results = probe(_foreignTable, input);
+            _joinedBlock.emplace_back(std::move(input), std::move(results));
+        }
+        return;
+    }
+
+    // Fetch every foreign document which could join with this block using a single query.
+    BSONObj query = buildBatchedQuery(_foreignFieldFieldName,
+                                      vector<Value>(localValues.begin(), localValues.end()),
+                                      _additionalFilter.value_or(BSONObj()));
+    std::unique_ptr<DBClientCursor> cursor =
+        _mongod->directClient()->query(_fromNs.ns(), query);
+    ++_foreignQueries;
+
+    LookupJoinTable blockTable(_foreignFieldFieldName);
+    while (cursor->more()) {
+        blockTable.insert(cursor->nextSafe().getOwned());
+
+        if (blockTable.getApproximateSize() > kMaxBatchedResultBytes) {
+            // The input documents join with too much of the foreign collection for batching to be
+            // worthwhile. Join them, and any input documents that follow, one at a time.
+            LOG(1) << "$lookup on " << _fromNs << " switching to the "
+                   << joinStrategyName(JoinStrategy::kNestedLoop)
+                   << " join strategy: batched query results exceed " << kMaxBatchedResultBytes
+                   << " bytes";
+            _strategy = JoinStrategy::kNestedLoop;
+            for (auto it = inputs.rbegin(); it != inputs.rend(); ++it) {
+                _pendingInputs.push_front(std::move(*it));
+            }
+            return;
+        }
+    }
+
+    for (auto&& input : inputs) {
+        auto results = probe(blockTable, input);
+        _joinedBlock.emplace_back(std::move(input), std::move(results));
+    }
+}
+
+bool DocumentSourceLookUp::loadForeignTable() {
+    const size_t maxBytes = std::max(internalLookupInMemoryHashMaxBytes.load(), 0);
+    if (maxBytes == 0) {
+        return false;
+    }
+
+    const BSONObj filter = _additionalFilter.value_or(BSONObj());
+
+    // Documents deleted from a capped collection to make room are not reported to the OpObserver,
+    // so results from capped collections are never cached. The cache holds the latest data, so
+    // reads from the majority committed snapshot neither use nor fill it.
+    auto& resultsCache = LookupResultsCache::get();
+    const bool useCache = resultsCache.isEnabled() && !_mongod->isCapped(_fromNs) &&
+        !_mongod->isReadingFromMajorityCommittedSnapshot();
+    const BSONObj cacheKey = BSON("lookupForeignTable" << filter);
+
+    if (useCache) {
+        if (auto cached = resultsCache.find(_fromNs, cacheKey)) {
+            for (auto&& doc : *cached) {
+                _foreignTable.insert(doc);
+
+                if (_foreignTable.getApproximateSize() > maxBytes) {
+                    _foreignTable.clear();
+                    return false;
+                }
+            }
+
+            LOG(1) << "$lookup on " << _fromNs << " using the "
+                   << joinStrategyName(JoinStrategy::kInMemoryHash) << " join strategy with "
+                   << _foreignTable.size() << " cached foreign documents";
+            return true;
+        }
+    }
+
+    const uint64_t generation = useCache ? resultsCache.getGeneration(_fromNs) : 0;
+    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), filter);
+    ++_foreignQueries;
+
+    std::vector<BSONObj> foreignDocs;
+    while (cursor->more()) {
+        BSONObj foreignDoc = cursor->nextSafe().getOwned();
+        if (useCache) {
+            foreignDocs.push_back(foreignDoc);
+        }
+        _foreignTable.insert(std::move(foreignDoc));
+
+        if (_foreignTable.getApproximateSize() > maxBytes) {
+            _foreignTable.clear();
+            return false;
+        }
+
+        pExpCtx->checkForInterrupt();
+    }
+
+    if (useCache) {
+        resultsCache.insert(_fromNs, cacheKey, generation, std::move(foreignDocs));
+    }
+
+    LOG(1) << "$lookup on " << _fromNs << " using the "
+           << joinStrategyName(JoinStrategy::kInMemoryHash) << " join strategy with "
+           << _foreignTable.size() << " foreign documents";
+    return true;
+}
+
+std::vector<BSONObj> DocumentSourceLookUp::probe(const LookupJoinTable& table,
+                                                 const Document& input) {
+    Value localValue = input.getNestedField(_localField);
+    if (localValue.missing()) {
+        localValue = Value(BSONNULL);
+    }
+
+    // The foreign documents in 'table' have already been filtered by '_additionalFilter', so only
+    // the joining predicate needs to be checked.
+    BSONObj joinQuery = queryForInput(input, _localField, _foreignFieldFieldName, BSONObj());
+    auto statusWithMatcher =
+        MatchExpressionParser::parse(joinQuery, ExtensionsCallbackNoop(), nullptr);
+    uassertStatusOK(statusWithMatcher.getStatus());
+
+    auto results = table.probe(localValue, *statusWithMatcher.getValue());
+
+    ++_probes;
+    if (!results.empty()) {
+        ++_probeHits;
+    }
+    return results;
+}
+
 Pipeline::SourceContainer::iterator DocumentSourceLookUp::optimizeAt(
     Pipeline::SourceContainer::iterator itr, Pipeline::SourceContainer* container) {
     invariant(*itr == this);
@@ -265,6 +569,10 @@ Pipeline::SourceContainer::iterator DocumentSourceLookUp::optimizeAt(
 
 void DocumentSourceLookUp::dispose() {
     _cursor.reset();
+    _foreignResults.clear();
+    _joinedBlock.clear();
+    _pendingInputs.clear();
+    _foreignTable.clear();
     pSource->dispose();
 }
 
@@ -333,20 +641,13 @@ boost::optional<Document> DocumentSourceLookUp::unwindResult() {
     // Loop until we get a document that has at least one match.
     // Note we may return early from this loop if our source stage is exhausted or if the unwind
     // source was asked to return empty arrays and we get a document without a match.
-    while (!_cursor || !_cursor->more()) {
-        _input = pSource->getNext();
-        if (!_input)
+    while (!_input || !moreForeignResults()) {
+        if (!advanceInput())
             return {};
-
-        BSONObj filter = _additionalFilter.value_or(BSONObj());
-        _cursor = _mongod->directClient()->query(
-            _fromNs.ns(),
-            DocumentSourceLookUp::queryForInput(
-                *_input, _localField, _foreignFieldFieldName, filter));
         _cursorIndex = 0;
 
-        if (_unwindSrc->preserveNullAndEmptyArrays() && !_cursor->more()) {
-            // There were no results for this cursor, but the $unwind was asked to preserve empty
+        if (_unwindSrc->preserveNullAndEmptyArrays() && !moreForeignResults()) {
+            // There were no results for this input, but the $unwind was asked to preserve empty
             // arrays, so we should return a document without the array.
             MutableDocument output(std::move(*_input));
             // Note this will correctly objects in the prefix of '_as', to act as if we had created
@@ -358,11 +659,11 @@ boost::optional<Document> DocumentSourceLookUp::unwindResult() {
             return output.freeze();
         }
     }
-    invariant(_cursor->more() && bool(_input));
-    auto nextVal = Value(_cursor->nextSafe());
+    invariant(moreForeignResults() && bool(_input));
+    auto nextVal = Value(nextForeignResult());
 
     // Move input document into output if this is the last or only result, otherwise perform a copy.
-    MutableDocument output(_cursor->more() ? *_input : std::move(*_input));
+    MutableDocument output(moreForeignResults() ? *_input : std::move(*_input));
     output.setNestedField(_as, nextVal);
 
     if (indexPath) {
@@ -399,6 +700,16 @@ void DocumentSourceLookUp::serializeToArray(std::vector<Value>& array, bool expl
                           ->getQuery());
         }
 
+        if (_strategyChosen) {
+            // The join strategy is only final once execution has begun.
+            output[getSourceName()]["joinStrategy"] = Value(joinStrategyName(_strategy));
+            output[getSourceName()]["joinStats"] =
+                Value(DOC("foreignQueries" << _foreignQueries << "probes" << _probes << "probeHits"
+                                           << _probeHits
+                                           << "foreignDocsInMemory"
+                                           << static_cast<long long>(_foreignTable.size())));
+        }
+
         array.push_back(Value(output.freeze()));
     } else {
         array.push_back(Value(output.freeze()));
@@ -28,6 +28,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <cctype>
 
 #include "mongo/db/jsobj.h"
@@ -70,13 +71,7 @@ boost::optional<Document> DocumentSourceMatch::getNext() {
     massert(17309, "Should never call getNext on a $match stage with $text clause", !_isTextQuery);
 
     while (boost::optional<Document> next = pSource->getNext()) {
-        // MatchExpression only takes BSON documents, so we have to make one. As an optimization,
-        // only serialize the fields we need to do the match.
-        if (_dependencies.needWholeDocument) {
-            if (_expression->matchesBSON(next->toBson())) {
-                return next;
-            }
-        } else if (_expression->matchesBSON(getObjectForMatch(*next, _dependencies.fields))) {
+        if (matches(*next)) {
             return next;
         }
     }
@@ -85,6 +80,37 @@ boost::optional<Document> DocumentSourceMatch::getNext() {
     return boost::none;
 }
 
+bool DocumentSourceMatch::getNextBatch(std::vector<Document>* batch, size_t maxDocs) {
+    pExpCtx->checkForInterrupt();
+
+    // The user facing error should have been generated earlier.
+    massert(17309, "Should never call getNext on a $match stage with $text clause", !_isTextQuery);
+
+    // Filter whole batches of input in place. Keep going until some document passes, since an
+    // empty batch signals EOF.
+    while (pSource->getNextBatch(batch, maxDocs)) {
+        batch->erase(std::remove_if(batch->begin(),
+                                    batch->end(),
+                                    [this](const Document& doc) { return !matches(doc); }),
+                     batch->end());
+        if (!batch->empty()) {
+            return true;
+        }
+    }
+
+    // We have exhausted the previous source.
+    return false;
+}
+
+bool DocumentSourceMatch::matches(const Document& input) const {
+    // MatchExpression only takes BSON documents, so we have to make one. As an optimization,
+    // only serialize the fields we need to do the match.
+    if (_dependencies.needWholeDocument) {
+        return _expression->matchesBSON(input.toBson());
+    }
+    return _expression->matchesBSON(getObjectForMatch(input, _dependencies.fields));
+}
+
 Pipeline::SourceContainer::iterator DocumentSourceMatch::optimizeAt(
     Pipeline::SourceContainer::iterator itr, Pipeline::SourceContainer* container) {
     invariant(*itr == this);
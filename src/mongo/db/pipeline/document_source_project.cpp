@@ -59,10 +59,26 @@ boost::optional<Document> DocumentSourceProject::getNext() {
     if (!input)
         return boost::none;
 
+    return applyProjection(*input);
+}
+
+bool DocumentSourceProject::getNextBatch(std::vector<Document>* batch, size_t maxDocs) {
+    pExpCtx->checkForInterrupt();
+
+    if (!pSource->getNextBatch(batch, maxDocs))
+        return false;
+
+    for (auto&& doc : *batch) {
+        doc = applyProjection(doc);
+    }
+    return true;
+}
+
+Document DocumentSourceProject::applyProjection(const Document& input) {
     /* create the result document */
     const size_t sizeHint = pEO->getSizeHint();
     MutableDocument out(sizeHint);
-    out.copyMetaDataFrom(*input);
+    out.copyMetaDataFrom(input);
 
     /*
       Use the ExpressionObject to create the base result.
@@ -70,8 +86,8 @@ boost::optional<Document> DocumentSourceProject::getNext() {
       If we're excluding fields at the top level, leave out the _id if
       it is found, because we took care of it above.
     */
-    _variables->setRoot(*input);
-    pEO->addToDocument(out, *input, _variables.get());
+    _variables->setRoot(input);
+    pEO->addToDocument(out, input, _variables.get());
     _variables->clearRoot();
 
     return out.freeze();
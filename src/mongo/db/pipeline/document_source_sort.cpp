@@ -68,7 +68,26 @@ boost::optional<Document> DocumentSourceSort::getNext() {
         return boost::none;
     }
 
-    return _output->next().second;
+    return nextFromOutput();
+}
+
+bool DocumentSourceSort::getNextBatch(vector<Document>* batch, size_t maxDocs) {
+    pExpCtx->checkForInterrupt();
+
+    if (!populated)
+        populate();
+
+    batch->clear();
+    while (batch->size() < maxDocs && _output && _output->more()) {
+        batch->push_back(nextFromOutput());
+    }
+
+    if (batch->empty()) {
+        // See getNext().
+        dispose();
+        return false;
+    }
+    return true;
 }
 
 void DocumentSourceSort::serializeToArray(vector<Value>& array, bool explain) const {
@@ -233,22 +252,67 @@ SortOptions DocumentSourceSort::makeSortOptions() const {
     if (pExpCtx->extSortAllowed && !pExpCtx->inRouter) {
         opts.extSortAllowed = true;
         opts.tempDir = pExpCtx->tempDir;
+
+        // Sort and spill runs in the background while the input is still being consumed.
+        // loadDocument() makes the documents safe to read from those threads.
+        opts.parallel = true;
+        opts.maxMergeFanIn = 64;
     }
 
     return opts;
 }
 
+class DocumentSourceSort::IteratorFromSource : public MySorter::Iterator {
+public:
+    IteratorFromSource(DocumentSourceSort* sorter, DocumentSource* source)
+        : _sorter(sorter), _source(source) {}
+
+    bool more() {
+        if (!_next) {
+            _next = _source->getNext();
+        }
+        return bool(_next);
+    }
+    Data next() {
+        invariant(more());
+        Document doc = std::move(*_next);
+        _next = boost::none;
+        return make_pair(_sorter->extractKey(doc), std::move(doc));
+    }
+
+private:
+    DocumentSourceSort* _sorter;
+    DocumentSource* _source;
+    boost::optional<Document> _next;
+};
+
+void DocumentSourceSort::populateFromPresortedSource() {
+    std::vector<std::shared_ptr<MySorter::Iterator>> iterators{
+        std::make_shared<IteratorFromSource>(this, pSource)};
+    _output.reset(MySorter::Iterator::merge(iterators, makeSortOptions(), Comparator(*this)));
+    populated = true;
+}
+
 void DocumentSourceSort::populate() {
-    if (_mergingPresorted) {
+    if (_inputIsPresorted) {
+        populateFromPresortedSource();
+    } else if (_mergingPresorted) {
         typedef DocumentSourceMergeCursors DSCursors;
         if (DSCursors* castedSource = dynamic_cast<DSCursors*>(pSource)) {
             populateFromCursors(castedSource->getCursors());
+        } else if (pExpCtx->inRouter) {
+            // mongos has already merged the shards' output in sorted order, using the sort keys
+            // they attached. All that is left to do is to apply the limit, if any.
+            populateFromPresortedSource();
         } else {
             msgasserted(17196, "can only mergePresorted from MergeCursors");
         }
     } else {
-        while (boost::optional<Document> next = pSource->getNext()) {
-            loadDocument(std::move(*next));
+        vector<Document> batch;
+        while (pSource->getNextBatch(&batch)) {
+            for (auto&& doc : batch) {
+                loadDocument(std::move(doc));
+            }
         }
         loadingDone();
     }
@@ -257,7 +321,14 @@ void DocumentSourceSort::populate() {
 void DocumentSourceSort::loadDocument(const Document& doc) {
     invariant(!populated);
     if (!_sorter) {
-        _sorter.reset(MySorter::make(makeSortOptions(), Comparator(*this)));
+        const SortOptions opts = makeSortOptions();
+        _sorterIsParallel = opts.parallel && opts.limit == 0;
+        _sorter.reset(MySorter::make(opts, Comparator(*this)));
+    }
+    if (_sorterIsParallel) {
+        // Looking up a field which is still backed by BSON converts it, so the sorter's threads
+        // could otherwise race to modify the document, and the sort key which shares its storage.
+        doc.loadLazyFields();
     }
     _sorter->add(extractKey(doc), doc);
 }
@@ -313,6 +384,43 @@ Value DocumentSourceSort::extractKey(const Document& d) const {
     return Value(std::move(keys));
 }
 
+Document DocumentSourceSort::nextFromOutput() {
+    auto next = _output->next();
+    if (!pExpCtx->inShard || !pExpCtx->mergeOnRouter || _mergingPresorted) {
+        return std::move(next.second);
+    }
+
+    // Missing fields are stored as undefined, which compares equal to a missing field both here
+    // and in BSON, and before every other type except MinKey.
+    BSONObjBuilder sortKey;
+    auto appendKeyPart = [&sortKey](const Value& part) {
+        if (part.missing()) {
+            sortKey.appendUndefined("");
+        } else {
+            part.addToBsonObj(&sortKey, "");
+        }
+    };
+    if (vSortKey.size() == 1) {
+        appendKeyPart(next.first);
+    } else {
+        for (auto&& part : next.first.getArray()) {
+            appendKeyPart(part);
+        }
+    }
+
+    MutableDocument doc(std::move(next.second));
+    doc.setSortKeyMetaField(sortKey.obj());
+    return doc.freeze();
+}
+
+BSONObj DocumentSourceSort::getSortKeyMetaFieldPattern() const {
+    BSONObjBuilder pattern;
+    for (auto&& ascending : vAscending) {
+        pattern.append("", ascending ? 1 : -1);
+    }
+    return pattern.obj();
+}
+
 int DocumentSourceSort::compare(const Value& lhs, const Value& rhs) const {
     /*
       populate() already checked that there is a non-empty sort key,
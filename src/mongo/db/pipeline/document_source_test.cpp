@@ -35,6 +35,7 @@
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_noop.h"
 #include "mongo/db/storage/storage_options.h"
@@ -257,6 +258,146 @@ TEST(Mock, Empty) {
 
 }  // namespace Mock
 
+namespace GetNextBatch {
+using mongo::DocumentSourceMock;
+
+class GetNextBatchTest : public Mock::Base, public unittest::Test {
+public:
+    GetNextBatchTest() : _tempDir("GetNextBatchTest") {
+        // $group may spill in debug builds.
+        ctx()->tempDir = _tempDir.path();
+    }
+
+protected:
+    intrusive_ptr<DocumentSource> makeStage(BSONObj spec) {
+        return DocumentSource::parse(ctx(), spec);
+    }
+
+    intrusive_ptr<DocumentSourceMock> makeMock(int numDocs) {
+        std::deque<Document> docs;
+        for (int i = 0; i < numDocs; ++i) {
+            docs.push_back(DOC("_id" << i << "a" << (i % 3)));
+        }
+        return DocumentSourceMock::create(std::move(docs));
+    }
+
+    /**
+     * Drains 'source' in batches of at most 'maxDocs', checking that no batch is empty or larger
+     * than 'maxDocs'.
+     */
+    BSONArray drainBatches(const intrusive_ptr<DocumentSource>& source, size_t maxDocs) {
+        BSONArrayBuilder out;
+        vector<Document> batch;
+        while (source->getNextBatch(&batch, maxDocs)) {
+            ASSERT_FALSE(batch.empty());
+            ASSERT_LTE(batch.size(), maxDocs);
+            for (auto&& doc : batch) {
+                out.append(doc.toBson());
+            }
+        }
+        ASSERT_TRUE(batch.empty());
+        ASSERT_FALSE(source->getNextBatch(&batch, maxDocs));
+        return out.arr();
+    }
+
+private:
+    unittest::TempDir _tempDir;
+};
+
+TEST_F(GetNextBatchTest, DefaultImplementationUsesGetNext) {
+    auto mock = makeMock(5);
+    vector<Document> batch;
+    ASSERT_TRUE(mock->getNextBatch(&batch, 2));
+    ASSERT_EQUALS(2U, batch.size());
+    ASSERT_EQUALS(DOC("_id" << 0 << "a" << 0), batch[0]);
+    ASSERT_TRUE(mock->getNextBatch(&batch, 2));
+    ASSERT_EQUALS(2U, batch.size());
+    ASSERT_EQUALS(DOC("_id" << 2 << "a" << 2), batch[0]);
+    ASSERT_TRUE(mock->getNextBatch(&batch, 2));
+    ASSERT_EQUALS(1U, batch.size());
+    ASSERT_FALSE(mock->getNextBatch(&batch, 2));
+    ASSERT_TRUE(batch.empty());
+}
+
+TEST_F(GetNextBatchTest, MatchSkipsBatchesWithNoMatches) {
+    auto mock = makeMock(10);
+    auto match = makeStage(BSON("$match" << BSON("_id" << BSON("$gte" << 7))));
+    match->setSource(mock.get());
+    ASSERT_EQUALS(BSON_ARRAY(BSON("_id" << 7 << "a" << 1) << BSON("_id" << 8 << "a" << 2)
+                                                          << BSON("_id" << 9 << "a" << 0)),
+                  drainBatches(match, 2));
+}
+
+TEST_F(GetNextBatchTest, ProjectTransformsEachDocument) {
+    auto mock = makeMock(3);
+    auto project = makeStage(fromjson("{$project: {_id: 0, b: {$add: ['$_id', '$a']}}}"));
+    project->setSource(mock.get());
+    ASSERT_EQUALS(BSON_ARRAY(BSON("b" << 0) << BSON("b" << 2) << BSON("b" << 4)),
+                  drainBatches(project, 2));
+}
+
+TEST_F(GetNextBatchTest, SortReturnsSortedBatches) {
+    auto mock = makeMock(5);
+    auto sort = makeStage(BSON("$sort" << BSON("a" << 1 << "_id" << -1)));
+    sort->setSource(mock.get());
+    ASSERT_EQUALS(BSON_ARRAY(BSON("_id" << 3 << "a" << 0) << BSON("_id" << 0 << "a" << 0)
+                                                          << BSON("_id" << 4 << "a" << 1)
+                                                          << BSON("_id" << 1 << "a" << 1)
+                                                          << BSON("_id" << 2 << "a" << 2)),
+                  drainBatches(sort, 2));
+}
+
+TEST_F(GetNextBatchTest, GroupReturnsAllGroups) {
+    auto mock = makeMock(300);
+    auto group = makeStage(BSON("$group" << BSON("_id"
+                                                 << "$a"
+                                                 << "count"
+                                                 << BSON("$sum" << 1))));
+    group->setSource(mock.get());
+    auto sort = makeStage(BSON("$sort" << BSON("_id" << 1)));
+    sort->setSource(group.get());
+    ASSERT_EQUALS(BSON_ARRAY(BSON("_id" << 0 << "count" << 100)
+                             << BSON("_id" << 1 << "count" << 100)
+                             << BSON("_id" << 2 << "count" << 100)),
+                  drainBatches(sort, 2));
+}
+
+TEST_F(GetNextBatchTest, GroupBatchesMatchGetNext) {
+    auto group = makeStage(BSON("$group" << BSON("_id"
+                                                 << "$_id")));
+    auto mock = makeMock(10);
+    group->setSource(mock.get());
+
+    auto expectedGroup = makeStage(BSON("$group" << BSON("_id"
+                                                         << "$_id")));
+    auto expectedMock = makeMock(10);
+    expectedGroup->setSource(expectedMock.get());
+    BSONArrayBuilder expected;
+    while (auto next = expectedGroup->getNext()) {
+        expected.append(next->toBson());
+    }
+
+    ASSERT_EQUALS(expected.arr(), drainBatches(group, 3));
+}
+
+TEST_F(GetNextBatchTest, CanMixGetNextAndGetNextBatch) {
+    auto mock = makeMock(4);
+    auto project = makeStage(BSON("$project" << BSON("a" << 1)));
+    project->setSource(mock.get());
+
+    ASSERT_EQUALS(DOC("_id" << 0 << "a" << 0), *project->getNext());
+    vector<Document> batch;
+    ASSERT_TRUE(project->getNextBatch(&batch, 2));
+    ASSERT_EQUALS(2U, batch.size());
+    ASSERT_EQUALS(DOC("_id" << 1 << "a" << 1), batch[0]);
+    ASSERT_EQUALS(DOC("_id" << 2 << "a" << 2), batch[1]);
+    ASSERT_EQUALS(DOC("_id" << 3 << "a" << 0), *project->getNext());
+    ASSERT_FALSE(project->getNext());
+    ASSERT_FALSE(project->getNextBatch(&batch, 2));
+}
+
+}  // namespace GetNextBatch
+
 namespace DocumentSourceRedact {
 using mongo::DocumentSourceRedact;
 using mongo::DocumentSourceMatch;
@@ -442,7 +583,10 @@ public:
     Base() : _tempDir("DocumentSourceGroupTest") {}
 
 protected:
-    void createGroup(const BSONObj& spec, bool inShard = false, bool inRouter = false) {
+    void createGroup(const BSONObj& spec,
+                     bool inShard = false,
+                     bool inRouter = false,
+                     bool extSortAllowed = false) {
         BSONObj namedSpec = BSON("$group" << spec);
         BSONElement specElement = namedSpec.firstElement();
 
@@ -450,6 +594,7 @@ protected:
             new ExpressionContext(_opCtx.get(), NamespaceString(ns));
         expressionContext->inShard = inShard;
         expressionContext->inRouter = inRouter;
+        expressionContext->extSortAllowed = extSortAllowed;
         // Won't spill to disk properly if it needs to.
         expressionContext->tempDir = _tempDir.path();
 
@@ -1345,6 +1490,90 @@ public:
     }
 };
 
+/** Sets a server parameter for the lifetime of this object. */
+class ServerParameterOverride {
+public:
+    ServerParameterOverride(const string& name, const string& value) {
+        auto it = ServerParameterSet::getGlobal()->getMap().find(name);
+        invariant(it != ServerParameterSet::getGlobal()->getMap().end());
+        _parameter = it->second;
+
+        BSONObjBuilder original;
+        _parameter->append(nullptr, original, name);
+        _original = original.obj();
+        ASSERT_OK(_parameter->setFromString(value));
+    }
+    ~ServerParameterOverride() {
+        ASSERT_OK(_parameter->set(_original.firstElement()));
+    }
+
+private:
+    ServerParameter* _parameter;
+    BSONObj _original;
+};
+
+/**
+ * A $group that spills both before and after it partitions its input across worker threads still
+ * accumulates the values of each group in input order.
+ */
+class ParallelSpillsPreserveInputOrder : public Base {
+public:
+    void run() {
+        // Group the first batch of input on this thread, then the rest on two partitions. Each
+        // value takes over 100 bytes, so both spill many times.
+        ServerParameterOverride parallelism("internalGroupParallelism", "2");
+        ServerParameterOverride parallelMinDocs("internalGroupParallelMinDocs", "100");
+        ServerParameterOverride maxMemoryBytes("internalDocumentSourceGroupMaxMemoryBytes",
+                                               "12000");
+
+        const int numDocs = 1000;
+        std::deque<Document> inputs;
+        for (int i = 0; i < numDocs; ++i) {
+            inputs.push_back(Document{{"k", i % 2}, {"v", value(i)}});
+        }
+        auto source = DocumentSourceMock::create(inputs);
+
+        const bool inShard = false;
+        const bool inRouter = false;
+        const bool extSortAllowed = true;
+        createGroup(fromjson("{_id: '$k', first: {$first: '$v'}, last: {$last: '$v'},"
+                             " all: {$push: '$v'}}"),
+                    inShard,
+                    inRouter,
+                    extSortAllowed);
+        group()->setSource(source.get());
+
+        size_t numResults = 0;
+        while (boost::optional<Document> result = group()->getNext()) {
+            ++numResults;
+            const int k = result->getField("_id").getInt();
+            vector<Value> expected;
+            for (int i = k; i < numDocs; i += 2) {
+                expected.push_back(Value(value(i)));
+            }
+            ASSERT_EQUALS(expected.front(), result->getField("first"));
+            ASSERT_EQUALS(expected.back(), result->getField("last"));
+            ASSERT_EQUALS(Value(expected), result->getField("all"));
+        }
+        ASSERT_EQUALS(2U, numResults);
+
+        // The input was partitioned, and the partitions spilled.
+        Value explained = group()->serialize(true);
+        vector<Value> partitions = explained["partitions"].getArray();
+        ASSERT_EQUALS(2U, partitions.size());
+        long long spills = 0;
+        for (auto&& partition : partitions) {
+            spills += partition["spills"].coerceToLong();
+        }
+        ASSERT_GT(spills, 0);
+    }
+
+private:
+    static string value(int i) {
+        return str::stream() << i << string(100, 'x');
+    }
+};
+
 }  // namespace DocumentSourceGroup
 
 namespace DocumentSourceProject {
@@ -2259,6 +2488,93 @@ public:
     }
 };
 
+/** A $sort on a shard whose output mongos merges attaches each document's sort key. */
+class AttachesSortKeyForRouter : public Base {
+public:
+    void run() {
+        ctx()->inShard = true;
+        ctx()->mergeOnRouter = true;
+        createSort(BSON("a" << 1 << "b" << -1));
+        ASSERT_EQUALS(BSON("" << 1 << "" << -1), sort()->getSortKeyMetaFieldPattern());
+
+        auto source = DocumentSourceMock::create({"{_id: 0, a: 2, b: 1}",
+                                                  "{_id: 1, b: 3}",
+                                                  "{_id: 2, a: 1, b: 5}",
+                                                  "{_id: 3, a: 1, b: 6}"});
+        sort()->setSource(source.get());
+
+        vector<BSONObj> expectedKeys = {BSON("" << BSONUndefined << "" << 3),
+                                        BSON("" << 1 << "" << 6),
+                                        BSON("" << 1 << "" << 5),
+                                        BSON("" << 2 << "" << 1)};
+        vector<int> expectedIds = {1, 3, 2, 0};
+        for (size_t i = 0; i < expectedIds.size(); ++i) {
+            auto next = sort()->getNext();
+            ASSERT(next);
+            ASSERT_EQUALS(expectedIds[i], next->getField("_id").getInt());
+            ASSERT(next->hasSortKeyMetaField());
+            ASSERT_EQUALS(expectedKeys[i], next->getSortKeyMetaField());
+
+            // Merging by the attached keys reproduces the order of the sort.
+            if (i > 0) {
+                ASSERT_LTE(expectedKeys[i - 1].woCompare(
+                               expectedKeys[i], sort()->getSortKeyMetaFieldPattern(), false),
+                           0);
+            }
+        }
+        assertExhausted();
+    }
+};
+
+/**
+ * When the query system provides the sort on a shard, the $sort still attaches sort keys for
+ * mongos, streaming its input and applying its limit.
+ */
+class AttachesSortKeyToPresortedInput : public Base {
+public:
+    void run() {
+        ctx()->inShard = true;
+        ctx()->mergeOnRouter = true;
+        auto sort = DocumentSourceSort::create(ctx(), BSON("a" << -1), 2);
+        sort->setInputIsPresorted();
+
+        auto source = DocumentSourceMock::create({"{a: 3}", "{a: 2}", "{a: 1}"});
+        sort->setSource(source.get());
+
+        for (int a = 3; a > 1; --a) {
+            auto next = sort->getNext();
+            ASSERT(next);
+            ASSERT_EQUALS(a, next->getField("a").getInt());
+            ASSERT_EQUALS(BSON("" << a), next->getSortKeyMetaField());
+        }
+        ASSERT(!sort->getNext());
+    }
+};
+
+/** On mongos the merging $sort passes through input which is already sorted, applying its limit. */
+class MergesPresortedInputOnRouter : public Base {
+public:
+    void run() {
+        ctx()->inRouter = true;
+        auto shardSort = DocumentSourceSort::create(ctx(), BSON("a" << 1), 2);
+        auto mergeSource = shardSort->getMergeSource();
+        auto mergeSort = dynamic_cast<DocumentSourceSort*>(mergeSource.get());
+        ASSERT(mergeSort);
+        ASSERT(mergeSort->isMergingPresorted());
+
+        auto source = DocumentSourceMock::create({"{a: 1}", "{a: 2}", "{a: 3}"});
+        mergeSort->setSource(source.get());
+
+        auto next = mergeSort->getNext();
+        ASSERT(next);
+        ASSERT_EQUALS(1, next->getField("a").getInt());
+        next = mergeSort->getNext();
+        ASSERT(next);
+        ASSERT_EQUALS(2, next->getField("a").getInt());
+        ASSERT(!mergeSort->getNext());
+    }
+};
+
 }  // namespace DocumentSourceSort
 
 namespace DocumentSourceUnwind {
@@ -3476,6 +3792,7 @@ public:
         add<DocumentSourceGroup::StreamingWithRootSubfield>();
         add<DocumentSourceGroup::StreamingWithConstantAndFieldPath>();
         add<DocumentSourceGroup::StreamingWithFieldRepeated>();
+        add<DocumentSourceGroup::ParallelSpillsPreserveInputOrder>();
 #endif
 
         add<DocumentSourceProject::Inclusion>();
@@ -3509,6 +3826,9 @@ public:
         add<DocumentSourceSort::ExtractArrayValues>();
         add<DocumentSourceSort::Dependencies>();
         add<DocumentSourceSort::OutputSort>();
+        add<DocumentSourceSort::AttachesSortKeyForRouter>();
+        add<DocumentSourceSort::AttachesSortKeyToPresortedInput>();
+        add<DocumentSourceSort::MergesPresortedInputOnRouter>();
 
         add<DocumentSourceUnwind::Empty>();
         add<DocumentSourceUnwind::EmptyArray>();
@@ -485,10 +485,13 @@ protected:
         ASSERT_EQ(output, input);
         ASSERT_EQ(output.hasTextScore(), input.hasTextScore());
         ASSERT_EQ(output.hasRandMetaField(), input.hasRandMetaField());
+        ASSERT_EQ(output.hasSortKeyMetaField(), input.hasSortKeyMetaField());
         if (input.hasTextScore())
             ASSERT_EQ(output.getTextScore(), input.getTextScore());
         if (input.hasRandMetaField())
             ASSERT_EQ(output.getRandMetaField(), input.getRandMetaField());
+        if (input.hasSortKeyMetaField())
+            ASSERT_EQ(output.getSortKeyMetaField(), input.getSortKeyMetaField());
 
         ASSERT(output.toBson().binaryEqual(input.toBson()));
     }
@@ -509,6 +512,12 @@ TEST_F(SerializationTest, MetaSerializationWithVals) {
     assertRoundTrips(docBuilder.freeze());
 }
 
+TEST_F(SerializationTest, SortKeySerialization) {
+    MutableDocument docBuilder(DOC("foo" << 10));
+    docBuilder.setSortKeyMetaField(BSON("" << 1 << "" << BSONUndefined));
+    assertRoundTrips(docBuilder.freeze());
+}
+
 TEST(MetaFields, ToAndFromBson) {
     MutableDocument docBuilder;
     docBuilder.setTextScore(10.0);
@@ -524,6 +533,20 @@ TEST(MetaFields, ToAndFromBson) {
     ASSERT_EQ(20, fromBson.getRandMetaField());
 }
 
+TEST(MetaFields, SortKeyToAndFromBson) {
+    MutableDocument docBuilder(DOC("a" << 1));
+    docBuilder.setSortKeyMetaField(BSON("" << 1 << "" << 2));
+    BSONObj obj = docBuilder.freeze().toBsonWithMetaData();
+    ASSERT_EQ(BSON("" << 1 << "" << 2), obj[Document::metaFieldSortKey].Obj());
+
+    for (auto&& fromBson :
+         {Document::fromBsonWithMetaData(obj), Document::wrapBsonWithMetaData(obj)}) {
+        ASSERT_TRUE(fromBson.hasSortKeyMetaField());
+        ASSERT_EQ(BSON("" << 1 << "" << 2), fromBson.getSortKeyMetaField());
+        ASSERT_EQUALS(BSON("a" << 1), fromBson.toBson());
+    }
+}
+
 TEST(MetaFields, BadSerialization) {
     // Write an unrecognized option to the buffer.
     BufBuilder bb;
@@ -541,6 +564,130 @@ TEST(MetaFields, BadSerialization) {
 }
 }  // namespace MetaFields
 
+namespace LazyBson {
+using mongo::Document;
+
+TEST(LazyBson, LooksUpFieldsInAnyOrder) {
+    Document doc = Document::wrapBsonWithMetaData(BSON("a" << 1 << "b"
+                                                           << "q"
+                                                           << "c" << 2.5));
+    ASSERT_EQUALS(Value(2.5), doc["c"]);
+    ASSERT_EQUALS(Value(1), doc["a"]);
+    ASSERT_EQUALS(Value(StringData("q")), doc["b"]);
+    ASSERT(doc["d"].missing());
+    ASSERT_EQUALS(3U, doc.size());
+    ASSERT_EQUALS("a", getNthField(doc, 0).first.toString());
+    ASSERT_EQUALS("b", getNthField(doc, 1).first.toString());
+    ASSERT_EQUALS("c", getNthField(doc, 2).first.toString());
+}
+
+TEST(LazyBson, EqualToEagerDocument) {
+    BSONObj obj = BSON("a" << 1 << "b" << BSON("c" << BSON_ARRAY(1 << BSON("d" << 2))) << "e"
+                           << BSONNULL);
+    Document lazy = Document::wrapBsonWithMetaData(obj);
+    Document eager = Document::fromBsonWithMetaData(obj);
+    ASSERT_EQUALS(eager, lazy);
+    ASSERT_EQUALS(Document::compare(eager, lazy), 0);
+}
+
+TEST(LazyBson, EmptyDocument) {
+    Document doc = Document::wrapBsonWithMetaData(BSONObj());
+    ASSERT(doc.empty());
+    ASSERT_EQUALS(0U, doc.size());
+    ASSERT_EQUALS(BSONObj(), doc.toBson());
+    ASSERT_EQUALS(0U, doc.clone().size());
+}
+
+TEST(LazyBson, ToBsonReturnsBackingBson) {
+    BSONObj obj = BSON("a" << 1 << "b" << BSON("c" << 2));
+    Document doc = Document::wrapBsonWithMetaData(obj);
+    ASSERT_EQUALS(Value(2), doc.getNestedField(FieldPath("b.c")));
+
+    BSONObj out = doc.toBson();
+    ASSERT(out.binaryEqual(obj));
+    ASSERT_EQUALS(obj.objdata(), out.objdata());
+}
+
+TEST(LazyBson, ReadsMetadataUpFront) {
+    BSONObj obj = BSON("a" << 1 << Document::metaFieldTextScore << 10.0
+                           << Document::metaFieldRandVal
+                           << 20.0);
+    Document doc = Document::wrapBsonWithMetaData(obj);
+    ASSERT_TRUE(doc.hasTextScore());
+    ASSERT_EQ(10.0, doc.getTextScore());
+    ASSERT_TRUE(doc.hasRandMetaField());
+    ASSERT_EQ(20.0, doc.getRandMetaField());
+
+    ASSERT(doc[Document::metaFieldTextScore].missing());
+    ASSERT_EQUALS(1U, doc.size());
+    ASSERT_EQUALS(BSON("a" << 1), doc.toBson());
+    ASSERT_EQUALS(obj, doc.toBsonWithMetaData());
+}
+
+TEST(LazyBson, DoesNotStripMetadataFromSubdocuments) {
+    BSONObj obj = BSON("a" << BSON(Document::metaFieldTextScore << 10.0));
+    Document doc = Document::wrapBsonWithMetaData(obj);
+    ASSERT_EQUALS(Value(10.0), doc["a"].getDocument()[Document::metaFieldTextScore]);
+    ASSERT_FALSE(doc["a"].getDocument().hasTextScore());
+    ASSERT_EQUALS(obj, doc.toBson());
+}
+
+TEST(LazyBson, DuplicateFieldNamesFindFirst) {
+    BSONObj obj = BSON("a" << 1 << "b" << 2 << "a" << 3);
+    Document lazy = Document::wrapBsonWithMetaData(obj);
+    ASSERT_EQUALS(Value(2), lazy["b"]);
+    ASSERT_EQUALS(Value(1), lazy["a"]);
+    ASSERT_EQUALS(3U, lazy.size());
+    ASSERT_EQUALS(obj, lazy.toBson());
+}
+
+TEST(LazyBson, ModifyingAfterLookup) {
+    BSONObj obj = BSON("a" << 1 << "b" << BSON("c" << 2 << "d" << 3) << "e" << 4);
+    Document doc = Document::wrapBsonWithMetaData(obj);
+    ASSERT_EQUALS(Value(1), doc["a"]);
+
+    MutableDocument md(doc);
+    md.setNestedField(FieldPath("b.d"), Value(30));
+    md.setField("f", Value(5));
+    md.remove("a");
+    Document modified = md.freeze();
+
+    ASSERT_EQUALS(BSON("b" << BSON("c" << 2 << "d" << 30) << "e" << 4 << "f" << 5),
+                      modified.toBson());
+
+    // The original is unchanged.
+    ASSERT_EQUALS(obj, doc.toBson());
+}
+
+TEST(LazyBson, ModifyingUnsharedStorage) {
+    BSONObj obj = BSON("a" << 1 << "b" << 2);
+    MutableDocument md(Document::wrapBsonWithMetaData(obj));
+    md.setField("a", Value(10));
+    ASSERT_EQUALS(BSON("a" << 10 << "b" << 2), md.freeze().toBson());
+}
+
+TEST(LazyBson, Clone) {
+    BSONObj obj = BSON("a" << 1 << "b" << BSON("c" << 2));
+    Document doc = Document::wrapBsonWithMetaData(obj);
+    ASSERT_EQUALS(Value(1), doc["a"]);
+
+    Document cloned = doc.clone();
+    ASSERT_EQUALS(doc, cloned);
+    ASSERT_EQUALS(obj, cloned.toBson());
+}
+
+TEST(LazyBson, MakesUnownedBsonOwned) {
+    Document doc;
+    {
+        BSONObj owned = BSON("a" << 1 << "b" << BSON("c" << 2));
+        BSONObj unowned(owned.objdata());
+        doc = Document::wrapBsonWithMetaData(unowned);
+    }
+    ASSERT_EQUALS(BSON("a" << 1 << "b" << BSON("c" << 2)), doc.toBson());
+    ASSERT_EQUALS(Value(2), doc.getNestedField(FieldPath("b.c")));
+}
+}  // namespace LazyBson
+
 namespace Value {
 
 using mongo::Value;
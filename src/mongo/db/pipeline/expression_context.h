@@ -54,6 +54,10 @@ public:
 
     bool inShard = false;
     bool inRouter = false;
+    // Set on the shards' half of a split pipeline when mongos, rather than a shard, runs the
+    // merging half. Tells $sort to attach the sort key of each document it returns, so that mongos
+    // can merge the shards' sorted streams.
+    bool mergeOnRouter = false;
     bool extSortAllowed = false;
     bool bypassDocumentValidation = false;
 
@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/lookup_join_table.h"
+
+#include <algorithm>
+
+#include "mongo/db/bson/dotted_path_support.h"
+#include "mongo/db/matcher/expression.h"
+
+namespace mongo {
+
+namespace dps = ::mongo::dotted_path_support;
+
+LookupJoinTable::LookupJoinTable(std::string foreignFieldName)
+    : _foreignFieldName(std::move(foreignFieldName)) {}
+
+void LookupJoinTable::insert(BSONObj foreignDoc) {
+    invariant(foreignDoc.isOwned());
+
+    // An equality predicate on the foreign field matches if any value along the path, or any array
+    // along the path taken as a whole, is equal to the value being searched for. Index the document
+    // under all of those values.
+    BSONElementSet elements;
+    dps::extractAllElementsAlongPath(foreignDoc, _foreignFieldName, elements, true);
+    dps::extractAllElementsAlongPath(foreignDoc, _foreignFieldName, elements, false);
+
+    const size_t position = _docs.size();
+    for (auto&& elem : elements) {
+        // Searching for null matches documents which are missing the path entirely, so a search for
+        // null never uses the hash table.
+        if (elem.isNull()) {
+            continue;
+        }
+
+        Value key(elem);
+        auto& positions = _keys[key];
+        if (positions.empty()) {
+            _memoryUsageBytes += key.getApproximateSize();
+        }
+        positions.push_back(position);
+        _memoryUsageBytes += sizeof(size_t);
+    }
+
+    _memoryUsageBytes += foreignDoc.objsize();
+    _docs.push_back(std::move(foreignDoc));
+}
+
+bool LookupJoinTable::addCandidates(const Value& value, std::vector<size_t>* candidates) const {
+    if (value.nullish()) {
+        return false;
+    }
+
+    auto it = _keys.find(value);
+    if (it != _keys.end()) {
+        candidates->insert(candidates->end(), it->second.begin(), it->second.end());
+    }
+    return true;
+}
+
+std::vector<BSONObj> LookupJoinTable::probe(const Value& localValue,
+                                            const MatchExpression& joinPredicate) const {
+    std::vector<size_t> candidates;
+    bool allDocsAreCandidates = false;
+
+    // An array local value is joined as if it were an $in over its elements.
+    if (localValue.isArray()) {
+        for (auto&& elem : localValue.getArray()) {
+            if (!addCandidates(elem, &candidates)) {
+                allDocsAreCandidates = true;
+                break;
+            }
+        }
+    } else {
+        allDocsAreCandidates = !addCandidates(localValue, &candidates);
+    }
+
+    std::vector<BSONObj> results;
+    auto checkCandidate = [this, &joinPredicate, &results](size_t position) {
+        if (joinPredicate.matchesBSON(_docs[position])) {
+            results.push_back(_docs[position]);
+        }
+    };
+
+    if (allDocsAreCandidates) {
+        for (size_t position = 0; position < _docs.size(); ++position) {
+            checkCandidate(position);
+        }
+        return results;
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (auto&& position : candidates) {
+        checkCandidate(position);
+    }
+    return results;
+}
+
+void LookupJoinTable::clear() {
+    _docs.clear();
+    _keys.clear();
+    _memoryUsageBytes = 0;
+}
+
+}  // namespace mongo
@@ -0,0 +1,99 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+class MatchExpression;
+
+/**
+ * An in-memory hash table over a set of documents from the foreign collection of a $lookup, keyed
+ * by the values found along the foreign field path. Used by $lookup to join a block of input
+ * documents against foreign documents which were fetched with a single query, instead of issuing
+ * one query per input document.
+ *
+ * The hash table is only used to find candidate documents. Each candidate is then checked against
+ * the equality predicate that $lookup would have used to query the foreign collection for that
+ * input document, so the documents returned by probe() are exactly those the query would return.
+ */
+class LookupJoinTable {
+public:
+    explicit LookupJoinTable(std::string foreignFieldName);
+
+    /**
+     * Adds 'foreignDoc' to the table, indexing it under every value found along the foreign field
+     * path. 'foreignDoc' must be owned.
+     */
+    void insert(BSONObj foreignDoc);
+
+    /**
+     * Returns the documents in the table which match 'joinPredicate', given that 'joinPredicate'
+     * is the predicate built by $lookup for an input document whose local field value is
+     * 'localValue'. Documents are returned in the order in which they were inserted.
+     */
+    std::vector<BSONObj> probe(const Value& localValue, const MatchExpression& joinPredicate) const;
+
+    void clear();
+
+    size_t size() const {
+        return _docs.size();
+    }
+
+    /**
+     * Returns an approximation of the memory used by the documents and keys in this table, not
+     * including the overhead of the hash table itself.
+     */
+    size_t getApproximateSize() const {
+        return _memoryUsageBytes;
+    }
+
+private:
+    /**
+     * Adds the positions of all documents which may match an equality predicate on 'value' to
+     * 'candidates'. Returns false if every document in the table must be considered a candidate.
+     */
+    bool addCandidates(const Value& value, std::vector<size_t>* candidates) const;
+
+    const std::string _foreignFieldName;
+
+    // Documents in insertion order; the index of each is used to refer to it from '_keys'.
+    std::vector<BSONObj> _docs;
+    std::unordered_map<Value, std::vector<size_t>, Value::Hash> _keys;
+
+    size_t _memoryUsageBytes = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,146 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/extensions_callback_noop.h"
+#include "mongo/db/pipeline/lookup_join_table.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Probes 'table' with 'localValue' using the same equality predicate that $lookup would use to
+ * query the foreign collection, and returns the _ids of the matching documents in order.
+ */
+BSONArray probeIds(const LookupJoinTable& table,
+                          const std::string& foreignField,
+                          const Value& localValue) {
+    BSONObjBuilder predicate;
+    if (localValue.isArray()) {
+        predicate << foreignField << BSON("$in" << localValue);
+    } else {
+        predicate << foreignField << BSON("$eq" << localValue);
+    }
+    auto statusWithMatcher =
+        MatchExpressionParser::parse(predicate.obj(), ExtensionsCallbackNoop(), nullptr);
+    ASSERT_OK(statusWithMatcher.getStatus());
+
+    BSONArrayBuilder ids;
+    for (auto&& doc : table.probe(localValue, *statusWithMatcher.getValue())) {
+        ids.append(doc["_id"]);
+    }
+    return ids.arr();
+}
+
+LookupJoinTable makeTable(const std::string& foreignField, const std::vector<std::string>& docs) {
+    LookupJoinTable table(foreignField);
+    for (auto&& doc : docs) {
+        table.insert(fromjson(doc));
+    }
+    return table;
+}
+
+TEST(LookupJoinTableTest, ScalarProbeFindsEqualValues) {
+    auto table = makeTable("b", {"{_id: 0, b: 1}", "{_id: 1, b: 2}", "{_id: 2, b: 1}"});
+    ASSERT_EQ(BSON_ARRAY(0 << 2), probeIds(table, "b", Value(1)));
+    ASSERT_EQ(BSON_ARRAY(1), probeIds(table, "b", Value(2)));
+    ASSERT_EQ(BSONArray(), probeIds(table, "b", Value(3)));
+}
+
+TEST(LookupJoinTableTest, NumericValuesOfDifferentTypesAreEqual) {
+    auto table =
+        makeTable("b", {"{_id: 0, b: 1}", "{_id: 1, b: NumberLong(1)}", "{_id: 2, b: 1.0}"});
+    ASSERT_EQ(BSON_ARRAY(0 << 1 << 2), probeIds(table, "b", Value(1LL)));
+}
+
+TEST(LookupJoinTableTest, ProbeMatchesElementsOfForeignArrays) {
+    auto table = makeTable("b", {"{_id: 0, b: [1, 2]}", "{_id: 1, b: [2, 3]}", "{_id: 2, b: 4}"});
+    ASSERT_EQ(BSON_ARRAY(0 << 1), probeIds(table, "b", Value(2)));
+    ASSERT_EQ(BSON_ARRAY(0), probeIds(table, "b", Value(1)));
+}
+
+TEST(LookupJoinTableTest, ProbeMatchesWholeForeignArrays) {
+    auto table = makeTable("b", {"{_id: 0, b: [1, 2]}", "{_id: 1, b: [[1, 2], 3]}"});
+    BSONObj query = BSON("x" << BSON_ARRAY(BSON_ARRAY(1 << 2)));
+    ASSERT_EQ(BSON_ARRAY(0 << 1), probeIds(table, "b", Value(query["x"])));
+}
+
+TEST(LookupJoinTableTest, ArrayLocalValueActsAsIn) {
+    auto table = makeTable("b", {"{_id: 0, b: 1}", "{_id: 1, b: 2}", "{_id: 2, b: 3}"});
+    BSONObj query = BSON("x" << BSON_ARRAY(3 << 1 << 5));
+    ASSERT_EQ(BSON_ARRAY(0 << 2), probeIds(table, "b", Value(query["x"])));
+}
+
+TEST(LookupJoinTableTest, ProbeTraversesArraysAlongDottedPath) {
+    auto table = makeTable("b.c",
+                           {"{_id: 0, b: [{c: 1}, {c: 2}]}",
+                            "{_id: 1, b: {c: [2, 3]}}",
+                            "{_id: 2, b: [{c: [4]}]}",
+                            "{_id: 3, b: 2}"});
+    ASSERT_EQ(BSON_ARRAY(0 << 1), probeIds(table, "b.c", Value(2)));
+    ASSERT_EQ(BSON_ARRAY(2), probeIds(table, "b.c", Value(4)));
+}
+
+TEST(LookupJoinTableTest, NullProbeMatchesNullAndMissing) {
+    auto table = makeTable("b.c",
+                           {"{_id: 0, b: {c: null}}",
+                            "{_id: 1}",
+                            "{_id: 2, b: [{c: 1}, {d: 1}]}",
+                            "{_id: 3, b: {c: 1}}"});
+    ASSERT_EQ(BSON_ARRAY(0 << 1 << 2), probeIds(table, "b.c", Value(BSONNULL)));
+}
+
+TEST(LookupJoinTableTest, ArrayLocalValueContainingNullMatchesMissing) {
+    auto table = makeTable("b", {"{_id: 0, b: 1}", "{_id: 1}", "{_id: 2, b: 2}"});
+    BSONObj query = BSON("x" << BSON_ARRAY(2 << BSONNULL));
+    ASSERT_EQ(BSON_ARRAY(1 << 2), probeIds(table, "b", Value(query["x"])));
+}
+
+TEST(LookupJoinTableTest, ObjectValuesAreComparedWhole) {
+    auto table = makeTable("b", {"{_id: 0, b: {x: 1, y: 2}}", "{_id: 1, b: {y: 2, x: 1}}"});
+    ASSERT_EQ(BSON_ARRAY(0), probeIds(table, "b", Value(fromjson("{x: 1, y: 2}"))));
+}
+
+TEST(LookupJoinTableTest, ClearRemovesAllDocuments) {
+    auto table = makeTable("b", {"{_id: 0, b: 1}", "{_id: 1, b: 2}"});
+    ASSERT_EQ(2U, table.size());
+    ASSERT_GT(table.getApproximateSize(), 0U);
+
+    table.clear();
+    ASSERT_EQ(0U, table.size());
+    ASSERT_EQ(0U, table.getApproximateSize());
+    ASSERT_EQ(BSONArray(), probeIds(table, "b", Value(1)));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,251 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/lookup_results_cache.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+namespace {
+
+// The most bytes of documents the server-wide $lookup results cache may hold. 0 disables it.
+std::atomic<int> internalLookupResultsCacheMaxBytes(0);  // NOLINT
+
+class ExportedLookupResultsCacheMaxBytesParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedLookupResultsCacheMaxBytesParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(),
+              "internalLookupResultsCacheMaxBytes",
+              &internalLookupResultsCacheMaxBytes) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 0) {
+            return Status(ErrorCodes::BadValue,
+                          "internalLookupResultsCacheMaxBytes must not be negative");
+        }
+        return Status::OK();
+    }
+
+    // Without this the compiler complains that defining set(const int&)
+    // hides set(const BSONElement&)
+    using ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>::set;
+
+    virtual Status set(const int& newValue) {
+        Status status =
+            ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>::set(newValue);
+        if (status.isOK()) {
+            LookupResultsCache::get().setMaxBytes(newValue);
+        }
+        return status;
+    }
+
+} exportedLookupResultsCacheMaxBytesParam;
+
+size_t approximateSize(const std::vector<BSONObj>& results) {
+    size_t bytes = sizeof(results);
+    for (auto&& result : results) {
+        bytes += sizeof(BSONObj) + static_cast<size_t>(result.objsize());
+    }
+    return bytes;
+}
+
+}  // namespace
+
+const size_t LookupResultsCache::kMinNamespacesBeforePrune;
+
+LookupResultsCache& LookupResultsCache::get() {
+    static LookupResultsCache cache;
+    return cache;
+}
+
+bool LookupResultsCache::isEnabled() const {
+    return _maxBytes.load() > 0;
+}
+
+uint64_t LookupResultsCache::getGeneration(const NamespaceString& nss) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto nsIt = _namespaces.find(nss.ns());
+    if (nsIt == _namespaces.end()) {
+        if (_namespaces.size() >= _pruneNamespacesAt) {
+            _pruneNamespaces_inlock();
+        }
+        nsIt = _namespaces.emplace(nss.ns(), NamespaceEntries()).first;
+        nsIt->second.generation = ++_nextGeneration;
+    }
+    return nsIt->second.generation;
+}
+
+LookupResultsCache::Results LookupResultsCache::find(const NamespaceString& nss,
+                                                     const BSONObj& key) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto nsIt = _namespaces.find(nss.ns());
+    if (nsIt != _namespaces.end()) {
+        auto& entries = nsIt->second.entries;
+        auto it = entries.find(std::string(key.objdata(), key.objsize()));
+        if (it != entries.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second);
+            ++_hits;
+            return it->second->results;
+        }
+    }
+    ++_misses;
+    return nullptr;
+}
+
+void LookupResultsCache::insert(const NamespaceString& nss,
+                                const BSONObj& key,
+                                uint64_t generation,
+                                std::vector<BSONObj> results) {
+    const size_t maxBytes = static_cast<size_t>(_maxBytes.load());
+    std::string keyString(key.objdata(), key.objsize());
+    const size_t bytes = approximateSize(results) + keyString.size() + nss.ns().size();
+    if (bytes > maxBytes) {
+        return;
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto nsIt = _namespaces.find(nss.ns());
+    if (nsIt == _namespaces.end() || nsIt->second.generation != generation) {
+        // The collection was written to after the results were read, or was forgotten.
+        return;
+    }
+    auto& nsEntries = nsIt->second;
+
+    auto existing = nsEntries.entries.find(keyString);
+    if (existing != nsEntries.entries.end()) {
+        _erase_inlock(existing->second);
+    }
+
+    // Evicting never forgets a collection, so 'nsEntries' stays valid.
+    _evictDownTo_inlock(maxBytes - bytes);
+
+    _lru.push_front(Entry{nss.ns(),
+                          keyString,
+                          std::make_shared<const std::vector<BSONObj>>(std::move(results)),
+                          bytes});
+    nsEntries.entries.emplace(std::move(keyString), _lru.begin());
+    _bytes += bytes;
+    ++_inserts;
+}
+
+void LookupResultsCache::invalidate(const NamespaceString& nss) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto nsIt = _namespaces.find(nss.ns());
+    if (nsIt != _namespaces.end()) {
+        _invalidate_inlock(nsIt);
+    }
+}
+
+void LookupResultsCache::invalidateDatabase(StringData dbName) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (auto nsIt = _namespaces.begin(); nsIt != _namespaces.end();) {
+        if (nsToDatabaseSubstring(nsIt->first) == dbName) {
+            nsIt = _invalidate_inlock(nsIt);
+        } else {
+            ++nsIt;
+        }
+    }
+}
+
+void LookupResultsCache::setMaxBytes(size_t maxBytes) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _maxBytes.store(static_cast<long long>(maxBytes));
+    if (maxBytes == 0) {
+        // Writes are not reported to a disabled cache, so results read before it was disabled must
+        // not be cached if it is enabled again before they are inserted.
+        for (auto nsIt = _namespaces.begin(); nsIt != _namespaces.end();) {
+            nsIt = _invalidate_inlock(nsIt);
+        }
+    }
+    _evictDownTo_inlock(maxBytes);
+}
+
+void LookupResultsCache::appendStats(BSONObjBuilder* builder) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    builder->append("maxBytes", _maxBytes.load());
+    builder->append("bytes", static_cast<long long>(_bytes));
+    builder->append("entries", static_cast<long long>(_lru.size()));
+    builder->append("collections", static_cast<long long>(_namespaces.size()));
+    builder->append("hits", _hits);
+    builder->append("misses", _misses);
+    builder->append("inserts", _inserts);
+    builder->append("evictions", _evictions);
+    builder->append("invalidations", _invalidations);
+}
+
+LookupResultsCache::NamespaceMap::iterator LookupResultsCache::_invalidate_inlock(
+    NamespaceMap::iterator nsIt) {
+    ++_invalidations;
+    auto& entries = nsIt->second.entries;
+    while (!entries.empty()) {
+        _erase_inlock(entries.begin()->second);
+    }
+    // Queries which took the collection's generation before now find it forgotten, and any query
+    // starting after now gets a new generation.
+    return _namespaces.erase(nsIt);
+}
+
+void LookupResultsCache::_pruneNamespaces_inlock() {
+    for (auto nsIt = _namespaces.begin(); nsIt != _namespaces.end();) {
+        if (nsIt->second.entries.empty()) {
+            nsIt = _namespaces.erase(nsIt);
+        } else {
+            ++nsIt;
+        }
+    }
+    _pruneNamespacesAt = std::max(kMinNamespacesBeforePrune, 2 * _namespaces.size());
+}
+
+void LookupResultsCache::_evictDownTo_inlock(size_t maxBytes) {
+    while (_bytes > maxBytes) {
+        invariant(!_lru.empty());
+        _erase_inlock(std::prev(_lru.end()));
+        ++_evictions;
+    }
+}
+
+void LookupResultsCache::_erase_inlock(EntryList::iterator it) {
+    auto nsIt = _namespaces.find(it->ns);
+    invariant(nsIt != _namespaces.end());
+    nsIt->second.entries.erase(it->key);
+    _bytes -= it->bytes;
+    _lru.erase(it);
+}
+
+}  // namespace mongo
@@ -0,0 +1,178 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+class NamespaceString;
+
+/**
+ * A server-wide, memory-bounded cache of the documents returned by the queries $lookup and
+ * $graphLookup run against their foreign collections, so that pipelines which repeatedly join
+ * against slowly-changing collections need not query them each time.
+ *
+ * Each entry belongs to one collection and is keyed by a description of the query which produced
+ * it. Every write to a collection invalidates all of its entries once the write commits; the
+ * OpObserver calls invalidate() for this. A reader takes the collection's generation with
+ * getGeneration() before it runs a query, and insert() discards the results if the collection was
+ * invalidated in the meantime, so results read before a write are never cached after it.
+ *
+ * The cache only tracks collections which have entries or queries in progress. Generations are
+ * drawn from one counter shared by all collections, so a collection which is forgotten and later
+ * tracked again never reuses a generation handed out before.
+ *
+ * The cache is disabled, and empty, while internalLookupResultsCacheMaxBytes is 0.
+ */
+class LookupResultsCache {
+    MONGO_DISALLOW_COPYING(LookupResultsCache);
+
+public:
+    using Results = std::shared_ptr<const std::vector<BSONObj>>;
+
+    LookupResultsCache() = default;
+
+    static LookupResultsCache& get();
+
+    /**
+     * Whether the cache may hold any entries. Readers should not consult it, and writers need not
+     * invalidate it, when it is disabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Returns a token identifying the current contents of 'nss', to be passed to insert().
+     */
+    uint64_t getGeneration(const NamespaceString& nss);
+
+    /**
+     * Returns the cached results of the query described by 'key' against 'nss', or nullptr if
+     * there are none.
+     */
+    Results find(const NamespaceString& nss, const BSONObj& key);
+
+    /**
+     * Caches 'results' as the results of the query described by 'key' against 'nss', unless 'nss'
+     * has been invalidated since 'generation' was returned by getGeneration(). The documents in
+     * 'results' must be owned. Evicts the least recently used entries to stay within the size
+     * limit; results larger than the whole cache are not cached.
+     */
+    void insert(const NamespaceString& nss,
+                const BSONObj& key,
+                uint64_t generation,
+                std::vector<BSONObj> results);
+
+    /**
+     * Discards every entry for 'nss', or for every collection in 'dbName'.
+     */
+    void invalidate(const NamespaceString& nss);
+    void invalidateDatabase(StringData dbName);
+
+    /**
+     * Sets the most bytes the cached results may use, evicting entries as needed. 0 disables the
+     * cache and discards all of its entries.
+     */
+    void setMaxBytes(size_t maxBytes);
+
+    /**
+     * Appends the cache's size, the number of collections it tracks, and its hit, miss, insert,
+     * eviction and invalidation counts.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+private:
+    struct Entry {
+        std::string ns;
+        std::string key;
+        Results results;
+        size_t bytes;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    struct NamespaceEntries {
+        uint64_t generation = 0;
+        std::unordered_map<std::string, EntryList::iterator> entries;
+    };
+
+    using NamespaceMap = std::unordered_map<std::string, NamespaceEntries>;
+
+    // Forgetting collections without entries more often than this would make getGeneration() scan
+    // '_namespaces' too often.
+    static const size_t kMinNamespacesBeforePrune = 64;
+
+    /**
+     * Discards the entries of the collection at 'nsIt' and forgets it, returning the iterator
+     * following it.
+     */
+    NamespaceMap::iterator _invalidate_inlock(NamespaceMap::iterator nsIt);
+
+    /**
+     * Forgets every collection with no entries. Queries against them which are in progress will
+     * not cache their results.
+     */
+    void _pruneNamespaces_inlock();
+
+    void _evictDownTo_inlock(size_t maxBytes);
+    void _erase_inlock(EntryList::iterator it);
+
+    AtomicInt64 _maxBytes{0};
+
+    mutable stdx::mutex _mutex;
+
+    // Most recently used first.
+    EntryList _lru;
+    NamespaceMap _namespaces;
+    size_t _bytes = 0;
+
+    uint64_t _nextGeneration = 0;
+
+    // '_namespaces' is pruned when it grows past this size.
+    size_t _pruneNamespacesAt = kMinNamespacesBeforePrune;
+
+    long long _hits = 0;
+    long long _misses = 0;
+    long long _inserts = 0;
+    long long _evictions = 0;
+    long long _invalidations = 0;
+};
+
+}  // namespace mongo
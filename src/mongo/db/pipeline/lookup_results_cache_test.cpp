@@ -0,0 +1,218 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/lookup_results_cache.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const NamespaceString kFooNss("test.foo");
+const NamespaceString kBarNss("test.bar");
+const NamespaceString kOtherDbNss("other.foo");
+
+std::vector<BSONObj> makeResults(int n) {
+    std::vector<BSONObj> results;
+    for (int i = 0; i < n; ++i) {
+        results.push_back(BSON("_id" << i << "padding" << std::string(100, 'x')));
+    }
+    return results;
+}
+
+long long getStat(const LookupResultsCache& cache, StringData name) {
+    BSONObjBuilder stats;
+    cache.appendStats(&stats);
+    return stats.obj()[name].numberLong();
+}
+
+TEST(LookupResultsCacheTest, DisabledByDefault) {
+    LookupResultsCache cache;
+    ASSERT_FALSE(cache.isEnabled());
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    ASSERT_EQUALS(0, getStat(cache, "entries"));
+}
+
+TEST(LookupResultsCacheTest, FindReturnsInsertedResults) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+    ASSERT_TRUE(cache.isEnabled());
+
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(3));
+
+    auto results = cache.find(kFooNss, BSON("a" << 1));
+    ASSERT_TRUE(results);
+    ASSERT_EQUALS(3U, results->size());
+    ASSERT_EQUALS(2, (*results)[2]["_id"].numberInt());
+
+    // Entries are specific to both the collection and the key.
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 2)));
+    ASSERT_FALSE(cache.find(kBarNss, BSON("a" << 1)));
+
+    ASSERT_EQUALS(1, getStat(cache, "hits"));
+    ASSERT_EQUALS(3, getStat(cache, "misses"));
+    ASSERT_EQUALS(1, getStat(cache, "inserts"));
+}
+
+TEST(LookupResultsCacheTest, EmptyResultsAreCached) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), {});
+    auto results = cache.find(kFooNss, BSON("a" << 1));
+    ASSERT_TRUE(results);
+    ASSERT_TRUE(results->empty());
+}
+
+TEST(LookupResultsCacheTest, InvalidateDiscardsOnlyThatCollection) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+    cache.insert(kBarNss, BSON("a" << 1), cache.getGeneration(kBarNss), makeResults(1));
+
+    cache.invalidate(kFooNss);
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    ASSERT_TRUE(cache.find(kBarNss, BSON("a" << 1)));
+    ASSERT_EQUALS(1, getStat(cache, "entries"));
+}
+
+TEST(LookupResultsCacheTest, InvalidateDatabaseDiscardsEveryCollectionInIt) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+    cache.insert(kBarNss, BSON("a" << 1), cache.getGeneration(kBarNss), makeResults(1));
+    cache.insert(kOtherDbNss, BSON("a" << 1), cache.getGeneration(kOtherDbNss), makeResults(1));
+
+    cache.invalidateDatabase("test");
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    ASSERT_FALSE(cache.find(kBarNss, BSON("a" << 1)));
+    ASSERT_TRUE(cache.find(kOtherDbNss, BSON("a" << 1)));
+}
+
+TEST(LookupResultsCacheTest, ResultsReadBeforeAnInvalidationAreNotCached) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+
+    const uint64_t generation = cache.getGeneration(kFooNss);
+    cache.invalidate(kFooNss);
+    cache.insert(kFooNss, BSON("a" << 1), generation, makeResults(1));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 1)));
+}
+
+TEST(LookupResultsCacheTest, InvalidatingForgetsTheCollection) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+    cache.insert(kBarNss, BSON("a" << 1), cache.getGeneration(kBarNss), makeResults(1));
+    ASSERT_EQUALS(2, getStat(cache, "collections"));
+
+    const uint64_t generation = cache.getGeneration(kFooNss);
+    cache.invalidate(kFooNss);
+    ASSERT_EQUALS(1, getStat(cache, "collections"));
+
+    // A collection tracked again never reuses an earlier generation.
+    ASSERT_NOT_EQUALS(generation, cache.getGeneration(kFooNss));
+    cache.insert(kFooNss, BSON("a" << 1), generation, makeResults(1));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+}
+
+TEST(LookupResultsCacheTest, CollectionsWithoutEntriesArePruned) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+
+    // Queries which never cache their results leave their collections tracked until a prune.
+    for (int i = 0; i < 1000; ++i) {
+        cache.getGeneration(NamespaceString("test.coll" + std::to_string(i)));
+    }
+    ASSERT_LTE(getStat(cache, "collections"), 128);
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 1)));
+}
+
+TEST(LookupResultsCacheTest, EvictsLeastRecentlyUsedEntries) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+    cache.insert(kFooNss, BSON("a" << 0), cache.getGeneration(kFooNss), makeResults(10));
+    const long long entryBytes = getStat(cache, "bytes");
+
+    // Make room for exactly three entries of the same size.
+    cache.setMaxBytes(3 * entryBytes);
+    for (int i = 1; i < 3; ++i) {
+        cache.insert(kFooNss, BSON("a" << i), cache.getGeneration(kFooNss), makeResults(10));
+    }
+    ASSERT_EQUALS(3, getStat(cache, "entries"));
+
+    // Using {a: 0} makes {a: 1} the least recently used entry.
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 0)));
+    cache.insert(kFooNss, BSON("a" << 3), cache.getGeneration(kFooNss), makeResults(10));
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 0)));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 2)));
+    ASSERT_TRUE(cache.find(kFooNss, BSON("a" << 3)));
+    ASSERT_EQUALS(3 * entryBytes, getStat(cache, "bytes"));
+    ASSERT_EQUALS(1, getStat(cache, "evictions"));
+}
+
+TEST(LookupResultsCacheTest, ResultsLargerThanTheCacheAreNotCached) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024);
+
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(20));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 1)));
+    ASSERT_EQUALS(0, getStat(cache, "bytes"));
+}
+
+TEST(LookupResultsCacheTest, DisablingDiscardsEntriesAndPendingInserts) {
+    LookupResultsCache cache;
+    cache.setMaxBytes(1024 * 1024);
+    cache.insert(kFooNss, BSON("a" << 1), cache.getGeneration(kFooNss), makeResults(1));
+
+    const uint64_t generation = cache.getGeneration(kFooNss);
+    cache.setMaxBytes(0);
+    ASSERT_FALSE(cache.isEnabled());
+    ASSERT_EQUALS(0, getStat(cache, "entries"));
+
+    cache.setMaxBytes(1024 * 1024);
+    cache.insert(kFooNss, BSON("a" << 2), generation, makeResults(1));
+    ASSERT_FALSE(cache.find(kFooNss, BSON("a" << 2)));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -65,6 +65,7 @@ const char Pipeline::pipelineName[] = "pipeline";
 const char Pipeline::collationName[] = "collation";
 const char Pipeline::explainName[] = "explain";
 const char Pipeline::fromRouterName[] = "fromRouter";
+const char Pipeline::mergeOnRouterName[] = "mergeOnRouter";
 const char Pipeline::serverPipelineName[] = "serverPipeline";
 const char Pipeline::mongosPipelineName[] = "mongosPipeline";
 
@@ -144,6 +145,11 @@ intrusive_ptr<Pipeline> Pipeline::parseCommand(string& errmsg,
             continue;
         }
 
+        if (str::equals(pFieldName, mergeOnRouterName)) {
+            pCtx->mergeOnRouter = cmdElement.Bool();
+            continue;
+        }
+
         if (str::equals(pFieldName, "allowDiskUse")) {
             uassert(ErrorCodes::IllegalOperation,
                     "The 'allowDiskUse' option is not permitted in read-only mode.",
@@ -422,6 +428,32 @@ bool Pipeline::needsPrimaryShardMerger() const {
     return false;
 }
 
+bool Pipeline::canRunOnRouter() const {
+    if (pCtx->extSortAllowed) {
+        return false;
+    }
+
+    for (auto&& source : sources) {
+        if (source->needsPrimaryShard() ||
+            dynamic_cast<DocumentSourceNeedsMongod*>(source.get())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BSONObj Pipeline::getMergeSortPattern() const {
+    if (sources.empty()) {
+        return BSONObj();
+    }
+
+    auto sort = dynamic_cast<DocumentSourceSort*>(sources.front().get());
+    if (!sort || !sort->isMergingPresorted()) {
+        return BSONObj();
+    }
+    return sort->getSortKeyMetaFieldPattern();
+}
+
 std::vector<NamespaceString> Pipeline::getInvolvedCollections() const {
     std::vector<NamespaceString> collections;
     for (auto&& source : sources) {
@@ -494,17 +526,20 @@ void Pipeline::run(BSONObjBuilder& result) {
     // cant use subArrayStart() due to error handling
     BSONArrayBuilder resultArray;
     DocumentSource* finalSource = sources.back().get();
-    while (boost::optional<Document> next = finalSource->getNext()) {
-        // add the document to the result set
-        BSONObjBuilder documentBuilder(resultArray.subobjStart());
-        next->toBson(&documentBuilder);
-        documentBuilder.doneFast();
-        // object will be too large, assert. the extra 1KB is for headers
-        uassert(16389,
-                str::stream() << "aggregation result exceeds maximum document size ("
-                              << BSONObjMaxUserSize / (1024 * 1024)
-                              << "MB)",
-                resultArray.len() < BSONObjMaxUserSize - 1024);
+    vector<Document> batch;
+    while (finalSource->getNextBatch(&batch)) {
+        for (auto&& next : batch) {
+            // add the document to the result set
+            BSONObjBuilder documentBuilder(resultArray.subobjStart());
+            next.toBson(&documentBuilder);
+            documentBuilder.doneFast();
+            // object will be too large, assert. the extra 1KB is for headers
+            uassert(16389,
+                    str::stream() << "aggregation result exceeds maximum document size ("
+                                  << BSONObjMaxUserSize / (1024 * 1024)
+                                  << "MB)",
+                    resultArray.len() < BSONObjMaxUserSize - 1024);
+        }
     }
 
     resultArray.done();
@@ -119,6 +119,20 @@ public:
      */
     bool needsPrimaryShardMerger() const;
 
+    /**
+     * Returns whether this pipeline, the merging half of a split pipeline, can be run on mongos.
+     * This is not the case if any stage needs to access a collection, or if the pipeline is
+     * allowed to spill to disk, which mongos cannot do.
+     */
+    bool canRunOnRouter() const;
+
+    /**
+     * If this pipeline, the merging half of a split pipeline, starts by merging the sorted output
+     * of the shards, returns the pattern by which that output must be ordered, as described by
+     * DocumentSourceSort::getSortKeyMetaFieldPattern(). Otherwise returns an empty object.
+     */
+    BSONObj getMergeSortPattern() const;
+
     /**
      * Modifies the pipeline, optimizing it by combining and swapping stages.
      */
@@ -215,6 +229,7 @@ private:
     static const char collationName[];
     static const char explainName[];
     static const char fromRouterName[];
+    static const char mergeOnRouterName[];
     static const char serverPipelineName[];
     static const char mongosPipelineName[];
 
@@ -46,6 +46,7 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
+#include "mongo/db/operation_context.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/collation/collation_serializer.h"
@@ -129,6 +130,16 @@ public:
         return collection->getIndexCatalog()->findIdIndex(_ctx->opCtx);
     }
 
+    bool hasNonSimpleDefaultCollation(const NamespaceString& ns) final {
+        AutoGetCollectionForRead ctx(_ctx->opCtx, ns.ns());
+        Collection* collection = ctx.getCollection();
+        return collection && collection->getDefaultCollator();
+    }
+
+    bool isReadingFromMajorityCommittedSnapshot() final {
+        return _ctx->opCtx->recoveryUnit()->isReadingFromMajorityCommittedSnapshot();
+    }
+
 private:
     intrusive_ptr<ExpressionContext> _ctx;
     DBDirectClient _client;
@@ -410,6 +421,13 @@ std::shared_ptr<PlanExecutor> PipelineD::prepareExecutor(
                 exec = std::move(swExecutorSort.getValue());
             }
 
+            if (expCtx->mergeOnRouter) {
+                // mongos merges the output of the shards by the sort keys which the $sort stage
+                // attaches, so keep it. It streams its already sorted input through.
+                sortStage->setInputIsPresorted();
+                return exec;
+            }
+
             // We know the sort is being handled by the query system, so remove the $sort stage.
             pipeline->sources.pop_front();
 
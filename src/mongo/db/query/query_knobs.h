@@ -105,6 +105,10 @@ extern std::atomic<int> internalQueryExecYieldIterations;  // NOLINT
 // Yield if it's been at least this many milliseconds since we last yielded.
 extern std::atomic<int> internalQueryExecYieldPeriodMS;  // NOLINT
 
+// The number of threads on which a collection scan evaluates its filter. Values greater than one
+// enable the parallel collection scan for queries whose filter supports it.
+extern std::atomic<int> internalQueryExecCollectionScanThreads;  // NOLINT
+
 // Limit the size that we write without yielding to 16MB / 64 (max expected number of indexes)
 const int64_t insertVectorMaxBytes = 256 * 1024;
 
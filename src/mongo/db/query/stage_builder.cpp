@@ -48,6 +48,7 @@
 #include "mongo/db/exec/limit.h"
 #include "mongo/db/exec/merge_sort.h"
 #include "mongo/db/exec/or.h"
+#include "mongo/db/exec/parallel_collection_scan.h"
 #include "mongo/db/exec/projection.h"
 #include "mongo/db/exec/shard_filter.h"
 #include "mongo/db/exec/skip.h"
@@ -56,6 +57,8 @@
 #include "mongo/db/exec/text.h"
 #include "mongo/db/index/fts_access_method.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/s/sharding_state.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
@@ -65,6 +68,24 @@ namespace mongo {
 using std::unique_ptr;
 using stdx::make_unique;
 
+namespace {
+
+// The most threads a parallel collection scan will use, however high the knob is set.
+const int kMaxCollectionScanThreads = 64;
+
+/**
+ * Returns true if the collection scan described by 'csn' can evaluate its filter on several
+ * threads. The filter must not contain $where, which runs JavaScript in the operation's scope, or
+ * use a collator, which may not be safe to use concurrently.
+ */
+bool canUseParallelCollectionScan(const CanonicalQuery& cq, const CollectionScanNode* csn) {
+    const MatchExpression* filter = csn->filter.get();
+    return filter && !csn->tailable && csn->maxScan == 0 && !cq.getCollator() &&
+        !QueryPlannerCommon::hasNode(filter, MatchExpression::WHERE);
+}
+
+}  // namespace
+
 PlanStage* buildStages(OperationContext* txn,
                        Collection* collection,
                        const CanonicalQuery& cq,
@@ -79,6 +100,12 @@ PlanStage* buildStages(OperationContext* txn,
         params.direction =
             (csn->direction == 1) ? CollectionScanParams::FORWARD : CollectionScanParams::BACKWARD;
         params.maxScan = csn->maxScan;
+
+        const int numThreads =
+            std::min(internalQueryExecCollectionScanThreads.load(), kMaxCollectionScanThreads);
+        if (numThreads > 1 && canUseParallelCollectionScan(cq, csn)) {
+            return new ParallelCollectionScan(txn, params, ws, csn->filter.get(), numThreads);
+        }
         return new CollectionScan(txn, params, ws, csn->filter.get());
     } else if (STAGE_IXSCAN == root->getType()) {
         const IndexScanNode* ixn = static_cast<const IndexScanNode*>(root);
@@ -87,6 +87,10 @@ enum StageType {
     STAGE_MULTI_PLAN,
     STAGE_OPLOG_START,
     STAGE_OR,
+
+    // A collection scan which evaluates its filter on several threads.
+    STAGE_PARALLEL_COLLSCAN,
+
     STAGE_PROJECTION,
 
     // Stage for running aggregation pipelines.
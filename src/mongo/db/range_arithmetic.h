@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "mongo/db/jsobj.h"
+#include "mongo/util/persistent_sorted_map.h"
 
 namespace mongo {
 
@@ -105,10 +106,13 @@ int compareRanges(const BSONObj& rangeMin1,
  * A RangeMap is a mapping of a BSON range from lower->upper (lower maps to upper), using
  * standard BSON woCompare.  Upper bound is exclusive.
  *
+ * Copies of a RangeMap share their entries, so building a modified copy of a large map only
+ * copies the parts of it which are modified.
+ *
  * NOTE: For overlap testing to work correctly, there may be no overlaps present in the map
  * itself.
  */
-typedef std::map<BSONObj, BSONObj, BSONObjCmp> RangeMap;
+typedef PersistentSortedMap<BSONObj, BSONObj, BSONObjCmp> RangeMap;
 
 /**
  * A RangeVector is a list of [lower,upper) ranges.
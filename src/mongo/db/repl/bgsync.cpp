@@ -43,6 +43,8 @@
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/repl/data_replicator_external_state_impl.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/oplog_buffer_blocking_queue.h"
+#include "mongo/db/repl/oplog_buffer_file.h"
 #include "mongo/db/repl/oplog_interface_local.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_coordinator_impl.h"
@@ -51,7 +53,9 @@
 #include "mongo/db/repl/rs_sync.h"
 #include "mongo/db/repl/storage_interface.h"
 #include "mongo/db/repl/sync_source_resolver.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/db/storage/storage_options.h"
 #include "mongo/executor/network_interface_factory.h"
 #include "mongo/rpc/metadata/repl_set_metadata.h"
 #include "mongo/stdx/memory.h"
@@ -120,6 +124,12 @@ size_t getSize(const BSONObj& o) {
     // SERVER-9808 Avoid Fortify complaint about implicit signed->unsigned conversion
     return static_cast<size_t>(o.objsize());
 }
+
+// The number of bytes of fetched oplog entries which may be spilled to disk once the in-memory
+// buffer is full. Zero keeps the buffer entirely in memory.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replOplogBufferMaxSpillSizeBytes,
+                                      long long,
+                                      1024 * 1024 * 1024);
 }  // namespace
 
 MONGO_FP_DECLARE(rsBgSyncProduce);
@@ -147,16 +157,48 @@ static ServerStatusMetricField<Counter64> displayBufferSize("repl.buffer.sizeByt
 static int bufferMaxSizeGauge = 256 * 1024 * 1024;
 static ServerStatusMetricField<int> displayBufferMaxSize("repl.buffer.maxSizeBytes",
                                                          &bufferMaxSizeGauge);
+// The size (bytes) of items in the buffer which have been spilled to disk
+static Counter64 bufferSpilledSizeGauge;
+static ServerStatusMetricField<Counter64> displayBufferSpilledSize("repl.buffer.spilledSizeBytes",
+                                                                   &bufferSpilledSizeGauge);
+// The bytes of items spilled to disk by the buffer
+static Counter64 bufferSpilledBytesStats;
+static ServerStatusMetricField<Counter64> displayBufferSpilledBytes("repl.buffer.spilledBytes",
+                                                                    &bufferSpilledBytesStats);
+
+namespace {
+
+/**
+ * Returns the buffer for fetched oplog entries, which spills to disk once more than
+ * 'bufferMaxSizeGauge' bytes are buffered unless replOplogBufferMaxSpillSizeBytes is zero.
+ */
+std::unique_ptr<OplogBuffer> makeOplogBuffer() {
+    if (replOplogBufferMaxSpillSizeBytes <= 0) {
+        return stdx::make_unique<OplogBufferBlockingQueue>(bufferMaxSizeGauge);
+    }
+
+    OplogBufferFile::Options options;
+    options.maxMemorySize = bufferMaxSizeGauge;
+    options.maxSize = bufferMaxSizeGauge + replOplogBufferMaxSpillSizeBytes;
+    options.tempDir = storageGlobalParams.dbpath + "/_tmp";
+    options.spilledBytesCounter = &bufferSpilledBytesStats;
+    options.spilledSizeGauge = &bufferSpilledSizeGauge;
+    return stdx::make_unique<OplogBufferFile>(std::move(options));
+}
+
+}  // namespace
 
 
 BackgroundSync::BackgroundSync()
-    : _buffer(bufferMaxSizeGauge, &getSize),
+    : _buffer(makeOplogBuffer()),
       _threadPoolTaskExecutor(makeThreadPool(),
                               executor::makeNetworkInterface("NetworkInterfaceASIO-BGSync")),
       _replCoord(getGlobalReplicationCoordinator()),
       _syncSourceResolver(_replCoord),
       _lastOpTimeFetched(Timestamp(std::numeric_limits<int>::max(), 0),
-                         std::numeric_limits<long long>::max()) {}
+                         std::numeric_limits<long long>::max()) {
+    _buffer->startup();
+}
 
 void BackgroundSync::shutdown() {
     stdx::lock_guard<stdx::mutex> lock(_mutex);
@@ -201,10 +243,10 @@ void BackgroundSync::producerThread(
 void BackgroundSync::_signalNoNewDataForApplier() {
     // Signal to consumers that we have entered the stopped state
     // if the signal isn't already in the queue.
-    const boost::optional<BSONObj> lastObjectPushed = _buffer.lastObjectPushed();
+    const boost::optional<BSONObj> lastObjectPushed = _buffer->lastObjectPushed();
     if (!lastObjectPushed || !lastObjectPushed->isEmpty()) {
         const BSONObj sentinelDoc;
-        _buffer.pushEvenIfFull(sentinelDoc);
+        _buffer->pushEvenIfFull(sentinelDoc);
         bufferCountGauge.increment();
         bufferSizeGauge.increment(sentinelDoc.objsize());
     }
@@ -486,14 +528,14 @@ void BackgroundSync::_enqueueDocuments(Fetcher::Documents::const_iterator begin,
     }
 
     // Wait for enough space.
-    _buffer.waitForSpace(info.toApplyDocumentBytes);
+    _buffer->waitForSpace(info.toApplyDocumentBytes);
 
     OCCASIONALLY {
-        LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes";
+        LOG(2) << "bgsync buffer has " << _buffer->getSize() << " bytes";
     }
 
     // Buffer docs for later application.
-    _buffer.pushAllNonBlocking(begin, end);
+    fassert(40150, _buffer->pushAllNonBlocking(begin, end));
 
     // Update last fetched info.
     {
@@ -507,22 +549,32 @@ void BackgroundSync::_enqueueDocuments(Fetcher::Documents::const_iterator begin,
 }
 
 bool BackgroundSync::peek(BSONObj* op) {
-    return _buffer.peek(*op);
+    return _buffer->peek(op);
 }
 
 void BackgroundSync::waitForMore() {
-    BSONObj op;
     // Block for one second before timing out.
-    // Ignore the value of the op we peeked at.
-    _buffer.blockingPeek(op, 1);
+    _buffer->waitForData(Seconds(1));
 }
 
 void BackgroundSync::consume() {
     // this is just to get the op off the queue, it's been peeked at
-    // and queued for application already
-    BSONObj op = _buffer.blockingPop();
-    bufferCountGauge.decrement(1);
-    bufferSizeGauge.decrement(getSize(op));
+    // and queued for application already. It may have been cleared since, in which case the
+    // gauges have been reset already.
+    BSONObj op;
+    if (_buffer->tryPop(&op)) {
+        bufferCountGauge.decrement(1);
+        bufferSizeGauge.decrement(getSize(op));
+    }
+}
+
+void BackgroundSync::appendBufferStats(BSONObjBuilder* builder) {
+    BSONObjBuilder bufferBuilder(builder->subobjStart("oplogBuffer"));
+    bufferBuilder.append("count", bufferCountGauge.get());
+    bufferBuilder.append("sizeBytes", bufferSizeGauge.get());
+    bufferBuilder.append("maxSizeBytes", bufferMaxSizeGauge);
+    bufferBuilder.append("spilledSizeBytes", bufferSpilledSizeGauge.get());
+    bufferBuilder.append("spilledBytes", bufferSpilledBytesStats.get());
 }
 
 void BackgroundSync::_rollback(OperationContext* txn,
@@ -540,7 +592,7 @@ void BackgroundSync::_rollback(OperationContext* txn,
         // Wait until the buffer is empty.
         // This is an indication that syncTail has removed the sentinal marker from the buffer
         // and reset its local lastAppliedOpTime via the replCoord.
-        while (!_buffer.empty()) {
+        while (!_buffer->isEmpty()) {
             sleepmillis(10);
             if (inShutdown()) {
                 return;
@@ -596,7 +648,7 @@ void BackgroundSync::stop() {
 }
 
 void BackgroundSync::start(OperationContext* txn) {
-    massert(16235, "going to start syncing, but buffer is not empty", _buffer.empty());
+    massert(16235, "going to start syncing, but buffer is not empty", _buffer->isEmpty());
 
     long long lastFetchedHash = _readLastAppliedHash(txn);
     stdx::lock_guard<stdx::mutex> lk(_mutex);
@@ -615,7 +667,7 @@ bool BackgroundSync::isStopped() const {
 }
 
 void BackgroundSync::clearBuffer() {
-    _buffer.clear();
+    _buffer->clear();
     const auto count = bufferCountGauge.get();
     bufferCountGauge.decrement(count);
     const auto size = bufferSizeGauge.get();
@@ -684,7 +736,7 @@ bool BackgroundSync::shouldStopFetching() const {
 }
 
 void BackgroundSync::pushTestOpToBuffer(const BSONObj& op) {
-    _buffer.push(op);
+    _buffer->push(op);
     bufferCountGauge.increment();
     bufferSizeGauge.increment(op.objsize());
 }
@@ -34,6 +34,7 @@
 #include "mongo/base/status_with.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl/data_replicator_external_state.h"
+#include "mongo/db/repl/oplog_buffer.h"
 #include "mongo/db/repl/oplog_fetcher.h"
 #include "mongo/db/repl/optime.h"
 #include "mongo/db/repl/sync_source_resolver.h"
@@ -42,10 +43,10 @@
 #include "mongo/stdx/functional.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/net/hostandport.h"
-#include "mongo/util/queue.h"
 
 namespace mongo {
 
+class BSONObjBuilder;
 class DBClientBase;
 class OperationContext;
 
@@ -94,6 +95,12 @@ public:
     // For monitoring
     BSONObj getCounters();
 
+    /**
+     * Appends the size and count of the buffered oplog entries, and how much of them have been
+     * spilled to disk, to 'builder' for replSetGetStatus.
+     */
+    static void appendBufferStats(BSONObjBuilder* builder);
+
     // Clears any fetched and buffered oplog entries.
     void clearBuffer();
 
@@ -156,7 +163,7 @@ private:
     long long _readLastAppliedHash(OperationContext* txn);
 
     // Production thread
-    BlockingQueue<BSONObj> _buffer;
+    std::unique_ptr<OplogBuffer> _buffer;
 
     // Task executor used to run find/getMore commands on sync source.
     executor::ThreadPoolTaskExecutor _threadPoolTaskExecutor;
@@ -28,11 +28,13 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
 #include <cstddef>
 #include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/bson/bsonobj.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 namespace repl {
@@ -76,6 +78,18 @@ public:
      */
     virtual void shutdown() = 0;
 
+    /**
+     * Pushes operation into oplog buffer, ignoring any size constraints. Does not block.
+     */
+    virtual void pushEvenIfFull(const Value& value) = 0;
+
+    /**
+     * Pushes operation into oplog buffer.
+     * If there are size constraints on the oplog buffer, this may block until sufficient space
+     * is made available (by popping) to complete this operation.
+     */
+    virtual void push(const Value& value) = 0;
+
     /**
      * Pushes operations in the iterator range [begin, end) into the oplog buffer without blocking.
      *
@@ -88,6 +102,11 @@ public:
      */
     virtual void waitForSpace(std::size_t size) = 0;
 
+    /**
+     * Returns true if oplog buffer is empty.
+     */
+    virtual bool isEmpty() const = 0;
+
     /**
      * Total size of all oplog entries in this oplog buffer as measured by the BSONObj::size()
      * function.
@@ -110,11 +129,23 @@ public:
      */
     virtual bool tryPop(Value* value) = 0;
 
+    /**
+     * Waits up to "waitDuration" for an operation to be pushed into the oplog buffer.
+     * Returns false if oplog buffer is still empty after "waitDuration" or if the oplog buffer is
+     * cleared while waiting. Otherwise, returns true.
+     */
+    virtual bool waitForData(Seconds waitDuration) = 0;
+
     /**
      * Returns false if oplog buffer is empty.
      * Otherwise, returns true and sets "value" to last item in oplog buffer.
      */
     virtual bool peek(Value* value) = 0;
+
+    /**
+     * Returns the item most recently added to the oplog buffer or nothing if the buffer is empty.
+     */
+    virtual boost::optional<Value> lastObjectPushed() const = 0;
 };
 
 }  // namespace repl
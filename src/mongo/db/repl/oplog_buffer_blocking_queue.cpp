@@ -45,12 +45,24 @@ size_t getDocumentSize(const BSONObj& o) {
 
 }  // namespace
 
-OplogBufferBlockingQueue::OplogBufferBlockingQueue() : _queue(kOplogBufferSize, &getDocumentSize) {}
+OplogBufferBlockingQueue::OplogBufferBlockingQueue()
+    : OplogBufferBlockingQueue(kOplogBufferSize) {}
+
+OplogBufferBlockingQueue::OplogBufferBlockingQueue(std::size_t maxSize)
+    : _queue(maxSize, &getDocumentSize) {}
 
 void OplogBufferBlockingQueue::startup() {}
 
 void OplogBufferBlockingQueue::shutdown() {}
 
+void OplogBufferBlockingQueue::pushEvenIfFull(const Value& value) {
+    _queue.pushEvenIfFull(value);
+}
+
+void OplogBufferBlockingQueue::push(const Value& value) {
+    _queue.push(value);
+}
+
 bool OplogBufferBlockingQueue::pushAllNonBlocking(Batch::const_iterator begin,
                                                   Batch::const_iterator end) {
     _queue.pushAllNonBlocking(begin, end);
@@ -61,6 +73,10 @@ void OplogBufferBlockingQueue::waitForSpace(std::size_t size) {
     _queue.waitForSpace(size);
 }
 
+bool OplogBufferBlockingQueue::isEmpty() const {
+    return _queue.empty();
+}
+
 std::size_t OplogBufferBlockingQueue::getSize() const {
     return _queue.size();
 }
@@ -77,9 +93,18 @@ bool OplogBufferBlockingQueue::tryPop(Value* value) {
     return _queue.tryPop(*value);
 }
 
+bool OplogBufferBlockingQueue::waitForData(Seconds waitDuration) {
+    Value ignored;
+    return _queue.blockingPeek(ignored, static_cast<int>(durationCount<Seconds>(waitDuration)));
+}
+
 bool OplogBufferBlockingQueue::peek(Value* value) {
     return _queue.peek(*value);
 }
 
+boost::optional<OplogBuffer::Value> OplogBufferBlockingQueue::lastObjectPushed() const {
+    return _queue.lastObjectPushed();
+}
+
 }  // namespace repl
 }  // namespace mongo
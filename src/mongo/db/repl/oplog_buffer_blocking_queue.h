@@ -40,16 +40,22 @@ namespace repl {
 class OplogBufferBlockingQueue : public OplogBuffer {
 public:
     OplogBufferBlockingQueue();
+    explicit OplogBufferBlockingQueue(std::size_t maxSize);
 
     void startup() override;
     void shutdown() override;
+    void pushEvenIfFull(const Value& value) override;
+    void push(const Value& value) override;
     bool pushAllNonBlocking(Batch::const_iterator begin, Batch::const_iterator end) override;
     void waitForSpace(std::size_t size) override;
+    bool isEmpty() const override;
     std::size_t getSize() const override;
     std::size_t getCount() const override;
     void clear() override;
     bool tryPop(Value* value) override;
+    bool waitForData(Seconds waitDuration) override;
     bool peek(Value* value) override;
+    boost::optional<Value> lastObjectPushed() const override;
 
 private:
     BlockingQueue<BSONObj> _queue;
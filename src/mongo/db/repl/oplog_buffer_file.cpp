@@ -0,0 +1,435 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kReplication
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/oplog_buffer_file.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "mongo/base/data_view.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/destructor_guard.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+namespace repl {
+
+namespace {
+
+std::size_t getDocumentSize(const BSONObj& o) {
+    // SERVER-9808 Avoid Fortify complaint about implicit signed->unsigned conversion
+    return static_cast<std::size_t>(o.objsize());
+}
+
+unsigned nextFileNumber() {
+    static AtomicUInt32 fileCounter;
+    return fileCounter.fetchAndAdd(1);
+}
+
+}  // namespace
+
+OplogBufferFile::OplogBufferFile(Options options) : _options(std::move(options)) {
+    invariant(_options.maxMemorySize <= _options.maxSize);
+}
+
+OplogBufferFile::~OplogBufferFile() {
+    DESTRUCTOR_GUARD(clear();)
+}
+
+void OplogBufferFile::startup() {
+    // The files are only created once entries need to be spilled.
+}
+
+void OplogBufferFile::shutdown() {
+    clear();
+}
+
+void OplogBufferFile::pushEvenIfFull(const Value& value) {
+    stdx::lock_guard<stdx::mutex> writeLock(_writeMutex);
+    const Batch values{value};
+    _push(values.begin(), values.end());
+}
+
+void OplogBufferFile::push(const Value& value) {
+    waitForSpace(getDocumentSize(value));
+
+    stdx::lock_guard<stdx::mutex> writeLock(_writeMutex);
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _clearing = false;
+    }
+    const Batch values{value};
+    _push(values.begin(), values.end());
+}
+
+bool OplogBufferFile::pushAllNonBlocking(Batch::const_iterator begin, Batch::const_iterator end) {
+    if (begin == end) {
+        return true;
+    }
+
+    stdx::lock_guard<stdx::mutex> writeLock(_writeMutex);
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _clearing = false;
+    }
+    _push(begin, end);
+    return true;
+}
+
+void OplogBufferFile::waitForSpace(std::size_t size) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (!_hasSpaceFor_inlock(size)) {
+        _notFullCondition.wait(lk);
+    }
+}
+
+bool OplogBufferFile::isEmpty() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _memory.empty() && _spilledCount == 0;
+}
+
+std::size_t OplogBufferFile::getSize() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _getSize_inlock();
+}
+
+std::size_t OplogBufferFile::getCount() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _memory.size() + _spilledCount;
+}
+
+void OplogBufferFile::clear() {
+    stdx::lock_guard<stdx::mutex> writeLock(_writeMutex);
+    stdx::lock_guard<stdx::mutex> readLock(_readMutex);
+    std::vector<std::string> fileNames;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _memory.clear();
+        _memorySize = 0;
+        fileNames = _releaseSegments_inlock(true);
+        _lastPushed = boost::none;
+        _clearing = true;
+        _notEmptyCondition.notify_all();
+        _notFullCondition.notify_all();
+    }
+    _removeFiles(fileNames);
+}
+
+bool OplogBufferFile::tryPop(Value* value) {
+    stdx::lock_guard<stdx::mutex> readLock(_readMutex);
+    _unspillIfNeeded();
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_memory.empty()) {
+        return false;
+    }
+
+    *value = std::move(_memory.front());
+    _memory.pop_front();
+    _memorySize -= getDocumentSize(*value);
+    if (_memory.empty() && _spilledCount == 0 && !_spilling) {
+        _lastPushed = boost::none;
+    }
+    _notFullCondition.notify_one();
+    return true;
+}
+
+bool OplogBufferFile::waitForData(Seconds waitDuration) {
+    const auto deadline = stdx::chrono::system_clock::now() + waitDuration.toSystemDuration();
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _clearing = false;
+    while (_memory.empty() && _spilledCount == 0 && !_clearing) {
+        if (stdx::cv_status::timeout == _notEmptyCondition.wait_until(lk, deadline)) {
+            return false;
+        }
+    }
+    return !_clearing;
+}
+
+bool OplogBufferFile::peek(Value* value) {
+    stdx::lock_guard<stdx::mutex> readLock(_readMutex);
+    _unspillIfNeeded();
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_memory.empty()) {
+        return false;
+    }
+    *value = _memory.front();
+    return true;
+}
+
+boost::optional<OplogBuffer::Value> OplogBufferFile::lastObjectPushed() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _lastPushed;
+}
+
+std::size_t OplogBufferFile::getSpilledSize() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _spilledSize;
+}
+
+std::string OplogBufferFile::getFileName() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _segments.empty() ? std::string() : _segments.back().fileName;
+}
+
+std::size_t OplogBufferFile::_getSize_inlock() const {
+    return _memorySize + _spilledSize;
+}
+
+bool OplogBufferFile::_hasSpaceFor_inlock(std::size_t size) const {
+    // An entry larger than the buffer must still be accepted once the buffer is empty.
+    const std::size_t currentSize = _getSize_inlock();
+    return currentSize == 0 || currentSize + size <= _options.maxSize;
+}
+
+void OplogBufferFile::_push(Batch::const_iterator begin, Batch::const_iterator end) {
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        const bool wasEmpty = _memory.empty() && _spilledCount == 0;
+
+        // Only '_writeMutex' is held while spilling, so with no spilled entries there is no spill
+        // in progress either, and these entries follow everything in the buffer.
+        auto it = begin;
+        while (it != end && _spilledCount == 0 &&
+               (_memory.empty() || _memorySize + getDocumentSize(*it) <= _options.maxMemorySize)) {
+            _memory.push_back(it->getOwned());
+            _memorySize += getDocumentSize(*it);
+            ++it;
+        }
+
+        if (it != begin) {
+            _lastPushed = std::prev(it)->getOwned();
+            if (wasEmpty) {
+                _notEmptyCondition.notify_one();
+            }
+        }
+        begin = it;
+    }
+
+    if (begin != end) {
+        _spill(begin, end);
+    }
+}
+
+void OplogBufferFile::_spill(Batch::const_iterator begin, Batch::const_iterator end) {
+    massert(40145,
+            "Attempting to spill oplog buffer to disk without setting Options::tempDir",
+            !_options.tempDir.empty());
+    boost::filesystem::create_directories(_options.tempDir);
+
+    while (begin != end) {
+        // Append to the last segment unless it is full or all of its entries have been read back,
+        // in which case start a new one.
+        std::string fileName;
+        std::uint64_t offset = 0;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_segments.empty() || _segments.back().sealed ||
+                (_segments.back().size > 0 &&
+                 _segments.back().size + getDocumentSize(*begin) > _options.maxSegmentSize)) {
+                if (!_segments.empty()) {
+                    _segments.back().sealed = true;
+                }
+
+                str::stream newFileName;
+                newFileName << _options.tempDir << "/oplogBuffer." << nextFileNumber();
+                _segments.emplace_back();
+                _segments.back().fileName = newFileName;
+                LOG(1) << "spilling oplog buffer to " << _segments.back().fileName;
+            }
+            fileName = _segments.back().fileName;
+            offset = _segments.back().size;
+            _spilling = true;
+        }
+        ON_BLOCK_EXIT([this] {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _spilling = false;
+        });
+
+        std::ofstream file(fileName.c_str(),
+                           std::ios::binary | std::ios::out |
+                               (offset == 0 ? std::ios::trunc : std::ios::in));
+        massert(40146,
+                str::stream() << "error opening file \"" << fileName
+                              << "\": " << errnoWithDescription(),
+                file.good());
+        file.seekp(offset);
+
+        // Write as many entries as fit in the segment, but always at least one.
+        auto it = begin;
+        std::uint64_t bytes = 0;
+        while (it != end &&
+               (it == begin || offset + bytes + getDocumentSize(*it) <= _options.maxSegmentSize)) {
+            file.write(it->objdata(), getDocumentSize(*it));
+            bytes += getDocumentSize(*it);
+            ++it;
+        }
+        file.close();
+        massert(40147,
+                str::stream() << "error writing file \"" << fileName
+                              << "\": " << errnoWithDescription(),
+                !file.fail());
+
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            const bool wasEmpty = _memory.empty() && _spilledCount == 0;
+            _segments.back().size += bytes;
+            _spilledCount += std::distance(begin, it);
+            _spilledSize += bytes;
+            _lastPushed = std::prev(it)->getOwned();
+            if (wasEmpty) {
+                _notEmptyCondition.notify_one();
+            }
+        }
+        if (_options.spilledBytesCounter) {
+            _options.spilledBytesCounter->increment(bytes);
+        }
+        if (_options.spilledSizeGauge) {
+            _options.spilledSizeGauge->increment(bytes);
+        }
+        begin = it;
+    }
+}
+
+void OplogBufferFile::_unspillIfNeeded() {
+    std::string fileName;
+    std::uint64_t offset = 0;
+    std::uint64_t available = 0;
+    std::vector<std::string> releasedFileNames;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (!_memory.empty() || _spilledCount == 0) {
+            return;
+        }
+
+        releasedFileNames = _releaseSegments_inlock(false);
+        invariant(!_segments.empty());
+        fileName = _segments.front().fileName;
+        offset = _readOffset;
+        available = _segments.front().size - _readOffset;
+    }
+    _removeFiles(releasedFileNames);
+
+    std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::in);
+    file.seekg(offset);
+
+    // Read back up to the memory limit, so that the segment can be removed as soon as possible.
+    std::vector<BSONObj> entries;
+    std::uint64_t bytes = 0;
+    while (bytes < available && bytes < _options.maxMemorySize) {
+        char sizeBytes[sizeof(int32_t)];
+        file.read(sizeBytes, sizeof(sizeBytes));
+        const int32_t size = ConstDataView(sizeBytes).read<LittleEndian<int32_t>>();
+        massert(40148,
+                str::stream() << "error reading file \"" << fileName
+                              << "\": " << errnoWithDescription(),
+                file.good() && size >= BSONObj::kMinBSONLength &&
+                    static_cast<std::uint64_t>(size) <= available - bytes);
+
+        auto buffer = SharedBuffer::allocate(size);
+        std::memcpy(buffer.get(), sizeBytes, sizeof(sizeBytes));
+        file.read(buffer.get() + sizeof(sizeBytes), size - sizeof(sizeBytes));
+        massert(40149,
+                str::stream() << "error reading file \"" << fileName
+                              << "\": " << errnoWithDescription(),
+                file.good());
+
+        entries.emplace_back(std::move(buffer));
+        bytes += size;
+    }
+    file.close();
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        for (auto&& entry : entries) {
+            _memorySize += getDocumentSize(entry);
+            _memory.push_back(std::move(entry));
+        }
+        _readOffset += bytes;
+        _spilledCount -= entries.size();
+        _spilledSize -= bytes;
+        releasedFileNames = _releaseSegments_inlock(false);
+    }
+    if (_options.spilledSizeGauge) {
+        _options.spilledSizeGauge->decrement(bytes);
+    }
+    _removeFiles(releasedFileNames);
+}
+
+std::vector<std::string> OplogBufferFile::_releaseSegments_inlock(bool all) {
+    std::vector<std::string> fileNames;
+    while (!_segments.empty()) {
+        const Segment& segment = _segments.front();
+        const bool readBack = _readOffset == segment.size;
+
+        // The last segment may still be appended to unless it has been sealed, or no spill is in
+        // progress and everything spilled has been read back.
+        const bool finished = segment.sealed || (!_spilling && _spilledCount == 0);
+        if (!all && !(readBack && finished)) {
+            break;
+        }
+
+        fileNames.push_back(segment.fileName);
+        _segments.pop_front();
+        _readOffset = 0;
+    }
+
+    if (all) {
+        _readOffset = 0;
+        if (_options.spilledSizeGauge) {
+            _options.spilledSizeGauge->decrement(_spilledSize);
+        }
+        _spilledCount = 0;
+        _spilledSize = 0;
+    }
+    return fileNames;
+}
+
+void OplogBufferFile::_removeFiles(const std::vector<std::string>& fileNames) {
+    for (auto&& fileName : fileNames) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(fileName, ec);
+        if (ec) {
+            warning() << "failed to remove oplog buffer file \"" << fileName
+                      << "\": " << ec.message();
+        }
+    }
+}
+
+}  // namespace repl
+}  // namespace mongo
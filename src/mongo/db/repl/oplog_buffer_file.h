@@ -0,0 +1,187 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/repl/oplog_buffer.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+namespace repl {
+
+/**
+ * Oplog buffer which holds up to a fixed number of bytes of oplog entries in memory and spills the
+ * rest to files, so that a node which is far behind its sync source can keep fetching while the
+ * applier catches up.
+ *
+ * Entries are always popped in the order they were pushed. Once an entry has been spilled, all
+ * entries pushed after it are spilled as well until the spilled entries have all been read back.
+ * Spilled entries are appended to a sequence of segment files of up to Options::maxSegmentSize
+ * bytes each, and each segment is removed once its entries have been read back, so the files only
+ * ever hold about as much as is spilled even if the buffer never empties.
+ *
+ * Files are only written and read while '_writeMutex' or '_readMutex' is held, never while
+ * '_mutex' is held, so that a slow disk does not stall callers which only look at the buffer. The
+ * locks are acquired in the order '_writeMutex', '_readMutex', '_mutex'.
+ */
+class OplogBufferFile : public OplogBuffer {
+public:
+    struct Options {
+        // Maximum total size of the entries held in memory.
+        std::size_t maxMemorySize = 256 * 1024 * 1024;
+
+        // Maximum total size of the entries held in memory and in the files together.
+        std::size_t maxSize = 1024 * 1024 * 1024;
+
+        // Maximum size of each segment file, unless it holds a single larger entry.
+        std::size_t maxSegmentSize = 64 * 1024 * 1024;
+
+        // Directory in which the files are created when entries are spilled.
+        std::string tempDir;
+
+        // If not null, incremented by the size of each entry written to a file.
+        Counter64* spilledBytesCounter = nullptr;
+
+        // If not null, kept up to date with the total size of the entries in the files.
+        Counter64* spilledSizeGauge = nullptr;
+    };
+
+    explicit OplogBufferFile(Options options);
+    ~OplogBufferFile() override;
+
+    void startup() override;
+    void shutdown() override;
+    void pushEvenIfFull(const Value& value) override;
+    void push(const Value& value) override;
+    bool pushAllNonBlocking(Batch::const_iterator begin, Batch::const_iterator end) override;
+    void waitForSpace(std::size_t size) override;
+    bool isEmpty() const override;
+    std::size_t getSize() const override;
+    std::size_t getCount() const override;
+    void clear() override;
+    bool tryPop(Value* value) override;
+    bool waitForData(Seconds waitDuration) override;
+    bool peek(Value* value) override;
+    boost::optional<Value> lastObjectPushed() const override;
+
+    /**
+     * Returns the total size of the entries which are currently in the files.
+     */
+    std::size_t getSpilledSize() const;
+
+    /**
+     * Returns the name of the segment file entries are currently spilled to, or an empty string if
+     * there is none.
+     */
+    std::string getFileName() const;
+
+private:
+    // A file holding the spilled entries in the range [0, size) of it, of which those before
+    // '_readOffset' have been read back if it is the first segment.
+    struct Segment {
+        std::string fileName;
+        std::uint64_t size = 0;
+
+        // Set once no more entries will be appended to the segment.
+        bool sealed = false;
+    };
+
+    std::size_t _getSize_inlock() const;
+    bool _hasSpaceFor_inlock(std::size_t size) const;
+
+    /**
+     * Adds the entries in ['begin', 'end') to the end of the buffer, spilling them to the files if
+     * needed. The caller must hold '_writeMutex'.
+     */
+    void _push(Batch::const_iterator begin, Batch::const_iterator end);
+
+    /**
+     * Appends the entries in ['begin', 'end') to the files. The caller must hold '_writeMutex'.
+     */
+    void _spill(Batch::const_iterator begin, Batch::const_iterator end);
+
+    /**
+     * Reads entries from the files into memory when there are none left in memory, and removes the
+     * segments which have been read back. The caller must hold '_readMutex'.
+     */
+    void _unspillIfNeeded();
+
+    /**
+     * Removes from '_segments' those whose entries have all been read back, and returns their file
+     * names for the caller to remove once it has released '_mutex'. All segments are removed if
+     * 'all' is true.
+     */
+    std::vector<std::string> _releaseSegments_inlock(bool all);
+
+    /**
+     * Removes the named files, which must no longer be in '_segments'.
+     */
+    static void _removeFiles(const std::vector<std::string>& fileNames);
+
+    const Options _options;
+
+    // Serializes pushes, which write to the files.
+    stdx::mutex _writeMutex;
+
+    // Serializes pops and peeks, which read from the files.
+    stdx::mutex _readMutex;
+
+    mutable stdx::mutex _mutex;
+    stdx::condition_variable _notEmptyCondition;
+    stdx::condition_variable _notFullCondition;
+
+    // Entries held in memory, which always precede the entries in the files.
+    std::deque<Value> _memory;
+    std::size_t _memorySize = 0;
+
+    // The segment files holding spilled entries, oldest first, and the offset in the first of the
+    // next entry to read back.
+    std::deque<Segment> _segments;
+    std::uint64_t _readOffset = 0;
+    std::size_t _spilledCount = 0;
+    std::size_t _spilledSize = 0;
+
+    // Set while a push is writing to the last segment, which must then not be removed even if all
+    // of its entries so far have been read back.
+    bool _spilling = false;
+
+    boost::optional<Value> _lastPushed;
+
+    // Set by clear() to wake up callers of waitForData().
+    bool _clearing = false;
+};
+
+}  // namespace repl
+}  // namespace mongo
@@ -0,0 +1,218 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/repl/oplog_buffer_file.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+using namespace mongo;
+using namespace mongo::repl;
+
+BSONObj makeOp(int i) {
+    return BSON("ts" << Timestamp(i, 1) << "h" << static_cast<long long>(i) << "op"
+                     << "i"
+                     << "o"
+                     << BSON("_id" << i));
+}
+
+OplogBufferFile::Options makeOptions(const unittest::TempDir& tempDir,
+                                     std::size_t opsInMemory,
+                                     std::size_t maxOps) {
+    const std::size_t opSize = makeOp(0).objsize();
+    OplogBufferFile::Options options;
+    options.maxMemorySize = opsInMemory * opSize;
+    options.maxSize = maxOps * opSize;
+    options.tempDir = tempDir.path();
+    return options;
+}
+
+TEST(OplogBufferFileTest, EntriesAreKeptInMemoryUpToTheMemoryLimit) {
+    unittest::TempDir tempDir("oplogBufferFileTest");
+    OplogBufferFile buffer(makeOptions(tempDir, 10, 100));
+    buffer.startup();
+
+    OplogBuffer::Batch ops;
+    for (int i = 0; i < 10; ++i) {
+        ops.push_back(makeOp(i));
+    }
+    ASSERT_TRUE(buffer.pushAllNonBlocking(ops.begin(), ops.end()));
+
+    ASSERT_EQUALS(10U, buffer.getCount());
+    ASSERT_EQUALS(10U * makeOp(0).objsize(), buffer.getSize());
+    ASSERT_EQUALS(0U, buffer.getSpilledSize());
+    ASSERT_TRUE(buffer.getFileName().empty());
+    ASSERT(boost::filesystem::is_empty(tempDir.path()));
+}
+
+TEST(OplogBufferFileTest, SpilledEntriesArePoppedInOrder) {
+    unittest::TempDir tempDir("oplogBufferFileTest");
+    Counter64 spilledBytes;
+    Counter64 spilledSize;
+    auto options = makeOptions(tempDir, 3, 100);
+    options.spilledBytesCounter = &spilledBytes;
+    options.spilledSizeGauge = &spilledSize;
+    OplogBufferFile buffer(options);
+    buffer.startup();
+
+    const long long opSize = makeOp(0).objsize();
+    OplogBuffer::Batch ops;
+    for (int i = 0; i < 10; ++i) {
+        ops.push_back(makeOp(i));
+    }
+    ASSERT_TRUE(buffer.pushAllNonBlocking(ops.begin(), ops.end()));
+
+    ASSERT_EQUALS(10U, buffer.getCount());
+    ASSERT_EQUALS(7U * opSize, buffer.getSpilledSize());
+    ASSERT_EQUALS(7 * opSize, spilledBytes.get());
+    ASSERT_EQUALS(7 * opSize, spilledSize.get());
+    const std::string fileName = buffer.getFileName();
+    ASSERT_TRUE(boost::filesystem::exists(fileName));
+    ASSERT_EQUALS(makeOp(9), *buffer.lastObjectPushed());
+
+    BSONObj op;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(buffer.peek(&op));
+        ASSERT_EQUALS(makeOp(i), op);
+        ASSERT_TRUE(buffer.tryPop(&op));
+        ASSERT_EQUALS(makeOp(i), op);
+
+        // Entries pushed while spilled entries remain in the file are spilled behind them.
+        if (i == 4) {
+            buffer.push(makeOp(10));
+        }
+    }
+    ASSERT_TRUE(buffer.tryPop(&op));
+    ASSERT_EQUALS(makeOp(10), op);
+
+    ASSERT_FALSE(buffer.tryPop(&op));
+    ASSERT_TRUE(buffer.isEmpty());
+    ASSERT_FALSE(buffer.lastObjectPushed());
+    ASSERT_EQUALS(0U, buffer.getSize());
+    ASSERT_EQUALS(0, spilledSize.get());
+    ASSERT_EQUALS(8 * opSize, spilledBytes.get());
+
+    // The file is removed once all of its entries have been read back.
+    ASSERT_FALSE(boost::filesystem::exists(fileName));
+}
+
+std::size_t countFiles(const unittest::TempDir& tempDir) {
+    return std::distance(boost::filesystem::directory_iterator(tempDir.path()),
+                         boost::filesystem::directory_iterator());
+}
+
+TEST(OplogBufferFileTest, SegmentsAreRemovedOnceReadBack) {
+    unittest::TempDir tempDir("oplogBufferFileTest");
+    auto options = makeOptions(tempDir, 2, 100);
+    const std::size_t opSize = makeOp(0).objsize();
+    options.maxSegmentSize = 4 * opSize;
+    OplogBufferFile buffer(options);
+    buffer.startup();
+
+    // The applier keeps up with the fetcher, but never empties the buffer.
+    int pushed = 0;
+    int popped = 0;
+    for (; pushed < 10; ++pushed) {
+        buffer.push(makeOp(pushed));
+    }
+    ASSERT_EQUALS(2U, countFiles(tempDir));
+
+    BSONObj op;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            buffer.push(makeOp(pushed++));
+        }
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(buffer.tryPop(&op));
+            ASSERT_EQUALS(makeOp(popped++), op);
+        }
+        ASSERT_EQUALS(10U * opSize, buffer.getSpilledSize());
+        ASSERT_LTE(countFiles(tempDir), 3U);
+    }
+
+    while (buffer.tryPop(&op)) {
+        ASSERT_EQUALS(makeOp(popped++), op);
+    }
+    ASSERT_EQUALS(pushed, popped);
+    ASSERT_EQUALS(0U, countFiles(tempDir));
+}
+
+TEST(OplogBufferFileTest, WaitForSpaceCountsSpilledEntries) {
+    unittest::TempDir tempDir("oplogBufferFileTest");
+    OplogBufferFile buffer(makeOptions(tempDir, 2, 5));
+    buffer.startup();
+
+    const std::size_t opSize = makeOp(0).objsize();
+    for (int i = 0; i < 4; ++i) {
+        buffer.push(makeOp(i));
+    }
+
+    // There is room for one more entry. This would block if there was not.
+    buffer.waitForSpace(opSize);
+    buffer.push(makeOp(4));
+    ASSERT_EQUALS(5U * opSize, buffer.getSize());
+
+    BSONObj op;
+    ASSERT_TRUE(buffer.tryPop(&op));
+    buffer.waitForSpace(opSize);
+}
+
+TEST(OplogBufferFileTest, ClearRemovesSpilledEntries) {
+    unittest::TempDir tempDir("oplogBufferFileTest");
+    OplogBufferFile buffer(makeOptions(tempDir, 1, 10));
+    buffer.startup();
+
+    for (int i = 0; i < 5; ++i) {
+        buffer.push(makeOp(i));
+    }
+    const std::string fileName = buffer.getFileName();
+    ASSERT_TRUE(boost::filesystem::exists(fileName));
+
+    buffer.clear();
+    ASSERT_TRUE(buffer.isEmpty());
+    ASSERT_EQUALS(0U, buffer.getCount());
+    ASSERT_EQUALS(0U, buffer.getSpilledSize());
+    ASSERT_FALSE(boost::filesystem::exists(fileName));
+    ASSERT_FALSE(buffer.waitForData(Seconds(0)));
+
+    // The buffer can be used again after being cleared.
+    buffer.pushEvenIfFull(makeOp(5));
+    ASSERT_TRUE(buffer.waitForData(Seconds(0)));
+    BSONObj op;
+    ASSERT_TRUE(buffer.tryPop(&op));
+    ASSERT_EQUALS(makeOp(5), op);
+}
+
+}  // namespace
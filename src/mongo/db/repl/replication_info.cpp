@@ -48,6 +48,7 @@
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compressor_manager.h"
 
 namespace mongo {
 
@@ -242,6 +243,8 @@ public:
         result.append("maxWireVersion", WireSpec::instance().maxWireVersionIncoming);
         result.append("minWireVersion", WireSpec::instance().minWireVersionIncoming);
         result.append("readOnly", storageGlobalParams.readOnly);
+
+        MessageCompressorManager::serverNegotiate(cmdObj, &result);
         return true;
     }
 } cmdismaster;
@@ -44,6 +44,7 @@
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/op_observer.h"
+#include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/initial_sync.h"
 #include "mongo/db/repl/old_update_position_args.h"
 #include "mongo/db/repl/oplog.h"
@@ -54,6 +55,7 @@
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_executor.h"
+#include "mongo/db/repl/rs_initialsync.h"
 #include "mongo/db/repl/update_position_args.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/storage_engine.h"
@@ -211,6 +213,10 @@ public:
             return appendCommandStatus(result, status);
 
         status = getGlobalReplicationCoordinator()->processReplSetGetStatus(&result);
+        if (status.isOK()) {
+            BackgroundSync::appendBufferStats(&result);
+            appendInitialSyncProgress(&result);
+        }
         return appendCommandStatus(result, status);
     }
 } cmdReplSetGetStatus;
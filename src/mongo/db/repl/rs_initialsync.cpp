@@ -51,12 +51,16 @@
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/storage_interface.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/net/socket_exception.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 namespace repl {
@@ -71,6 +75,71 @@ MONGO_FP_DECLARE(failInitSyncWithBufferedEntriesLeft);
 // Failpoint which causes the initial sync function to hang before copying databases.
 MONGO_FP_DECLARE(initialSyncHangBeforeCopyingDatabases);
 
+// The number of collections whose documents or indexes are cloned at once during initial sync.
+MONGO_EXPORT_SERVER_PARAMETER(initialSyncCloneConcurrency, int, 4);
+
+using CollectionsPerDb = std::map<std::string, std::vector<BSONObj>>;
+
+/**
+ * The progress of cloning each collection during the current initial sync, which is reported by
+ * replSetGetStatus.
+ */
+class InitialSyncProgress {
+public:
+    void start(const CollectionsPerDb& collectionsPerDb) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _collections.clear();
+        for (auto&& dbCollsPair : collectionsPerDb) {
+            for (auto&& collection : dbCollsPair.second) {
+                const NamespaceString nss(dbCollsPair.first, collection["name"].valuestr());
+                _collections[nss.ns()].state = "pending";
+            }
+        }
+    }
+
+    void clear() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _collections.clear();
+    }
+
+    void setState(const std::string& ns, StringData state) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _collections[ns].state = state.toString();
+    }
+
+    void setDocumentsCopied(const std::string& ns, long long documentsCopied) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _collections[ns].documentsCopied = documentsCopied;
+    }
+
+    void append(BSONObjBuilder* builder) const {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_collections.empty()) {
+            return;
+        }
+
+        BSONObjBuilder statusBuilder(builder->subobjStart("initialSyncStatus"));
+        BSONArrayBuilder collectionsBuilder(statusBuilder.subarrayStart("collections"));
+        for (auto&& nsProgressPair : _collections) {
+            collectionsBuilder.append(BSON("ns" << nsProgressPair.first << "state"
+                                                << nsProgressPair.second.state
+                                                << "documentsCopied"
+                                                << nsProgressPair.second.documentsCopied));
+        }
+    }
+
+private:
+    struct CollectionProgress {
+        std::string state;
+        long long documentsCopied = 0;
+    };
+
+    mutable stdx::mutex _mutex;
+    std::map<std::string, CollectionProgress> _collections;
+};
+
+InitialSyncProgress initialSyncProgress;
+
 /**
  * Truncates the oplog (removes any documents) and resets internal variables that were
  * originally initialized or affected by using values from the oplog at startup time.  These
@@ -167,19 +236,25 @@ void checkAdminDatabasePostClone(OperationContext* txn, Database* adminDb) {
     }
 }
 
-bool _initialSyncClone(OperationContext* txn,
-                       Cloner& cloner,
-                       const std::string& host,
-                       const std::string& db,
-                       std::vector<BSONObj>& collections,
-                       bool dataPass) {
-    if (db == "local")
-        return true;
+/**
+ * Clones the documents (if 'dataPass') or the secondary indexes of the collection described by
+ * 'collection' in 'db' from 'host', holding only an exclusive lock on the collection. Storage
+ * engines without document-level locking, such as MMAPv1, update the database's catalog when they
+ * build indexes, so on them the index pass locks the whole database exclusively.
+ */
+Status _initialSyncCloneCollection(OperationContext* txn,
+                                   Cloner& cloner,
+                                   const std::string& host,
+                                   const std::string& db,
+                                   const BSONObj& collection,
+                                   bool dataPass) {
+    const NamespaceString nss(db, collection["name"].valuestr());
 
     if (dataPass)
-        log() << "initial sync cloning db: " << db;
+        log() << "initial sync cloning collection: " << nss;
     else
-        log() << "initial sync cloning indexes for : " << db;
+        log() << "initial sync cloning indexes for : " << nss;
+    initialSyncProgress.setState(nss.ns(), dataPass ? "cloning" : "building indexes");
 
     CloneOptions options;
     options.fromDB = db;
@@ -189,20 +264,113 @@ bool _initialSyncClone(OperationContext* txn,
     options.syncData = dataPass;
     options.syncIndexes = !dataPass;
     options.createCollections = false;
+    options.collectionLocksOnly = dataPass || supportsDocLocking();
+    options.onDocumentsCopied = [&nss](long long documentsCopied) {
+        initialSyncProgress.setDocumentsCopied(nss.ns(), documentsCopied);
+    };
 
-    // Make database stable
-    ScopedTransaction transaction(txn, MODE_IX);
-    Lock::DBLock dbWrite(txn->lockState(), db, MODE_X);
+    Status status = Status::OK();
+    try {
+        ScopedTransaction transaction(txn, MODE_IX);
+        Lock::DBLock dbLock(txn->lockState(), db, options.collectionLocksOnly ? MODE_IX : MODE_X);
+        Lock::CollectionLock collectionLock(txn->lockState(), nss.ns(), MODE_X);
+
+        status = cloner.copyDb(txn, db, host, options, nullptr, {collection});
+    } catch (const DBException& ex) {
+        status = ex.toStatus();
+    }
 
-    Status status = cloner.copyDb(txn, db, host, options, nullptr, collections);
     if (!status.isOK()) {
-        log() << "initial sync: error while " << (dataPass ? "cloning " : "indexing ") << db
+        log() << "initial sync: error while " << (dataPass ? "cloning " : "indexing ") << nss
               << ".  " << status.toString();
+        initialSyncProgress.setState(nss.ns(), "failed");
+        return status;
+    }
+
+    initialSyncProgress.setState(nss.ns(), dataPass ? "cloned" : "done");
+    return Status::OK();
+}
+
+/**
+ * Clones the documents (if 'dataPass') or the secondary indexes of every collection in
+ * 'collectionsPerDb' from 'host'. Up to initialSyncCloneConcurrency collections are cloned at
+ * once, each by a thread with its own connection to 'host'.
+ */
+bool _initialSyncClone(OperationContext* txn,
+                       const std::string& host,
+                       const CollectionsPerDb& collectionsPerDb,
+                       bool dataPass) {
+    std::vector<std::pair<std::string, BSONObj>> collections;
+    for (auto&& dbCollsPair : collectionsPerDb) {
+        if (dbCollsPair.first == "local")
+            continue;
+        for (auto&& collection : dbCollsPair.second) {
+            collections.emplace_back(dbCollsPair.first, collection);
+        }
+    }
+
+    stdx::mutex mutex;
+    size_t nextCollection = 0;
+    Status firstError = Status::OK();
+
+    auto cloneCollections = [&](int threadNumber) {
+        const std::string threadName = str::stream() << "initialSyncCloner-" << threadNumber;
+        Client::initThread(threadName.c_str());
+        const ServiceContext::UniqueOperationContext clonerTxnPtr = cc().makeOperationContext();
+        OperationContext& clonerTxn = *clonerTxnPtr;
+        clonerTxn.setReplicatedWrites(false);
+        DisableDocumentValidation validationDisabler(&clonerTxn);
+
+        // Each thread has its own connection to the sync source.
+        Cloner cloner;
+        while (true) {
+            const std::pair<std::string, BSONObj>* dbCollectionPair;
+            {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                if (!firstError.isOK() || nextCollection == collections.size()) {
+                    return;
+                }
+                if (inShutdown()) {
+                    firstError = {ErrorCodes::ShutdownInProgress, "shutting down"};
+                    return;
+                }
+                dbCollectionPair = &collections[nextCollection++];
+            }
+
+            Status status = _initialSyncCloneCollection(&clonerTxn,
+                                                        cloner,
+                                                        host,
+                                                        dbCollectionPair->first,
+                                                        dbCollectionPair->second,
+                                                        dataPass);
+            if (!status.isOK()) {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                if (firstError.isOK()) {
+                    firstError = status;
+                }
+                return;
+            }
+        }
+    };
+
+    const int numThreads = std::max(
+        1, std::min(initialSyncCloneConcurrency.load(), static_cast<int>(collections.size())));
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(cloneCollections, i);
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+
+    if (!firstError.isOK()) {
         return false;
     }
 
-    if (dataPass && (db == "admin")) {
-        checkAdminDatabasePostClone(txn, dbHolder().get(txn, db));
+    if (dataPass && collectionsPerDb.count("admin")) {
+        ScopedTransaction transaction(txn, MODE_IX);
+        Lock::DBLock dbLock(txn->lockState(), "admin", MODE_X);
+        checkAdminDatabasePostClone(txn, dbHolder().get(txn, "admin"));
     }
     return true;
 }
@@ -383,7 +551,7 @@ Status _initialSync(BackgroundSync* bgsync) {
     }
 
     Cloner cloner;
-    std::map<std::string, std::vector<BSONObj>> collectionsPerDb;
+    CollectionsPerDb collectionsPerDb;
     for (auto&& db : dbs) {
         CloneOptions options;
         options.fromDB = db;
@@ -405,15 +573,12 @@ Status _initialSync(BackgroundSync* bgsync) {
         }
         collectionsPerDb.emplace(db, std::move(collections));
     }
-    for (auto&& dbCollsPair : collectionsPerDb) {
-        if (!_initialSyncClone(&txn,
-                               cloner,
-                               r.conn()->getServerAddress(),
-                               dbCollsPair.first,
-                               dbCollsPair.second,
-                               true)) {
-            return Status(ErrorCodes::InitialSyncFailure, "initial sync failed data cloning");
-        }
+
+    // Secondary indexes are only built once the data has been cloned and made consistent, below.
+    initialSyncProgress.start(collectionsPerDb);
+    ON_BLOCK_EXIT([] { initialSyncProgress.clear(); });
+    if (!_initialSyncClone(&txn, r.conn()->getServerAddress(), collectionsPerDb, true)) {
+        return Status(ErrorCodes::InitialSyncFailure, "initial sync failed data cloning");
     }
 
     log() << "initial sync data copy, starting syncup";
@@ -448,16 +613,9 @@ Status _initialSync(BackgroundSync* bgsync) {
 
     msg = "initial sync building indexes";
     log() << msg;
-    for (auto&& dbCollsPair : collectionsPerDb) {
-        if (!_initialSyncClone(&txn,
-                               cloner,
-                               r.conn()->getServerAddress(),
-                               dbCollsPair.first,
-                               dbCollsPair.second,
-                               false)) {
-            return Status(ErrorCodes::InitialSyncFailure,
-                          str::stream() << "initial sync failed: " << msg);
-        }
+    if (!_initialSyncClone(&txn, r.conn()->getServerAddress(), collectionsPerDb, false)) {
+        return Status(ErrorCodes::InitialSyncFailure,
+                      str::stream() << "initial sync failed: " << msg);
     }
 
     // WARNING: If the 3rd oplog sync step is removed we must reset minValid to the last entry on
@@ -510,6 +668,10 @@ const auto kMaxFailedAttempts = 10;
 const auto kInitialSyncRetrySleepDuration = Seconds{5};
 }  // namespace
 
+void appendInitialSyncProgress(BSONObjBuilder* builder) {
+    initialSyncProgress.append(builder);
+}
+
 void syncDoInitialSync(BackgroundSync* bgsync) {
     stdx::unique_lock<stdx::mutex> lk(_initialSyncMutex, stdx::defer_lock);
     if (!lk.try_lock()) {
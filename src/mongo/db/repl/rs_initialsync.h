@@ -29,6 +29,9 @@
 #pragma once
 
 namespace mongo {
+
+class BSONObjBuilder;
+
 namespace repl {
 
 class BackgroundSync;
@@ -39,5 +42,11 @@ class BackgroundSync;
  */
 void syncDoInitialSync(BackgroundSync* bgsync);
 
+/**
+ * Appends the progress of cloning each collection during the initial sync in progress, if any, to
+ * 'builder' as "initialSyncStatus".
+ */
+void appendInitialSyncProgress(BSONObjBuilder* builder);
+
 }  // namespace repl
 }  // namespace mongo
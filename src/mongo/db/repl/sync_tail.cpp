@@ -118,6 +118,19 @@ static Counter64 opsAppliedStats;
 // The oplog entries applied
 static ServerStatusMetricField<Counter64> displayOpsApplied("repl.apply.ops", &opsAppliedStats);
 
+// The oplog entries applied by the writer threads together with other entries for the same
+// collection (grouped inserts, updates and deletes), and those applied on their own.
+static Counter64 groupedOpsAppliedStats;
+static ServerStatusMetricField<Counter64> displayGroupedOpsApplied("repl.apply.groupedOps",
+                                                                   &groupedOpsAppliedStats);
+static Counter64 singleOpsAppliedStats;
+static ServerStatusMetricField<Counter64> displaySingleOpsApplied("repl.apply.singleOps",
+                                                                  &singleOpsAppliedStats);
+
+// The most updates and deletes to a single collection that a writer thread applies in one
+// WriteUnitOfWork. Values below 2 disable grouping of updates and deletes.
+MONGO_EXPORT_SERVER_PARAMETER(replGroupedUpdatesMaxOps, int, 64);
+
 MONGO_FP_DECLARE(rsSyncApplyStop);
 
 // Failpoint which causes the initial sync function to hang before calling shouldRetry on a failed
@@ -128,6 +141,21 @@ MONGO_FP_DECLARE(initialSyncHangBeforeGettingMissingDocument);
 static TimerStats applyBatchStats;
 static ServerStatusMetricField<TimerStats> displayOpBatchesApplied("repl.apply.batches",
                                                                    &applyBatchStats);
+
+// Number and time of each stage of the oplog application pipeline in oplogApplication(). Batches
+// are partitioned among the writer threads by the batcher while the previous batch is applied,
+// then applied by the writer threads while the applier writes them to the oplog. 'oplogWrite' is
+// included in 'apply', which ends once both are done.
+static TimerStats pipelinePartitionStats;
+static ServerStatusMetricField<TimerStats> displayPipelinePartition("repl.apply.pipeline.partition",
+                                                                    &pipelinePartitionStats);
+static TimerStats pipelineApplyStats;
+static ServerStatusMetricField<TimerStats> displayPipelineApply("repl.apply.pipeline.apply",
+                                                                &pipelineApplyStats);
+static TimerStats pipelineOplogWriteStats;
+static ServerStatusMetricField<TimerStats> displayPipelineOplogWrite(
+    "repl.apply.pipeline.oplogWrite", &pipelineOplogWriteStats);
+
 void initializePrefetchThread() {
     if (!ClientBasic::getCurrent()) {
         Client::initThreadIfNotAlready();
@@ -370,7 +398,7 @@ Status SyncTail::syncApply(OperationContext* txn,
     }
 
     if (isCrudOpType(opType)) {
-        MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+        auto applyCrudOp = [&] {
             // DB lock always acquires the global lock
             std::unique_ptr<Lock::DBLock> dbLock;
             std::unique_ptr<Lock::CollectionLock> collectionLock;
@@ -401,6 +429,16 @@ Status SyncTail::syncApply(OperationContext* txn,
             }
 
             return applyOp(ctx->db());
+        };
+
+        // When this op is part of a group applied in the caller's WriteUnitOfWork, a write
+        // conflict must abort the whole group, so leave retrying to the caller.
+        if (txn->lockState()->inAWriteUnitOfWork()) {
+            return applyCrudOp();
+        }
+
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+            return applyCrudOp();
         }
         MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "syncApply_CRUD", ns);
     }
@@ -500,29 +538,49 @@ private:
     StringMap<bool> _cache;
 };
 
+WriterHashes computeWriterHashes(const OplogEntry& op, bool supportsDocLocking) {
+    WriterHashes hashes;
+    hashes.nsHash = StringMapTraits::hash(op.ns);
+    hashes.docHash = hashes.nsHash;
+    if (supportsDocLocking && op.isCrudOpType()) {
+        BSONElement id = op.getIdElement();
+        const size_t idHash = BSONElement::Hasher()(id);
+        MurmurHash3_x86_32(&idHash, sizeof(idHash), hashes.nsHash, &hashes.docHash);
+    }
+    return hashes;
+}
+
+/**
+ * Assigns each of 'ops' to one of the 'writerVectors'. If 'precomputedHashes' is not null, it holds
+ * the result of computeWriterHashes() for each of 'ops', leaving only the checks which depend on
+ * the catalog to be done here.
+ */
 void fillWriterVectors(OperationContext* txn,
                        const MultiApplier::Operations& ops,
+                       const std::vector<WriterHashes>* precomputedHashes,
                        std::vector<MultiApplier::Operations>* writerVectors) {
     const bool supportsDocLocking =
         getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
     const uint32_t numWriters = writerVectors->size();
+    invariant(!precomputedHashes || precomputedHashes->size() == ops.size());
 
     Lock::GlobalRead globalReadLock(txn->lockState());
 
     CachingCappedChecker isCapped;
 
-    for (auto&& op : ops) {
-        StringMapTraits::HashedKey hashedNs(op.ns);
-        uint32_t hash = hashedNs.hash();
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const OplogEntry& op = ops[i];
+        const WriterHashes hashes = precomputedHashes ? (*precomputedHashes)[i]
+                                                      : computeWriterHashes(op, supportsDocLocking);
+        StringMapTraits::HashedKey hashedNs(op.ns, hashes.nsHash);
+        uint32_t hash = hashes.nsHash;
 
         // For doc locking engines, include the _id of the document in the hash so we get
         // parallelism even if all writes are to a single collection. We can't do this for capped
         // collections because the order of inserts is a guaranteed property, unlike for normal
         // collections.
         if (supportsDocLocking && op.isCrudOpType() && !isCapped(txn, hashedNs)) {
-            BSONElement id = op.getIdElement();
-            const size_t idHash = BSONElement::Hasher()(id);
-            MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+            hash = hashes.docHash;
         }
 
         if (op.opType == "i" && isCapped(txn, hashedNs)) {
@@ -537,6 +595,61 @@ void fillWriterVectors(OperationContext* txn,
     }
 }
 
+/**
+ * Applies 'ops' using the threads of 'workerPool' while holding the ParallelBatchWriterMode lock,
+ * and calls 'whileApplying', if given, on this thread while they do. 'precomputedHashes' is passed
+ * to fillWriterVectors().
+ *
+ * Returns ErrorCodes::InterruptedAtShutdown or ErrorCodes::CannotApplyOplogWhilePrimary as
+ * multiApply() does.
+ */
+Status applyBatch(OperationContext* txn,
+                  OldThreadPool* workerPool,
+                  const MultiApplier::Operations& ops,
+                  const std::vector<WriterHashes>* precomputedHashes,
+                  MultiApplier::ApplyOperationFn applyOperation,
+                  const stdx::function<void()>& whileApplying) {
+    if (getGlobalServiceContext()->getGlobalStorageEngine()->isMmapV1()) {
+        // Use a ThreadPool to prefetch all the operations in a batch.
+        prefetchOps(ops, workerPool);
+    }
+
+    std::vector<std::vector<OplogEntry>> writerVectors(workerPool->getNumThreads());
+
+    fillWriterVectors(txn, ops, precomputedHashes, &writerVectors);
+    LOG(2) << "replication batch size is " << ops.size();
+    // We must grab this because we're going to grab write locks later.
+    // We hold this mutex the entire time we're writing; it doesn't matter
+    // because all readers are blocked anyway.
+    stdx::lock_guard<SimpleMutex> fsynclk(filesLockedFsync);
+
+    // stop all readers until we're done
+    Lock::ParallelBatchWriterMode pbwm(txn->lockState());
+
+    auto replCoord = ReplicationCoordinator::get(txn);
+    if (replCoord->getMemberState().primary() && !replCoord->isWaitingForApplierToDrain()) {
+        severe() << "attempting to replicate ops while primary";
+        return {ErrorCodes::CannotApplyOplogWhilePrimary,
+                "attempting to replicate ops while primary"};
+    }
+
+    applyOps(writerVectors, workerPool, applyOperation);
+
+    {
+        ON_BLOCK_EXIT([&] { workerPool->join(); });
+        if (whileApplying) {
+            whileApplying();
+        }
+    }
+
+    if (inShutdownStrict()) {
+        log() << "Cannot apply operations due to shutdown in progress";
+        return {ErrorCodes::InterruptedAtShutdown,
+                "Cannot apply operations due to shutdown in progress"};
+    }
+    return Status::OK();
+}
+
 }  // namespace
 
 // Applies a batch of oplog entries, by using a set of threads to apply the operations and then
@@ -600,7 +713,18 @@ void tryToGoLiveAsASecondary(OperationContext* txn,
                   << ". Current state: " << replCoord->getMemberState();
     }
 }
-}
+
+/**
+ * A batch of oplog entries ready to be applied by oplogApplication(), along with the hashes used to
+ * assign each of them to a writer thread. The hashes are computed by the OpQueueBatcher, while the
+ * previous batch is being applied.
+ */
+struct PreparedBatch {
+    MultiApplier::Operations ops;
+    std::vector<WriterHashes> hashes;
+};
+
+}  // namespace
 
 class SyncTail::OpQueueBatcher {
     MONGO_DISALLOW_COPYING(OpQueueBatcher);
@@ -613,19 +737,19 @@ public:
         _thread.join();
     }
 
-    OpQueue getNextBatch(Seconds maxWaitTime) {
+    PreparedBatch getNextBatch(Seconds maxWaitTime) {
         stdx::unique_lock<stdx::mutex> lk(_mutex);
-        if (_ops.empty()) {
+        if (_batch.ops.empty() && maxWaitTime > Seconds(0)) {
             // We intentionally don't care about whether this returns due to signaling or timeout
-            // since we do the same thing either way: return whatever is in _ops.
+            // since we do the same thing either way: return whatever is in _batch.
             (void)_cv.wait_for(lk, maxWaitTime.toSystemDuration());
         }
 
-        OpQueue ops = std::move(_ops);
-        _ops = {};
+        PreparedBatch batch = std::move(_batch);
+        _batch = {};
         _cv.notify_all();
 
-        return ops;
+        return batch;
     }
 
 private:
@@ -678,24 +802,45 @@ private:
                 sleepmillis(10);
             }
 
+            PreparedBatch batch = prepareBatch(ops);
+
             stdx::unique_lock<stdx::mutex> lk(_mutex);
-            while (!_ops.empty()) {
+            while (!_batch.ops.empty()) {
                 // Block until the previous batch has been taken.
                 if (_inShutdown.load())
                     return;
                 _cv.wait(lk);
             }
-            _ops = std::move(ops);
+            _batch = std::move(batch);
             _cv.notify_all();
         }
     }
 
+    /**
+     * Computes the writer thread hashes of each entry in 'ops', which is the part of assigning
+     * them to writer threads that does not depend on the catalog, and so can be done before the
+     * previous batch has been applied.
+     */
+    static PreparedBatch prepareBatch(const OpQueue& ops) {
+        TimerHolder timer(&pipelinePartitionStats);
+        const bool supportsDocLocking =
+            getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
+
+        PreparedBatch batch;
+        batch.ops.assign(ops.getDeque().begin(), ops.getDeque().end());
+        batch.hashes.reserve(batch.ops.size());
+        for (auto&& op : batch.ops) {
+            batch.hashes.push_back(computeWriterHashes(op, supportsDocLocking));
+        }
+        return batch;
+    }
+
     AtomicWord<bool> _inShutdown;
     SyncTail* const _syncTail;
 
-    stdx::mutex _mutex;  // Guards _ops.
+    stdx::mutex _mutex;  // Guards _batch.
     stdx::condition_variable _cv;
-    OpQueue _ops;
+    PreparedBatch _batch;
 
     stdx::thread _thread;  // Must be last so all other members are initialized before starting.
 };
@@ -716,7 +861,7 @@ void SyncTail::oplogApplication() {
     OpTime originalEndOpTime(minValidBoundaries.end);
     OpTime lastWriteOpTime{replCoord->getMyLastAppliedOpTime()};
     while (!inShutdown()) {
-        OpQueue ops;
+        PreparedBatch batch;
 
         do {
             if (replCoord->getInitialSyncRequestedFlag()) {
@@ -728,20 +873,20 @@ void SyncTail::oplogApplication() {
 
             // Blocks up to a second waiting for a batch to be ready to apply. If one doesn't become
             // ready in time, we'll loop again so we can do the above checks periodically.
-            ops = batcher.getNextBatch(Seconds(1));
-        } while (!inShutdown() && ops.empty());
+            batch = batcher.getNextBatch(Seconds(1));
+        } while (!inShutdown() && batch.ops.empty());
 
         if (inShutdown())
             return;
 
-        invariant(!ops.empty());
+        invariant(!batch.ops.empty());
 
-        const BSONObj lastOp = ops.back().raw;
+        const BSONObj lastOp = batch.ops.back().raw;
 
         if (lastOp.isEmpty()) {
             // This means that the network thread has coalesced and we have processed all of its
             // data.
-            invariant(ops.getDeque().size() == 1);
+            invariant(batch.ops.size() == 1);
             if (replCoord->isWaitingForApplierToDrain()) {
                 replCoord->signalDrainComplete(&txn);
             }
@@ -793,16 +938,35 @@ void SyncTail::oplogApplication() {
         // This write will not journal/checkpoint.
         StorageInterface::get(&txn)->setMinValid(&txn, {start, end});
 
-        lastWriteOpTime = multiApply(&txn, ops);
-        if (lastWriteOpTime.isNull()) {
-            // fassert if oplog application failed for any reasons other than shutdown.
-            error() << "Failed to apply " << ops.getDeque().size()
+        // Apply this batch while it is written to the oplog. Both finish before the
+        // ParallelBatchWriterMode lock is released, so readers never see the writes of the batch
+        // without its oplog entries.
+        auto applyOperation = [this](const MultiApplier::Operations& ops) {
+            _applyFunc(ops, this);
+        };
+        auto writeOplog = [](OperationContext* txn, const MultiApplier::Operations& ops) {
+            return StorageInterface::get(txn)->writeOpsToOplog(
+                txn, NamespaceString(rsOplogName), ops);
+        };
+        StatusWith<OpTime> result = OpTime();
+        {
+            TimerHolder timer(&pipelineApplyStats);
+            result = multiApplyAndWriteOplog(
+                &txn, _writerPool.get(), batch.ops, &batch.hashes, applyOperation, writeOplog);
+        }
+        if (!result.isOK()) {
+            error() << "Failed to apply " << batch.ops.size()
                     << " operations - batch start:" << start << " end:" << end;
+            // fassert if oplog application failed for any reasons other than shutdown.
+            if (result.getStatus() != ErrorCodes::InterruptedAtShutdown) {
+                fassertStatusOK(34437, result.getStatus());
+            }
             fassert(34360, inShutdownStrict());
             // Return without setting minvalid in the case of shutdown.
             return;
         }
 
+        lastWriteOpTime = result.getValue();
         setNewTimestamp(lastWriteOpTime.getTimestamp());
         StorageInterface::get(&txn)->setMinValid(&txn, end, DurableRequirement::None);
         minValidBoundaries.start = {};
@@ -1086,6 +1250,8 @@ Status multiSyncApply_noAbort(OperationContext* txn,
                         syncApply(txn, groupedInsertBuilder.done(), convertUpdatesToUpserts));
                     // It succeeded, advance the oplogEntriesIterator to the end of the
                     // group of inserts.
+                    groupedOpsAppliedStats.increment(
+                        endOfGroupableOpsIterator - oplogEntriesIterator);
                     oplogEntriesIterator = endOfGroupableOpsIterator - 1;
                     continue;
                 } catch (const DBException& e) {
@@ -1106,6 +1272,70 @@ Status multiSyncApply_noAbort(OperationContext* txn,
             }
         }
 
+        if ((entry->opType[0] == 'u' || entry->opType[0] == 'd') &&
+            oplogEntriesIterator > doNotGroupBeforePoint) {
+            // Attempt to apply a run of updates and deletes to the same collection in a single
+            // WriteUnitOfWork, taking the collection lock once for the whole run.
+            const int maxGroupSize = replGroupedUpdatesMaxOps.load();
+            int groupSize = 1;
+            auto endOfGroupableOpsIterator =
+                std::find_if(oplogEntriesIterator + 1,
+                             oplogEntryPointers.end(),
+                             [&](const OplogEntry* nextEntry) {
+                                 return (nextEntry->opType[0] != 'u' &&  // Must be an update
+                                         nextEntry->opType[0] != 'd') ||  // or a delete.
+                                     nextEntry->ns != entry->ns ||  // Must be the same namespace.
+                                     ++groupSize > maxGroupSize;    // Or have too many entries.
+                             });
+
+            if (endOfGroupableOpsIterator != oplogEntriesIterator + 1) {
+                try {
+                    const StringData dbName = nsToDatabaseSubstring(entry->ns);
+                    MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+                        Lock::DBLock dbLock(txn->lockState(), dbName, MODE_IX);
+                        Lock::CollectionLock collectionLock(txn->lockState(), entry->ns, MODE_IX);
+
+                        // syncApply() would need to upgrade to MODE_X to create a missing
+                        // database or collection, which cannot be done inside the group.
+                        Database* db = dbHolder().get(txn, dbName);
+                        uassert(ErrorCodes::NamespaceNotFound,
+                                str::stream() << "collection " << entry->ns << " does not exist",
+                                db && db->getCollection(entry->ns));
+
+                        WriteUnitOfWork wuow(txn);
+                        for (auto groupingIterator = oplogEntriesIterator;
+                             groupingIterator != endOfGroupableOpsIterator;
+                             ++groupingIterator) {
+                            uassertStatusOK(syncApply(
+                                txn, (*groupingIterator)->raw, convertUpdatesToUpserts));
+                        }
+                        wuow.commit();
+                    }
+                    MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "multiSyncApply_grouped", entry->ns);
+
+                    // It succeeded, advance the oplogEntriesIterator to the end of the group.
+                    groupedOpsAppliedStats.increment(
+                        endOfGroupableOpsIterator - oplogEntriesIterator);
+                    oplogEntriesIterator = endOfGroupableOpsIterator - 1;
+                    continue;
+                } catch (const DBException& e) {
+                    // The group was rolled back, log an error and fall through to applying each
+                    // op in its own WriteUnitOfWork.
+                    str::stream msg;
+                    msg << "Error applying updates and deletes in bulk " << causedBy(e)
+                        << " trying first op on its own";
+                    error() << std::string(msg);
+                    if (inShutdown()) {
+                        return {ErrorCodes::InterruptedAtShutdown, msg};
+                    }
+
+                    // Avoid quadratic run time from a failed group by not retrying until we
+                    // are beyond this group of ops.
+                    doNotGroupBeforePoint = endOfGroupableOpsIterator - 1;
+                }
+            }
+        }
+
         try {
             // Apply an individual (non-grouped) op.
             const Status s = syncApply(txn, entry->raw, convertUpdatesToUpserts);
@@ -1117,6 +1347,7 @@ Status multiSyncApply_noAbort(OperationContext* txn,
                 }
                 return s;
             }
+            singleOpsAppliedStats.increment();
         } catch (const DBException& e) {
             severe() << "writer worker caught exception: " << causedBy(e)
                      << " on: " << entry->raw.toString();
@@ -1200,48 +1431,41 @@ StatusWith<OpTime> multiApply(OperationContext* txn,
         return {ErrorCodes::BadValue, "invalid apply operation function"};
     }
 
-    if (getGlobalServiceContext()->getGlobalStorageEngine()->isMmapV1()) {
-        // Use a ThreadPool to prefetch all the operations in a batch.
-        prefetchOps(ops, workerPool);
-    }
-
-    std::vector<std::vector<OplogEntry>> writerVectors(workerPool->getNumThreads());
-
-    fillWriterVectors(txn, ops, &writerVectors);
-    LOG(2) << "replication batch size is " << ops.size();
-    // We must grab this because we're going to grab write locks later.
-    // We hold this mutex the entire time we're writing; it doesn't matter
-    // because all readers are blocked anyway.
-    stdx::lock_guard<SimpleMutex> fsynclk(filesLockedFsync);
-
-    // stop all readers until we're done
-    Lock::ParallelBatchWriterMode pbwm(txn->lockState());
-
-    auto replCoord = ReplicationCoordinator::get(txn);
-    if (replCoord->getMemberState().primary() && !replCoord->isWaitingForApplierToDrain()) {
-        severe() << "attempting to replicate ops while primary";
-        return {ErrorCodes::CannotApplyOplogWhilePrimary,
-                "attempting to replicate ops while primary"};
-    }
-
-    applyOps(writerVectors, workerPool, applyOperation);
-
     OpTime lastOpTime;
-    {
-        ON_BLOCK_EXIT([&] { workerPool->join(); });
+    auto writeOplog = [&] {
         lastOpTime = fassertStatusOK(
             40141,
             StorageInterface::get(txn)->writeOpsToOplog(txn, NamespaceString(rsOplogName), ops));
+    };
+    auto status = applyBatch(txn, workerPool, ops, nullptr, applyOperation, writeOplog);
+    if (!status.isOK()) {
+        return status;
     }
 
-    if (inShutdownStrict()) {
-        log() << "Cannot apply operations due to shutdown in progress";
-        return {ErrorCodes::InterruptedAtShutdown,
-                "Cannot apply operations due to shutdown in progress"};
-    }
     // We have now written all database writes and updated the oplog to match.
     return lastOpTime;
 }
 
+StatusWith<OpTime> multiApplyAndWriteOplog(OperationContext* txn,
+                                           OldThreadPool* workerPool,
+                                           const MultiApplier::Operations& ops,
+                                           const std::vector<WriterHashes>* precomputedHashes,
+                                           MultiApplier::ApplyOperationFn applyOperation,
+                                           const WriteOplogFn& writeOplog) {
+    invariant(!ops.empty());
+
+    StatusWith<OpTime> written = OpTime();
+    auto whileApplying = [&] {
+        TimerHolder timer(&pipelineOplogWriteStats);
+        written = writeOplog(txn, ops);
+    };
+    auto status =
+        applyBatch(txn, workerPool, ops, precomputedHashes, applyOperation, whileApplying);
+    if (!status.isOK()) {
+        return status;
+    }
+    return written;
+}
+
 }  // namespace repl
 }  // namespace mongo
@@ -30,6 +30,7 @@
 
 #include <deque>
 #include <memory>
+#include <vector>
 
 #include "mongo/base/status.h"
 #include "mongo/bson/bsonobj.h"
@@ -198,6 +199,37 @@ StatusWith<OpTime> multiApply(OperationContext* txn,
                               const MultiApplier::Operations& ops,
                               MultiApplier::ApplyOperationFn applyOperation);
 
+/**
+ * The hashes which determine the writer thread an oplog entry is applied by.
+ */
+struct WriterHashes {
+    // The hash of the namespace alone.
+    uint32_t nsHash;
+
+    // The hash of the namespace and the _id of the document, for CRUD ops on storage engines that
+    // support document locking. Otherwise equal to 'nsHash'.
+    uint32_t docHash;
+};
+
+/**
+ * Applies "ops" as multiApply() does, calling "writeOplog" on this thread to write them to the
+ * oplog while the worker threads apply them. Both finish before the ParallelBatchWriterMode lock
+ * is released, so readers, including the committed snapshot thread, never observe the writes of
+ * the batch without its oplog entries. "precomputedHashes", if not null, holds the WriterHashes of
+ * each of "ops".
+ *
+ * Returns the error of applying "ops" as multiApply() does, then the error of "writeOplog", and
+ * the OpTime returned by "writeOplog" otherwise.
+ */
+using WriteOplogFn =
+    stdx::function<StatusWith<OpTime>(OperationContext* txn, const MultiApplier::Operations& ops)>;
+StatusWith<OpTime> multiApplyAndWriteOplog(OperationContext* txn,
+                                           OldThreadPool* workerPool,
+                                           const MultiApplier::Operations& ops,
+                                           const std::vector<WriterHashes>* precomputedHashes,
+                                           MultiApplier::ApplyOperationFn applyOperation,
+                                           const WriteOplogFn& writeOplog);
+
 // These free functions are used by the thread pool workers to write ops to the db.
 void multiSyncApply(const std::vector<OplogEntry>& ops, SyncTail* st);
 void multiInitialSyncApply(const std::vector<OplogEntry>& ops, SyncTail* st);
@@ -43,6 +43,7 @@
 #include "mongo/db/db_raii.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplog_interface_local.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_coordinator_mock.h"
@@ -51,10 +52,13 @@
 #include "mongo/db/repl/sync_tail.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_d_test_fixture.h"
+#include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/concurrency/old_thread_pool.h"
 #include "mongo/util/string_map.h"
+#include "mongo/util/time_support.h"
 
 namespace {
 
@@ -229,6 +233,21 @@ OplogEntry makeUpdateDocumentOplogEntry(OpTime opTime,
     return OplogEntry(bob.obj());
 }
 
+/**
+ * Creates a delete oplog entry with given optime and namespace.
+ */
+OplogEntry makeDeleteDocumentOplogEntry(OpTime opTime,
+                                        const NamespaceString& nss,
+                                        const BSONObj& documentToDelete) {
+    BSONObjBuilder bob;
+    bob.appendElements(opTime.toBSON());
+    bob.append("h", 1LL);
+    bob.append("op", "d");
+    bob.append("ns", nss.ns());
+    bob.append("o", documentToDelete);
+    return OplogEntry(bob.obj());
+}
+
 TEST_F(SyncTailTest, SyncApplyNoNamespaceBadOp) {
     const BSONObj op = BSON("op"
                             << "x");
@@ -582,6 +601,104 @@ TEST_F(SyncTailTest, MultiApplyAssignsOperationsToWriterThreadsBasedOnNamespaceH
     ASSERT_EQUALS(op2, operationsWritternToOplog[1]);
 }
 
+TEST_F(SyncTailTest, MultiApplyAndWriteOplogWritesOplogWhileHoldingParallelBatchWriterMode) {
+    NamespaceString nss("test.t");
+    auto writerPool = SyncTail::makeWriterPool();
+    auto txn = _txn.get();
+    auto op1 = makeInsertDocumentOplogEntry({Timestamp(Seconds(1), 0), 1LL}, nss, BSON("x" << 1));
+    auto op2 = makeInsertDocumentOplogEntry({Timestamp(Seconds(2), 0), 1LL}, nss, BSON("x" << 2));
+
+    stdx::mutex mutex;
+    std::size_t operationsApplied = 0;
+    auto applyOperationFn = [&](const MultiApplier::Operations& operationsToApply) {
+        stdx::lock_guard<stdx::mutex> lock(mutex);
+        operationsApplied += operationsToApply.size();
+    };
+    bool writtenUnderLock = false;
+    auto writeOplogFn = [&](OperationContext* txn, const MultiApplier::Operations& ops) {
+        writtenUnderLock =
+            txn->lockState()->isLockHeldForMode(resourceIdParallelBatchWriterMode, MODE_X);
+        return _storageInterface->writeOpsToOplog(txn, NamespaceString(rsOplogName), ops);
+    };
+
+    auto lastOpTime = unittest::assertGet(multiApplyAndWriteOplog(
+        txn, writerPool.get(), {op1, op2}, nullptr, applyOperationFn, writeOplogFn));
+    ASSERT_EQUALS(op2.getOpTime(), lastOpTime);
+    ASSERT_TRUE(writtenUnderLock);
+    ASSERT_FALSE(txn->lockState()->isLockHeldForMode(resourceIdParallelBatchWriterMode, MODE_IS));
+
+    // Both the applying and the oplog write have finished by the time the lock is released.
+    {
+        stdx::lock_guard<stdx::mutex> lock(mutex);
+        ASSERT_EQUALS(2U, operationsApplied);
+    }
+    auto operationsWrittenToOplog = _storageInterface->getOperationsWrittenToOplog();
+    ASSERT_EQUALS(2U, operationsWrittenToOplog.size());
+    ASSERT_EQUALS(op1, operationsWrittenToOplog[0]);
+    ASSERT_EQUALS(op2, operationsWrittenToOplog[1]);
+}
+
+TEST_F(SyncTailTest, MultiApplyAndWriteOplogReturnsOplogWriteError) {
+    NamespaceString nss("test.t");
+    auto writerPool = SyncTail::makeWriterPool();
+    auto op = makeInsertDocumentOplogEntry({Timestamp(Seconds(1), 0), 1LL}, nss, BSON("x" << 1));
+
+    bool applied = false;
+    auto applyOperationFn = [&applied](const MultiApplier::Operations&) { applied = true; };
+    auto writeOplogFn = [](OperationContext*, const MultiApplier::Operations&) {
+        return StatusWith<OpTime>(ErrorCodes::OperationFailed, "failed to write oplog");
+    };
+
+    auto status = multiApplyAndWriteOplog(
+                      _txn.get(), writerPool.get(), {op}, nullptr, applyOperationFn, writeOplogFn)
+                      .getStatus();
+    ASSERT_EQUALS(ErrorCodes::OperationFailed, status);
+    ASSERT_STRING_CONTAINS(status.reason(), "failed to write oplog");
+    ASSERT_TRUE(applied);
+}
+
+TEST_F(SyncTailTest, MultiApplyAndWriteOplogHidesBatchFromSnapshotsUntilOplogIsWritten) {
+    NamespaceString nss("test.t");
+    auto writerPool = SyncTail::makeWriterPool();
+    auto op1 = makeInsertDocumentOplogEntry({Timestamp(Seconds(1), 0), 1LL}, nss, BSON("x" << 1));
+    auto op2 = makeInsertDocumentOplogEntry({Timestamp(Seconds(2), 0), 1LL}, nss, BSON("x" << 2));
+
+    stdx::mutex mutex;
+    stdx::condition_variable condition;
+    bool applying = false;
+    auto applyOperationFn = [&](const MultiApplier::Operations&) {
+        stdx::lock_guard<stdx::mutex> lock(mutex);
+        applying = true;
+        condition.notify_all();
+    };
+    auto writeOplogFn = [&](OperationContext* txn, const MultiApplier::Operations& ops) {
+        // Give the snapshot thread below time to block on the global lock.
+        sleepmillis(100);
+        return _storageInterface->writeOpsToOplog(txn, NamespaceString(rsOplogName), ops);
+    };
+
+    // Like the committed snapshot thread, reads the last oplog entry under a global IS lock once
+    // the batch is being applied.
+    std::size_t operationsSeenBySnapshot = 0;
+    stdx::thread snapshotThread([&] {
+        Client::initThread("SyncTailTestSnapshot");
+        auto snapshotTxn = cc().makeOperationContext();
+        {
+            stdx::unique_lock<stdx::mutex> lock(mutex);
+            condition.wait(lock, [&applying] { return applying; });
+        }
+        Lock::GlobalLock globalLock(snapshotTxn->lockState(), MODE_IS, UINT_MAX);
+        operationsSeenBySnapshot = _storageInterface->getOperationsWrittenToOplog().size();
+    });
+
+    auto lastOpTime = unittest::assertGet(multiApplyAndWriteOplog(
+        _txn.get(), writerPool.get(), {op1, op2}, nullptr, applyOperationFn, writeOplogFn));
+    snapshotThread.join();
+
+    ASSERT_EQUALS(op2.getOpTime(), lastOpTime);
+    ASSERT_EQUALS(2U, operationsSeenBySnapshot);
+}
+
 TEST_F(SyncTailTest, MultiSyncApplyUsesSyncApplyToApplyOperation) {
     NamespaceString nss("local." + _agent.getSuiteName() + "_" + _agent.getTestName());
     ASSERT_TRUE(_txn->writesAreReplicated());
@@ -810,6 +927,79 @@ TEST_F(SyncTailTest, MultiSyncApplyFallsBackOnApplyingInsertsIndividuallyWhenGro
     ASSERT_EQUALS(1U, numFailedGroupedInserts);
 }
 
+TEST_F(SyncTailTest, MultiSyncApplyAppliesUpdatesAndDeletesToSameCollectionInOneUnitOfWork) {
+    NamespaceString nss("test." + _agent.getSuiteName() + "_" + _agent.getTestName());
+    createCollection(_txn.get(), nss, CollectionOptions());
+
+    auto updateOp1 = makeUpdateDocumentOplogEntry(
+        {Timestamp(Seconds(1), 0), 1LL}, nss, BSON("_id" << 0), BSON("_id" << 0 << "x" << 1));
+    auto deleteOp =
+        makeDeleteDocumentOplogEntry({Timestamp(Seconds(2), 0), 1LL}, nss, BSON("_id" << 1));
+    auto updateOp2 = makeUpdateDocumentOplogEntry(
+        {Timestamp(Seconds(3), 0), 1LL}, nss, BSON("_id" << 2), BSON("_id" << 2 << "x" << 1));
+    auto insertOp = makeInsertDocumentOplogEntry(
+        {Timestamp(Seconds(4), 0), 1LL}, nss, BSON("_id" << 3));
+
+    MultiApplier::Operations operationsApplied;
+    std::vector<bool> appliedInUnitOfWork;
+    auto syncApply = [&](OperationContext* txn, const BSONObj& op, bool) {
+        operationsApplied.push_back(OplogEntry(op));
+        appliedInUnitOfWork.push_back(txn->lockState()->inAWriteUnitOfWork());
+        return Status::OK();
+    };
+
+    ASSERT_OK(multiSyncApply_noAbort(
+        _txn.get(), {updateOp1, deleteOp, updateOp2, insertOp}, syncApply));
+
+    // The updates and the delete are applied in order in a single unit of work; the insert
+    // following them is applied on its own.
+    ASSERT_EQUALS(4U, operationsApplied.size());
+    ASSERT_EQUALS(updateOp1, operationsApplied[0]);
+    ASSERT_EQUALS(deleteOp, operationsApplied[1]);
+    ASSERT_EQUALS(updateOp2, operationsApplied[2]);
+    ASSERT_EQUALS(insertOp, operationsApplied[3]);
+    ASSERT_TRUE(appliedInUnitOfWork[0]);
+    ASSERT_TRUE(appliedInUnitOfWork[1]);
+    ASSERT_TRUE(appliedInUnitOfWork[2]);
+    ASSERT_FALSE(appliedInUnitOfWork[3]);
+    ASSERT_FALSE(_txn->lockState()->inAWriteUnitOfWork());
+}
+
+TEST_F(SyncTailTest, MultiSyncApplyFallsBackOnApplyingUpdatesIndividuallyWhenGroupFails) {
+    NamespaceString nss("test." + _agent.getSuiteName() + "_" + _agent.getTestName());
+    createCollection(_txn.get(), nss, CollectionOptions());
+
+    MultiApplier::Operations updateOps;
+    for (int i = 0; i < 3; ++i) {
+        updateOps.push_back(makeUpdateDocumentOplogEntry({Timestamp(Seconds(i + 1), 0), 1LL},
+                                                         nss,
+                                                         BSON("_id" << i),
+                                                         BSON("_id" << i << "x" << 1)));
+    }
+
+    std::size_t numFailedGroupedOps = 0;
+    MultiApplier::Operations operationsApplied;
+    auto syncApply = [&](OperationContext* txn, const BSONObj& op, bool) -> Status {
+        // Reject the second update when it is applied as part of a group.
+        if (txn->lockState()->inAWriteUnitOfWork() && OplogEntry(op) == updateOps[1]) {
+            numFailedGroupedOps++;
+            return {ErrorCodes::OperationFailed, "grouped updates not supported"};
+        }
+        operationsApplied.push_back(OplogEntry(op));
+        return Status::OK();
+    };
+
+    ASSERT_OK(multiSyncApply_noAbort(_txn.get(), updateOps, syncApply));
+
+    // The group was abandoned after the failure and each update was then applied individually.
+    ASSERT_EQUALS(1U, numFailedGroupedOps);
+    ASSERT_EQUALS(4U, operationsApplied.size());
+    ASSERT_EQUALS(updateOps[0], operationsApplied[0]);
+    ASSERT_EQUALS(updateOps[0], operationsApplied[1]);
+    ASSERT_EQUALS(updateOps[1], operationsApplied[2]);
+    ASSERT_EQUALS(updateOps[2], operationsApplied[3]);
+}
+
 TEST_F(SyncTailTest, MultiInitialSyncApplyDisablesDocumentValidationWhileApplyingOperations) {
     SyncTailWithOperationContextChecker syncTail;
     NamespaceString nss("local." + _agent.getSuiteName() + "_" + _agent.getTestName());
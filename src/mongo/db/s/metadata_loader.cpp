@@ -34,13 +34,17 @@
 
 #include <vector>
 
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/s/collection_metadata.h"
+#include "mongo/db/stats/timer_stats.h"
 #include "mongo/s/catalog/catalog_manager.h"
 #include "mongo/s/catalog/type_chunk.h"
 #include "mongo/s/catalog/type_collection.h"
 #include "mongo/s/chunk_diff.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -52,6 +56,15 @@ using std::string;
 
 namespace {
 
+// How long it takes to apply the chunk diffs to the previous metadata, and how many bytes of chunk
+// map had to be copied because they were shared with the previous metadata
+TimerStats refreshStats;
+ServerStatusMetricField<TimerStats> displayRefreshStats("sharding.collectionMetadataRefresh.time",
+                                                        &refreshStats);
+Counter64 refreshBytesCopied;
+ServerStatusMetricField<Counter64> displayRefreshBytesCopied(
+    "sharding.collectionMetadataRefresh.bytesCopied", &refreshBytesCopied);
+
 /**
  * This is an adapter so we can use config diffs - mongos and mongod do them slightly
  * differently.
@@ -156,8 +169,8 @@ Status MetadataLoader::initChunks(OperationContext* txn,
             versionMap[shard] = oldMetadata->_shardVersion;
             metadata->_collVersion = oldMetadata->_collVersion;
 
-            // TODO: This could be made more efficient if copying not required, but
-            // not as frequently reloaded as in mongos.
+            // The chunk map shares its storage with the old metadata, so only the parts touched
+            // by the diff below are copied
             metadata->_chunksMap = oldMetadata->_chunksMap;
 
             LOG(2) << "loading new chunks for collection " << ns
@@ -195,6 +208,7 @@ Status MetadataLoader::initChunks(OperationContext* txn,
         // last time).  If not, something has changed on the config server (potentially between
         // when we read the collection data and when we read the chunks data).
         //
+        Timer t;
         int diffsApplied = differ.calculateConfigDiff(txn, chunks);
         if (diffsApplied > 0) {
             // Chunks found, return ok
@@ -212,6 +226,9 @@ Status MetadataLoader::initChunks(OperationContext* txn,
             metadata->_shardVersion = versionMap[shard];
             metadata->fillRanges();
 
+            refreshStats.record(t);
+            refreshBytesCopied.increment(metadata->_chunksMap.bytesCopied());
+
             invariant(metadata->isValid());
             return Status::OK();
         } else if (diffsApplied == 0) {
@@ -282,7 +299,7 @@ Status MetadataLoader::promotePendingChunks(const CollectionMetadata* afterMetad
             LOG(2) << "verified chunk " << rangeToString(it->first, it->second)
                    << " was migrated earlier to this shard";
 
-            remoteMetadata->_pendingMap.erase(it++);
+            it = remoteMetadata->_pendingMap.erase(it);
         } else {
             // Something strange happened, maybe manual editing of config?
             RangeVector overlap;
@@ -59,11 +59,13 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_customization_hooks.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/s/mongos_options.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/bufreader.h"
 #include "mongo/util/destructor_guard.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/print.h"
+#include "mongo/util/timer.h"
 #include "mongo/util/unowned_ptr.h"
 
 namespace mongo {
@@ -413,6 +415,50 @@ private:
     STLComparator _greater;                      // named so calls make sense
 };
 
+// Runs of at least this many items are sorted by several threads in parallel mode, each sorting
+// at least this many.
+const size_t kMinItemsPerSortThread = 16 * 1024;
+
+// The most threads a sorter in parallel mode uses to sort one run or to merge groups of runs.
+inline size_t maxSorterThreads() {
+    return std::max(1U, std::min(8U, stdx::thread::hardware_concurrency()));
+}
+
+/**
+ * Runs 'numTasks' calls to 'task', passing each index in [0, numTasks), on up to 'numThreads'
+ * threads including this one. Returns the first error thrown by any call, after all have finished.
+ */
+template <typename Task>
+Status runConcurrently(size_t numTasks, size_t numThreads, const Task& task) {
+    std::vector<Status> statuses(numTasks, Status::OK());
+    auto runTask = [&](size_t i) {
+        try {
+            task(i);
+        } catch (...) {
+            statuses[i] = exceptionToStatus();
+        }
+    };
+
+    for (size_t first = 0; first < numTasks; first += numThreads) {
+        const size_t last = std::min(numTasks, first + numThreads);
+        std::vector<stdx::thread> threads;
+        for (size_t i = first + 1; i < last; i++) {
+            threads.emplace_back(runTask, i);
+        }
+        runTask(first);
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+    }
+
+    for (auto&& status : statuses) {
+        if (!status.isOK()) {
+            return status;
+        }
+    }
+    return Status::OK();
+}
+
 template <typename Key, typename Value, typename Comparator>
 class NoLimitSorter : public Sorter<Key, Value> {
 public:
@@ -427,6 +473,18 @@ public:
                   const Settings& settings = Settings())
         : _comp(comp), _settings(settings), _opts(opts), _memUsed(0) {
         verify(_opts.limit == 0);
+
+        // A run being spilled in the background still uses memory while the next one fills, so
+        // each gets half of the budget.
+        _maxRunMemoryUsageBytes = (_opts.parallel && _opts.extSortAllowed)
+            ? _opts.maxMemoryUsageBytes / 2
+            : _opts.maxMemoryUsageBytes;
+    }
+
+    ~NoLimitSorter() {
+        if (_backgroundSpill.joinable()) {
+            _backgroundSpill.join();
+        }
     }
 
     void add(const Key& key, const Value& val) {
@@ -435,28 +493,39 @@ public:
         _memUsed += key.memUsageForSorter();
         _memUsed += val.memUsageForSorter();
 
-        if (_memUsed > _opts.maxMemoryUsageBytes)
+        if (_memUsed > _maxRunMemoryUsageBytes)
             spill();
     }
 
     Iterator* done() {
-        if (_iters.empty()) {
-            sort();
+        if (_stats.numRuns == 0) {
+            sort(&_data);
             return new InMemIterator<Key, Value>(_data);
         }
 
-        spill();
+        Timer timer;
+        if (_opts.parallel) {
+            waitForBackgroundSpill();
+        }
+        spill(/*inBackground*/ false);
+        mergeRunsToFanIn();
+        _stats.mergeMillis += timer.millis();
+
         return Iterator::merge(_iters, _opts, _comp);
     }
 
     // TEMP these are here for compatibility. Will be replaced with a general stats API
     int numFiles() const {
-        return _iters.size();
+        return _stats.numRuns;
     }
     size_t memUsed() const {
         return _memUsed;
     }
 
+    SorterStats stats() const {
+        return _stats;
+    }
+
 private:
     class STLComparator {
     public:
@@ -470,16 +539,61 @@ private:
         const Comparator& _comp;
     };
 
-    void sort() {
+    /**
+     * Sorts 'data'. In parallel mode a large run is split into contiguous pieces which are sorted
+     * concurrently and then merged, which keeps the sort stable.
+     */
+    void sort(std::deque<Data>* data) const {
         STLComparator less(_comp);
-        std::stable_sort(_data.begin(), _data.end(), less);
 
-        // Does 2x more compares than stable_sort
-        // TODO test on windows
-        // std::sort(_data.begin(), _data.end(), comp);
+        const size_t numPieces = _opts.parallel
+            ? std::min(maxSorterThreads(), data->size() / kMinItemsPerSortThread)
+            : 1;
+        if (numPieces < 2) {
+            std::stable_sort(data->begin(), data->end(), less);
+
+            // Does 2x more compares than stable_sort
+            // TODO test on windows
+            // std::sort(_data.begin(), _data.end(), comp);
+            return;
+        }
+
+        std::vector<typename std::deque<Data>::iterator> bounds;
+        for (size_t i = 0; i <= numPieces; i++) {
+            bounds.push_back(data->begin() + data->size() * i / numPieces);
+        }
+
+        uassertStatusOK(runConcurrently(numPieces, numPieces, [&](size_t i) {
+            std::stable_sort(bounds[i], bounds[i + 1], less);
+        }));
+
+        for (size_t width = 1; width < numPieces; width *= 2) {
+            for (size_t i = 0; i + width < numPieces; i += 2 * width) {
+                std::inplace_merge(
+                    bounds[i], bounds[i + width], bounds[std::min(i + 2 * width, numPieces)], less);
+            }
+        }
     }
 
-    void spill() {
+    /**
+     * Sorts 'data' and writes it to a new file, returning an iterator over that file and adding
+     * the bytes written to '*bytesWritten'.
+     */
+    std::shared_ptr<Iterator> writeRun(std::deque<Data>* data,
+                                       unsigned long long* bytesWritten) const {
+        sort(data);
+
+        SortedFileWriter<Key, Value> writer(_opts, _settings);
+        for (; !data->empty(); data->pop_front()) {
+            writer.addAlreadySorted(data->front().first, data->front().second);
+        }
+
+        std::shared_ptr<Iterator> iter(writer.done());
+        *bytesWritten += writer.bytesWritten();
+        return iter;
+    }
+
+    void spill(bool inBackground = true) {
         if (_data.empty())
             return;
 
@@ -496,24 +610,104 @@ private:
                           << " Pass allowDiskUse:true to opt in.");
         }
 
-        sort();
+        _stats.numRuns++;
+        _memUsed = 0;
 
-        SortedFileWriter<Key, Value> writer(_opts, _settings);
-        for (; !_data.empty(); _data.pop_front()) {
-            writer.addAlreadySorted(_data.front().first, _data.front().second);
+        if (!_opts.parallel || !inBackground) {
+            _iters.push_back(writeRun(&_data, &_stats.spilledBytes));
+            return;
         }
 
-        _iters.push_back(std::shared_ptr<Iterator>(writer.done()));
+        // Only one run is spilled in the background at a time, which bounds memory usage.
+        waitForBackgroundSpill();
+        _backgroundData.swap(_data);
+        _backgroundSpill = stdx::thread([this] {
+            try {
+                _backgroundIter = writeRun(&_backgroundData, &_backgroundBytesWritten);
+            } catch (...) {
+                _backgroundStatus = exceptionToStatus();
+            }
+        });
+    }
 
-        _memUsed = 0;
+    /**
+     * Waits for the run being spilled in the background, if any, and takes over the resulting
+     * iterator. Throws if the spill failed.
+     */
+    void waitForBackgroundSpill() {
+        if (!_backgroundSpill.joinable())
+            return;
+
+        _backgroundSpill.join();
+        std::deque<Data>().swap(_backgroundData);
+        _stats.spilledBytes += _backgroundBytesWritten;
+        _backgroundBytesWritten = 0;
+        uassertStatusOK(_backgroundStatus);
+
+        _iters.push_back(std::move(_backgroundIter));
+    }
+
+    /**
+     * While there are more runs than maxMergeFanIn, merges consecutive groups of runs into single
+     * runs. Consecutive runs are merged so that equal items keep the order in which they were
+     * added.
+     */
+    void mergeRunsToFanIn() {
+        if (_opts.maxMergeFanIn == 0)
+            return;
+
+        const size_t fanIn = std::max(size_t(2), _opts.maxMergeFanIn);
+        while (_iters.size() > fanIn) {
+            const size_t numGroups = (_iters.size() + fanIn - 1) / fanIn;
+            std::vector<std::shared_ptr<Iterator>> merged(numGroups);
+            std::vector<unsigned long long> bytesWritten(numGroups, 0);
+
+            auto mergeGroup = [&](size_t group) {
+                const auto first = _iters.begin() + group * fanIn;
+                const auto last = _iters.begin() + std::min(_iters.size(), (group + 1) * fanIn);
+                if (last - first == 1) {
+                    merged[group] = *first;
+                    return;
+                }
+
+                const std::vector<std::shared_ptr<Iterator>> runs(first, last);
+                std::unique_ptr<Iterator> iter(Iterator::merge(runs, _opts, _comp));
+                SortedFileWriter<Key, Value> writer(_opts, _settings);
+                while (iter->more()) {
+                    Data data = iter->next();
+                    writer.addAlreadySorted(data.first, data.second);
+                }
+                merged[group].reset(writer.done());
+                bytesWritten[group] = writer.bytesWritten();
+            };
+
+            const size_t numThreads = _opts.parallel ? maxSorterThreads() : 1;
+            uassertStatusOK(runConcurrently(numGroups, numThreads, mergeGroup));
+
+            _iters.swap(merged);
+            for (auto&& bytes : bytesWritten) {
+                _stats.spilledBytes += bytes;
+            }
+            _stats.numMergePasses++;
+        }
     }
 
     const Comparator _comp;
     const Settings _settings;
     SortOptions _opts;
+    size_t _maxRunMemoryUsageBytes;
     size_t _memUsed;
     std::deque<Data> _data;                         // the "current" data
     std::vector<std::shared_ptr<Iterator>> _iters;  // data that has already been spilled
+    SorterStats _stats;
+
+    // State of the run being spilled by '_backgroundSpill' in parallel mode. Only that thread
+    // touches these until it is joined.
+    stdx::thread _backgroundSpill;
+    std::deque<Data> _backgroundData;
+    std::shared_ptr<Iterator> _backgroundIter;
+    unsigned long long _backgroundBytesWritten = 0;
+    Status _backgroundStatus = Status::OK();
 };
 
 template <typename Key, typename Value, typename Comparator>
@@ -656,6 +850,10 @@ public:
         return _memUsed;
     }
 
+    SorterStats stats() const {
+        return _stats;
+    }
+
 private:
     class STLComparator {
     public:
@@ -789,6 +987,8 @@ private:
         std::vector<Data>().swap(_data);
 
         _iters.push_back(std::shared_ptr<Iterator>(writer.done()));
+        _stats.numRuns++;
+        _stats.spilledBytes += writer.bytesWritten();
 
         _memUsed = 0;
     }
@@ -799,6 +999,7 @@ private:
     size_t _memUsed;
     std::vector<Data> _data;  // the "current" data. Organized as max-heap if size == limit.
     std::vector<std::shared_ptr<Iterator>> _iters;  // data that has already been spilled
+    SorterStats _stats;
 
     // See updateCutoff() for a full description of how these members are used.
     bool _haveCutoff;
@@ -906,6 +1107,7 @@ void SortedFileWriter<Key, Value>::spill() {
     try {
         _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
         _file.write(outBuffer, std::abs(size));
+        _bytesWritten += sizeof(size) + std::abs(size);
 
     } catch (const std::exception&) {
         msgasserted(16821,
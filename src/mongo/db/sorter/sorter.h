@@ -99,7 +99,22 @@ struct SortOptions {
     std::string tempDir;         /// Directory to directly place files in.
                                  /// Must be explicitly set if extSortAllowed is true.
 
-    SortOptions() : limit(0), maxMemoryUsageBytes(64 * 1024 * 1024), extSortAllowed(false) {}
+    /// If true, runs are sorted and spilled on a background thread while data is still being
+    /// added, large runs are sorted by several threads, and the intermediate merges done to honor
+    /// maxMergeFanIn run concurrently. Keys, values and the comparator must then be safe to use
+    /// from multiple threads at once. Only applies when there is no limit.
+    bool parallel;
+
+    /// Most spilled runs merged by a single MergeIterator. When there are more, done() first
+    /// merges groups of runs into larger runs. 0 for no limit.
+    size_t maxMergeFanIn;
+
+    SortOptions()
+        : limit(0),
+          maxMemoryUsageBytes(64 * 1024 * 1024),
+          extSortAllowed(false),
+          parallel(false),
+          maxMergeFanIn(0) {}
 
     /// Fluent API to support expressions like SortOptions().Limit(1000).ExtSortAllowed(true)
 
@@ -122,6 +137,26 @@ struct SortOptions {
         tempDir = newTempDir;
         return *this;
     }
+
+    SortOptions& Parallel(bool newParallel = true) {
+        parallel = newParallel;
+        return *this;
+    }
+
+    SortOptions& MaxMergeFanIn(size_t newMaxMergeFanIn) {
+        maxMergeFanIn = newMaxMergeFanIn;
+        return *this;
+    }
+};
+
+/**
+ * Work done by a Sorter so far, for callers to report.
+ */
+struct SorterStats {
+    unsigned long long numRuns = 0;         /// Sorted runs spilled to disk.
+    unsigned long long spilledBytes = 0;    /// Bytes written to disk, including by merge passes.
+    unsigned long long numMergePasses = 0;  /// Passes merging runs down to maxMergeFanIn.
+    long long mergeMillis = 0;              /// Time done() spent finishing spills and merging.
 };
 
 /// This is the output from the sorting framework
@@ -176,6 +211,10 @@ public:
     virtual int numFiles() const = 0;
     virtual size_t memUsed() const = 0;
 
+    virtual SorterStats stats() const {
+        return SorterStats();
+    }
+
 protected:
     Sorter() {}  // can only be constructed as a base
 };
@@ -196,10 +235,16 @@ public:
     void addAlreadySorted(const Key&, const Value&);
     Iterator* done();  /// Can't add more data after calling done()
 
+    /// Bytes written to the file so far.
+    unsigned long long bytesWritten() const {
+        return _bytesWritten;
+    }
+
 private:
     void spill();
 
     const Settings _settings;
+    unsigned long long _bytesWritten = 0;
     std::string _fileName;
     std::shared_ptr<sorter::FileDeleter> _fileDeleter;  // Must outlive _file
     std::ofstream _file;
@@ -549,6 +549,57 @@ class LotsOfDataWithLimit : public LotsOfDataLittleMemory<Random> {
     }
     enum { MEM_LIMIT = 32 * 1024 };
 };
+
+// Spills runs on a background thread and merges them down to a small fan-in before the final
+// merge.
+template <bool Random = true>
+class ParallelLotsOfDataLittleMemory : public LotsOfDataLittleMemory<Random> {
+    typedef LotsOfDataLittleMemory<Random> Parent;
+    SortOptions adjustSortOptions(SortOptions opts) {
+        return Parent::adjustSortOptions(opts).Parallel().MaxMergeFanIn(8);
+    }
+};
+
+// Large enough that the final in-memory sort is split across threads.
+template <bool Random = true>
+class ParallelLotsOfDataInMemory : public LotsOfDataLittleMemory<Random> {
+    typedef LotsOfDataLittleMemory<Random> Parent;
+    SortOptions adjustSortOptions(SortOptions opts) {
+        return opts.Parallel();
+    }
+};
+
+class Stats {
+public:
+    void run() {
+        unittest::TempDir tempDir("sorterStatsTests");
+        for (bool parallel : {false, true}) {
+            const SortOptions opts = SortOptions()
+                                         .TempDir(tempDir.path())
+                                         .MaxMemoryUsageBytes(16 * 1024)
+                                         .ExtSortAllowed()
+                                         .Parallel(parallel)
+                                         .MaxMergeFanIn(4);
+
+            std::unique_ptr<IWSorter> sorter(IWSorter::make(opts, IWComparator(ASC)));
+            const int numItems = 100 * 1000;
+            for (int i = numItems - 1; i >= 0; i--) {
+                sorter->add(i, -i);
+            }
+            ASSERT_GREATER_THAN(sorter->stats().numRuns, 16U);
+            ASSERT_GREATER_THAN(sorter->stats().spilledBytes, 0U);
+            ASSERT_EQUALS(sorter->stats().numMergePasses, 0U);
+
+            std::shared_ptr<IWIterator> iter(sorter->done());
+            const SorterStats stats = sorter->stats();
+            ASSERT_GREATER_THAN_OR_EQUALS(stats.numMergePasses, 2U);
+            ASSERT_GREATER_THAN_OR_EQUALS(stats.mergeMillis, 0);
+
+            ASSERT_ITERATORS_EQUIVALENT(iter, make_shared<IntIterator>(0, numItems));
+        }
+        ASSERT(boost::filesystem::is_empty(tempDir.path()));
+    }
+};
 }
 
 class SorterSuite : public mongo::unittest::Suite {
@@ -570,6 +621,11 @@ public:
         add<SorterTests::LotsOfDataWithLimit<100, /*random=*/true>>();    // fits in mem
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/false>>();  // spills
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/true>>();   // spills
+        add<SorterTests::ParallelLotsOfDataLittleMemory</*random=*/false>>();
+        add<SorterTests::ParallelLotsOfDataLittleMemory</*random=*/true>>();
+        add<SorterTests::ParallelLotsOfDataInMemory</*random=*/false>>();
+        add<SorterTests::ParallelLotsOfDataInMemory</*random=*/true>>();
+        add<SorterTests::Stats>();
     }
 };
 
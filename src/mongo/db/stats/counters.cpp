@@ -158,8 +158,49 @@ void NetworkCounter::append(BSONObjBuilder& b) {
     b.append("numRequests", static_cast<long long>(_requests.loadRelaxed()));
 }
 
+void ServiceExecutorCounter::setExecutor(std::string name, int maxThreads) {
+    _executor = std::move(name);
+    _maxThreads = maxThreads;
+}
+
+void ServiceExecutorCounter::changeState(SessionState from, SessionState to) {
+    if (auto counter = _counterFor(from)) {
+        counter->subtractAndFetch(1);
+    }
+    if (auto counter = _counterFor(to)) {
+        counter->addAndFetch(1);
+    }
+}
+
+void ServiceExecutorCounter::noteOverflow(size_t sessions) {
+    _sessionsOverflowed.addAndFetch(static_cast<long long>(sessions));
+}
+
+AtomicInt64* ServiceExecutorCounter::_counterFor(SessionState state) {
+    switch (state) {
+        case SessionState::kNone:
+            return nullptr;
+        case SessionState::kIdle:
+            return &_sessionsIdle;
+        case SessionState::kQueued:
+            return &_sessionsQueued;
+        case SessionState::kRunning:
+            return &_sessionsRunning;
+    }
+    MONGO_UNREACHABLE;
+}
+
+void ServiceExecutorCounter::append(BSONObjBuilder& b) {
+    b.append("executor", _executor);
+    b.append("maxThreads", _maxThreads);
+    b.append("sessionsIdle", static_cast<long long>(_sessionsIdle.loadRelaxed()));
+    b.append("sessionsQueued", static_cast<long long>(_sessionsQueued.loadRelaxed()));
+    b.append("sessionsRunning", static_cast<long long>(_sessionsRunning.loadRelaxed()));
+    b.append("sessionsOverflowed", static_cast<long long>(_sessionsOverflowed.loadRelaxed()));
+}
 
 OpCounters globalOpCounters;
 OpCounters replOpCounters;
 NetworkCounter networkCounter;
+ServiceExecutorCounter serviceExecutorCounter;
 }
@@ -106,4 +106,50 @@ private:
 };
 
 extern NetworkCounter networkCounter;
+
+/**
+ * Tracks the state of the connections of a server which runs them on a shared pool of threads.
+ */
+class ServiceExecutorCounter {
+public:
+    // A connection is idle while waiting for its next request, queued once a request has arrived
+    // until a thread is free to run it, and running while the request is processed.
+    enum class SessionState { kNone, kIdle, kQueued, kRunning };
+
+    ServiceExecutorCounter()
+        : _sessionsIdle(0), _sessionsQueued(0), _sessionsRunning(0), _sessionsOverflowed(0) {}
+
+    /**
+     * Records the name of the executor in use and the most threads it may run connections on.
+     * Called once at startup.
+     */
+    void setExecutor(std::string name, int maxThreads);
+
+    /**
+     * Records that a connection moved from state 'from' to state 'to'. New connections move from
+     * kNone, and ended connections move to kNone.
+     */
+    void changeState(SessionState from, SessionState to);
+
+    /**
+     * Records that 'sessions' queued connections were run on overflow threads because no worker
+     * became free to run them.
+     */
+    void noteOverflow(size_t sessions);
+
+    void append(BSONObjBuilder& b);
+
+private:
+    AtomicInt64* _counterFor(SessionState state);
+
+    std::string _executor = "synchronous";
+    int _maxThreads = 0;
+
+    AtomicInt64 _sessionsIdle;
+    AtomicInt64 _sessionsQueued;
+    AtomicInt64 _sessionsRunning;
+    AtomicInt64 _sessionsOverflowed;
+};
+
+extern ServiceExecutorCounter serviceExecutorCounter;
 }
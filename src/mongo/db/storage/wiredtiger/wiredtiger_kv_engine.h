@@ -133,6 +133,10 @@ public:
     // held by this class
     int reconfigure(const char* str);
 
+    WiredTigerSessionCache* getSessionCache() const {
+        return _sessionCache.get();
+    }
+
     WT_CONNECTION* getConnection() {
         return _conn;
     }
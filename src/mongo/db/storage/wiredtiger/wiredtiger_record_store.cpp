@@ -835,7 +835,7 @@ WiredTigerRecordStore::WiredTigerRecordStore(OperationContext* ctx,
     Cursor cursor(ctx, *this, /*forward=*/false);
     if (auto record = cursor.next()) {
         int64_t max = _makeKey(record->id);
-        _oplog_highestSeen = record->id;
+        _uncommittedRecordIds.setHighestSeen(record->id);
         _nextIdNum.store(1 + max);
 
         if (_sizeStorer) {
@@ -1295,9 +1295,9 @@ Status WiredTigerRecordStore::_insertRecords(OperationContext* txn,
                 return status.getStatus();
             record.id = status.getValue();
         } else if (_isCapped) {
-            stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
+            stdx::lock_guard<stdx::mutex> lk(_cappedIdAllocationMutex);
             record.id = _nextId();
-            _addUncommitedRecordId_inlock(txn, record.id);
+            _addUncommittedRecordId(txn, record.id);
         } else {
             record.id = _nextId();
         }
@@ -1305,10 +1305,8 @@ Status WiredTigerRecordStore::_insertRecords(OperationContext* txn,
         highestId = record.id;
     }
 
-    if (_useOplogHack && (highestId > _oplog_highestSeen)) {
-        stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-        if (highestId > _oplog_highestSeen)
-            _oplog_highestSeen = highestId;
+    if (_useOplogHack) {
+        _uncommittedRecordIds.raiseHighestSeen(highestId);
     }
 
     for (size_t i = 0; i < nRecords; i++) {
@@ -1344,23 +1342,12 @@ StatusWith<RecordId> WiredTigerRecordStore::insertRecord(OperationContext* txn,
     return StatusWith<RecordId>(record.id);
 }
 
-void WiredTigerRecordStore::_dealtWithCappedId(SortedRecordIds::iterator it) {
-    invariant(&(*it) != NULL);
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    _uncommittedRecordIds.erase(it);
-}
-
 bool WiredTigerRecordStore::isCappedHidden(const RecordId& id) const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    if (_uncommittedRecordIds.empty()) {
-        return false;
-    }
-    return _uncommittedRecordIds.front() <= id;
+    return _uncommittedRecordIds.isHidden(id);
 }
 
 RecordId WiredTigerRecordStore::lowestCappedHiddenRecord() const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    return _uncommittedRecordIds.empty() ? RecordId() : _uncommittedRecordIds.front();
+    return _uncommittedRecordIds.lowestHidden();
 }
 
 Status WiredTigerRecordStore::insertRecordsWithDocWriter(OperationContext* txn,
@@ -1454,12 +1441,7 @@ StatusWith<RecordData> WiredTigerRecordStore::updateWithDamages(
 }
 
 void WiredTigerRecordStore::_oplogSetStartHack(WiredTigerRecoveryUnit* wru) const {
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    if (_uncommittedRecordIds.empty()) {
-        wru->setOplogReadTill(_oplog_highestSeen);
-    } else {
-        wru->setOplogReadTill(_uncommittedRecordIds.front());
-    }
+    wru->setOplogReadTill(_uncommittedRecordIds.oplogReadTill());
 }
 
 std::unique_ptr<SeekableRecordCursor> WiredTigerRecordStore::getCursor(OperationContext* txn,
@@ -1664,40 +1646,36 @@ Status WiredTigerRecordStore::oplogDiskLocRegister(OperationContext* txn, const
     if (!id.isOK())
         return id.getStatus();
 
-    stdx::lock_guard<stdx::mutex> lk(_uncommittedRecordIdsMutex);
-    _addUncommitedRecordId_inlock(txn, id.getValue());
+    // Callers register oplog RecordIds in increasing order under the lock which assigns optimes.
+    _addUncommittedRecordId(txn, id.getValue());
     return Status::OK();
 }
 
 class WiredTigerRecordStore::CappedInsertChange : public RecoveryUnit::Change {
 public:
-    CappedInsertChange(WiredTigerRecordStore* rs, SortedRecordIds::iterator it)
-        : _rs(rs), _it(it) {}
+    CappedInsertChange(WiredTigerRecordStore* rs, WiredTigerUncommittedRecordIds::Handle handle)
+        : _rs(rs), _handle(handle) {}
 
     virtual void commit() {
         // Do not notify here because all committed inserts notify, always.
-        _rs->_dealtWithCappedId(_it);
+        _rs->_uncommittedRecordIds.release(_handle);
     }
 
     virtual void rollback() {
         // Notify on rollback since it might make later commits visible.
-        _rs->_dealtWithCappedId(_it);
+        _rs->_uncommittedRecordIds.release(_handle);
         if (_rs->_cappedCallback)
             _rs->_cappedCallback->notifyCappedWaitersIfNeeded();
     }
 
 private:
     WiredTigerRecordStore* _rs;
-    SortedRecordIds::iterator _it;
+    const WiredTigerUncommittedRecordIds::Handle _handle;
 };
 
-void WiredTigerRecordStore::_addUncommitedRecordId_inlock(OperationContext* txn,
-                                                          const RecordId& id) {
-    // todo: make this a dassert at some point
-    // invariant(_uncommittedRecordIds.empty() || _uncommittedRecordIds.back() < id);
-    SortedRecordIds::iterator it = _uncommittedRecordIds.insert(_uncommittedRecordIds.end(), id);
-    txn->recoveryUnit()->registerChange(new CappedInsertChange(this, it));
-    _oplog_highestSeen = id;
+void WiredTigerRecordStore::_addUncommittedRecordId(OperationContext* txn, const RecordId& id) {
+    auto handle = _uncommittedRecordIds.add(id);
+    txn->recoveryUnit()->registerChange(new CappedInsertChange(this, handle));
 }
 
 boost::optional<RecordId> WiredTigerRecordStore::oplogStartHack(
@@ -1858,7 +1836,7 @@ void WiredTigerRecordStore::temp_cappedTruncateAfter(OperationContext* txn,
 
     if (_useOplogHack) {
         // Forget that we've ever seen a higher timestamp than we now have.
-        _oplog_highestSeen = lastKeptId;
+        _uncommittedRecordIds.setHighestSeen(lastKeptId);
     }
 
     if (_oplogStones) {
@@ -38,6 +38,7 @@
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/storage/capped_callback.h"
 #include "mongo/db/storage/record_store.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_uncommitted_record_ids.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/concurrency/synchronization.h"
@@ -57,7 +58,6 @@ class WiredTigerRecoveryUnit;
 class WiredTigerSizeStorer;
 
 extern const std::string kWiredTigerEngineName;
-typedef std::list<RecordId> SortedRecordIds;
 
 class WiredTigerRecordStore final : public RecordStore {
 public:
@@ -255,8 +255,7 @@ private:
     static int64_t _makeKey(const RecordId& id);
     static RecordId _fromKey(int64_t k);
 
-    void _dealtWithCappedId(SortedRecordIds::iterator it);
-    void _addUncommitedRecordId_inlock(OperationContext* txn, const RecordId& id);
+    void _addUncommittedRecordId(OperationContext* txn, const RecordId& id);
 
     Status _insertRecords(OperationContext* txn, Record* records, size_t nRecords);
 
@@ -293,10 +292,10 @@ private:
 
     const bool _useOplogHack;
 
-    SortedRecordIds _uncommittedRecordIds;
-    RecordId _oplog_visibleTo;
-    RecordId _oplog_highestSeen;
-    mutable stdx::mutex _uncommittedRecordIdsMutex;
+    WiredTigerUncommittedRecordIds _uncommittedRecordIds;
+    // Serializes allocating and registering RecordIds for capped collections that are not using
+    // the oplog hack, since '_uncommittedRecordIds' requires them to be registered in order.
+    stdx::mutex _cappedIdAllocationMutex;
 
     AtomicInt64 _nextIdNum;
     AtomicInt64 _dataSize;
@@ -30,8 +30,10 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "mongo/base/checked_cast.h"
 #include "mongo/base/string_data.h"
@@ -46,8 +48,10 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -923,6 +927,103 @@ TEST(WiredTigerRecordStoreTest, OplogOrder) {
     }
 }
 
+// Microbenchmark of oplog hole tracking: concurrent writers insert oplog entries, registering
+// their optimes in order as the replication code does, while readers repeatedly open oplog cursors.
+// Readers must only ever see a gap-free prefix of the oplog.
+TEST(WiredTigerRecordStoreTest, OplogVisibilityWithConcurrentInsertsAndReads) {
+    WiredTigerHarnessHelper harnessHelper;
+    unique_ptr<RecordStore> rs(
+        harnessHelper.newCappedRecordStore("local.oplog.foo", 100 * 1024 * 1024, -1));
+    WiredTigerRecordStore* wrs = checked_cast<WiredTigerRecordStore*>(rs.get());
+    ASSERT(wrs->usingOplogHack());
+
+    const int kNumWriters = 16;
+    const int kInsertsPerWriter = 500;
+    const int kNumReaders = 4;
+
+    // Stands in for the mutex under which the replication code assigns optimes.
+    stdx::mutex optimeMutex;
+    unsigned nextInc = 1;
+
+    AtomicWord<bool> writersDone(false);
+    AtomicInt64 failures;
+    AtomicInt64 cursorsOpened;
+    AtomicInt64 recordsRead;
+
+    auto writer = [&](int i) {
+        auto client = harnessHelper.serviceContext()->makeClient(str::stream() << "writer" << i);
+        auto opCtx = harnessHelper.newOperationContext(client.get());
+        for (int j = 0; j < kInsertsPerWriter; ++j) {
+            WriteUnitOfWork wuow(opCtx.get());
+            Timestamp opTime;
+            {
+                stdx::lock_guard<stdx::mutex> lk(optimeMutex);
+                opTime = Timestamp(1, nextInc++);
+                if (!wrs->oplogDiskLocRegister(opCtx.get(), opTime).isOK()) {
+                    failures.fetchAndAdd(1);
+                }
+            }
+            BSONObj obj = BSON("ts" << opTime);
+            if (!rs->insertRecord(opCtx.get(), obj.objdata(), obj.objsize(), false).isOK()) {
+                failures.fetchAndAdd(1);
+            }
+            wuow.commit();
+        }
+    };
+
+    auto reader = [&](int i) {
+        auto client = harnessHelper.serviceContext()->makeClient(str::stream() << "reader" << i);
+        while (!writersDone.load()) {
+            auto opCtx = harnessHelper.newOperationContext(client.get());
+            auto cursor = rs->getCursor(opCtx.get());
+            cursorsOpened.fetchAndAdd(1);
+            unsigned expectedInc = 1;
+            while (auto record = cursor->next()) {
+                if (record->data.toBson()["ts"].timestamp().getInc() != expectedInc) {
+                    failures.fetchAndAdd(1);
+                    break;
+                }
+                ++expectedInc;
+            }
+            recordsRead.fetchAndAdd(expectedInc - 1);
+        }
+    };
+
+    Timer timer;
+    std::vector<stdx::thread> readers;
+    for (int i = 0; i < kNumReaders; ++i) {
+        readers.emplace_back(reader, i);
+    }
+    std::vector<stdx::thread> writers;
+    for (int i = 0; i < kNumWriters; ++i) {
+        writers.emplace_back(writer, i);
+    }
+    for (auto&& thread : writers) {
+        thread.join();
+    }
+    const long long micros = std::max(timer.micros(), 1LL);
+    writersDone.store(true);
+    for (auto&& thread : readers) {
+        thread.join();
+    }
+
+    ASSERT_EQUALS(0, failures.load());
+    const long long numInserts = kNumWriters * kInsertsPerWriter;
+    unittest::log() << "oplog visibility: " << kNumWriters << " writers inserted " << numInserts
+          << " entries in " << micros / 1000 << "ms (" << numInserts * 1000 * 1000 / micros
+          << "/s) while " << kNumReaders << " readers opened " << cursorsOpened.load()
+          << " cursors and read " << recordsRead.load() << " entries";
+
+    // Once all writers are done every entry is visible.
+    auto opCtx = harnessHelper.newOperationContext();
+    auto cursor = rs->getCursor(opCtx.get());
+    long long numVisible = 0;
+    while (cursor->next()) {
+        ++numVisible;
+    }
+    ASSERT_EQUALS(numInserts, numVisible);
+}
+
 TEST(WiredTigerRecordStoreTest, StorageSizeStatisticsDisabled) {
     WiredTigerHarnessHelper harnessHelper("statistics=(none)");
     unique_ptr<RecordStore> rs(harnessHelper.newNonCappedRecordStore("a.b"));
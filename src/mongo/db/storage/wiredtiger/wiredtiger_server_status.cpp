@@ -75,6 +75,8 @@ BSONObj WiredTigerServerStatusSection::generateSection(OperationContext* txn,
     }
 
     WiredTigerKVEngine::appendGlobalStats(bob);
+    _engine->getSessionCache()->appendStats(&bob);
+    WiredTigerSession::appendCursorCacheStats(&bob);
 
     return bob.obj();
 }
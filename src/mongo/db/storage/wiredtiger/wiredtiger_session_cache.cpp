@@ -35,7 +35,13 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
 #include "mongo/base/error_codes.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/journal_listener.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
@@ -46,6 +52,16 @@
 
 namespace mongo {
 
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerCursorCacheMaxPerSession, int, 1000);
+
+namespace {
+
+AtomicUInt64 cursorCacheHits;
+AtomicUInt64 cursorCacheMisses;
+AtomicUInt64 cursorCacheReopens;
+
+}  // namespace
+
 WiredTigerSession::WiredTigerSession(WT_CONNECTION* conn, int epoch)
     : _epoch(epoch), _session(NULL), _cursorGen(0), _cursorsCached(0), _cursorsOut(0) {
     invariantWTOK(conn->open_session(conn, NULL, "isolation=snapshot", &_session));
@@ -62,21 +78,32 @@ WiredTigerSession::WiredTigerSession(WT_CONNECTION* conn, WiredTigerSessionCache
 }
 
 WiredTigerSession::~WiredTigerSession() {
+    _flushCursorCacheStats();
     if (_session) {
         invariantWTOK(_session->close(_session, NULL));
     }
 }
 
 WT_CURSOR* WiredTigerSession::getCursor(const std::string& uri, uint64_t id, bool forRecordStore) {
-    // Find the most recently used cursor
-    for (CursorCache::iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-        if (i->_id == id) {
-            WT_CURSOR* c = i->_cursor;
-            _cursors.erase(i);
-            _cursorsOut++;
-            _cursorsCached--;
-            return c;
+    auto indexed = _cursorIndex.find(id);
+    if (indexed != _cursorIndex.end()) {
+        // Reuse the table's most recently released cursor, leaving its older ones to age out.
+        auto& entries = indexed->second;
+        WT_CURSOR* c = entries.back()->_cursor;
+        _cursors.erase(entries.back());
+        entries.pop_back();
+        if (entries.empty()) {
+            _cursorIndex.erase(indexed);
         }
+        _cursorsOut++;
+        _cursorsCached--;
+        _cursorCacheHits++;
+        return c;
+    }
+
+    _cursorCacheMisses++;
+    if (_evictedIds.erase(id)) {
+        _cursorCacheReopens++;
     }
 
     WT_CURSOR* c = NULL;
@@ -98,6 +125,7 @@ void WiredTigerSession::releaseCursor(uint64_t id, WT_CURSOR* cursor) {
 
     // Cursors are pushed to the front of the list and removed from the back
     _cursors.push_front(WiredTigerCachedCursor(id, _cursorGen++, cursor));
+    _cursorIndex[id].push_back(_cursors.begin());
     _cursorsCached++;
 
     // "Old" is defined as not used in the last N**2 operations, if we have N cursors cached.
@@ -105,14 +133,39 @@ void WiredTigerSession::releaseCursor(uint64_t id, WT_CURSOR* cursor) {
     // across all of them (i.e., each cursor has 1/N chance of used for each operation).  We
     // would like to cache N cursors in that case, so any given cursor could go N**2 operations
     // in between use.
-    while (_cursorGen - _cursors.back()._gen > 10000) {
-        cursor = _cursors.back()._cursor;
-        _cursors.pop_back();
-        _cursorsCached--;
-        invariantWTOK(cursor->close(cursor));
+    const int maxCached = wiredTigerCursorCacheMaxPerSession.load();
+    while (!_cursors.empty() &&
+           (_cursorGen - _cursors.back()._gen > 10000 || _cursorsCached > maxCached)) {
+        _evictOldestCursor(maxCached);
     }
 }
 
+void WiredTigerSession::_evictOldestCursor(int maxEvictedIds) {
+    auto oldest = std::prev(_cursors.end());
+
+    // The least recently used cursor is also the oldest of its table's cursors.
+    auto indexed = _cursorIndex.find(oldest->_id);
+    invariant(indexed != _cursorIndex.end() && indexed->second.front() == oldest);
+    indexed->second.erase(indexed->second.begin());
+    if (indexed->second.empty()) {
+        _cursorIndex.erase(indexed);
+    }
+
+    // Forget an arbitrary evicted table to make room, so that tables which are never used again,
+    // such as dropped ones, do not accumulate on a long-lived session.
+    if (!_evictedIds.empty() && static_cast<int>(_evictedIds.size()) >= maxEvictedIds) {
+        _evictedIds.erase(_evictedIds.begin());
+    }
+    if (maxEvictedIds > 0) {
+        _evictedIds.insert(oldest->_id);
+    }
+
+    WT_CURSOR* cursor = oldest->_cursor;
+    _cursors.erase(oldest);
+    _cursorsCached--;
+    invariantWTOK(cursor->close(cursor));
+}
+
 void WiredTigerSession::closeAllCursors() {
     invariant(_session);
     for (CursorCache::iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
@@ -122,6 +175,32 @@ void WiredTigerSession::closeAllCursors() {
         }
     }
     _cursors.clear();
+    _cursorIndex.clear();
+    _evictedIds.clear();
+    _cursorsCached = 0;
+}
+
+void WiredTigerSession::_flushCursorCacheStats() {
+    if (_cursorCacheHits) {
+        cursorCacheHits.fetchAndAdd(_cursorCacheHits);
+        _cursorCacheHits = 0;
+    }
+    if (_cursorCacheMisses) {
+        cursorCacheMisses.fetchAndAdd(_cursorCacheMisses);
+        _cursorCacheMisses = 0;
+    }
+    if (_cursorCacheReopens) {
+        cursorCacheReopens.fetchAndAdd(_cursorCacheReopens);
+        _cursorCacheReopens = 0;
+    }
+}
+
+// static
+void WiredTigerSession::appendCursorCacheStats(BSONObjBuilder* builder) {
+    BSONObjBuilder cursorCacheBuilder(builder->subobjStart("cursor cache"));
+    cursorCacheBuilder.append("hits", static_cast<long long>(cursorCacheHits.load()));
+    cursorCacheBuilder.append("misses", static_cast<long long>(cursorCacheMisses.load()));
+    cursorCacheBuilder.append("reopens", static_cast<long long>(cursorCacheReopens.load()));
 }
 
 namespace {
@@ -134,11 +213,28 @@ uint64_t WiredTigerSession::genTableId() {
 
 // -----------------------
 
+namespace {
+
+// One shard per hardware thread, within bounds.
+size_t numSessionCacheShards() {
+    const size_t kMaxShards = 64;
+    return std::max(size_t(1), std::min<size_t>(stdx::thread::hardware_concurrency(), kMaxShards));
+}
+
+}  // namespace
+
 WiredTigerSessionCache::WiredTigerSessionCache(WiredTigerKVEngine* engine)
-    : _engine(engine), _conn(engine->getConnection()), _snapshotManager(_conn), _shuttingDown(0) {}
+    : WiredTigerSessionCache(engine->getConnection()) {
+    _engine = engine;
+}
 
 WiredTigerSessionCache::WiredTigerSessionCache(WT_CONNECTION* conn)
-    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {
+    const size_t numShards = numSessionCacheShards();
+    for (size_t i = 0; i < numShards; ++i) {
+        _shards.push_back(stdx::make_unique<Shard>());
+    }
+}
 
 WiredTigerSessionCache::~WiredTigerSessionCache() {
     shuttingDown();
@@ -221,16 +317,18 @@ void WiredTigerSessionCache::waitUntilDurable(bool forceCheckpoint) {
 
 void WiredTigerSessionCache::closeAll() {
     // Increment the epoch as we are now closing all sessions with this epoch
-    SessionCache swap;
+    _epoch.fetchAndAdd(1);
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        _epoch.fetchAndAdd(1);
-        _sessions.swap(swap);
-    }
+    for (auto&& shard : _shards) {
+        std::vector<WiredTigerSession*> swap;
+        {
+            stdx::lock_guard<SpinLock> lock(shard->lock);
+            shard->sessions.swap(swap);
+        }
 
-    for (SessionCache::iterator i = swap.begin(); i != swap.end(); i++) {
-        delete (*i);
+        for (auto session : swap) {
+            delete session;
+        }
     }
 }
 
@@ -243,18 +341,38 @@ UniqueWiredTigerSession WiredTigerSessionCache::getSession() {
     // operations should be allowed to start.
     invariant(!(_shuttingDown.loadRelaxed() & kShuttingDownMask));
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        if (!_sessions.empty()) {
-            // Get the most recently used session so that if we discard sessions, we're
-            // discarding older ones
-            WiredTigerSession* cachedSession = _sessions.back();
-            _sessions.pop_back();
+    // Get the most recently used session so that if we discard sessions, we're discarding older
+    // ones.
+    auto popSession = [](Shard& shard) -> WiredTigerSession* {
+        stdx::lock_guard<SpinLock> lock(shard.lock);
+        if (shard.sessions.empty()) {
+            return nullptr;
+        }
+        WiredTigerSession* cachedSession = shard.sessions.back();
+        shard.sessions.pop_back();
+        return cachedSession;
+    };
+
+    const size_t homeIndex = _shardIndexForCurrentThread();
+    Shard& home = *_shards[homeIndex];
+    if (WiredTigerSession* cachedSession = popSession(home)) {
+        home.hits.fetchAndAdd(1);
+        return UniqueWiredTigerSession(cachedSession);
+    }
+
+    // Steal from the other shards, starting with the next one so that threads hashing to
+    // different shards spread out their steals.
+    for (size_t i = 1; i < _shards.size(); ++i) {
+        if (WiredTigerSession* cachedSession =
+                popSession(*_shards[(homeIndex + i) % _shards.size()])) {
+            home.steals.fetchAndAdd(1);
             return UniqueWiredTigerSession(cachedSession);
         }
     }
 
-    // Outside of the cache partition lock, but on release will be put back on the cache
+    home.misses.fetchAndAdd(1);
+
+    // Outside of the shard locks, but on release will be put back on the cache
     return UniqueWiredTigerSession(new WiredTigerSession(_conn, this, _epoch.load()));
 }
 
@@ -262,6 +380,8 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
     invariant(session);
     invariant(session->cursorsOut() == 0);
 
+    session->_flushCursorCacheStats();
+
     const int shuttingDown = _shuttingDown.fetchAndAdd(1);
     ON_BLOCK_EXIT([this] { _shuttingDown.fetchAndSubtract(1); });
 
@@ -286,10 +406,11 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
     uint64_t currentEpoch = _epoch.load();
 
     if (session->_getEpoch() == currentEpoch) {  // check outside of lock to reduce contention
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
+        Shard& shard = *_shards[_shardIndexForCurrentThread()];
+        stdx::lock_guard<SpinLock> lock(shard.lock);
         if (session->_getEpoch() == _epoch.load()) {  // recheck inside the lock for correctness
             returnedToCache = true;
-            _sessions.push_back(session);
+            shard.sessions.push_back(session);
         }
     } else
         invariant(session->_getEpoch() < currentEpoch);
@@ -302,6 +423,42 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
 }
 
 
+size_t WiredTigerSessionCache::_shardIndexForCurrentThread() const {
+    return std::hash<stdx::thread::id>()(stdx::this_thread::get_id()) % _shards.size();
+}
+
+void WiredTigerSessionCache::appendStats(BSONObjBuilder* builder) const {
+    BSONObjBuilder cacheBuilder(builder->subobjStart("session cache"));
+    long long totalCached = 0;
+    long long totalHits = 0;
+    long long totalSteals = 0;
+    long long totalMisses = 0;
+    {
+        BSONArrayBuilder shardsBuilder(cacheBuilder.subarrayStart("shards"));
+        for (auto&& shard : _shards) {
+            long long cached;
+            {
+                stdx::lock_guard<SpinLock> lock(shard->lock);
+                cached = shard->sessions.size();
+            }
+            const long long hits = shard->hits.load();
+            const long long steals = shard->steals.load();
+            const long long misses = shard->misses.load();
+            shardsBuilder.append(
+                BSON("cached" << cached << "hits" << hits << "steals" << steals << "misses"
+                              << misses));
+            totalCached += cached;
+            totalHits += hits;
+            totalSteals += steals;
+            totalMisses += misses;
+        }
+    }
+    cacheBuilder.append("cached", totalCached);
+    cacheBuilder.append("hits", totalHits);
+    cacheBuilder.append("steals", totalSteals);
+    cacheBuilder.append("misses", totalMisses);
+}
+
 void WiredTigerSessionCache::setJournalListener(JournalListener* jl) {
     stdx::unique_lock<stdx::mutex> lk(_journalListenerMutex);
     _journalListener = jl;
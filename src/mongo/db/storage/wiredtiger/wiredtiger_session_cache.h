@@ -31,8 +31,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <wiredtiger.h>
@@ -45,9 +50,13 @@
 
 namespace mongo {
 
+class BSONObjBuilder;
 class WiredTigerKVEngine;
 class WiredTigerSessionCache;
 
+// The most cursors a WiredTigerSession keeps cached.
+extern std::atomic<int> wiredTigerCursorCacheMaxPerSession;  // NOLINT
+
 class WiredTigerCachedCursor {
 public:
     WiredTigerCachedCursor(uint64_t id, uint64_t gen, WT_CURSOR* cursor)
@@ -62,6 +71,10 @@ public:
  * This is a structure that caches 1 cursor for each uri.
  * The idea is that there is a pool of these somewhere.
  * NOT THREADSAFE
+ *
+ * Cached cursors are looked up by table id through a hash index and evicted in least recently
+ * used order, either once they have aged out or when the session holds more than
+ * wiredTigerCursorCacheMaxPerSession of them.
  */
 class WiredTigerSession {
 public:
@@ -104,6 +117,12 @@ public:
 
     static uint64_t genTableId();
 
+    /**
+     * Appends the cursor cache hits, misses and reopens of all sessions. A reopen is a miss for a
+     * table whose cursor was evicted from the session's cache earlier.
+     */
+    static void appendCursorCacheStats(BSONObjBuilder* builder);
+
     /**
      * For "metadata:" cursors. Guaranteed never to collide with genTableId() ids.
      */
@@ -112,7 +131,7 @@ public:
 private:
     friend class WiredTigerSessionCache;
 
-    // The cursor cache is a list of pairs that contain an ID and cursor
+    // The cursor cache is a list of pairs that contain an ID and cursor, most recently used first
     typedef std::list<WiredTigerCachedCursor> CursorCache;
 
     // Used internally by WiredTigerSessionCache
@@ -120,17 +139,44 @@ private:
         return _epoch;
     }
 
+    /**
+     * Closes the least recently used cached cursor, and remembers its table for the reopen count
+     * while no more than 'maxEvictedIds' evicted tables are remembered.
+     */
+    void _evictOldestCursor(int maxEvictedIds);
+
+    /**
+     * Adds this session's cursor cache statistics to the global counters and resets them.
+     */
+    void _flushCursorCacheStats();
+
     const uint64_t _epoch;
     WiredTigerSessionCache* _cache;  // not owned
     WT_SESSION* _session;            // owned
     CursorCache _cursors;            // owned
+    // Indexes '_cursors' by table id. A table may have several cached cursors, which are listed
+    // least recently used first.
+    std::unordered_map<uint64_t, std::vector<CursorCache::iterator>> _cursorIndex;
+    // Ids of some of the tables whose cursors were evicted and have not been reopened since, at
+    // most wiredTigerCursorCacheMaxPerSession of them.
+    std::unordered_set<uint64_t> _evictedIds;
     uint64_t _cursorGen;
     int _cursorsCached, _cursorsOut;
+
+    // Counted per session so that cursor operations do not touch shared cache lines, and added to
+    // the global counters when the session is released.
+    uint64_t _cursorCacheHits = 0;
+    uint64_t _cursorCacheMisses = 0;
+    uint64_t _cursorCacheReopens = 0;
 };
 
 /**
  *  This cache implements a shared pool of WiredTiger sessions with the goal to amortize the
  *  cost of session creation and destruction over multiple uses.
+ *
+ *  The pool is split into shards, and each thread gets and releases sessions through the shard
+ *  its id hashes to, so that threads rarely contend on a shard's lock. A thread whose shard is
+ *  empty steals a session from another shard before creating a new one.
  */
 class WiredTigerSessionCache {
 public:
@@ -187,7 +233,30 @@ public:
 
     void setJournalListener(JournalListener* jl);
 
+    /**
+     * Appends the number of cached sessions and the hit, steal and miss counts of each shard.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+    size_t numShards() const {
+        return _shards.size();
+    }
+
 private:
+    struct Shard {
+        SpinLock lock;
+        std::vector<WiredTigerSession*> sessions;  // guarded by 'lock'
+
+        AtomicUInt64 hits;    // Sessions taken from this shard by threads hashing to it.
+        AtomicUInt64 steals;  // Sessions taken from other shards by threads hashing to it.
+        AtomicUInt64 misses;  // Sessions created because no shard had one.
+    };
+
+    /**
+     * Returns the index of the shard the current thread gets sessions from and releases them to.
+     */
+    size_t _shardIndexForCurrentThread() const;
+
     WiredTigerKVEngine* _engine;  // not owned, might be NULL
     WT_CONNECTION* _conn;         // not owned
     WiredTigerSnapshotManager _snapshotManager;
@@ -198,12 +267,12 @@ private:
     AtomicUInt32 _shuttingDown;
     static const uint32_t kShuttingDownMask = 1 << 31;
 
-    stdx::mutex _cacheLock;
-    typedef std::vector<WiredTigerSession*> SessionCache;
-    SessionCache _sessions;
+    // Allocated separately so that shards do not share cache lines.
+    std::vector<std::unique_ptr<Shard>> _shards;
 
-    // Bumped when all open sessions need to be closed
-    AtomicUInt64 _epoch;  // atomic so we can check it outside of the lock
+    // Bumped when all open sessions need to be closed. Always bumped before any shard is emptied,
+    // so a session released with a stale epoch is never put back in a shard.
+    AtomicUInt64 _epoch;  // atomic so we can check it outside of the shard locks
 
     // Counter and critical section mutex for waitUntilDurable
     AtomicUInt32 _lastSyncTime;
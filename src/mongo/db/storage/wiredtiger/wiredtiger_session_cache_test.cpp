@@ -0,0 +1,196 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+namespace {
+
+class WiredTigerSessionCacheTest : public unittest::Test {
+public:
+    void setUp() override {
+        int ret = wiredtiger_open(_dbpath.path().c_str(), NULL, "create,", &_conn);
+        ASSERT_OK(wtRCToStatus(ret));
+        _sessionCache.reset(new WiredTigerSessionCache(_conn));
+    }
+
+    void tearDown() override {
+        _sessionCache.reset();
+        _conn->close(_conn, NULL);
+    }
+
+protected:
+    /**
+     * Returns the session cache statistics summed over all shards.
+     */
+    BSONObj getStats() const {
+        BSONObjBuilder builder;
+        _sessionCache->appendStats(&builder);
+        return builder.obj()["session cache"].Obj().getOwned();
+    }
+
+    /**
+     * Returns the cursor cache statistics, which are shared by every session in the process.
+     */
+    static BSONObj getCursorCacheStats() {
+        BSONObjBuilder builder;
+        WiredTigerSession::appendCursorCacheStats(&builder);
+        return builder.obj()["cursor cache"].Obj().getOwned();
+    }
+
+    unittest::TempDir _dbpath{"wt_session_cache_test"};
+    WT_CONNECTION* _conn = nullptr;
+    std::unique_ptr<WiredTigerSessionCache> _sessionCache;
+};
+
+TEST_F(WiredTigerSessionCacheTest, ReusesReleasedSession) {
+    WiredTigerSession* first;
+    {
+        UniqueWiredTigerSession session = _sessionCache->getSession();
+        first = session.get();
+    }
+    UniqueWiredTigerSession session = _sessionCache->getSession();
+    ASSERT_EQUALS(first, session.get());
+
+    BSONObj stats = getStats();
+    ASSERT_EQUALS(1LL, stats["hits"].numberLong());
+    ASSERT_EQUALS(1LL, stats["misses"].numberLong());
+    ASSERT_EQUALS(0LL, stats["cached"].numberLong());
+    ASSERT_EQUALS(static_cast<int>(_sessionCache->numShards()),
+                  stats["shards"].Obj().nFields());
+}
+
+TEST_F(WiredTigerSessionCacheTest, SessionReleasedOnAnotherThreadIsReused) {
+    WiredTigerSession* released = nullptr;
+    stdx::thread([&] {
+        UniqueWiredTigerSession session = _sessionCache->getSession();
+        released = session.get();
+    }).join();
+    ASSERT_EQUALS(1LL, getStats()["cached"].numberLong());
+
+    // Whichever shard the session was released to, this thread finds it rather than creating a
+    // new session.
+    UniqueWiredTigerSession session = _sessionCache->getSession();
+    ASSERT_EQUALS(released, session.get());
+
+    BSONObj stats = getStats();
+    ASSERT_EQUALS(1LL, stats["hits"].numberLong() + stats["steals"].numberLong());
+    ASSERT_EQUALS(1LL, stats["misses"].numberLong());
+}
+
+TEST_F(WiredTigerSessionCacheTest, CloseAllDiscardsSessionsFromEarlierEpochs) {
+    {
+        UniqueWiredTigerSession cached = _sessionCache->getSession();
+        UniqueWiredTigerSession outstanding = _sessionCache->getSession();
+        cached.reset();
+        ASSERT_EQUALS(1LL, getStats()["cached"].numberLong());
+
+        _sessionCache->closeAll();
+        ASSERT_EQUALS(0LL, getStats()["cached"].numberLong());
+    }
+
+    // The session which was outstanding during closeAll() was not returned to the cache.
+    ASSERT_EQUALS(0LL, getStats()["cached"].numberLong());
+    UniqueWiredTigerSession session = _sessionCache->getSession();
+    ASSERT_EQUALS(3LL, getStats()["misses"].numberLong());
+}
+
+TEST_F(WiredTigerSessionCacheTest, CursorCacheReusesCursorsAndEvictsLeastRecentlyUsed) {
+    const int originalMaxCursors = wiredTigerCursorCacheMaxPerSession.load();
+    ON_BLOCK_EXIT([&] { wiredTigerCursorCacheMaxPerSession.store(originalMaxCursors); });
+    wiredTigerCursorCacheMaxPerSession.store(2);
+    const BSONObj statsBefore = getCursorCacheStats();
+
+    UniqueWiredTigerSession session = _sessionCache->getSession();
+    WT_SESSION* wtSession = session->getSession();
+    const std::vector<std::string> uris = {"table:a", "table:b", "table:c"};
+    std::vector<uint64_t> ids;
+    for (auto&& uri : uris) {
+        invariantWTOK(wtSession->create(wtSession, uri.c_str(), NULL));
+        ids.push_back(WiredTigerSession::genTableId());
+    }
+
+    auto useCursor = [&](size_t i) {
+        WT_CURSOR* cursor = session->getCursor(uris[i], ids[i], true);
+        ASSERT(cursor);
+        session->releaseCursor(ids[i], cursor);
+        return cursor;
+    };
+
+    WT_CURSOR* a = useCursor(0);
+    ASSERT_EQUALS(a, useCursor(0));
+    useCursor(1);
+    useCursor(2);  // Evicts the cursor on "a", the least recently used.
+    ASSERT_EQUALS(0, session->cursorsOut());
+
+    WT_CURSOR* b = session->getCursor(uris[1], ids[1], true);
+    session->releaseCursor(ids[1], b);
+    useCursor(0);  // Reopened.
+
+    session.reset();
+    BSONObj stats = getCursorCacheStats();
+    ASSERT_EQUALS(2LL, stats["hits"].numberLong() - statsBefore["hits"].numberLong());
+    ASSERT_EQUALS(4LL, stats["misses"].numberLong() - statsBefore["misses"].numberLong());
+    ASSERT_EQUALS(1LL, stats["reopens"].numberLong() - statsBefore["reopens"].numberLong());
+}
+
+TEST_F(WiredTigerSessionCacheTest, CursorCacheReusesMostRecentlyReleasedCursorOfTable) {
+    UniqueWiredTigerSession session = _sessionCache->getSession();
+    WT_SESSION* wtSession = session->getSession();
+    const std::string uri = "table:a";
+    invariantWTOK(wtSession->create(wtSession, uri.c_str(), NULL));
+    const uint64_t id = WiredTigerSession::genTableId();
+
+    WT_CURSOR* first = session->getCursor(uri, id, true);
+    WT_CURSOR* second = session->getCursor(uri, id, true);
+    ASSERT(first);
+    ASSERT(second);
+    ASSERT_NOT_EQUALS(first, second);
+    session->releaseCursor(id, first);
+    session->releaseCursor(id, second);
+
+    ASSERT_EQUALS(second, session->getCursor(uri, id, true));
+    ASSERT_EQUALS(first, session->getCursor(uri, id, true));
+    session->releaseCursor(id, first);
+    session->releaseCursor(id, second);
+    ASSERT_EQUALS(0, session->cursorsOut());
+}
+
+}  // namespace
+}  // namespace mongo
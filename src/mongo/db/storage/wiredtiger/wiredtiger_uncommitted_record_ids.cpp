@@ -0,0 +1,147 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_uncommitted_record_ids.h"
+
+#include <functional>
+
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+const int WiredTigerUncommittedRecordIds::kNumSlots;
+
+WiredTigerUncommittedRecordIds::Handle WiredTigerUncommittedRecordIds::add(const RecordId& id) {
+    invariant(id.repr() > 0);
+
+    // Count the RecordId and publish it before raising the highest seen RecordId, so that a reader
+    // which observes the new highest seen RecordId also observes this one as uncommitted.
+    _numRegistered.fetchAndAdd(1);
+
+    // Start from a slot chosen by thread so that concurrent writers rarely contend on a slot.
+    const size_t start = std::hash<stdx::thread::id>()(stdx::this_thread::get_id()) % kNumSlots;
+    Handle handle{-1, id};
+    for (int i = 0; i < kNumSlots; ++i) {
+        const int slot = (start + i) % kNumSlots;
+        if (_slots[slot].loadRelaxed() == 0 && _slots[slot].compareAndSwap(0, id.repr()) == 0) {
+            handle.slot = slot;
+            break;
+        }
+    }
+
+    if (handle.slot < 0) {
+        stdx::lock_guard<stdx::mutex> lk(_overflowMutex);
+        _overflow.insert(id);
+        _numOverflow.fetchAndAdd(1);
+    }
+
+    _highestSeen.store(id.repr());
+    return handle;
+}
+
+void WiredTigerUncommittedRecordIds::release(const Handle& handle) {
+    if (handle.slot >= 0) {
+        invariant(_slots[handle.slot].load() == handle.id.repr());
+        _slots[handle.slot].store(0);
+    } else {
+        stdx::lock_guard<stdx::mutex> lk(_overflowMutex);
+        invariant(_overflow.erase(handle.id) == 1);
+        _numOverflow.fetchAndSubtract(1);
+    }
+    _numRegistered.fetchAndSubtract(1);
+}
+
+void WiredTigerUncommittedRecordIds::raiseHighestSeen(const RecordId& id) {
+    long long current = _highestSeen.load();
+    while (current < id.repr()) {
+        const long long old = _highestSeen.compareAndSwap(current, id.repr());
+        if (old == current) {
+            return;
+        }
+        current = old;
+    }
+}
+
+RecordId WiredTigerUncommittedRecordIds::_lowestHidden(RecordId* highestSeen) const {
+    // The highest seen RecordId must be loaded before looking at the registered RecordIds. See the
+    // class comment.
+    const long long highest = _highestSeen.load();
+    *highestSeen = RecordId(highest);
+
+    if (_numRegistered.load() == 0) {
+        return RecordId();
+    }
+
+    long long lowest = 0;
+    auto consider = [&](long long repr) {
+        if (repr != 0 && repr <= highest && (lowest == 0 || repr < lowest)) {
+            lowest = repr;
+        }
+    };
+
+    for (auto&& slot : _slots) {
+        consider(slot.load());
+    }
+
+    if (_numOverflow.load() > 0) {
+        stdx::lock_guard<stdx::mutex> lk(_overflowMutex);
+        if (!_overflow.empty()) {
+            consider(_overflow.begin()->repr());
+        }
+    }
+
+    return RecordId(lowest);
+}
+
+bool WiredTigerUncommittedRecordIds::isHidden(const RecordId& id) const {
+    RecordId highestSeen;
+    const RecordId lowest = _lowestHidden(&highestSeen);
+
+    // A record beyond the highest seen RecordId may have been registered after it was loaded, so
+    // it cannot be known to have committed.
+    if (id > highestSeen) {
+        return true;
+    }
+    return !lowest.isNull() && lowest <= id;
+}
+
+RecordId WiredTigerUncommittedRecordIds::lowestHidden() const {
+    RecordId highestSeen;
+    return _lowestHidden(&highestSeen);
+}
+
+RecordId WiredTigerUncommittedRecordIds::oplogReadTill() const {
+    RecordId highestSeen;
+    const RecordId lowest = _lowestHidden(&highestSeen);
+    return lowest.isNull() ? highestSeen : lowest;
+}
+
+}  // namespace mongo
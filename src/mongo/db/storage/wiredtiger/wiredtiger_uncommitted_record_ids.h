@@ -0,0 +1,135 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <set>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/record_id.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+/**
+ * Tracks the RecordIds of uncommitted inserts into a capped collection or the oplog, so that
+ * readers can hide every record at or after the lowest uncommitted one ("hole").
+ *
+ * Writers claim one of a fixed number of slots with a compare-and-swap, falling back to a
+ * mutex-protected set only when every slot is in use. Readers never take a lock unless that
+ * overflow set is non-empty.
+ *
+ * RecordIds must be registered in increasing order; callers serialize registration (the oplog
+ * registers under the lock that assigns optimes). Readers rely on this: any RecordId not greater
+ * than the highest seen RecordId they observed was registered before they looked at the slots.
+ */
+class WiredTigerUncommittedRecordIds {
+    MONGO_DISALLOW_COPYING(WiredTigerUncommittedRecordIds);
+
+public:
+    static const int kNumSlots = 128;
+
+    /**
+     * Identifies a registered RecordId so that it can be released.
+     */
+    struct Handle {
+        int slot;  // -1 if the RecordId is in the overflow set.
+        RecordId id;
+    };
+
+    WiredTigerUncommittedRecordIds() = default;
+
+    /**
+     * Registers 'id' as uncommitted and makes it the highest seen RecordId.
+     */
+    Handle add(const RecordId& id);
+
+    /**
+     * Called once the insert of the RecordId identified by 'handle' has committed or rolled back.
+     */
+    void release(const Handle& handle);
+
+    /**
+     * Returns true if the record 'id' must not be visible to readers yet, either because it is
+     * uncommitted or because an insert with a lower RecordId is.
+     */
+    bool isHidden(const RecordId& id) const;
+
+    /**
+     * Returns the lowest uncommitted RecordId, or a null RecordId if everything up to the highest
+     * seen RecordId has committed.
+     */
+    RecordId lowestHidden() const;
+
+    /**
+     * Returns the point up to which the oplog may be read: the lowest uncommitted RecordId if there
+     * is one, and otherwise the highest seen RecordId.
+     */
+    RecordId oplogReadTill() const;
+
+    RecordId highestSeen() const {
+        return RecordId(_highestSeen.load());
+    }
+
+    /**
+     * Sets the highest seen RecordId unconditionally, e.g. after truncating the collection.
+     */
+    void setHighestSeen(const RecordId& id) {
+        _highestSeen.store(id.repr());
+    }
+
+    /**
+     * Raises the highest seen RecordId to 'id' if it is lower.
+     */
+    void raiseHighestSeen(const RecordId& id);
+
+private:
+    /**
+     * Returns the lowest uncommitted RecordId no greater than the highest seen RecordId, which is
+     * returned through 'highestSeen'.
+     */
+    RecordId _lowestHidden(RecordId* highestSeen) const;
+
+    // Holds the repr() of an uncommitted RecordId, or 0 if the slot is free.
+    std::array<AtomicInt64, kNumSlots> _slots;
+
+    // The number of registered RecordIds, both in '_slots' and in '_overflow'. Lets readers skip
+    // scanning the slots when there are no uncommitted inserts.
+    AtomicInt64 _numRegistered;
+
+    AtomicInt64 _highestSeen;
+
+    // Guards '_overflow'. '_numOverflow' lets readers skip taking it while the set is empty.
+    mutable stdx::mutex _overflowMutex;
+    std::set<RecordId> _overflow;
+    AtomicInt64 _numOverflow;
+};
+
+}  // namespace mongo
@@ -0,0 +1,116 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_uncommitted_record_ids.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using Handle = WiredTigerUncommittedRecordIds::Handle;
+
+TEST(WiredTigerUncommittedRecordIdsTest, NothingHiddenWhenEmpty) {
+    WiredTigerUncommittedRecordIds ids;
+    ids.setHighestSeen(RecordId(10));
+    ASSERT_FALSE(ids.isHidden(RecordId(1)));
+    ASSERT_FALSE(ids.isHidden(RecordId(10)));
+    ASSERT_TRUE(ids.lowestHidden().isNull());
+    ASSERT_EQUALS(RecordId(10), ids.oplogReadTill());
+}
+
+TEST(WiredTigerUncommittedRecordIdsTest, RecordsBeyondHighestSeenAreHidden) {
+    WiredTigerUncommittedRecordIds ids;
+    ids.setHighestSeen(RecordId(10));
+    ASSERT_TRUE(ids.isHidden(RecordId(11)));
+}
+
+TEST(WiredTigerUncommittedRecordIdsTest, HidesEverythingFromLowestUncommitted) {
+    WiredTigerUncommittedRecordIds ids;
+    Handle h1 = ids.add(RecordId(1));
+    Handle h2 = ids.add(RecordId(2));
+    Handle h3 = ids.add(RecordId(3));
+    ASSERT_EQUALS(RecordId(3), ids.highestSeen());
+
+    // Commit out of order; the hole at 1 keeps 2 and 3 hidden.
+    ids.release(h3);
+    ids.release(h2);
+    ASSERT_TRUE(ids.isHidden(RecordId(1)));
+    ASSERT_TRUE(ids.isHidden(RecordId(3)));
+    ASSERT_EQUALS(RecordId(1), ids.lowestHidden());
+    ASSERT_EQUALS(RecordId(1), ids.oplogReadTill());
+
+    ids.release(h1);
+    ASSERT_FALSE(ids.isHidden(RecordId(1)));
+    ASSERT_FALSE(ids.isHidden(RecordId(3)));
+    ASSERT_TRUE(ids.lowestHidden().isNull());
+    ASSERT_EQUALS(RecordId(3), ids.oplogReadTill());
+}
+
+TEST(WiredTigerUncommittedRecordIdsTest, RaiseHighestSeenNeverLowersIt) {
+    WiredTigerUncommittedRecordIds ids;
+    ids.raiseHighestSeen(RecordId(5));
+    ids.raiseHighestSeen(RecordId(3));
+    ASSERT_EQUALS(RecordId(5), ids.highestSeen());
+
+    // Truncating the collection lowers it explicitly.
+    ids.setHighestSeen(RecordId(2));
+    ASSERT_EQUALS(RecordId(2), ids.highestSeen());
+}
+
+TEST(WiredTigerUncommittedRecordIdsTest, OverflowsWhenAllSlotsAreInUse) {
+    WiredTigerUncommittedRecordIds ids;
+    const int numIds = WiredTigerUncommittedRecordIds::kNumSlots + 10;
+    std::vector<Handle> handles;
+    for (int i = 1; i <= numIds; ++i) {
+        handles.push_back(ids.add(RecordId(i)));
+    }
+    ASSERT_EQUALS(-1, handles.back().slot);
+
+    // Release everything but one RecordId in the overflow set.
+    const Handle& overflowed = handles[WiredTigerUncommittedRecordIds::kNumSlots + 5];
+    ASSERT_EQUALS(-1, overflowed.slot);
+    for (auto&& handle : handles) {
+        if (handle.id != overflowed.id) {
+            ids.release(handle);
+        }
+    }
+    ASSERT_EQUALS(overflowed.id, ids.lowestHidden());
+    ASSERT_FALSE(ids.isHidden(RecordId(overflowed.id.repr() - 1)));
+    ASSERT_TRUE(ids.isHidden(RecordId(numIds)));
+
+    ids.release(overflowed);
+    ASSERT_TRUE(ids.lowestHidden().isNull());
+    ASSERT_EQUALS(RecordId(numIds), ids.oplogReadTill());
+}
+
+}  // namespace
+}  // namespace mongo
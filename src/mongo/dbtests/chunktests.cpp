@@ -26,13 +26,21 @@
  *    then also delete it in the license file.
  */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
+
+#include "mongo/config.h"
 #include "mongo/db/json.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/platform/random.h"
 #include "mongo/s/chunk_manager.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -54,16 +62,48 @@ public:
             const string shardId = str::stream() << (i - 1);
             _shardIds.insert(shardId);
 
-            std::shared_ptr<Chunk> chunk(new Chunk(this,
-                                                   mySplitPoints[i - 1],
-                                                   mySplitPoints[i],
-                                                   shardId,
-                                                   ChunkVersion(0, 0, OID()),
-                                                   0));
+            std::shared_ptr<Chunk> chunk(new Chunk(
+                mySplitPoints[i - 1], mySplitPoints[i], shardId, ChunkVersion(0, 0, OID()), 0));
             _chunkMap[mySplitPoints[i]] = chunk;
         }
 
-        _chunkRangeMap = _constructRanges(_chunkMap);
+        _routingTable = ChunkRoutingTable(_chunkMap);
+    }
+
+    /**
+     * Splits the key space of a single field shard key into 'numChunks' chunks, with split points
+     * at { <field>: 0 }, { <field>: 1 }, ... The chunks are dealt out to 'numShards' shards in runs
+     * of 'chunksPerRange' consecutive chunks.
+     */
+    void setChunks(int numChunks, int chunksPerRange, int numShards) {
+        const BSONObj keyPattern = _keyPattern.getKeyPattern().toBSON();
+        const StringData fieldName = keyPattern.firstElementFieldName();
+
+        BSONObj min = _keyPattern.getKeyPattern().globalMin();
+        for (int i = 0; i < numChunks; ++i) {
+            const BSONObj max = (i == numChunks - 1) ? _keyPattern.getKeyPattern().globalMax()
+                                                     : BSON(fieldName << i);
+            const string shardId = str::stream() << ((i / chunksPerRange) % numShards);
+            _shardIds.insert(shardId);
+
+            _chunkMap[max] =
+                std::make_shared<Chunk>(min, max, shardId, ChunkVersion(0, 0, OID()), 0);
+            min = max;
+        }
+
+        _routingTable = ChunkRoutingTable(_chunkMap);
+    }
+
+    /**
+     * Looks up 'shardKey' by walking the chunk map itself, as a reference for the routing table.
+     */
+    std::shared_ptr<Chunk> findIntersectingChunkInChunkMap(const BSONObj& shardKey) const {
+        auto it = _chunkMap.upper_bound(shardKey);
+        return it == _chunkMap.end() ? nullptr : it->second;
+    }
+
+    const ChunkRoutingTable& getRoutingTable() const {
+        return _routingTable;
     }
 };
 
@@ -337,6 +377,187 @@ class InMultiShard : public CompoundKeyBase {
     }
 };
 
+/**
+ * Checks that the routing table finds the same chunk as the chunk map for keys of every type a
+ * shard key may hold, including numeric keys of a different type than the split points.
+ */
+class RoutingTableMatchesChunkMap {
+public:
+    void run() {
+        auto opCtx = stdx::make_unique<OperationContextNoop>();
+
+        ShardKeyPattern shardKeyPattern(BSON("a" << 1 << "b" << 1));
+        TestableChunkManager chunkManager("", shardKeyPattern, false);
+        chunkManager.setSingleChunkForShards({BSON("a" << -1.5 << "b" << 0),
+                                              BSON("a" << 0 << "b" << MINKEY),
+                                              BSON("a" << 0 << "b" << 10),
+                                              BSON("a" << 7LL << "b"
+                                                       << "x"),
+                                              BSON("a"
+                                                   << ""
+                                                   << "b"
+                                                   << 0),
+                                              BSON("a"
+                                                   << "abc"
+                                                   << "b"
+                                                   << BSONNULL),
+                                              BSON("a" << BSON("x" << 1) << "b" << 0),
+                                              BSON("a" << true << "b" << 0)});
+
+        const ChunkRoutingTable& routingTable = chunkManager.getRoutingTable();
+        ASSERT_EQUALS(9U, routingTable.numChunks());
+        ASSERT_EQUALS(9U, routingTable.numRanges());
+
+        const vector<BSONObj> keys{BSON("a" << MINKEY << "b" << MINKEY),
+                                   BSON("a" << -2 << "b" << 100),
+                                   BSON("a" << -1.5 << "b" << 0),
+                                   BSON("a" << -1.5 << "b" << 0.5),
+                                   BSON("a" << 0.0 << "b" << MINKEY),
+                                   BSON("a" << 0LL << "b" << 9.99),
+                                   BSON("a" << 0 << "b" << 10),
+                                   BSON("a" << 7 << "b"
+                                            << "x"),
+                                   BSON("a" << 7.0 << "b"
+                                            << "w"),
+                                   BSON("a" << 1e300 << "b" << 0),
+                                   BSON("a"
+                                        << ""
+                                        << "b"
+                                        << 0),
+                                   BSON("a"
+                                        << "ab"
+                                        << "b"
+                                        << 1),
+                                   BSON("a"
+                                        << "abc"
+                                        << "b"
+                                        << BSONNULL),
+                                   BSON("a" << BSONObj() << "b" << 0),
+                                   BSON("a" << BSON("x" << 1) << "b" << 0),
+                                   BSON("a" << false << "b" << 0),
+                                   BSON("a" << true << "b" << 0),
+                                   BSON("a" << true << "b" << MAXKEY),
+                                   BSON("a" << MAXKEY << "b" << 0)};
+
+        for (const BSONObj& key : keys) {
+            auto expected = chunkManager.findIntersectingChunkInChunkMap(key);
+            ASSERT(expected);
+            ASSERT_EQUALS(expected, routingTable.findIntersectingChunk(key));
+            ASSERT_EQUALS(expected, chunkManager.findIntersectingChunk(opCtx.get(), key));
+        }
+
+        ASSERT_FALSE(routingTable.findIntersectingChunk(BSON("a" << MAXKEY << "b" << MAXKEY)));
+    }
+};
+
+/**
+ * Checks that consecutive chunks on the same shard are collapsed into a single range.
+ */
+class RoutingTableCollapsesRanges {
+public:
+    void run() {
+        auto opCtx = stdx::make_unique<OperationContextNoop>();
+
+        ShardKeyPattern shardKeyPattern(BSON("a" << 1));
+        TestableChunkManager chunkManager("", shardKeyPattern, false);
+        chunkManager.setChunks(100, 10, 3);
+
+        const ChunkRoutingTable& routingTable = chunkManager.getRoutingTable();
+        ASSERT_EQUALS(100U, routingTable.numChunks());
+        ASSERT_EQUALS(10U, routingTable.numRanges());
+        ASSERT_EQUALS("0", routingTable.getFirstShardId());
+
+        set<ShardId> shardIds;
+        chunkManager.getShardIdsForQuery(
+            opCtx.get(), BSON("a" << GTE << 12 << LT << 25), &shardIds);
+        ASSERT(set<ShardId>({"1", "2"}) == shardIds);
+
+        shardIds.clear();
+        chunkManager.getShardIdsForQuery(opCtx.get(), BSON("a" << 95), &shardIds);
+        ASSERT(set<ShardId>({"0"}) == shardIds);
+
+        shardIds.clear();
+        chunkManager.getShardIdsForQuery(opCtx.get(), BSON("a" << GT << 3 << LT << 3), &shardIds);
+        ASSERT(set<ShardId>({"0"}) == shardIds);
+    }
+};
+
+#ifndef MONGO_CONFIG_DEBUG_BUILD
+/**
+ * Measures routing by shard key against a collection with a million chunks. Not built in debug
+ * builds, where loading that many chunks would dominate the run time of the suite.
+ */
+class RoutingBenchmark {
+public:
+    void run() {
+        const int kNumChunks = 1000 * 1000;
+        const int kNumShards = 50;
+        const int kNumLookups = 1000 * 1000;
+        const int kNumQueries = 100 * 1000;
+
+        auto opCtx = stdx::make_unique<OperationContextNoop>();
+
+        ShardKeyPattern shardKeyPattern(BSON("a" << 1));
+        TestableChunkManager chunkManager("", shardKeyPattern, false);
+        {
+            Timer timer;
+            chunkManager.setChunks(kNumChunks, 100, kNumShards);
+            log() << "routing benchmark: loaded " << kNumChunks << " chunks in " << timer.millis()
+                  << "ms";
+        }
+
+        PseudoRandom random(1);
+
+        vector<BSONObj> keys;
+        keys.reserve(kNumLookups);
+        for (int i = 0; i < kNumLookups; ++i) {
+            keys.push_back(BSON("a" << random.nextInt32(kNumChunks)));
+        }
+
+        {
+            Timer timer;
+            size_t found = 0;
+            for (const BSONObj& key : keys) {
+                found += chunkManager.findIntersectingChunk(opCtx.get(), key) ? 1 : 0;
+            }
+            ASSERT_EQUALS(keys.size(), found);
+            report("findIntersectingChunk", kNumLookups, timer.micros());
+        }
+
+        {
+            Timer timer;
+            set<ShardId> shardIds;
+            for (int i = 0; i < kNumQueries; ++i) {
+                shardIds.clear();
+                chunkManager.getShardIdsForQuery(opCtx.get(), keys[i], &shardIds);
+                ASSERT_EQUALS(1U, shardIds.size());
+            }
+            report("getShardIdsForQuery (equality)", kNumQueries, timer.micros());
+        }
+
+        {
+            Timer timer;
+            set<ShardId> shardIds;
+            for (int i = 0; i < kNumQueries; ++i) {
+                const int a = keys[i].firstElement().numberInt();
+                shardIds.clear();
+                chunkManager.getShardIdsForQuery(
+                    opCtx.get(), BSON("a" << GTE << a << LT << a + 1000), &shardIds);
+                ASSERT_FALSE(shardIds.empty());
+            }
+            report("getShardIdsForQuery (range)", kNumQueries, timer.micros());
+        }
+    }
+
+private:
+    static void report(StringData operation, int numOps, long long micros) {
+        log() << "routing benchmark: " << operation << ": " << numOps << " ops in "
+              << micros / 1000 << "ms, " << (numOps * 1000LL * 1000) / std::max(micros, 1LL)
+              << " ops/sec";
+    }
+};
+#endif
+
 class All : public Suite {
 public:
     All() : Suite("chunk") {}
@@ -361,6 +582,11 @@ public:
         add<InequalityThenUnsatisfiable>();
         add<OrEqualityUnsatisfiableInequality>();
         add<InMultiShard>();
+        add<RoutingTableMatchesChunkMap>();
+        add<RoutingTableCollapsesRanges>();
+#ifndef MONGO_CONFIG_DEBUG_BUILD
+        add<RoutingBenchmark>();
+#endif
     }
 };
 
@@ -46,6 +46,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/stage_builder.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
 
 namespace DocumentSourceCursorTests {
 
@@ -311,6 +312,75 @@ public:
 
 }  // namespace DocumentSourceCursor
 
+namespace LazyDocument {
+
+/**
+ * Compares the throughput of a $match and $project over wide documents, when the documents
+ * entering the pipeline have been fully converted from BSON and when they are converted lazily as
+ * DocumentSourceCursor does.
+ */
+class WideDocumentThroughput : public CollectionBase {
+public:
+    void run() {
+        const int kNumFields = 200;
+        const int kNumDocs = 2000;
+
+        std::vector<BSONObj> inputs;
+        for (int i = 0; i < kNumDocs; ++i) {
+            BSONObjBuilder bob;
+            bob.append("_id", i);
+            for (int field = 0; field < kNumFields; ++field) {
+                bob.append(std::string(str::stream() << "f" << field), i * kNumFields + field);
+            }
+            inputs.push_back(bob.obj());
+        }
+
+        std::vector<Document> eagerResults;
+        const long long eagerMicros = runPipeline(inputs, false, &eagerResults);
+        std::vector<Document> lazyResults;
+        const long long lazyMicros = runPipeline(inputs, true, &lazyResults);
+
+        log() << "$match and $project over " << kNumDocs << " documents of " << kNumFields
+              << " fields: eager conversion " << eagerMicros << " micros, lazy conversion "
+              << lazyMicros << " micros";
+
+        ASSERT_EQUALS(eagerResults.size(), lazyResults.size());
+        ASSERT_EQUALS(static_cast<size_t>(kNumDocs / 2), lazyResults.size());
+        for (size_t i = 0; i < eagerResults.size(); ++i) {
+            ASSERT_EQUALS(eagerResults[i], lazyResults[i]);
+        }
+    }
+
+private:
+    long long runPipeline(const std::vector<BSONObj>& inputs,
+                          bool lazy,
+                          std::vector<Document>* results) {
+        intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext(&_opCtx, nss));
+        auto match = DocumentSourceMatch::createFromBson(
+            BSON("$match" << BSON("f1" << BSON("$mod" << BSON_ARRAY(2 << 0)))).firstElement(),
+            expCtx);
+        auto project = DocumentSourceProject::createFromBson(
+            BSON("$project" << BSON("f0" << 1 << "f150" << 1)).firstElement(), expCtx);
+
+        Timer timer;
+        std::deque<Document> docs;
+        for (auto&& input : inputs) {
+            docs.push_back(lazy ? Document::wrapBsonWithMetaData(input)
+                                : Document::fromBsonWithMetaData(input));
+        }
+
+        auto mock = DocumentSourceMock::create(std::move(docs));
+        match->setSource(mock.get());
+        project->setSource(match.get());
+        while (auto next = project->getNext()) {
+            results->push_back(std::move(*next));
+        }
+        return timer.micros();
+    }
+};
+
+}  // namespace LazyDocument
+
 class All : public Suite {
 public:
     All() : Suite("documentsource") {}
@@ -324,6 +394,7 @@ public:
         add<DocumentSourceCursor::IndexScanProvidesSortOnKeys>();
         add<DocumentSourceCursor::ReverseIndexScanProvidesSort>();
         add<DocumentSourceCursor::CompoundIndexScanProvidesMultipleSorts>();
+        add<LazyDocument::WideDocumentThroughput>();
     }
 };
 
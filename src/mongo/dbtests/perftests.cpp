@@ -42,6 +42,7 @@
 #include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
@@ -52,6 +53,8 @@
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/db/storage/mmap_v1/dur_stats.h"
 #include "mongo/db/storage/mmap_v1/mmap.h"
 #include "mongo/db/storage/storage_options.h"
@@ -74,6 +77,7 @@ using std::right;
 using std::setprecision;
 using std::setw;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 namespace dps = ::mongo::dotted_path_support;
@@ -449,6 +453,148 @@ public:
     }
 };
 
+// The sort benchmarks below run over this many documents, or sort keys.
+const int kSortBenchmarkDocs = 1000 * 1000;
+
+BSONObj makeSortBenchmarkDoc(int i) {
+    // Spread the values so that most comparisons need more than the first field to be decided.
+    const unsigned hash = static_cast<unsigned>(i) * 2654435761U;
+    return BSON("_id" << i << "a" << static_cast<int>(hash % 100) << "b"
+                      << ("str" + std::to_string(hash % 1000))
+                      << "c"
+                      << static_cast<double>(hash % 1000003) / 7);
+}
+
+/**
+ * Runs a find sorted on a compound pattern over kSortBenchmarkDocs documents, which the SORT stage
+ * sorts in memory.
+ */
+class SortBase : public B {
+public:
+    virtual int howLongMillis() {
+        return 0;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    void prep() {
+        _oldMaxBlockingSortBytes = internalQueryExecMaxBlockingSortBytes.load();
+        internalQueryExecMaxBlockingSortBytes.store(1024 * 1024 * 1024);
+
+        vector<BSONObj> batch;
+        for (int i = 0; i < kSortBenchmarkDocs; i++) {
+            batch.push_back(makeSortBenchmarkDoc(i));
+            if (batch.size() == 1000) {
+                client()->insert(ns(), batch);
+                batch.clear();
+            }
+        }
+        client()->insert(ns(), batch);
+    }
+    void timed() {
+        unique_ptr<DBClientCursor> cursor =
+            client()->query(ns(), Query().sort(pattern()), limit());
+        int n = 0;
+        while (cursor->more()) {
+            cursor->nextSafe();
+            n++;
+        }
+        verify(n == (limit() ? limit() : kSortBenchmarkDocs));
+    }
+    void post() {
+        internalQueryExecMaxBlockingSortBytes.store(_oldMaxBlockingSortBytes);
+        client()->dropCollection(ns());
+    }
+
+protected:
+    virtual BSONObj pattern() {
+        return BSON("a" << 1 << "b" << -1 << "c" << 1);
+    }
+    virtual int limit() {
+        return 0;
+    }
+
+private:
+    int _oldMaxBlockingSortBytes = 0;
+};
+
+class SortCompound : public SortBase {
+public:
+    string name() {
+        return "sort-compound-1M";
+    }
+};
+
+class SortCompoundTopK : public SortBase {
+public:
+    string name() {
+        return "sort-compound-top100-1M";
+    }
+
+protected:
+    int limit() {
+        return 100;
+    }
+};
+
+/**
+ * Sorts kSortBenchmarkDocs compound sort keys, as the SORT stage holds them, to compare the cost of
+ * comparing keys as BSON with that of comparing their KeyString encodings.
+ */
+class SortKeysBase : public B {
+public:
+    virtual int howLongMillis() {
+        return 0;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    void prep() {
+        const BSONObj pattern = BSON("a" << 1 << "b" << -1 << "c" << 1);
+        const Ordering ordering = Ordering::make(pattern);
+        KeyString keyString(KeyString::Version::V1);
+        for (int i = 0; i < kSortBenchmarkDocs; i++) {
+            const BSONObj doc = makeSortBenchmarkDoc(i);
+            const BSONObj key = BSON("" << doc["a"] << "" << doc["b"] << "" << doc["c"]);
+            _keys.push_back(key);
+            keyString.resetToKey(key, ordering, RecordId(i + 1));
+            _keyStrings.emplace_back(keyString.getBuffer(), keyString.getSize());
+        }
+        _pattern = pattern;
+    }
+    void post() {
+        _keys.clear();
+        _keyStrings.clear();
+    }
+
+protected:
+    vector<BSONObj> _keys;
+    vector<string> _keyStrings;
+    BSONObj _pattern;
+};
+
+class SortKeysWoCompare : public SortKeysBase {
+public:
+    string name() {
+        return "sortkeys-woCompare-1M";
+    }
+    void timed() {
+        const BSONObj& pattern = _pattern;
+        std::sort(_keys.begin(), _keys.end(), [&pattern](const BSONObj& lhs, const BSONObj& rhs) {
+            return lhs.woCompare(rhs, pattern, false) < 0;
+        });
+    }
+};
+
+class SortKeysKeyString : public SortKeysBase {
+public:
+    string name() {
+        return "sortkeys-KeyString-1M";
+    }
+    void timed() {
+        std::sort(_keyStrings.begin(), _keyStrings.end());
+    }
+};
 
 class All : public Suite {
 public:
@@ -462,6 +608,10 @@ public:
         add<boosttimed_mutexspeed>();
         add<stdmutexspeed>();
         add<stdtimed_mutexspeed>();
+        add<SortCompound>();
+        add<SortCompoundTopK>();
+        add<SortKeysWoCompare>();
+        add<SortKeysKeyString>();
     }
 } myall;
 }
@@ -57,6 +57,7 @@
 #include "mongo/stdx/mutex.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor_manager.h"
 
 namespace mongo {
 
@@ -160,9 +161,13 @@ private:
         rpc::ProtocolSet clientProtocols() const;
         void setServerProtocols(rpc::ProtocolSet protocols);
 
+        MessageCompressorManager& getCompressorManager();
+
     private:
         std::unique_ptr<AsyncStreamInterface> _stream;
 
+        MessageCompressorManager _compressorManager;
+
         rpc::ProtocolSet _serverProtocols;
 
         // Dynamically initialized from [min max]WireVersionOutgoing.
@@ -204,6 +209,7 @@ private:
         NetworkInterfaceASIO::AsyncConnection& conn();
 
         Message& toSend();
+        Message& toSendCompressed();
         Message& toRecv();
         MSGHEADER::Value& header();
 
@@ -217,6 +223,8 @@ private:
         const CommandType _type;
 
         Message _toSend;
+        // The compressed form of '_toSend', if this connection compresses outgoing messages.
+        Message _toSendCompressed;
         Message _toRecv;
 
         // TODO: Investigate efficiency of storing header separately.
@@ -70,6 +70,8 @@ void NetworkInterfaceASIO::_runIsMaster(AsyncOp* op) {
         bob.append("hostInfo", sb.str());
     }
 
+    op->connection().getCompressorManager().clientBegin(&bob);
+
     requestBuilder.setCommandArgs(bob.done());
     requestBuilder.setMetadata(rpc::makeEmptyMetadata());
 
@@ -96,6 +98,8 @@ void NetworkInterfaceASIO::_runIsMaster(AsyncOp* op) {
 
         op->connection().setServerProtocols(protocolSet.getValue());
 
+        op->connection().getCompressorManager().clientFinish(commandReply.data);
+
         invariant(op->connection().clientProtocols() != rpc::supports::kNone);
         // Set the operation protocol
         auto negotiatedProtocol =
@@ -71,12 +71,30 @@ template <typename FunctionLike>
 using IsNetworkHandler =
     std::is_convertible<FunctionLike, stdx::function<void(std::error_code, std::size_t)>>;
 
+/**
+ * Sends 'm', or its compressed form in 'compressed' if 'compressorManager' compresses it. The
+ * message sent must outlive the write, so 'compressed' is owned by the caller.
+ */
 template <typename Handler>
-void asyncSendMessage(AsyncStreamInterface& stream, Message* m, Handler&& handler) {
+void asyncSendMessage(AsyncStreamInterface& stream,
+                      MessageCompressorManager& compressorManager,
+                      Message* m,
+                      Message* compressed,
+                      Handler&& handler) {
     static_assert(IsNetworkHandler<Handler>::value,
                   "Handler passed to asyncSendMessage does not conform to NetworkHandler concept");
     m->header().setResponseToMsgId(0);
     m->header().setId(nextMessageId());
+
+    compressed->reset();
+    auto status = compressorManager.compressMessage(*m, compressed);
+    if (!status.isOK()) {
+        return handler(make_error_code(status.code()), 0);
+    }
+    if (!compressed->empty()) {
+        m = compressed;
+    }
+
     // TODO: Some day we may need to support vector messages.
     fassert(28708, m->buf() != 0);
     stream.write(asio::buffer(m->buf(), m->size()), std::forward<Handler>(handler));
@@ -187,6 +205,10 @@ Message& NetworkInterfaceASIO::AsyncCommand::toSend() {
     return _toSend;
 }
 
+Message& NetworkInterfaceASIO::AsyncCommand::toSendCompressed() {
+    return _toSendCompressed;
+}
+
 Message& NetworkInterfaceASIO::AsyncCommand::toRecv() {
     return _toRecv;
 }
@@ -362,6 +384,13 @@ void NetworkInterfaceASIO::_asyncRunCommand(AsyncOp* op, NetworkOpHandler handle
 
     // Step 4
     auto recvMessageCallback = [this, cmd, handler, op](std::error_code ec, size_t bytes) {
+        if (!ec) {
+            auto status = cmd->conn().getCompressorManager().decompressMessage(&cmd->toRecv());
+            if (!status.isOK()) {
+                return handler(make_error_code(status.code()), bytes);
+            }
+        }
+
         // We don't call _validateAndRun here as we assume the caller will.
         handler(ec, bytes);
     };
@@ -401,7 +430,11 @@ void NetworkInterfaceASIO::_asyncRunCommand(AsyncOp* op, NetworkOpHandler handle
     };
 
     // Step 1
-    asyncSendMessage(cmd->conn().stream(), &cmd->toSend(), std::move(sendMessageCallback));
+    asyncSendMessage(cmd->conn().stream(),
+                     cmd->conn().getCompressorManager(),
+                     &cmd->toSend(),
+                     &cmd->toSendCompressed(),
+                     std::move(sendMessageCallback));
 }
 
 void NetworkInterfaceASIO::_runConnectionHook(AsyncOp* op) {
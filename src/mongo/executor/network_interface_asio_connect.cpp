@@ -75,6 +75,10 @@ void NetworkInterfaceASIO::AsyncConnection::setServerProtocols(rpc::ProtocolSet
     _serverProtocols = protocols;
 }
 
+MessageCompressorManager& NetworkInterfaceASIO::AsyncConnection::getCompressorManager() {
+    return _compressorManager;
+}
+
 void NetworkInterfaceASIO::_connect(AsyncOp* op) {
     LOG(1) << "Connecting to " << op->request().target.toString();
 
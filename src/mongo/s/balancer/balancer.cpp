@@ -601,11 +601,11 @@ int Balancer::_moveChunks(OperationContext* txn,
 
                 auto c = cm->findIntersectingChunk(txn, migrateInfo.minKey);
 
-                auto splitStatus = c->split(txn, Chunk::normal, nullptr);
+                auto splitStatus = c->split(txn, cm, Chunk::normal, nullptr);
                 if (!splitStatus.isOK()) {
                     log() << "Marking chunk " << c->toString() << " as jumbo.";
 
-                    c->markAsJumbo(txn);
+                    c->markAsJumbo(txn, cm);
 
                     // We increment moveCount so we do another round right away
                     movedCount++;
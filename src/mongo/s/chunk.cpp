@@ -64,9 +64,8 @@ const uint64_t kTooManySplitPoints = 4;
 
 }  // namespace
 
-Chunk::Chunk(OperationContext* txn, ChunkManager* manager, const ChunkType& from)
-    : _manager(manager), _lastmod(from.getVersion()), _dataWritten(mkDataWritten()) {
-    string ns = from.getNS();
+Chunk::Chunk(OperationContext* txn, const string& ns, const ChunkType& from)
+    : _lastmod(from.getVersion()), _dataWritten(mkDataWritten()) {
     _shardId = from.getShard();
 
     verify(_lastmod.isSet());
@@ -76,21 +75,19 @@ Chunk::Chunk(OperationContext* txn, ChunkManager* manager, const ChunkType& from
 
     _jumbo = from.getJumbo();
 
-    uassert(10170, "Chunk needs a ns", !ns.empty());
-    uassert(13327, "Chunk ns must match server ns", ns == _manager->getns());
+    uassert(10170, "Chunk needs a ns", !from.getNS().empty());
+    uassert(13327, "Chunk ns must match server ns", from.getNS() == ns);
     uassert(10172, "Chunk needs a min", !_min.isEmpty());
     uassert(10173, "Chunk needs a max", !_max.isEmpty());
     uassert(10171, "Chunk needs a server", grid.shardRegistry()->getShard(txn, _shardId));
 }
 
-Chunk::Chunk(ChunkManager* info,
-             const BSONObj& min,
+Chunk::Chunk(const BSONObj& min,
              const BSONObj& max,
              const ShardId& shardId,
              ChunkVersion lastmod,
              uint64_t initialDataWritten)
-    : _manager(info),
-      _min(min),
+    : _min(min),
       _max(max),
       _shardId(shardId),
       _lastmod(lastmod),
@@ -107,23 +104,25 @@ bool Chunk::containsKey(const BSONObj& shardKey) const {
     return getMin().woCompare(shardKey) <= 0 && shardKey.woCompare(getMax()) < 0;
 }
 
-bool Chunk::_minIsInf() const {
-    return 0 == _manager->getShardKeyPattern().getKeyPattern().globalMin().woCompare(getMin());
+bool Chunk::_minIsInf(const ChunkManager* manager) const {
+    return 0 == manager->getShardKeyPattern().getKeyPattern().globalMin().woCompare(getMin());
 }
 
-bool Chunk::_maxIsInf() const {
-    return 0 == _manager->getShardKeyPattern().getKeyPattern().globalMax().woCompare(getMax());
+bool Chunk::_maxIsInf(const ChunkManager* manager) const {
+    return 0 == manager->getShardKeyPattern().getKeyPattern().globalMax().woCompare(getMax());
 }
 
-BSONObj Chunk::_getExtremeKey(OperationContext* txn, bool doSplitAtLower) const {
+BSONObj Chunk::_getExtremeKey(OperationContext* txn,
+                              const ChunkManager* manager,
+                              bool doSplitAtLower) const {
     Query q;
     if (doSplitAtLower) {
-        q.sort(_manager->getShardKeyPattern().toBSON());
+        q.sort(manager->getShardKeyPattern().toBSON());
     } else {
         // need to invert shard key pattern to sort backwards
         // TODO: make a helper in ShardKeyPattern?
 
-        BSONObj k = _manager->getShardKeyPattern().toBSON();
+        BSONObj k = manager->getShardKeyPattern().toBSON();
         BSONObjBuilder r;
 
         BSONObjIterator i(k);
@@ -144,7 +143,7 @@ BSONObj Chunk::_getExtremeKey(OperationContext* txn, bool doSplitAtLower) const
         // Splitting close to the lower bound means that the split point will be the
         // upper bound. Chunk range upper bounds are exclusive so skip a document to
         // make the lower half of the split end up with a single document.
-        unique_ptr<DBClientCursor> cursor = conn->query(_manager->getns(),
+        unique_ptr<DBClientCursor> cursor = conn->query(manager->getns(),
                                                         q,
                                                         1, /* nToReturn */
                                                         1 /* nToSkip */);
@@ -159,16 +158,18 @@ BSONObj Chunk::_getExtremeKey(OperationContext* txn, bool doSplitAtLower) const
             end = cursor->next().getOwned();
         }
     } else {
-        end = conn->findOne(_manager->getns(), q);
+        end = conn->findOne(manager->getns(), q);
     }
 
     conn.done();
     if (end.isEmpty())
         return BSONObj();
-    return _manager->getShardKeyPattern().extractShardKeyFromDoc(end);
+    return manager->getShardKeyPattern().extractShardKeyFromDoc(end);
 }
 
-std::vector<BSONObj> Chunk::_determineSplitPoints(OperationContext* txn, bool atMedian) const {
+std::vector<BSONObj> Chunk::_determineSplitPoints(OperationContext* txn,
+                                                  const ChunkManager* manager,
+                                                  bool atMedian) const {
     // If splitting is not obligatory we may return early if there are not enough data we cap the
     // number of objects that would fall in the first half (before the split point) the rationale is
     // we'll find a split point without traversing all the data.
@@ -178,15 +179,15 @@ std::vector<BSONObj> Chunk::_determineSplitPoints(OperationContext* txn, bool at
         BSONObj medianKey =
             uassertStatusOK(shardutil::selectMedianKey(txn,
                                                        _shardId,
-                                                       NamespaceString(_manager->getns()),
-                                                       _manager->getShardKeyPattern(),
+                                                       NamespaceString(manager->getns()),
+                                                       manager->getShardKeyPattern(),
                                                        _min,
                                                        _max));
         if (!medianKey.isEmpty()) {
             splitPoints.push_back(medianKey);
         }
     } else {
-        uint64_t chunkSize = _manager->getCurrentDesiredChunkSize();
+        uint64_t chunkSize = manager->getCurrentDesiredChunkSize();
 
         // Note: One split point for every 1/2 chunk size.
         const uint64_t estNumSplitPoints = _dataWritten / chunkSize * 2;
@@ -202,8 +203,8 @@ std::vector<BSONObj> Chunk::_determineSplitPoints(OperationContext* txn, bool at
         splitPoints =
             uassertStatusOK(shardutil::selectChunkSplitPoints(txn,
                                                               _shardId,
-                                                              NamespaceString(_manager->getns()),
-                                                              _manager->getShardKeyPattern(),
+                                                              NamespaceString(manager->getns()),
+                                                              manager->getShardKeyPattern(),
                                                               _min,
                                                               _max,
                                                               chunkSize,
@@ -220,6 +221,7 @@ std::vector<BSONObj> Chunk::_determineSplitPoints(OperationContext* txn, bool at
 }
 
 StatusWith<boost::optional<ChunkRange>> Chunk::split(OperationContext* txn,
+                                                     const ChunkManager* manager,
                                                      SplitPointMode mode,
                                                      size_t* resultingSplits) const {
     size_t dummy;
@@ -228,7 +230,7 @@ StatusWith<boost::optional<ChunkRange>> Chunk::split(OperationContext* txn,
     }
 
     bool atMedian = mode == Chunk::atMedian;
-    vector<BSONObj> splitPoints = _determineSplitPoints(txn, atMedian);
+    vector<BSONObj> splitPoints = _determineSplitPoints(txn, manager, atMedian);
     if (splitPoints.empty()) {
         string msg;
         if (atMedian) {
@@ -247,14 +249,14 @@ StatusWith<boost::optional<ChunkRange>> Chunk::split(OperationContext* txn,
     // This heuristic is skipped for "special" shard key patterns that are not likely to
     // produce monotonically increasing or decreasing values (e.g. hashed shard keys).
     if (mode == Chunk::autoSplitInternal &&
-        KeyPattern::isOrderedKeyPattern(_manager->getShardKeyPattern().toBSON())) {
-        if (_minIsInf()) {
-            BSONObj key = _getExtremeKey(txn, true);
+        KeyPattern::isOrderedKeyPattern(manager->getShardKeyPattern().toBSON())) {
+        if (_minIsInf(manager)) {
+            BSONObj key = _getExtremeKey(txn, manager, true);
             if (!key.isEmpty()) {
                 splitPoints[0] = key.getOwned();
             }
-        } else if (_maxIsInf()) {
-            BSONObj key = _getExtremeKey(txn, false);
+        } else if (_maxIsInf(manager)) {
+            BSONObj key = _getExtremeKey(txn, manager, false);
             if (!key.isEmpty()) {
                 splitPoints.pop_back();
                 splitPoints.push_back(key);
@@ -282,9 +284,9 @@ StatusWith<boost::optional<ChunkRange>> Chunk::split(OperationContext* txn,
 
     auto splitStatus = shardutil::splitChunkAtMultiplePoints(txn,
                                                              _shardId,
-                                                             NamespaceString(_manager->getns()),
-                                                             _manager->getShardKeyPattern(),
-                                                             _manager->getVersion(),
+                                                             NamespaceString(manager->getns()),
+                                                             manager->getShardKeyPattern(),
+                                                             manager->getVersion(),
                                                              _min,
                                                              _max,
                                                              splitPoints);
@@ -292,19 +294,19 @@ StatusWith<boost::optional<ChunkRange>> Chunk::split(OperationContext* txn,
         return splitStatus.getStatus();
     }
 
-    _manager->reload(txn);
+    manager->reload(txn);
 
     *resultingSplits = splitPoints.size();
     return splitStatus.getValue();
 }
 
-bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
+bool Chunk::splitIfShould(OperationContext* txn, const ChunkManager* manager, long dataWritten) {
     LastError::Disabled d(&LastError::get(cc()));
 
     try {
         _dataWritten += dataWritten;
-        uint64_t splitThreshold = _manager->getCurrentDesiredChunkSize();
-        if (_minIsInf() || _maxIsInf()) {
+        uint64_t splitThreshold = manager->getCurrentDesiredChunkSize();
+        if (_minIsInf(manager) || _maxIsInf(manager)) {
             splitThreshold = static_cast<uint64_t>((double)splitThreshold * 0.9);
         }
 
@@ -312,18 +314,18 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
             return false;
         }
 
-        if (!_manager->_splitHeuristics._splitTickets.tryAcquire()) {
-            LOG(1) << "won't auto split because not enough tickets: " << _manager->getns();
+        if (!manager->_splitHeuristics._splitTickets.tryAcquire()) {
+            LOG(1) << "won't auto split because not enough tickets: " << manager->getns();
             return false;
         }
 
-        TicketHolderReleaser releaser(&(_manager->_splitHeuristics._splitTickets));
+        TicketHolderReleaser releaser(&(manager->_splitHeuristics._splitTickets));
 
         LOG(1) << "about to initiate autosplit: " << *this << " dataWritten: " << _dataWritten
                << " splitThreshold: " << splitThreshold;
 
         size_t splitCount = 0;
-        auto splitStatus = split(txn, Chunk::autoSplitInternal, &splitCount);
+        auto splitStatus = split(txn, manager, Chunk::autoSplitInternal, &splitCount);
         if (!splitStatus.isOK()) {
             // Split would have issued a message if we got here. This means there wasn't enough
             // data to split, so don't want to try again until considerable more data
@@ -331,7 +333,7 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
             return false;
         }
 
-        if (_maxIsInf() || _minIsInf()) {
+        if (_maxIsInf(manager) || _minIsInf(manager)) {
             // we don't want to reset _dataWritten since we kind of want to check the other side
             // right away
         } else {
@@ -349,9 +351,9 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
 
         bool shouldBalance = balancerConfig->isBalancerActive();
         if (shouldBalance) {
-            auto collStatus = grid.catalogManager(txn)->getCollection(txn, _manager->getns());
+            auto collStatus = grid.catalogManager(txn)->getCollection(txn, manager->getns());
             if (!collStatus.isOK()) {
-                warning() << "Auto-split for " << _manager->getns()
+                warning() << "Auto-split for " << manager->getns()
                           << " failed to load collection metadata"
                           << causedBy(collStatus.getStatus());
                 return false;
@@ -362,7 +364,7 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
 
         const auto suggestedMigrateChunk = std::move(splitStatus.getValue());
 
-        log() << "autosplitted " << _manager->getns() << " shard: " << toString() << " into "
+        log() << "autosplitted " << manager->getns() << " shard: " << toString() << " into "
               << (splitCount + 1) << " (splitThreshold " << splitThreshold << ")"
               << (suggestedMigrateChunk ? "" : (string) " (migrate suggested" +
                           (shouldBalance ? ")" : ", but no migrations allowed)"));
@@ -371,7 +373,7 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
         // spot from staying on a single shard. This is based on the assumption that succeeding
         // inserts will fall on the top chunk.
         if (suggestedMigrateChunk && shouldBalance) {
-            const NamespaceString nss(_manager->getns());
+            const NamespaceString nss(manager->getns());
 
             // We need to use the latest chunk manager (after the split) in order to have the most
             // up-to-date view of the chunk we are about to move
@@ -391,7 +393,7 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
                 msgassertedNoTraceWithStatus(10412, rebalanceStatus);
             }
 
-            _manager->reload(txn);
+            manager->reload(txn);
         }
 
         return true;
@@ -401,7 +403,7 @@ bool Chunk::splitIfShould(OperationContext* txn, long dataWritten) {
         _dataWritten = mkDataWritten();
 
         // if the collection lock is taken (e.g. we're migrating), it is fine for the split to fail.
-        warning() << "could not autosplit collection " << _manager->getns() << causedBy(e);
+        warning() << "could not autosplit collection " << manager->getns() << causedBy(e);
         return false;
     }
 }
@@ -424,19 +426,19 @@ bool Chunk::operator==(const Chunk& s) const {
 
 string Chunk::toString() const {
     stringstream ss;
-    ss << ChunkType::ns() << ": " << _manager->getns() << ", " << ChunkType::shard() << ": "
-       << _shardId << ", " << ChunkType::DEPRECATED_lastmod() << ": " << _lastmod.toString() << ", "
-       << ChunkType::min() << ": " << _min << ", " << ChunkType::max() << ": " << _max;
+    ss << ChunkType::shard() << ": " << _shardId << ", " << ChunkType::DEPRECATED_lastmod() << ": "
+       << _lastmod.toString() << ", " << ChunkType::min() << ": " << _min << ", "
+       << ChunkType::max() << ": " << _max;
     return ss.str();
 }
 
-void Chunk::markAsJumbo(OperationContext* txn) const {
+void Chunk::markAsJumbo(OperationContext* txn, const ChunkManager* manager) const {
     // set this first
     // even if we can't set it in the db
     // at least this mongos won't try and keep moving
     _jumbo = true;
 
-    const string chunkName = ChunkType::genID(_manager->getns(), _min);
+    const string chunkName = ChunkType::genID(manager->getns(), _min);
 
     auto status =
         grid.catalogManager(txn)->updateConfigDocument(txn,
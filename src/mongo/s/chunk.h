@@ -46,6 +46,10 @@ class OperationContext;
 
    x is in a shard iff
    min <= x < max
+
+   A chunk does not refer to the ChunkManager which holds it, so that the chunks which did not
+   change can be shared by successive ChunkManagers of a collection. Operations which need the
+   collection's routing information take the current ChunkManager as an argument.
  */
 class Chunk {
     MONGO_DISALLOW_COPYING(Chunk);
@@ -65,10 +69,9 @@ public:
         autoSplitInternal
     };
 
-    Chunk(OperationContext* txn, ChunkManager* manager, const ChunkType& from);
+    Chunk(OperationContext* txn, const std::string& ns, const ChunkType& from);
 
-    Chunk(ChunkManager* manager,
-          const BSONObj& min,
+    Chunk(const BSONObj& min,
           const BSONObj& max,
           const ShardId& shardId,
           ChunkVersion lastmod,
@@ -116,7 +119,7 @@ public:
      * then we check the real size, and if its too big, we split
      * @return if something was split
      */
-    bool splitIfShould(OperationContext* txn, long dataWritten);
+    bool splitIfShould(OperationContext* txn, const ChunkManager* manager, long dataWritten);
 
     /**
      * Splits this chunk at a non-specificed split key to be chosen by the
@@ -129,6 +132,7 @@ public:
      * @throws UserException
      */
     StatusWith<boost::optional<ChunkRange>> split(OperationContext* txn,
+                                                  const ChunkManager* manager,
                                                   SplitPointMode mode,
                                                   size_t* resultingSplits) const;
 
@@ -136,7 +140,7 @@ public:
      * marks this chunk as a jumbo chunk
      * that means the chunk will be inelligble for migrates
      */
-    void markAsJumbo(OperationContext* txn) const;
+    void markAsJumbo(OperationContext* txn, const ChunkManager* manager) const;
 
     bool isJumbo() const {
         return _jumbo;
@@ -167,9 +171,6 @@ public:
     ShardId getShardId() const {
         return _shardId;
     }
-    const ChunkManager* getManager() const {
-        return _manager;
-    }
 
 private:
     /**
@@ -178,11 +179,8 @@ private:
     ConnectionString _getShardConnectionString(OperationContext* txn) const;
 
     // if min/max key is pos/neg infinity
-    bool _minIsInf() const;
-    bool _maxIsInf() const;
-
-    // The chunk manager, which owns this chunk. Not owned by the chunk.
-    const ChunkManager* _manager;
+    bool _minIsInf(const ChunkManager* manager) const;
+    bool _maxIsInf(const ChunkManager* manager) const;
 
     BSONObj _min;
     BSONObj _max;
@@ -206,7 +204,9 @@ private:
      *          is simply an ordered list of ascending/descending field names. Examples:
      *          {a : 1, b : -1} is not special. {a : "hashed"} is.
      */
-    BSONObj _getExtremeKey(OperationContext* txn, bool doSplitAtLower) const;
+    BSONObj _getExtremeKey(OperationContext* txn,
+                           const ChunkManager* manager,
+                           bool doSplitAtLower) const;
 
     /**
      * Determines the appropriate split points for this chunk.
@@ -214,7 +214,9 @@ private:
      * @param atMedian perform a single split at the middle of this chunk.
      * @param splitPoints out parameter containing the chosen split points. Can be empty.
      */
-    std::vector<BSONObj> _determineSplitPoints(OperationContext* txn, bool atMedian) const;
+    std::vector<BSONObj> _determineSplitPoints(OperationContext* txn,
+                                               const ChunkManager* manager,
+                                               bool atMedian) const;
 
     /**
      * initializes _dataWritten with a random value so that a mongos restart
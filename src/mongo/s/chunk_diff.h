@@ -33,6 +33,7 @@
 #include "mongo/bson/bsonmisc.h"
 #include "mongo/bson/bsonobj.h"
 #include "mongo/s/client/shard.h"
+#include "mongo/util/persistent_sorted_map.h"
 
 namespace mongo {
 
@@ -72,7 +73,7 @@ template <class ValType>
 class ConfigDiffTracker : public ConfigDiffTrackerBase {
 public:
     // Stores ranges indexed by max or  min key
-    typedef typename std::map<BSONObj, ValType, BSONObjCmp> RangeMap;
+    typedef PersistentSortedMap<BSONObj, ValType, BSONObjCmp> RangeMap;
 
     // Pair of iterators defining a subset of ranges
     typedef typename std::pair<typename RangeMap::iterator, typename RangeMap::iterator>
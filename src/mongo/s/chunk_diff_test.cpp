@@ -104,7 +104,7 @@ void convertBSONArrayToChunkTypes(const vector<BSONObj>& chunksArray,
 
 class ChunkDiffUnitTest : public mongo::unittest::Test {
 protected:
-    typedef map<BSONObj, BSONObj, BSONObjCmp> RangeMap;
+    typedef ConfigDiffTracker<BSONObj>::RangeMap RangeMap;
     typedef map<string, ChunkVersion> VersionMap;
 
     ChunkDiffUnitTest() = default;
@@ -35,15 +35,19 @@
 #include <iterator>
 #include <map>
 #include <set>
+#include <unordered_set>
 
+#include "mongo/base/counter.h"
 #include "mongo/bson/util/bson_extract.h"
 #include "mongo/client/read_preference.h"
 #include "mongo/client/remote_command_targeter.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/matcher/extensions_callback_noop.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/stats/timer_stats.h"
 #include "mongo/rpc/get_status_from_command_result.h"
 #include "mongo/s/balancer/balancer_configuration.h"
 #include "mongo/s/catalog/catalog_cache.h"
@@ -72,6 +76,15 @@ using std::vector;
 
 namespace {
 
+// Number and duration of successful chunk manager loads, and the approximate number of bytes of
+// routing metadata they copied or built, as opposed to shared with the previous chunk manager.
+TimerStats refreshStats;
+ServerStatusMetricField<TimerStats> displayRefreshStats("sharding.chunkManagerRefresh.time",
+                                                        &refreshStats);
+Counter64 refreshBytesCopied;
+ServerStatusMetricField<Counter64> displayRefreshBytesCopied(
+    "sharding.chunkManagerRefresh.bytesCopied", &refreshBytesCopied);
+
 /**
  * This is an adapter so we can use config diffs - mongos and mongod do them slightly
  * differently
@@ -93,7 +106,7 @@ public:
 
     pair<BSONObj, shared_ptr<Chunk>> rangeFor(OperationContext* txn,
                                               const ChunkType& chunk) const final {
-        shared_ptr<Chunk> c(new Chunk(txn, _manager, chunk));
+        shared_ptr<Chunk> c(new Chunk(txn, _manager->getns(), chunk));
         return make_pair(chunk.getMax(), c);
     }
 
@@ -117,7 +130,12 @@ bool allOfType(BSONType type, const BSONObj& o) {
     return true;
 }
 
-bool isChunkMapValid(const ChunkMap& chunkMap) {
+/**
+ * Checks that the chunks in 'chunkMap' cover the whole key space without gaps or overlaps. Blocks
+ * of entries which 'chunkMap' shares with 'validatedChunkMap', a chunk map which was already
+ * checked, are not checked again.
+ */
+bool isChunkMapValid(const ChunkMap& chunkMap, const ChunkMap* validatedChunkMap) {
 #define ENSURE(x)                                          \
     do {                                                   \
         if (!(x)) {                                        \
@@ -134,20 +152,40 @@ bool isChunkMapValid(const ChunkMap& chunkMap) {
     ENSURE(allOfType(MinKey, chunkMap.begin()->second->getMin()));
     ENSURE(allOfType(MaxKey, boost::prior(chunkMap.end())->second->getMax()));
 
+    std::unordered_set<const ChunkMap::Block*> validatedBlocks;
+    if (validatedChunkMap) {
+        for (size_t i = 0; i < validatedChunkMap->numBlocks(); ++i) {
+            validatedBlocks.insert(validatedChunkMap->getBlock(i).get());
+        }
+    }
+
     // Make sure there are no gaps or overlaps
-    for (ChunkMap::const_iterator it = boost::next(chunkMap.begin()), end = chunkMap.end();
-         it != end;
-         ++it) {
-        ChunkMap::const_iterator last = boost::prior(it);
-
-        if (!(it->second->getMin() == last->second->getMax())) {
-            log() << last->second->toString();
-            log() << it->second->toString();
-            log() << it->second->getMin();
-            log() << last->second->getMax();
+    const Chunk* last = nullptr;
+    for (size_t i = 0; i < chunkMap.numBlocks(); ++i) {
+        const auto block = chunkMap.getBlock(i);
+
+        // Only the first chunk of a validated block needs to be checked against its predecessor.
+        const size_t numToCheck = validatedBlocks.count(block.get()) ? 1 : block->size();
+
+        for (size_t pos = 0; pos < numToCheck; ++pos) {
+            const Chunk* chunk = (*block)[pos].second.get();
+            if (!last) {
+                last = chunk;
+                continue;
+            }
+
+            if (!(chunk->getMin() == last->getMax())) {
+                log() << last->toString();
+                log() << chunk->toString();
+                log() << chunk->getMin();
+                log() << last->getMax();
+            }
+
+            ENSURE(chunk->getMin() == last->getMax());
+            last = chunk;
         }
 
-        ENSURE(it->second->getMin() == last->second->getMax());
+        last = block->back().second.get();
     }
 
     return true;
@@ -191,12 +229,23 @@ void ChunkManager::loadExistingRanges(OperationContext* txn, const ChunkManager*
                   << " based on: "
                   << (oldManager ? oldManager->getVersion().toString() : "(empty)");
 
+            const ChunkMap* validatedChunkMap = oldManager ? &oldManager->_chunkMap : nullptr;
+
             // TODO: Merge into diff code above, so we validate in one place
-            if (isChunkMapValid(chunkMap)) {
+            if (isChunkMapValid(chunkMap, validatedChunkMap)) {
                 _chunkMap.swap(chunkMap);
                 _shardIds.swap(shardIds);
                 _shardVersions.swap(shardVersions);
-                _chunkRangeMap = _constructRanges(_chunkMap);
+                _routingTable =
+                    ChunkRoutingTable(_chunkMap, oldManager ? &oldManager->_routingTable : nullptr);
+
+                const size_t bytesCopied = _chunkMap.bytesCopied() + _routingTable.getBytesBuilt();
+                refreshStats.record(t);
+                refreshBytesCopied.increment(bytesCopied);
+
+                LOG(1) << "ChunkManager: copied or built " << bytesCopied
+                       << " bytes of routing metadata for " << _ns << " with "
+                       << _chunkMap.size() << " chunks";
                 return;
             }
         }
@@ -229,23 +278,9 @@ bool ChunkManager::_load(OperationContext* txn,
         // Load a copy of the old versions
         *shardVersions = oldManager->_shardVersions;
 
-        // Load a copy of the chunk map, replacing the chunk manager with our own
+        // Share the old chunk map, and through it every chunk which did not change
         const ChunkMap& oldChunkMap = oldManager->getChunkMap();
-
-        // Could be v.expensive
-        // TODO: If chunks were immutable and didn't reference the manager, we could do more
-        // interesting things here
-        for (const auto& oldChunkMapEntry : oldChunkMap) {
-            shared_ptr<Chunk> oldC = oldChunkMapEntry.second;
-            shared_ptr<Chunk> newC(new Chunk(this,
-                                             oldC->getMin(),
-                                             oldC->getMax(),
-                                             oldC->getShardId(),
-                                             oldC->getLastmod(),
-                                             oldC->getBytesWritten()));
-
-            chunkMap.insert(make_pair(oldC->getMax(), newC));
-        }
+        chunkMap = oldChunkMap;
 
         LOG(2) << "loading chunk manager for collection " << _ns
                << " using old chunk manager w/ version " << _version.toString() << " and "
@@ -447,22 +482,13 @@ Status ChunkManager::createFirstChunks(OperationContext* txn,
 shared_ptr<Chunk> ChunkManager::findIntersectingChunk(OperationContext* txn,
                                                       const BSONObj& shardKey) const {
     {
-        BSONObj chunkMin;
-        shared_ptr<Chunk> chunk;
-        {
-            ChunkMap::const_iterator it = _chunkMap.upper_bound(shardKey);
-            if (it != _chunkMap.end()) {
-                chunkMin = it->first;
-                chunk = it->second;
-            }
-        }
-
+        shared_ptr<Chunk> chunk = _routingTable.findIntersectingChunk(shardKey);
         if (chunk) {
             if (chunk->containsKey(shardKey)) {
                 return chunk;
             }
 
-            log() << chunkMin;
+            log() << chunk->getMax();
             log() << *chunk;
             log() << shardKey;
 
@@ -531,33 +557,14 @@ void ChunkManager::getShardIdsForQuery(OperationContext* txn,
     // For now, we satisfy that assumption by adding a shard with no matches rather than returning
     // an empty set of shards.
     if (shardIds->empty()) {
-        shardIds->insert(_chunkRangeMap.begin()->second.getShardId());
+        shardIds->insert(_routingTable.getFirstShardId());
     }
 }
 
 void ChunkManager::getShardIdsForRange(set<ShardId>& shardIds,
                                        const BSONObj& min,
                                        const BSONObj& max) const {
-    auto it = _chunkRangeMap.upper_bound(min);
-    auto end = _chunkRangeMap.upper_bound(max);
-
-    // The chunk range map must always cover the entire key space
-    invariant(it != _chunkRangeMap.end());
-
-    // We need to include the last chunk
-    if (end != _chunkRangeMap.cend()) {
-        ++end;
-    }
-
-    for (; it != end; ++it) {
-        shardIds.insert(it->second.getShardId());
-
-        // No need to iterate through the rest of the ranges, because we already know we need to use
-        // all shards.
-        if (shardIds.size() == _shardIds.size()) {
-            break;
-        }
-    }
+    _routingTable.getShardIdsForRange(min, max, &shardIds);
 }
 
 void ChunkManager::getAllShardIds(set<ShardId>* all) const {
@@ -707,43 +714,6 @@ string ChunkManager::toString() const {
     return sb.str();
 }
 
-ChunkManager::ChunkRangeMap ChunkManager::_constructRanges(const ChunkMap& chunkMap) {
-    ChunkRangeMap chunkRangeMap;
-
-    if (chunkMap.empty()) {
-        return chunkRangeMap;
-    }
-
-    ChunkMap::const_iterator current = chunkMap.cbegin();
-
-    while (current != chunkMap.cend()) {
-        const auto rangeFirst = current;
-        current = std::find_if(
-            current, chunkMap.cend(), [&rangeFirst](const ChunkMap::value_type& chunkMapEntry) {
-                return chunkMapEntry.second->getShardId() != rangeFirst->second->getShardId();
-            });
-        const auto rangeLast = std::prev(current);
-
-        const BSONObj rangeMin = rangeFirst->second->getMin();
-        const BSONObj rangeMax = rangeLast->second->getMax();
-
-        auto insertResult = chunkRangeMap.insert(std::make_pair(
-            rangeMax, ShardAndChunkRange(rangeMin, rangeMax, rangeFirst->second->getShardId())));
-        invariant(insertResult.second);
-        if (insertResult.first != chunkRangeMap.begin()) {
-            // Make sure there are no gaps in the ranges
-            insertResult.first--;
-            invariant(insertResult.first->first == rangeMin);
-        }
-    }
-
-    invariant(!chunkRangeMap.empty());
-    invariant(allOfType(MinKey, chunkRangeMap.begin()->second.getMin()));
-    invariant(allOfType(MaxKey, chunkRangeMap.rbegin()->first));
-
-    return chunkRangeMap;
-}
-
 uint64_t ChunkManager::getCurrentDesiredChunkSize() const {
     // split faster in early chunks helps spread out an initial load better
     const uint64_t minChunkSize = 1 << 20;  // 1 MBytes
@@ -36,6 +36,7 @@
 #include "mongo/db/repl/optime.h"
 #include "mongo/s/catalog/type_chunk.h"
 #include "mongo/s/chunk.h"
+#include "mongo/s/chunk_routing_table.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/client/shard.h"
 #include "mongo/s/shard_key_pattern.h"
@@ -52,9 +53,6 @@ class OperationContext;
 
 typedef std::shared_ptr<ChunkManager> ChunkManagerPtr;
 
-// The key for the map is max for each Chunk or ChunkRange
-typedef std::map<BSONObj, std::shared_ptr<Chunk>, BSONObjCmp> ChunkMap;
-
 class ChunkManager {
 public:
     typedef std::map<std::string, ChunkVersion> ShardVersionMap;
@@ -184,40 +182,9 @@ public:
     repl::OpTime getConfigOpTime() const;
 
 private:
-    /**
-     * Represents a range of chunk keys [getMin(), getMax()) and the id of the shard on which they
-     * reside according to the metadata.
-     */
-    class ShardAndChunkRange {
-    public:
-        ShardAndChunkRange(const BSONObj& min, const BSONObj& max, ShardId inShardId)
-            : _range(min, max), _shardId(std::move(inShardId)) {}
-
-        const BSONObj& getMin() const {
-            return _range.getMin();
-        }
-
-        const BSONObj& getMax() const {
-            return _range.getMax();
-        }
-
-        const ShardId& getShardId() const {
-            return _shardId;
-        }
-
-    private:
-        ChunkRange _range;
-        ShardId _shardId;
-    };
-
-    // Contains a compressed map of what range of keys resides on which shard. The index is the max
-    // key of the respective range and the union of all ranges in a such constructed map must cover
-    // the complete space from [MinKey, MaxKey).
-    using ChunkRangeMap = std::map<BSONObj, ShardAndChunkRange, BSONObjCmp>;
-
     /**
      * If load was successful, returns true and it is guaranteed that the _chunkMap and
-     * _chunkRangeMap are consistent with each other. If false is returned, it is not safe to use
+     * _routingTable are consistent with each other. If false is returned, it is not safe to use
      * the chunk manager anymore.
      */
     bool _load(OperationContext* txn,
@@ -226,11 +193,6 @@ private:
                ShardVersionMap* shardVersions,
                const ChunkManager* oldManager);
 
-    /**
-     * Merges consecutive chunks, which reside on the same shard into a single range.
-     */
-    static ChunkRangeMap _constructRanges(const ChunkMap& chunkMap);
-
     // All members should be const for thread-safety
     const std::string _ns;
     const ShardKeyPattern _keyPattern;
@@ -242,7 +204,10 @@ private:
     const unsigned long long _sequenceNumber;
 
     ChunkMap _chunkMap;
-    ChunkRangeMap _chunkRangeMap;
+
+    // Built from _chunkMap once it is loaded and used for all shard key and range lookups. The
+    // union of its ranges covers the complete space from [MinKey, MaxKey).
+    ChunkRoutingTable _routingTable;
 
     std::set<ShardId> _shardIds;
 
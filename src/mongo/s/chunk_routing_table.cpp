@@ -0,0 +1,241 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/chunk_routing_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "mongo/bson/ordering.h"
+#include "mongo/db/storage/key_string.h"
+#include "mongo/s/chunk.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+namespace {
+
+// BSONObjCmp compares keys as if every field were ascending, so the keys are encoded that way too.
+const Ordering kAllAscending = Ordering::make(BSONObj());
+
+}  // namespace
+
+ChunkRoutingTable::ChunkRoutingTable(const ChunkMap& chunkMap, const ChunkRoutingTable* previous) {
+    std::unordered_map<const ChunkMap::Block*, std::shared_ptr<const Segment>> previousSegments;
+    if (previous) {
+        _shardIds = previous->_shardIds;
+        for (const auto& segment : previous->_segments) {
+            previousSegments.emplace(segment->chunks.get(), segment);
+        }
+    }
+
+    std::map<ShardId, uint32_t> shardIndexes;
+    for (uint32_t i = 0; i < _shardIds.size(); ++i) {
+        shardIndexes.emplace(_shardIds[i], i);
+    }
+
+    _segments.reserve(chunkMap.numBlocks());
+
+    for (size_t i = 0; i < chunkMap.numBlocks(); ++i) {
+        auto block = chunkMap.getBlock(i);
+
+        auto it = previousSegments.find(block.get());
+        if (it != previousSegments.end()) {
+            _segments.push_back(it->second);
+            continue;
+        }
+
+        auto segment = std::make_shared<Segment>();
+        segment->chunks = std::move(block);
+
+        const ChunkMap::Block& chunks = *segment->chunks;
+        for (size_t pos = 0; pos < chunks.size(); ++pos) {
+            const auto& chunk = chunks[pos].second;
+            const KeyString chunkMax(KeyString::Version::V1, chunks[pos].first, kAllAscending);
+
+            segment->chunkMaxes.push_back(chunkMax);
+
+            auto shardIt = shardIndexes.find(chunk->getShardId());
+            if (shardIt == shardIndexes.end()) {
+                shardIt = shardIndexes.emplace(chunk->getShardId(), _shardIds.size()).first;
+                _shardIds.push_back(chunk->getShardId());
+            }
+
+            // A range ends at the last chunk before a chunk on a different shard, or at the end of
+            // the segment.
+            if (pos + 1 == chunks.size() ||
+                chunks[pos + 1].second->getShardId() != chunk->getShardId()) {
+                segment->rangeMaxes.push_back(chunkMax);
+                segment->rangeShards.push_back(shardIt->second);
+            }
+        }
+
+        segment->shards = segment->rangeShards;
+        std::sort(segment->shards.begin(), segment->shards.end());
+        segment->shards.erase(std::unique(segment->shards.begin(), segment->shards.end()),
+                              segment->shards.end());
+
+        _bytesBuilt += segment->chunkMaxes.getApproximateSize() +
+            segment->rangeMaxes.getApproximateSize() +
+            (segment->rangeShards.size() + segment->shards.size()) * sizeof(uint32_t);
+
+        _segments.push_back(std::move(segment));
+    }
+
+    std::vector<bool> ownsChunks(_shardIds.size(), false);
+    for (const auto& segment : _segments) {
+        _numChunks += segment->chunks->size();
+        _numRanges += segment->rangeMaxes.size();
+
+        for (uint32_t shardIndex : segment->shards) {
+            if (!ownsChunks[shardIndex]) {
+                ownsChunks[shardIndex] = true;
+                ++_numShards;
+            }
+        }
+    }
+
+    _bytesBuilt += _segments.size() * sizeof(_segments[0]) + _shardIds.size() * sizeof(ShardId);
+}
+
+std::shared_ptr<Chunk> ChunkRoutingTable::findIntersectingChunk(const BSONObj& shardKey) const {
+    const KeyString key(KeyString::Version::V1, shardKey, kAllAscending);
+
+    const size_t segment = _findSegment(key);
+    if (segment == _segments.size()) {
+        return nullptr;
+    }
+
+    const size_t pos = _segments[segment]->chunkMaxes.upperBound(key);
+    return (*_segments[segment]->chunks)[pos].second;
+}
+
+void ChunkRoutingTable::getShardIdsForRange(const BSONObj& min,
+                                            const BSONObj& max,
+                                            std::set<ShardId>* shardIds) const {
+    const KeyString minKey(KeyString::Version::V1, min, kAllAscending);
+    const KeyString maxKey(KeyString::Version::V1, max, kAllAscending);
+
+    size_t segment = _findSegment(minKey);
+
+    // The ranges must always cover the entire key space
+    invariant(segment != _segments.size());
+
+    size_t pos = _segments[segment]->rangeMaxes.upperBound(minKey);
+
+    // Visit every range up to and including the one which contains 'max', or all of them if none
+    // does.
+    size_t lastSegment = _findSegment(maxKey);
+    size_t lastPos;
+    if (lastSegment == _segments.size()) {
+        lastSegment = _segments.size() - 1;
+        lastPos = _segments[lastSegment]->rangeMaxes.size() - 1;
+    } else {
+        lastPos = _segments[lastSegment]->rangeMaxes.upperBound(maxKey);
+    }
+
+    std::vector<bool> seen(_shardIds.size(), false);
+    size_t numSeen = 0;
+
+    for (; segment <= lastSegment; ++segment, pos = 0) {
+        const Segment& current = *_segments[segment];
+        const size_t end = (segment == lastSegment) ? lastPos + 1 : current.rangeShards.size();
+
+        for (; pos < end; ++pos) {
+            const uint32_t shardIndex = current.rangeShards[pos];
+            if (seen[shardIndex]) {
+                continue;
+            }
+
+            seen[shardIndex] = true;
+            shardIds->insert(_shardIds[shardIndex]);
+
+            // No need to look at the rest of the ranges, because we already know we need to use
+            // all shards.
+            if (++numSeen == _numShards) {
+                return;
+            }
+        }
+    }
+}
+
+const ShardId& ChunkRoutingTable::getFirstShardId() const {
+    invariant(!_segments.empty());
+    return _shardIds[_segments.front()->rangeShards.front()];
+}
+
+size_t ChunkRoutingTable::_findSegment(const KeyString& key) const {
+    const auto it = std::partition_point(
+        _segments.begin(), _segments.end(), [&key](const std::shared_ptr<const Segment>& segment) {
+            return !segment->chunkMaxes.isLessThanBack(key);
+        });
+    return it - _segments.begin();
+}
+
+void ChunkRoutingTable::KeyArray::push_back(const KeyString& key) {
+    invariant(_data.size() + key.getSize() <= std::numeric_limits<uint32_t>::max());
+    _data.append(key.getBuffer(), key.getSize());
+    _ends.push_back(static_cast<uint32_t>(_data.size()));
+}
+
+size_t ChunkRoutingTable::KeyArray::upperBound(const KeyString& key) const {
+    size_t low = 0;
+    size_t high = _ends.size();
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (_compare(key, mid) < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+bool ChunkRoutingTable::KeyArray::isLessThanBack(const KeyString& key) const {
+    return _compare(key, _ends.size() - 1) < 0;
+}
+
+int ChunkRoutingTable::KeyArray::_compare(const KeyString& key, size_t i) const {
+    const uint32_t begin = i == 0 ? 0 : _ends[i - 1];
+    const size_t size = _ends[i] - begin;
+
+    // Bytewise, and a key sorts before every key it is a proper prefix of.
+    const int cmp =
+        std::memcmp(key.getBuffer(), _data.data() + begin, std::min(key.getSize(), size));
+    if (cmp != 0) {
+        return cmp;
+    }
+    return key.getSize() < size ? -1 : (key.getSize() > size ? 1 : 0);
+}
+
+}  // namespace mongo
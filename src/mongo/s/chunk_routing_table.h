@@ -0,0 +1,203 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/s/client/shard.h"
+#include "mongo/util/persistent_sorted_map.h"
+
+namespace mongo {
+
+class Chunk;
+class KeyString;
+
+// The key for the map is max for each Chunk or ChunkRange. Copies of a ChunkMap share both their
+// entries and the chunks themselves.
+typedef PersistentSortedMap<BSONObj, std::shared_ptr<Chunk>, BSONObjCmp> ChunkMap;
+
+/**
+ * Read-only routing structure built from a ChunkMap, used by the ChunkManager to map shard keys to
+ * chunks and key ranges to shards.
+ *
+ * The max bound of every chunk is stored KeyString-encoded in contiguous buffers, in ascending
+ * order, so a lookup is a binary search of memcmp comparisons over those buffers instead of a walk
+ * down a tree of BSONObjs compared field by field. Consecutive chunks which reside on the same
+ * shard are additionally collapsed into ranges, each of which carries a small integer index into
+ * the table's list of distinct shard ids.
+ *
+ * The table is made of one segment per block of entries of the ChunkMap it was built from. When
+ * a table is built for a copy of a ChunkMap, the segments for the blocks which the copy shares
+ * with the original are taken from the original's table instead of being built again.
+ *
+ * Keys are encoded with an all-ascending ordering, which matches the ordering of the ChunkMap
+ * (BSONObjCmp) regardless of the direction of the shard key fields.
+ */
+class ChunkRoutingTable {
+public:
+    ChunkRoutingTable() = default;
+
+    /**
+     * Builds the routing table for the chunks in 'chunkMap', which must cover the whole key space
+     * without gaps or overlaps. The parts of 'previous', if given, which were built from blocks of
+     * entries that 'chunkMap' still holds are reused.
+     */
+    explicit ChunkRoutingTable(const ChunkMap& chunkMap,
+                               const ChunkRoutingTable* previous = nullptr);
+
+    /**
+     * Returns the chunk with the smallest max bound which is greater than 'shardKey', or nullptr
+     * if there is no such chunk. This is the only chunk which may contain 'shardKey'.
+     */
+    std::shared_ptr<Chunk> findIntersectingChunk(const BSONObj& shardKey) const;
+
+    /**
+     * Adds to 'shardIds' the ids of the shards owning any chunk which intersects [min, max]. The
+     * table must not be empty.
+     */
+    void getShardIdsForRange(const BSONObj& min,
+                             const BSONObj& max,
+                             std::set<ShardId>* shardIds) const;
+
+    /**
+     * Returns the id of the shard which owns the chunk with the smallest keys. The table must not
+     * be empty.
+     */
+    const ShardId& getFirstShardId() const;
+
+    bool empty() const {
+        return _numChunks == 0;
+    }
+
+    size_t numChunks() const {
+        return _numChunks;
+    }
+
+    /**
+     * Returns the number of ranges of consecutive chunks residing on the same shard.
+     */
+    size_t numRanges() const {
+        return _numRanges;
+    }
+
+    /**
+     * Returns the approximate number of bytes of routing information which the constructor built,
+     * as opposed to reused from the previous table.
+     */
+    size_t getBytesBuilt() const {
+        return _bytesBuilt;
+    }
+
+private:
+    /**
+     * An ascending sequence of KeyString-encoded keys, stored back to back in one buffer.
+     */
+    class KeyArray {
+    public:
+        void push_back(const KeyString& key);
+
+        /**
+         * Returns the position of the first key which is greater than 'key', or size() if there
+         * is none.
+         */
+        size_t upperBound(const KeyString& key) const;
+
+        /**
+         * Returns whether 'key' is less than the last key of the array, which must not be empty.
+         */
+        bool isLessThanBack(const KeyString& key) const;
+
+        size_t size() const {
+            return _ends.size();
+        }
+
+        size_t getApproximateSize() const {
+            return _data.size() + _ends.size() * sizeof(uint32_t);
+        }
+
+    private:
+        /**
+         * Compares 'key' with the key at position 'i', with the same result as KeyString::compare.
+         */
+        int _compare(const KeyString& key, size_t i) const;
+
+        std::string _data;
+
+        // The end offset within '_data' of each key. Each key begins where the previous one ends.
+        std::vector<uint32_t> _ends;
+    };
+
+    /**
+     * The routing information for the chunks in one block of entries of a ChunkMap.
+     */
+    struct Segment {
+        // The block this segment was built from, which holds its chunks in key order.
+        std::shared_ptr<const ChunkMap::Block> chunks;
+
+        // Max bound of each chunk, at the position of the chunk in 'chunks'.
+        KeyArray chunkMaxes;
+
+        // Max bound of each range of same-shard chunks, and the index into the table's shard ids
+        // of the shard owning the range at the same position.
+        KeyArray rangeMaxes;
+        std::vector<uint32_t> rangeShards;
+
+        // The distinct indexes in 'rangeShards'.
+        std::vector<uint32_t> shards;
+    };
+
+    /**
+     * Returns the position of the first segment whose last chunk has a max bound greater than
+     * 'key', or the number of segments if there is none.
+     */
+    size_t _findSegment(const KeyString& key) const;
+
+    std::vector<std::shared_ptr<const Segment>> _segments;
+
+    // Each distinct shard id owning chunks, in order of first appearance. A table built from a
+    // previous one starts with the previous table's shard ids, so that the segments it reuses
+    // refer to the same shards.
+    std::vector<ShardId> _shardIds;
+
+    size_t _numChunks = 0;
+    size_t _numRanges = 0;
+
+    // The number of distinct shards owning chunks in this table, which may be less than the
+    // number of shard ids if some shards no longer own any.
+    size_t _numShards = 0;
+
+    size_t _bytesBuilt = 0;
+};
+
+}  // namespace mongo
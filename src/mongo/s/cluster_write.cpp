@@ -143,7 +143,7 @@ void splitIfNeeded(OperationContext* txn, const NamespaceString& nss, const Targ
             return;
         }
 
-        chunk->splitIfShould(txn, it->second);
+        chunk->splitIfShould(txn, chunkManager.get(), it->second);
     }
 }
 
@@ -176,7 +176,8 @@ public:
         if (ok) {
             // check whether split is necessary (using update object for size heuristic)
             if (mongosGlobalParams.shouldAutoSplit) {
-                chunk->splitIfShould(txn, cmdObj.getObjectField("update").objsize());
+                chunk->splitIfShould(
+                    txn, chunkMgr.get(), cmdObj.getObjectField("update").objsize());
             }
         }
 
@@ -32,6 +32,7 @@
 #include "mongo/db/wire_version.h"
 #include "mongo/s/grid.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compressor_manager.h"
 
 namespace mongo {
 namespace {
@@ -77,6 +78,8 @@ public:
         result.append("maxWireVersion", WireSpec::instance().maxWireVersionIncoming);
         result.append("minWireVersion", WireSpec::instance().minWireVersionIncoming);
 
+        MessageCompressorManager::serverNegotiate(cmdObj, &result);
+
         return true;
     }
 
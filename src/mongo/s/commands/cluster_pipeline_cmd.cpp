@@ -42,6 +42,8 @@
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/query/cursor_response.h"
+#include "mongo/db/query/find_common.h"
 #include "mongo/executor/task_executor_pool.h"
 #include "mongo/platform/random.h"
 #include "mongo/rpc/get_status_from_command_result.h"
@@ -53,6 +55,8 @@
 #include "mongo/s/commands/sharded_command_processing.h"
 #include "mongo/s/config.h"
 #include "mongo/s/grid.h"
+#include "mongo/s/query/cluster_client_cursor_impl.h"
+#include "mongo/s/query/cluster_cursor_manager.h"
 #include "mongo/s/query/store_possible_cursor.h"
 #include "mongo/s/stale_exception.h"
 #include "mongo/util/log.h"
@@ -67,6 +71,13 @@ using std::vector;
 
 namespace {
 
+// Same as the default batch size of an aggregation cursor on mongod.
+const long long kDefaultBatchSize = 101;
+
+// Upper bound on the space, in addition to the document itself, taken up by each document of a
+// batch once it is added to the response.
+const int kPerDocumentOverheadBytesUpperBound = 10;
+
 /**
  * Implements the aggregation (pipeline command for sharding).
  */
@@ -154,12 +165,20 @@ public:
         // 'pipeline' will become the merger side.
         intrusive_ptr<Pipeline> shardPipeline(needSplit ? pipeline->splitForSharded() : pipeline);
 
+        // Unless the merger side needs to run on a shard, this mongos runs it itself, reading the
+        // shards' cursors directly instead of through another shard.
+        const bool mergeOnRouter =
+            needSplit && !needPrimaryShardMerger && pipeline->canRunOnRouter();
+
         // Create the command for the shards. The 'fromRouter' field means produce output to
-        // be merged.
+        // be merged, and the 'mergeOnRouter' field that it is merged by this mongos.
         MutableDocument commandBuilder(shardPipeline->serialize());
         if (needSplit) {
             commandBuilder.setField("fromRouter", Value(true));
             commandBuilder.setField("cursor", Value(DOC("batchSize" << 0)));
+            if (mergeOnRouter) {
+                commandBuilder.setField("mergeOnRouter", Value(true));
+            }
         } else {
             commandBuilder.setField("cursor", Value(cmdObj["cursor"]));
         }
@@ -185,7 +204,8 @@ public:
             uassertAllShardsSupportExplain(shardResults);
 
             if (needSplit) {
-                result << "needsPrimaryShardMerger" << needPrimaryShardMerger << "splitPipeline"
+                result << "needsPrimaryShardMerger" << needPrimaryShardMerger << "mergeOnRouter"
+                       << mergeOnRouter << "splitPipeline"
                        << DOC("shardsPart" << shardPipeline->writeExplainOps() << "mergerPart"
                                            << pipeline->writeExplainOps());
             } else {
@@ -215,6 +235,11 @@ public:
             return reply["ok"].trueValue();
         }
 
+        if (mergeOnRouter) {
+            return runMergeOnRouter(
+                txn, NamespaceString(fullns), pipeline, shardResults, cmdObj, result);
+        }
+
         pipeline->addInitialSource(
             DocumentSourceMergeCursors::create(parseCursors(shardResults), mergeCtx));
 
@@ -266,6 +291,18 @@ private:
     std::vector<DocumentSourceMergeCursors::CursorDescriptor> parseCursors(
         const vector<Strategy::CommandResult>& shardResults);
 
+    /**
+     * Runs 'mergePipeline' on this mongos over the cursors the shards established. Returns the
+     * first batch of results to the client, and registers a mongos cursor for the rest. If the
+     * client did not ask for a cursor, returns all of the results instead.
+     */
+    bool runMergeOnRouter(OperationContext* txn,
+                          const NamespaceString& nss,
+                          intrusive_ptr<Pipeline> mergePipeline,
+                          const vector<Strategy::CommandResult>& shardResults,
+                          const BSONObj& cmdObj,
+                          BSONObjBuilder& result);
+
     void killAllCursors(const vector<Strategy::CommandResult>& shardResults);
     void uassertAllShardsSupportExplain(const vector<Strategy::CommandResult>& shardResults);
 
@@ -338,6 +375,77 @@ std::vector<DocumentSourceMergeCursors::CursorDescriptor> PipelineCommand::parse
     }
 }
 
+bool PipelineCommand::runMergeOnRouter(OperationContext* txn,
+                                       const NamespaceString& nss,
+                                       intrusive_ptr<Pipeline> mergePipeline,
+                                       const vector<Strategy::CommandResult>& shardResults,
+                                       const BSONObj& cmdObj,
+                                       BSONObjBuilder& result) {
+    const bool isCursorCommand = !cmdObj["cursor"].eoo();
+    long long batchSize = kDefaultBatchSize;
+    if (isCursorCommand) {
+        uassertStatusOK(Command::parseCommandCursorOptions(cmdObj, kDefaultBatchSize, &batchSize));
+    }
+
+    // If the shards sorted their output, the AsyncResultsMerger merges it by the sort keys they
+    // attached to each document.
+    ClusterClientCursorParams params(nss);
+    params.sort = mergePipeline->getMergeSortPattern();
+    params.mergePipeline = std::move(mergePipeline);
+    for (auto&& cursor : parseCursors(shardResults)) {
+        params.remotes.emplace_back(cursor.connectionString.getServers()[0], cursor.cursorId);
+    }
+
+    auto ccc = ClusterClientCursorImpl::make(grid.getExecutorPool()->getArbitraryExecutor(),
+                                             std::move(params));
+
+    if (!isCursorCommand) {
+        BSONArrayBuilder resultArray;
+        while (auto next = uassertStatusOK(ccc->next())) {
+            resultArray.append(*next);
+            uassert(16389,
+                    str::stream() << "aggregation result exceeds maximum document size ("
+                                  << BSONObjMaxUserSize / (1024 * 1024)
+                                  << "MB)",
+                    resultArray.len() < BSONObjMaxUserSize - 1024);
+        }
+        result.appendArray("result", resultArray.arr());
+        return true;
+    }
+
+    std::vector<BSONObj> batch;
+    int bytesBuffered = 0;
+    auto cursorState = ClusterCursorManager::CursorState::NotExhausted;
+    while (static_cast<long long>(batch.size()) < batchSize) {
+        auto next = uassertStatusOK(ccc->next());
+        if (!next) {
+            cursorState = ClusterCursorManager::CursorState::Exhausted;
+            break;
+        }
+
+        if (!FindCommon::haveSpaceForNext(*next, batch.size(), bytesBuffered)) {
+            ccc->queueResult(*next);
+            break;
+        }
+
+        bytesBuffered += (next->objsize() + kPerDocumentOverheadBytesUpperBound);
+        batch.push_back(std::move(*next));
+    }
+
+    CursorId cursorId = 0;
+    if (cursorState == ClusterCursorManager::CursorState::NotExhausted) {
+        cursorId = uassertStatusOK(grid.getCursorManager()->registerCursor(
+            ccc.releaseCursor(),
+            nss,
+            ClusterCursorManager::CursorType::NamespaceSharded,
+            ClusterCursorManager::CursorLifetime::Mortal));
+    }
+
+    CursorResponse(nss, cursorId, std::move(batch))
+        .addToBSON(CursorResponse::ResponseType::InitialResponse, &result);
+    return true;
+}
+
 void PipelineCommand::uassertAllShardsSupportExplain(
     const vector<Strategy::CommandResult>& shardResults) {
     for (size_t i = 0; i < shardResults.size(); i++) {
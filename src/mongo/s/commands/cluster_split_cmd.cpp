@@ -252,7 +252,7 @@ public:
 
         BSONObj res;
         if (middle.isEmpty()) {
-            uassertStatusOK(chunk->split(txn, Chunk::atMedian, nullptr));
+            uassertStatusOK(chunk->split(txn, info.get(), Chunk::atMedian, nullptr));
         } else {
             uassertStatusOK(shardutil::splitChunkAtMultiplePoints(txn,
                                                                   chunk->getShardId(),
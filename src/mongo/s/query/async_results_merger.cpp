@@ -32,7 +32,11 @@
 
 #include "mongo/s/query/async_results_merger.h"
 
+#include <algorithm>
+
+#include "mongo/base/counter.h"
 #include "mongo/client/remote_command_targeter.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/query/cursor_response.h"
 #include "mongo/db/query/getmore_request.h"
 #include "mongo/db/query/killcursors_request.h"
@@ -51,6 +55,34 @@ namespace {
 // Maximum number of retries for network and replication notMaster errors (per host).
 const int kMaxNumFailedHostRetryAttempts = 3;
 
+// Bounds on the batchSize chosen for getMores when read-ahead is enabled. A read-ahead getMore may
+// ask for fewer documents than the lower bound if no more fit in the budget.
+const long long kMinAdaptiveBatchSize = 16;
+const long long kMaxAdaptiveBatchSize = 100 * 1000;
+
+// A remote which responds slower than the average of all remotes is given at most this many times
+// its even share of the read-ahead budget.
+const long long kMaxRoundTripShareFactor = 4;
+
+// Totals over all ARMs, reported in serverStatus.
+Counter64 totalBufferedBytes;
+Counter64 totalReadAheadGetMores;
+Counter64 totalStallMillis;
+
+ServerStatusMetricField<Counter64> displayBufferedBytes("cursor.readAhead.bufferedBytes",
+                                                        &totalBufferedBytes);
+ServerStatusMetricField<Counter64> displayReadAheadGetMores("cursor.readAhead.getMores",
+                                                            &totalReadAheadGetMores);
+ServerStatusMetricField<Counter64> displayStallMillis("cursor.readAhead.stallMillis",
+                                                      &totalStallMillis);
+
+/**
+ * Folds 'sample' into the moving average 'avg', giving the most recent sample a weight of 1/4.
+ */
+long long updateMovingAverage(long long avg, long long sample) {
+    return avg ? (3 * avg + sample) / 4 : sample;
+}
+
 }  // namespace
 
 AsyncResultsMerger::AsyncResultsMerger(executor::TaskExecutor* executor,
@@ -85,6 +117,13 @@ AsyncResultsMerger::AsyncResultsMerger(executor::TaskExecutor* executor,
 AsyncResultsMerger::~AsyncResultsMerger() {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
     invariant(remotesExhausted_inlock() || _lifecycleState == kKillComplete);
+
+    totalBufferedBytes.decrement(_readAheadStats.bufferedBytes);
+    if (_readAheadStats.readAheadGetMores || _readAheadStats.stallTime > Milliseconds(0)) {
+        LOG(1) << "Cursor on " << _params.nsString << " over " << _remotes.size()
+               << " remotes issued " << _readAheadStats.readAheadGetMores
+               << " read-ahead getMores and stalled for " << _readAheadStats.stallTime;
+    }
 }
 
 bool AsyncResultsMerger::remotesExhausted() {
@@ -211,8 +250,7 @@ boost::optional<BSONObj> AsyncResultsMerger::nextReadySorted() {
     invariant(!_remotes[smallestRemote].docBuffer.empty());
     invariant(_remotes[smallestRemote].status.isOK());
 
-    BSONObj front = _remotes[smallestRemote].docBuffer.front();
-    _remotes[smallestRemote].docBuffer.pop();
+    BSONObj front = popFromBuffer_inlock(smallestRemote);
 
     // Re-populate the merging queue with the next result from 'smallestRemote', if it has a
     // next result.
@@ -230,8 +268,7 @@ boost::optional<BSONObj> AsyncResultsMerger::nextReadyUnsorted() {
         invariant(_remotes[_gettingFromRemote].status.isOK());
 
         if (_remotes[_gettingFromRemote].hasNext()) {
-            BSONObj front = _remotes[_gettingFromRemote].docBuffer.front();
-            _remotes[_gettingFromRemote].docBuffer.pop();
+            BSONObj front = popFromBuffer_inlock(_gettingFromRemote);
 
             if (_params.isTailable && !_remotes[_gettingFromRemote].hasNext()) {
                 // The cursor is tailable and we're about to return the last buffered result. This
@@ -253,7 +290,21 @@ boost::optional<BSONObj> AsyncResultsMerger::nextReadyUnsorted() {
     return boost::none;
 }
 
-Status AsyncResultsMerger::askForNextBatch_inlock(size_t remoteIndex) {
+BSONObj AsyncResultsMerger::popFromBuffer_inlock(size_t remoteIndex) {
+    auto& remote = _remotes[remoteIndex];
+    BSONObj front = remote.docBuffer.front();
+    remote.docBuffer.pop();
+
+    remote.bufferedBytes -= front.objsize();
+    _readAheadStats.bufferedBytes -= front.objsize();
+    totalBufferedBytes.decrement(front.objsize());
+
+    // Consuming a result may have made room in the read-ahead budget.
+    scheduleReadAhead_inlock();
+    return front;
+}
+
+Status AsyncResultsMerger::askForNextBatch_inlock(size_t remoteIndex, bool isReadAhead) {
     auto& remote = _remotes[remoteIndex];
 
     invariant(!remote.cbHandle.isValid());
@@ -263,6 +314,7 @@ Status AsyncResultsMerger::askForNextBatch_inlock(size_t remoteIndex) {
     // a full sort as is the case for the OP_QUERY find then this optimization will prevent
     // switching to the full sort plan branch.
     BSONObj cmdObj;
+    long long requestedBytes = 0;
 
     if (remote.cursorId) {
         auto adjustedBatchSize = _params.batchSize;
@@ -271,6 +323,23 @@ Status AsyncResultsMerger::askForNextBatch_inlock(size_t remoteIndex) {
             adjustedBatchSize = *_params.batchSize - remote.fetchedCount;
         }
 
+        if (readAheadEnabled_inlock()) {
+            const auto budgetBatchSize = adaptiveBatchSize_inlock(remote, isReadAhead);
+            if (isReadAhead) {
+                // A read-ahead getMore is capped by the budget, even if the client asked for more.
+                invariant(budgetBatchSize);
+                adjustedBatchSize = adjustedBatchSize
+                    ? std::min(*adjustedBatchSize, *budgetBatchSize)
+                    : *budgetBatchSize;
+            } else if (!_params.batchSize) {
+                adjustedBatchSize = budgetBatchSize;
+            }
+
+            if (adjustedBatchSize) {
+                requestedBytes = *adjustedBatchSize * remote.avgObjSize;
+            }
+        }
+
         cmdObj = GetMoreRequest(_params.nsString,
                                 *remote.cursorId,
                                 adjustedBatchSize,
@@ -302,9 +371,105 @@ Status AsyncResultsMerger::askForNextBatch_inlock(size_t remoteIndex) {
     }
 
     remote.cbHandle = callbackStatus.getValue();
+    remote.requestedBytes = requestedBytes;
+    _requestedBytes += requestedBytes;
     return Status::OK();
 }
 
+bool AsyncResultsMerger::readAheadEnabled_inlock() const {
+    return _params.readAheadMaxBufferedBytes && *_params.readAheadMaxBufferedBytes > 0 &&
+        !_params.isTailable;
+}
+
+void AsyncResultsMerger::scheduleReadAhead_inlock() {
+    if (!readAheadEnabled_inlock() || _lifecycleState != kAlive || !_status.isOK()) {
+        return;
+    }
+
+    for (size_t i = 0; i < _remotes.size(); ++i) {
+        if (_readAheadStats.bufferedBytes + _requestedBytes >=
+            *_params.readAheadMaxBufferedBytes) {
+            return;
+        }
+
+        auto& remote = _remotes[i];
+        if (!remote.status.isOK()) {
+            // The error will be reported by the next call to nextReady().
+            return;
+        }
+
+        // A read-ahead getMore is sized from the remote's documents, so none is scheduled until
+        // the remote has returned some.
+        if (!remote.cursorId || remote.exhausted() || remote.cbHandle.isValid() ||
+            !remote.avgObjSize) {
+            continue;
+        }
+
+        remote.status = askForNextBatch_inlock(i, true /* isReadAhead */);
+        if (!remote.status.isOK()) {
+            return;
+        }
+
+        ++_readAheadStats.readAheadGetMores;
+        totalReadAheadGetMores.increment();
+    }
+}
+
+long long AsyncResultsMerger::budgetShareBytes_inlock(const RemoteCursorData& remote) const {
+    long long roundTripSamples = 0;
+    Milliseconds totalRoundTrip{0};
+    for (const auto& other : _remotes) {
+        if (!other.exhausted() && other.avgObjSize) {
+            ++roundTripSamples;
+            totalRoundTrip += other.avgRoundTrip;
+        }
+    }
+
+    // Larger batches from slow remotes make them less likely to hold up a sorted merge.
+    const long long avgRoundTripMillis = roundTripSamples
+        ? std::max(durationCount<Milliseconds>(totalRoundTrip) / roundTripSamples, 1LL)
+        : 0;
+    auto weight = [avgRoundTripMillis](const RemoteCursorData& r) {
+        if (!avgRoundTripMillis || !r.avgObjSize) {
+            return 1LL;
+        }
+        return std::max(1LL,
+                        std::min(durationCount<Milliseconds>(r.avgRoundTrip) / avgRoundTripMillis,
+                                 kMaxRoundTripShareFactor));
+    };
+
+    long long totalWeight = 0;
+    for (const auto& other : _remotes) {
+        if (!other.exhausted()) {
+            totalWeight += weight(other);
+        }
+    }
+
+    return *_params.readAheadMaxBufferedBytes * weight(remote) / std::max(totalWeight, 1LL);
+}
+
+boost::optional<long long> AsyncResultsMerger::adaptiveBatchSize_inlock(
+    const RemoteCursorData& remote, bool isReadAhead) const {
+    if (!remote.avgObjSize) {
+        return boost::none;
+    }
+
+    long long shareBytes = budgetShareBytes_inlock(remote);
+    if (!isReadAhead) {
+        // The caller is waiting for these results, so the budget already in use does not hold
+        // them back.
+        return std::max(kMinAdaptiveBatchSize,
+                        std::min(shareBytes / remote.avgObjSize, kMaxAdaptiveBatchSize));
+    }
+
+    // The share may not exceed what is left of the budget once the results already buffered, and
+    // those expected from the getMores already outstanding, are accounted for.
+    const long long remainingBytes =
+        *_params.readAheadMaxBufferedBytes - _readAheadStats.bufferedBytes - _requestedBytes;
+    shareBytes = std::min(shareBytes, remainingBytes);
+    return std::max(1LL, std::min(shareBytes / remote.avgObjSize, kMaxAdaptiveBatchSize));
+}
+
 StatusWith<executor::TaskExecutor::EventHandle> AsyncResultsMerger::nextEvent() {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
 
@@ -345,6 +510,7 @@ StatusWith<executor::TaskExecutor::EventHandle> AsyncResultsMerger::nextEvent()
     }
     auto eventToReturn = eventStatus.getValue();
     _currentEvent = eventToReturn;
+    _currentEventStart = _executor->now();
 
     // It's possible that after we told the caller we had no ready results but before the call to
     // this method, new results became available. In this case we have to signal the event right
@@ -384,6 +550,8 @@ void AsyncResultsMerger::handleBatchResponse(
     // Clear the callback handle. This indicates that we are no longer waiting on a response from
     // 'remote'.
     remote.cbHandle = executor::TaskExecutor::CallbackHandle();
+    _requestedBytes -= remote.requestedBytes;
+    remote.requestedBytes = 0;
 
     // If we're in the process of shutting down then there's no need to process the batch.
     if (_lifecycleState != kAlive) {
@@ -473,6 +641,9 @@ void AsyncResultsMerger::handleBatchResponse(
             // Clear the results buffer and cursor id.
             std::queue<BSONObj> emptyBuffer;
             std::swap(remote.docBuffer, emptyBuffer);
+            _readAheadStats.bufferedBytes -= remote.bufferedBytes;
+            totalBufferedBytes.decrement(remote.bufferedBytes);
+            remote.bufferedBytes = 0;
             remote.cursorId = 0;
         }
 
@@ -484,6 +655,10 @@ void AsyncResultsMerger::handleBatchResponse(
     remote.cursorId = cursorResponse.getCursorId();
     remote.initialCmdObj = boost::none;
 
+    // A read-ahead batch may arrive while the remote is still on the merge queue.
+    const bool wasBuffering = remote.hasNext();
+    long long batchBytes = 0;
+
     for (const auto& obj : cursorResponse.getBatch()) {
         // If there's a sort, we're expecting the remote node to give us back a sort key.
         if (!_params.sort.isEmpty() &&
@@ -498,11 +673,26 @@ void AsyncResultsMerger::handleBatchResponse(
 
         remote.docBuffer.push(obj);
         ++remote.fetchedCount;
+        batchBytes += obj.objsize();
+    }
+
+    remote.bufferedBytes += batchBytes;
+    _readAheadStats.bufferedBytes += batchBytes;
+    totalBufferedBytes.increment(batchBytes);
+
+    if (!cursorResponse.getBatch().empty()) {
+        const long long batchCount = cursorResponse.getBatch().size();
+        remote.avgObjSize =
+            std::max(updateMovingAverage(remote.avgObjSize, batchBytes / batchCount), 1LL);
+        remote.avgRoundTrip = Milliseconds(
+            updateMovingAverage(durationCount<Milliseconds>(remote.avgRoundTrip),
+                                durationCount<Milliseconds>(
+                                    cbData.response.getValue().elapsedMillis)));
     }
 
     // If we're doing a sorted merge, then we have to make sure to put this remote onto the
     // merge queue.
-    if (!_params.sort.isEmpty() && !cursorResponse.getBatch().empty()) {
+    if (!_params.sort.isEmpty() && !cursorResponse.getBatch().empty() && !wasBuffering) {
         _mergeQueue.push(remoteIndex);
     }
 
@@ -524,6 +714,8 @@ void AsyncResultsMerger::handleBatchResponse(
         }
     }
 
+    scheduleReadAhead_inlock();
+
     // ScopeGuard requires dismiss on success, but we want waiter to be signalled on success as
     // well as failure.
     signaller.Dismiss();
@@ -532,6 +724,10 @@ void AsyncResultsMerger::handleBatchResponse(
 
 void AsyncResultsMerger::signalCurrentEventIfReady_inlock() {
     if (ready_inlock() && _currentEvent.isValid()) {
+        const Milliseconds stallTime = _executor->now() - _currentEventStart;
+        _readAheadStats.stallTime += stallTime;
+        totalStallMillis.increment(durationCount<Milliseconds>(stallTime));
+
         // To prevent ourselves from signalling the event twice, we set '_currentEvent' as
         // invalid after signalling it.
         _executor->signalEvent(_currentEvent);
@@ -608,6 +804,11 @@ executor::TaskExecutor::EventHandle AsyncResultsMerger::kill() {
     return _killCursorsScheduledEvent;
 }
 
+AsyncResultsMerger::ReadAheadStats AsyncResultsMerger::getReadAheadStats() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _readAheadStats;
+}
+
 //
 // AsyncResultsMerger::RemoteCursorData
 //
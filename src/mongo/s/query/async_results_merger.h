@@ -64,6 +64,13 @@ class CursorResponse;
  * This requires waiting until we have a response from every remote before returning results.
  * Without a sort, we are ready to return results as soon as we have *any* response from a remote.
  *
+ * By default, a getMore is only sent to a remote once all of its buffered results have been
+ * returned and the caller asks for more. If 'readAheadMaxBufferedBytes' is set, the next batch is
+ * requested from each remote as soon as its previous batch arrives, for as long as the buffered
+ * results fit in that many bytes, so that a sorted merge is less often held up by its slowest
+ * remote. The batchSize of these read-ahead getMores is capped so that the results they are
+ * expected to return fit in what is left of that budget.
+ *
  * On any error, the caller is responsible for shutting down the ARM using the kill() method.
  *
  * Does not throw exceptions.
@@ -72,6 +79,18 @@ class AsyncResultsMerger {
     MONGO_DISALLOW_COPYING(AsyncResultsMerger);
 
 public:
+    struct ReadAheadStats {
+        // Size in bytes of the results currently buffered from all of the remotes.
+        long long bufferedBytes = 0;
+
+        // Number of getMores scheduled by read-ahead, ahead of the caller needing their results.
+        long long readAheadGetMores = 0;
+
+        // Total time spent between a call to nextEvent() and the signaling of the returned event,
+        // i.e. time the caller may have spent blocked waiting on the remotes.
+        Milliseconds stallTime{0};
+    };
+
     /**
      * Constructs a new AsyncResultsMerger. The TaskExecutor* must remain valid for the lifetime of
      * the ARM.
@@ -163,6 +182,11 @@ public:
      */
     executor::TaskExecutor::EventHandle kill();
 
+    /**
+     * Returns the buffering and stall statistics of this ARM.
+     */
+    ReadAheadStats getReadAheadStats();
+
 private:
     /**
      * We instantiate one of these per remote host. It contains the buffer of results we've
@@ -240,6 +264,19 @@ private:
         // batchSize in getMore when mongod returned less docs than the requested batchSize.
         long long fetchedCount = 0;
 
+        // Size in bytes of the documents in 'docBuffer'.
+        long long bufferedBytes = 0;
+
+        // Moving averages of the size of the documents returned by this remote and of the time
+        // it takes to answer a request, used to size read-ahead getMores. Zero until the first
+        // non-empty batch has been received.
+        long long avgObjSize = 0;
+        Milliseconds avgRoundTrip{0};
+
+        // The size in bytes the outstanding getMore against this remote is expected to return,
+        // counted against the read-ahead budget until it does.
+        long long requestedBytes = 0;
+
     private:
         // For a cursor, which has shard id associated contains the exact host on which the remote
         // cursor resides.
@@ -281,9 +318,47 @@ private:
      * The 'remoteIndex' gives the position of the remote node from which we are retrieving the
      * batch in '_remotes'.
      *
+     * 'isReadAhead' is true if the batch is requested by scheduleReadAhead_inlock() before the
+     * remote's buffer runs dry, rather than because its results are needed.
+     *
      * Returns success if the command to retrieve the next batch was scheduled successfully.
      */
-    Status askForNextBatch_inlock(size_t remoteIndex);
+    Status askForNextBatch_inlock(size_t remoteIndex, bool isReadAhead = false);
+
+    /**
+     * Returns true if getMores should be scheduled ahead of the remotes' buffers running dry.
+     */
+    bool readAheadEnabled_inlock() const;
+
+    /**
+     * Schedules a getMore against each remote which has an established, non-exhausted cursor, no
+     * outstanding request and has returned results, as long as the buffered results stay within
+     * the read-ahead budget.
+     * A failure to schedule is recorded in the remote's status.
+     */
+    void scheduleReadAhead_inlock();
+
+    /**
+     * Returns the part of the read-ahead budget given to 'remote'. The budget is split between the
+     * remotes which are not exhausted, and remotes which respond slower than average are given a
+     * proportionally larger share, so that the shares add up to the budget.
+     */
+    long long budgetShareBytes_inlock(const RemoteCursorData& remote) const;
+
+    /**
+     * Returns the batchSize for a getMore against 'remote' when read-ahead is enabled and no
+     * batchSize was specified, or boost::none if nothing is known about the remote's documents
+     * yet. It asks for the remote's share of the budget, and at least kMinAdaptiveBatchSize
+     * documents. If 'isReadAhead' is true, it instead asks for at least one document, and no more
+     * than fit in what is left of the budget.
+     */
+    boost::optional<long long> adaptiveBatchSize_inlock(const RemoteCursorData& remote,
+                                                        bool isReadAhead) const;
+
+    /**
+     * Removes and returns the next document buffered for the remote at 'remoteIndex'.
+     */
+    BSONObj popFromBuffer_inlock(size_t remoteIndex);
 
     /**
      * Checks whether or not the remote cursors are all exhausted.
@@ -369,6 +444,14 @@ private:
 
     boost::optional<Milliseconds> _awaitDataTimeout;
 
+    ReadAheadStats _readAheadStats;
+
+    // The sum of the remotes' 'requestedBytes'.
+    long long _requestedBytes = 0;
+
+    // Time at which '_currentEvent' was created, used to account for stall time.
+    Date_t _currentEventStart;
+
     //
     // Killing
     //
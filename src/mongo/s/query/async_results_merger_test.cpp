@@ -126,11 +126,18 @@ protected:
 
     /**
      * Given a vector of (HostAndPort, CursorIds) representing a set of existing cursors, constructs
-     * the appropriate ARM.  The default CCC parameters are used.
+     * the appropriate ARM.  The default CCC parameters are used, other than the sort, the
+     * read-ahead budget and the batchSize.
      */
     void makeCursorFromExistingCursors(
-        const std::vector<std::pair<HostAndPort, CursorId>>& remotes) {
+        const std::vector<std::pair<HostAndPort, CursorId>>& remotes,
+        boost::optional<long long> readAheadMaxBufferedBytes = boost::none,
+        BSONObj sort = BSONObj(),
+        boost::optional<long long> batchSize = boost::none) {
         ClusterClientCursorParams params = ClusterClientCursorParams(_nss);
+        params.readAheadMaxBufferedBytes = readAheadMaxBufferedBytes;
+        params.sort = std::move(sort);
+        params.batchSize = batchSize;
 
         for (const auto& hostIdPair : remotes) {
             params.remotes.emplace_back(hostIdPair.first, hostIdPair.second);
@@ -188,6 +195,33 @@ protected:
         net->exitNetwork();
     }
 
+    bool hasReadyRequests() {
+        executor::NetworkInterfaceMock* net = network();
+        net->enterNetwork();
+        const bool hasReadyRequests = net->hasReadyRequests();
+        net->exitNetwork();
+        return hasReadyRequests;
+    }
+
+    /**
+     * Returns the remaining results of the ARM, waiting for the remotes as necessary.
+     */
+    std::vector<BSONObj> getRemainingResults() {
+        std::vector<BSONObj> results;
+        while (true) {
+            if (!arm->ready()) {
+                auto readyEvent = unittest::assertGet(arm->nextEvent());
+                executor()->waitForEvent(readyEvent);
+            }
+
+            auto next = unittest::assertGet(arm->nextReady());
+            if (!next) {
+                return results;
+            }
+            results.push_back(*next);
+        }
+    }
+
     void blackHoleNextRequest() {
         executor::NetworkInterfaceMock* net = network();
         net->enterNetwork();
@@ -1366,6 +1400,235 @@ TEST_F(AsyncResultsMergerTest, GetMoreRequestWithoutAwaitDataCantHaveMaxTime) {
     executor()->waitForEvent(killEvent);
 }
 
+TEST_F(AsyncResultsMergerTest, ReadAheadRequestsNextBatchBeforeBufferIsEmpty) {
+    const long long readAheadMaxBufferedBytes = 1024 * 1024;
+    makeCursorFromExistingCursors({{kTestShardHosts[0], 1}}, readAheadMaxBufferedBytes);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+
+    // Nothing is known about the remote's documents yet, so the first getMore leaves the batchSize
+    // to the remote.
+    auto firstRequest =
+        GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(firstRequest.getStatus());
+    ASSERT_FALSE(firstRequest.getValue().batchSize);
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1}"), fromjson("{_id: 2}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    // The next batch was requested while two results are still buffered, and sized to fill what
+    // is left of the read-ahead budget.
+    const long long objSize = batch1[0].objsize();
+    auto request = GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(request.getStatus());
+    ASSERT_EQ(request.getValue().cursorid, 1LL);
+    ASSERT_EQ(*request.getValue().batchSize, (readAheadMaxBufferedBytes - 2 * objSize) / objSize);
+
+    auto stats = arm->getReadAheadStats();
+    ASSERT_EQ(stats.readAheadGetMores, 1LL);
+    ASSERT_EQ(stats.bufferedBytes, 2 * objSize);
+
+    responses.clear();
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 3}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+
+    std::vector<BSONObj> expected = {
+        fromjson("{_id: 1}"), fromjson("{_id: 2}"), fromjson("{_id: 3}")};
+    auto results = getRemainingResults();
+    ASSERT_EQ(expected.size(), results.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], results[i]);
+    }
+    ASSERT_EQ(arm->getReadAheadStats().bufferedBytes, 0LL);
+    ASSERT_TRUE(arm->remotesExhausted());
+}
+
+TEST_F(AsyncResultsMergerTest, ReadAheadStopsAtBufferedBytesLimit) {
+    makeCursorFromExistingCursors({{kTestShardHosts[0], 1}}, 1LL);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+
+    // The budget does not apply to a getMore for results the caller is waiting for.
+    auto firstRequest =
+        GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(firstRequest.getStatus());
+    ASSERT_FALSE(firstRequest.getValue().batchSize);
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1}"), fromjson("{_id: 2}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    // The buffered results already exceed the budget.
+    ASSERT_FALSE(hasReadyRequests());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 1}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_FALSE(hasReadyRequests());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 2}"), *unittest::assertGet(arm->nextReady()));
+
+    // Returning the last buffered result made room for the next batch, which asks for a single
+    // document since no more fit in the budget.
+    auto request = GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(request.getStatus());
+    ASSERT_EQ(*request.getValue().batchSize, 1LL);
+    ASSERT_EQ(arm->getReadAheadStats().readAheadGetMores, 1LL);
+
+    responses.clear();
+    responses.emplace_back(_nss, CursorId(0), std::vector<BSONObj>());
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    ASSERT_TRUE(getRemainingResults().empty());
+    ASSERT_TRUE(arm->remotesExhausted());
+}
+
+TEST_F(AsyncResultsMergerTest, ReadAheadBudgetCapsClientBatchSize) {
+    const long long objSize = fromjson("{_id: 1}").objsize();
+    makeCursorFromExistingCursors({{kTestShardHosts[0], 1}}, 4 * objSize, BSONObj(), 1000LL);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+
+    // The caller is waiting for these results, so the client's batchSize is used as is.
+    auto firstRequest =
+        GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(firstRequest.getStatus());
+    ASSERT_EQ(*firstRequest.getValue().batchSize, 1000LL);
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1}"), fromjson("{_id: 2}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    // The read-ahead getMore only asks for the two more documents which fit in the budget,
+    // however many the client asked for.
+    auto request = GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(request.getStatus());
+    ASSERT_EQ(*request.getValue().batchSize, 2LL);
+
+    responses.clear();
+    responses.emplace_back(_nss, CursorId(0), std::vector<BSONObj>());
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    ASSERT_EQ(batch1.size(), getRemainingResults().size());
+    ASSERT_TRUE(arm->remotesExhausted());
+}
+
+TEST_F(AsyncResultsMergerTest, ReadAheadDemandGetMoreAsksForMinimumBatchSize) {
+    makeCursorFromExistingCursors(
+        {{kTestShardHosts[0], 1}, {kTestShardHosts[1], 2}}, 1LL, BSON("_id" << 1));
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1, $sortKey: {'': 1}}"),
+                                   fromjson("{_id: 4, $sortKey: {'': 4}}")};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 2, $sortKey: {'': 2}}")};
+    responses.emplace_back(_nss, CursorId(2), batch2);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    // The buffered results exceed the budget, so the second remote is not read ahead.
+    ASSERT_FALSE(hasReadyRequests());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 1, $sortKey: {'': 1}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 2, $sortKey: {'': 2}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_FALSE(hasReadyRequests());
+
+    // The merge now waits for the second remote. Its getMore is not held to the budget already in
+    // use, and asks for at least the minimum batchSize.
+    ASSERT_FALSE(arm->ready());
+    readyEvent = unittest::assertGet(arm->nextEvent());
+    auto request = GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(request.getStatus());
+    ASSERT_EQ(request.getValue().cursorid, 2LL);
+    ASSERT_EQ(*request.getValue().batchSize, 16LL);
+
+    responses.clear();
+    std::vector<BSONObj> batch3 = {fromjson("{_id: 3, $sortKey: {'': 3}}")};
+    responses.emplace_back(_nss, CursorId(0), batch3);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    std::vector<BSONObj> expected = {fromjson("{_id: 3, $sortKey: {'': 3}}"),
+                                     fromjson("{_id: 4, $sortKey: {'': 4}}")};
+    auto results = getRemainingResults();
+    ASSERT_EQ(expected.size(), results.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], results[i]);
+    }
+    ASSERT_TRUE(arm->remotesExhausted());
+}
+
+TEST_F(AsyncResultsMergerTest, ReadAheadBatchesMergeInSortOrder) {
+    makeCursorFromExistingCursors(
+        {{kTestShardHosts[0], 1}, {kTestShardHosts[1], 2}}, 1024LL * 1024, BSON("_id" << 1));
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1, $sortKey: {'': 1}}"),
+                                   fromjson("{_id: 4, $sortKey: {'': 4}}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 2, $sortKey: {'': 2}}")};
+    responses.emplace_back(_nss, CursorId(2), batch2);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor()->waitForEvent(readyEvent);
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 1, $sortKey: {'': 1}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 2, $sortKey: {'': 2}}"), *unittest::assertGet(arm->nextReady()));
+
+    // Both remotes were read ahead. The first remote's next batch arrives while one of its results
+    // is still buffered.
+    for (int i = 0; i < 2; ++i) {
+        auto request =
+            GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+        ASSERT_OK(request.getStatus());
+
+        responses.clear();
+        if (request.getValue().cursorid == 1) {
+            std::vector<BSONObj> batch = {fromjson("{_id: 5, $sortKey: {'': 5}}")};
+            responses.emplace_back(_nss, CursorId(0), batch);
+        } else {
+            std::vector<BSONObj> batch = {fromjson("{_id: 3, $sortKey: {'': 3}}")};
+            responses.emplace_back(_nss, CursorId(0), batch);
+        }
+        scheduleNetworkResponses(std::move(responses),
+                                 CursorResponse::ResponseType::SubsequentResponse);
+    }
+
+    std::vector<BSONObj> expected = {fromjson("{_id: 3, $sortKey: {'': 3}}"),
+                                     fromjson("{_id: 4, $sortKey: {'': 4}}"),
+                                     fromjson("{_id: 5, $sortKey: {'': 5}}")};
+    auto results = getRemainingResults();
+    ASSERT_EQ(expected.size(), results.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], results[i]);
+    }
+    ASSERT_TRUE(arm->remotesExhausted());
+}
+
 }  // namespace
 
 }  // namespace mongo
@@ -32,6 +32,8 @@
 
 #include "mongo/s/query/cluster_client_cursor_impl.h"
 
+#include "mongo/db/server_parameters.h"
+#include "mongo/s/query/router_stage_aggregation_merge.h"
 #include "mongo/s/query/router_stage_limit.h"
 #include "mongo/s/query/router_stage_merge.h"
 #include "mongo/s/query/router_stage_mock.h"
@@ -41,6 +43,19 @@
 
 namespace mongo {
 
+namespace {
+
+// Read-ahead budget of cursors which do not specify their own. Configurable with server parameter
+// "internalClusterCursorReadAheadMaxBufferedBytes". Zero disables read-ahead.
+std::atomic<long long> readAheadMaxBufferedBytes(4 * 1024 * 1024);  // NOLINT
+
+ExportedServerParameter<long long, ServerParameterType::kStartupAndRuntime>
+    readAheadMaxBufferedBytesConfig(ServerParameterSet::getGlobal(),
+                                    "internalClusterCursorReadAheadMaxBufferedBytes",
+                                    &readAheadMaxBufferedBytes);
+
+}  // namespace
+
 ClusterClientCursorGuard::ClusterClientCursorGuard(std::unique_ptr<ClusterClientCursor> ccc)
     : _ccc(std::move(ccc)) {}
 
@@ -118,11 +133,22 @@ std::unique_ptr<RouterExecStage> ClusterClientCursorImpl::buildMergerPlan(
     const auto skip = params.skip;
     const auto limit = params.limit;
     const bool hasSort = !params.sort.isEmpty();
+    auto mergePipeline = std::move(params.mergePipeline);
+
+    if (!params.readAheadMaxBufferedBytes) {
+        params.readAheadMaxBufferedBytes = readAheadMaxBufferedBytes.load();
+    }
 
     // The first stage is always the one which merges from the remotes.
     std::unique_ptr<RouterExecStage> root =
         stdx::make_unique<RouterStageMerge>(executor, std::move(params));
 
+    if (mergePipeline) {
+        invariant(!skip && !limit);
+        return stdx::make_unique<RouterStageAggregationMerge>(std::move(root),
+                                                              std::move(mergePipeline));
+    }
+
     if (skip) {
         root = stdx::make_unique<RouterStageSkip>(std::move(root), *skip);
     }
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <boost/intrusive_ptr.hpp>
 #include <boost/optional.hpp>
 #include <memory>
 #include <vector>
@@ -36,6 +37,7 @@
 #include "mongo/client/read_preference.h"
 #include "mongo/db/cursor_id.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/pipeline/pipeline.h"
 #include "mongo/s/client/shard.h"
 #include "mongo/util/net/hostandport.h"
 
@@ -112,6 +114,11 @@ struct ClusterClientCursorParams {
     // The sort specification. Leave empty if there is no sort.
     BSONObj sort;
 
+    // The merging half of a split aggregation pipeline, which is run on the merged results. Only
+    // set for aggregations which mongos merges itself. The pipeline applies any skip, limit or
+    // projection, so 'skip' and 'limit' must not be set.
+    boost::intrusive_ptr<Pipeline> mergePipeline;
+
     // The number of results to skip. Optional. Should not be forwarded to the remote hosts in
     // 'cmdObj'.
     boost::optional<long long> skip;
@@ -120,6 +127,14 @@ struct ClusterClientCursorParams {
     // each getMore.
     boost::optional<long long> batchSize;
 
+    // Upper bound on the size in bytes of the results buffered from the remotes before the client
+    // asks for them. While less than this is buffered, a getMore is kept outstanding against every
+    // remote which is not exhausted, rather than waiting for its buffer to run dry. The batchSize
+    // of these getMores, including one set by 'batchSize', is capped to what is left of this
+    // budget. If 'batchSize' is not set, other getMores are sized to share this budget between the
+    // remotes. Optional. Not set or zero disables read-ahead. Ignored for tailable cursors.
+    boost::optional<long long> readAheadMaxBufferedBytes;
+
     // Limits the number of results returned by the ClusterClientCursor to this many. Optional.
     // Should be forwarded to the remote hosts in 'cmdObj'.
     boost::optional<long long> limit;
@@ -173,14 +173,15 @@ ClusterCursorManager::ClusterCursorManager(ClockSource* clockSource)
 }
 
 ClusterCursorManager::~ClusterCursorManager() {
+    for (const auto& stripe : _stripes) {
+        invariant(stripe.entryMap.empty());
+    }
     invariant(_cursorIdPrefixToNamespaceMap.empty());
-    invariant(_namespaceToContainerMap.empty());
+    invariant(_namespaceToEntryMap.empty());
 }
 
 void ClusterCursorManager::shutdown() {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-    _inShutdown = true;
-    lk.unlock();
+    _inShutdown.store(true);
 
     killAllCursors();
     reapZombieCursors();
@@ -194,54 +195,36 @@ StatusWith<CursorId> ClusterCursorManager::registerCursor(
     // Read the clock out of the lock.
     const auto now = _clockSource->now();
 
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-
-    if (_inShutdown) {
-        lk.unlock();
-        cursor->kill();
-        return Status(ErrorCodes::ShutdownInProgress,
-                      "Cannot register new cursors as we are in the process of shutting down");
-    }
-
     invariant(cursor);
 
-    // Find the CursorEntryContainer for this namespace.  If none exists, create one.
-    auto nsToContainerIt = _namespaceToContainerMap.find(nss);
-    if (nsToContainerIt == _namespaceToContainerMap.end()) {
-        uint32_t containerPrefix = 0;
-        do {
-            // The server has always generated positive values for CursorId (which is a signed
-            // type), so we use std::abs() here on the prefix for consistency with this historical
-            // behavior.
-            containerPrefix = static_cast<uint32_t>(std::abs(_pseudoRandom.nextInt32()));
-        } while (_cursorIdPrefixToNamespaceMap.count(containerPrefix) > 0);
-        _cursorIdPrefixToNamespaceMap[containerPrefix] = nss;
+    while (true) {
+        // Generate a CursorId (which can't be the invalid value zero), and find the stripe it
+        // belongs to.
+        const CursorId cursorId = allocateCursorId(nss);
+        CursorEntryStripe& stripe = getStripe(cursorId);
 
-        auto emplaceResult =
-            _namespaceToContainerMap.emplace(nss, CursorEntryContainer(containerPrefix));
-        invariant(emplaceResult.second);
-        invariant(_namespaceToContainerMap.size() == _cursorIdPrefixToNamespaceMap.size());
+        stdx::unique_lock<stdx::mutex> lk(stripe.mutex);
 
-        nsToContainerIt = emplaceResult.first;
-    } else {
-        invariant(!nsToContainerIt->second.entryMap.empty());  // If exists, shouldn't be empty.
-    }
-    CursorEntryContainer& container = nsToContainerIt->second;
+        if (_inShutdown.load()) {
+            releaseCursorId(nss);
+            lk.unlock();
+            cursor->kill();
+            return Status(ErrorCodes::ShutdownInProgress,
+                          "Cannot register new cursors as we are in the process of shutting down");
+        }
 
-    // Generate a CursorId (which can't be the invalid value zero).
-    CursorEntryMap& entryMap = container.entryMap;
-    CursorId cursorId = 0;
-    do {
-        const uint32_t cursorSuffix = static_cast<uint32_t>(_pseudoRandom.nextInt32());
-        cursorId = createCursorId(container.containerPrefix, cursorSuffix);
-    } while (cursorId == 0 || entryMap.count(cursorId) > 0);
+        if (stripe.entryMap.count(cursorId) > 0) {
+            releaseCursorId(nss);
+            continue;
+        }
 
-    // Create a new CursorEntry and register it in the CursorEntryContainer's map.
-    auto emplaceResult =
-        entryMap.emplace(cursorId, CursorEntry(std::move(cursor), cursorType, cursorLifetime, now));
-    invariant(emplaceResult.second);
+        // Create a new CursorEntry and register it in the stripe's map.
+        auto emplaceResult = stripe.entryMap.emplace(
+            cursorId, CursorEntry(std::move(cursor), nss, cursorType, cursorLifetime, now));
+        invariant(emplaceResult.second);
 
-    return cursorId;
+        return cursorId;
+    }
 }
 
 StatusWith<ClusterCursorManager::PinnedCursor> ClusterCursorManager::checkOutCursor(
@@ -249,14 +232,15 @@ StatusWith<ClusterCursorManager::PinnedCursor> ClusterCursorManager::checkOutCur
     // Read the clock out of the lock.
     const auto now = _clockSource->now();
 
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
-
-    if (_inShutdown) {
+    if (_inShutdown.load()) {
         return Status(ErrorCodes::ShutdownInProgress,
                       "Cannot check out cursor as we are in the process of shutting down");
     }
 
-    CursorEntry* entry = getEntry_inlock(nss, cursorId);
+    CursorEntryStripe& stripe = getStripe(cursorId);
+    stdx::lock_guard<stdx::mutex> lk(stripe.mutex);
+
+    CursorEntry* entry = getEntry_inlock(stripe, nss, cursorId);
     if (!entry) {
         return cursorNotFoundStatus(nss, cursorId);
     }
@@ -279,13 +263,15 @@ void ClusterCursorManager::checkInCursor(std::unique_ptr<ClusterClientCursor> cu
                                          const NamespaceString& nss,
                                          CursorId cursorId,
                                          CursorState cursorState) {
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-
     invariant(cursor);
 
+    // Check whether the remote cursors are exhausted out of the lock.
     const bool remotesExhausted = cursor->remotesExhausted();
 
-    CursorEntry* entry = getEntry_inlock(nss, cursorId);
+    CursorEntryStripe& stripe = getStripe(cursorId);
+    stdx::unique_lock<stdx::mutex> lk(stripe.mutex);
+
+    CursorEntry* entry = getEntry_inlock(stripe, nss, cursorId);
     invariant(entry);
 
     entry->returnCursor(std::move(cursor));
@@ -303,7 +289,7 @@ void ClusterCursorManager::checkInCursor(std::unique_ptr<ClusterClientCursor> cu
 
     // The cursor is exhausted, is not already scheduled for deletion, and does not have any
     // remote cursor state left to clean up. We can delete the cursor right away.
-    auto detachedCursor = detachCursor_inlock(nss, cursorId);
+    auto detachedCursor = detachCursor_inlock(stripe, nss, cursorId);
     invariantOK(detachedCursor.getStatus());
 
     // Deletion of the cursor can happen out of the lock.
@@ -312,9 +298,10 @@ void ClusterCursorManager::checkInCursor(std::unique_ptr<ClusterClientCursor> cu
 }
 
 Status ClusterCursorManager::killCursor(const NamespaceString& nss, CursorId cursorId) {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    CursorEntryStripe& stripe = getStripe(cursorId);
+    stdx::lock_guard<stdx::mutex> lk(stripe.mutex);
 
-    CursorEntry* entry = getEntry_inlock(nss, cursorId);
+    CursorEntry* entry = getEntry_inlock(stripe, nss, cursorId);
     if (!entry) {
         return cursorNotFoundStatus(nss, cursorId);
     }
@@ -325,10 +312,10 @@ Status ClusterCursorManager::killCursor(const NamespaceString& nss, CursorId cur
 }
 
 void ClusterCursorManager::killMortalCursorsInactiveSince(Date_t cutoff) {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (auto& stripe : _stripes) {
+        stdx::lock_guard<stdx::mutex> lk(stripe.mutex);
 
-    for (auto& nsContainerPair : _namespaceToContainerMap) {
-        for (auto& cursorIdEntryPair : nsContainerPair.second.entryMap) {
+        for (auto& cursorIdEntryPair : stripe.entryMap) {
             CursorEntry& entry = cursorIdEntryPair.second;
             if (entry.getLifetimeType() == CursorLifetime::Mortal &&
                 entry.getLastActive() <= cutoff) {
@@ -341,56 +328,53 @@ void ClusterCursorManager::killMortalCursorsInactiveSince(Date_t cutoff) {
 }
 
 void ClusterCursorManager::killAllCursors() {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (auto& stripe : _stripes) {
+        stdx::lock_guard<stdx::mutex> lk(stripe.mutex);
 
-    for (auto& nsContainerPair : _namespaceToContainerMap) {
-        for (auto& cursorIdEntryPair : nsContainerPair.second.entryMap) {
+        for (auto& cursorIdEntryPair : stripe.entryMap) {
             cursorIdEntryPair.second.setKillPending();
         }
     }
 }
 
 void ClusterCursorManager::reapZombieCursors() {
-    // List all zombie cursors under the manager lock, and kill them one-by-one while not holding
-    // the lock (ClusterClientCursor::kill() is blocking, so we don't want to hold a lock while
-    // issuing the kill).
-
-    stdx::unique_lock<stdx::mutex> lk(_mutex);
-    std::vector<std::pair<NamespaceString, CursorId>> zombieCursorDescriptors;
-    for (auto& nsContainerPair : _namespaceToContainerMap) {
-        const NamespaceString& nss = nsContainerPair.first;
-        for (auto& cursorIdEntryPair : nsContainerPair.second.entryMap) {
-            CursorId cursorId = cursorIdEntryPair.first;
+    // Reap one stripe at a time.  List the stripe's zombie cursors under its lock, and kill them
+    // one-by-one while not holding the lock (ClusterClientCursor::kill() is blocking, so we don't
+    // want to hold a lock while issuing the kill).
+    for (auto& stripe : _stripes) {
+        stdx::unique_lock<stdx::mutex> lk(stripe.mutex);
+        std::vector<std::pair<NamespaceString, CursorId>> zombieCursorDescriptors;
+        for (auto& cursorIdEntryPair : stripe.entryMap) {
             const CursorEntry& entry = cursorIdEntryPair.second;
             if (!entry.getKillPending()) {
                 continue;
             }
-            zombieCursorDescriptors.emplace_back(nss, cursorId);
+            zombieCursorDescriptors.emplace_back(entry.getNamespace(), cursorIdEntryPair.first);
         }
-    }
 
-    for (auto& namespaceCursorIdPair : zombieCursorDescriptors) {
-        StatusWith<std::unique_ptr<ClusterClientCursor>> zombieCursor =
-            detachCursor_inlock(namespaceCursorIdPair.first, namespaceCursorIdPair.second);
-        if (!zombieCursor.isOK()) {
-            // Cursor in use, or has already been deleted.
-            continue;
-        }
+        for (auto& namespaceCursorIdPair : zombieCursorDescriptors) {
+            StatusWith<std::unique_ptr<ClusterClientCursor>> zombieCursor = detachCursor_inlock(
+                stripe, namespaceCursorIdPair.first, namespaceCursorIdPair.second);
+            if (!zombieCursor.isOK()) {
+                // Cursor in use, or has already been deleted.
+                continue;
+            }
 
-        lk.unlock();
-        zombieCursor.getValue()->kill();
-        zombieCursor.getValue().reset();
-        lk.lock();
+            lk.unlock();
+            zombieCursor.getValue()->kill();
+            zombieCursor.getValue().reset();
+            lk.lock();
+        }
     }
 }
 
 ClusterCursorManager::Stats ClusterCursorManager::stats() const {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
-
     Stats stats;
 
-    for (auto& nsContainerPair : _namespaceToContainerMap) {
-        for (auto& cursorIdEntryPair : nsContainerPair.second.entryMap) {
+    for (const auto& stripe : _stripes) {
+        stdx::lock_guard<stdx::mutex> lk(stripe.mutex);
+
+        for (auto& cursorIdEntryPair : stripe.entryMap) {
             const CursorEntry& entry = cursorIdEntryPair.second;
 
             if (entry.getKillPending()) {
@@ -419,7 +403,7 @@ ClusterCursorManager::Stats ClusterCursorManager::stats() const {
 
 boost::optional<NamespaceString> ClusterCursorManager::getNamespaceForCursorId(
     CursorId cursorId) const {
-    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    stdx::lock_guard<stdx::mutex> lk(_namespaceMutex);
 
     const auto it = _cursorIdPrefixToNamespaceMap.find(extractPrefixFromCursorId(cursorId));
     if (it == _cursorIdPrefixToNamespaceMap.end()) {
@@ -428,15 +412,17 @@ boost::optional<NamespaceString> ClusterCursorManager::getNamespaceForCursorId(
     return it->second;
 }
 
-ClusterCursorManager::CursorEntry* ClusterCursorManager::getEntry_inlock(const NamespaceString& nss,
-                                                                         CursorId cursorId) {
-    auto nsToContainerIt = _namespaceToContainerMap.find(nss);
-    if (nsToContainerIt == _namespaceToContainerMap.end()) {
-        return nullptr;
-    }
-    CursorEntryMap& entryMap = nsToContainerIt->second.entryMap;
-    auto entryMapIt = entryMap.find(cursorId);
-    if (entryMapIt == entryMap.end()) {
+ClusterCursorManager::CursorEntryStripe& ClusterCursorManager::getStripe(CursorId cursorId) {
+    // Mix the namespace prefix into the random suffix, so that the cursors of each namespace are
+    // spread over all of the stripes.
+    const uint64_t id = static_cast<uint64_t>(cursorId);
+    return _stripes[((id >> 32) ^ id) % kNumStripes];
+}
+
+ClusterCursorManager::CursorEntry* ClusterCursorManager::getEntry_inlock(
+    CursorEntryStripe& stripe, const NamespaceString& nss, CursorId cursorId) {
+    auto entryMapIt = stripe.entryMap.find(cursorId);
+    if (entryMapIt == stripe.entryMap.end() || entryMapIt->second.getNamespace() != nss) {
         return nullptr;
     }
 
@@ -444,8 +430,8 @@ ClusterCursorManager::CursorEntry* ClusterCursorManager::getEntry_inlock(const N
 }
 
 StatusWith<std::unique_ptr<ClusterClientCursor>> ClusterCursorManager::detachCursor_inlock(
-    const NamespaceString& nss, CursorId cursorId) {
-    CursorEntry* entry = getEntry_inlock(nss, cursorId);
+    CursorEntryStripe& stripe, const NamespaceString& nss, CursorId cursorId) {
+    CursorEntry* entry = getEntry_inlock(stripe, nss, cursorId);
     if (!entry) {
         return cursorNotFoundStatus(nss, cursorId);
     }
@@ -455,22 +441,63 @@ StatusWith<std::unique_ptr<ClusterClientCursor>> ClusterCursorManager::detachCur
         return cursorInUseStatus(nss, cursorId);
     }
 
-    auto nsToContainerIt = _namespaceToContainerMap.find(nss);
-    invariant(nsToContainerIt != _namespaceToContainerMap.end());
-    CursorEntryMap& entryMap = nsToContainerIt->second.entryMap;
-    size_t eraseResult = entryMap.erase(cursorId);
+    size_t eraseResult = stripe.entryMap.erase(cursorId);
     invariant(1 == eraseResult);
-    if (entryMap.empty()) {
+    releaseCursorId(nss);
+
+    return std::move(cursor);
+}
+
+CursorId ClusterCursorManager::allocateCursorId(const NamespaceString& nss) {
+    stdx::lock_guard<stdx::mutex> lk(_namespaceMutex);
+
+    // Find the NamespaceEntry for this namespace.  If none exists, create one.
+    auto nsToEntryIt = _namespaceToEntryMap.find(nss);
+    if (nsToEntryIt == _namespaceToEntryMap.end()) {
+        uint32_t containerPrefix = 0;
+        do {
+            // The server has always generated positive values for CursorId (which is a signed
+            // type), so we use std::abs() here on the prefix for consistency with this historical
+            // behavior.
+            containerPrefix = static_cast<uint32_t>(std::abs(_pseudoRandom.nextInt32()));
+        } while (_cursorIdPrefixToNamespaceMap.count(containerPrefix) > 0);
+        _cursorIdPrefixToNamespaceMap[containerPrefix] = nss;
+
+        auto emplaceResult = _namespaceToEntryMap.emplace(nss, NamespaceEntry(containerPrefix));
+        invariant(emplaceResult.second);
+        invariant(_namespaceToEntryMap.size() == _cursorIdPrefixToNamespaceMap.size());
+
+        nsToEntryIt = emplaceResult.first;
+    } else {
+        invariant(nsToEntryIt->second.numCursors > 0);  // If exists, shouldn't be empty.
+    }
+    NamespaceEntry& nsEntry = nsToEntryIt->second;
+    ++nsEntry.numCursors;
+
+    CursorId cursorId = 0;
+    do {
+        const uint32_t cursorSuffix = static_cast<uint32_t>(_pseudoRandom.nextInt32());
+        cursorId = createCursorId(nsEntry.containerPrefix, cursorSuffix);
+    } while (cursorId == 0);
+
+    return cursorId;
+}
+
+void ClusterCursorManager::releaseCursorId(const NamespaceString& nss) {
+    stdx::lock_guard<stdx::mutex> lk(_namespaceMutex);
+
+    auto nsToEntryIt = _namespaceToEntryMap.find(nss);
+    invariant(nsToEntryIt != _namespaceToEntryMap.end());
+    invariant(nsToEntryIt->second.numCursors > 0);
+    if (--nsToEntryIt->second.numCursors == 0) {
         // This was the last cursor remaining in the given namespace.  Erase all state associated
         // with this namespace.
         size_t numDeleted =
-            _cursorIdPrefixToNamespaceMap.erase(nsToContainerIt->second.containerPrefix);
+            _cursorIdPrefixToNamespaceMap.erase(nsToEntryIt->second.containerPrefix);
         invariant(numDeleted == 1);
-        _namespaceToContainerMap.erase(nsToContainerIt);
-        invariant(_namespaceToContainerMap.size() == _cursorIdPrefixToNamespaceMap.size());
+        _namespaceToEntryMap.erase(nsToEntryIt);
+        invariant(_namespaceToEntryMap.size() == _cursorIdPrefixToNamespaceMap.size());
     }
-
-    return std::move(cursor);
 }
 
 }  // namespace mongo
@@ -28,12 +28,14 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "mongo/db/cursor_id.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/query/cluster_client_cursor.h"
 #include "mongo/stdx/mutex.h"
@@ -62,6 +64,13 @@ class StatusWith;
  *
  * No public methods throw exceptions, and all public methods are thread-safe.
  *
+ * Registered cursors are partitioned by cursor id into stripes, each with its own lock, so that
+ * concurrent operations on different cursors rarely contend.  Since every cursor id carries the
+ * prefix of its namespace, cursors on different namespaces and different cursors on the same
+ * namespace are both spread across the stripes.  Operations which visit every cursor, such as the
+ * reaper, lock one stripe at a time.  A separate lock protects the registry of namespaces and
+ * their cursor id prefixes, which is only needed when cursors are registered or destroyed.
+ *
  * TODO: Add maxTimeMS support.  SERVER-19410.
  * TODO: Add method "size_t killCursorsOnNamespace(const NamespaceString& nss)" for
  *       dropCollection()?
@@ -363,13 +372,22 @@ private:
                        CursorId cursorId,
                        CursorState cursorState);
 
+    struct CursorEntryStripe;
+
+    /**
+     * Returns the stripe which holds the cursor with the given id, registered or not.
+     */
+    CursorEntryStripe& getStripe(CursorId cursorId);
+
     /**
      * Returns a pointer to the CursorEntry for the given cursor.  If the given cursor is not
      * registered, returns null.
      *
-     * Not thread-safe.
+     * Must be called with the mutex of 'stripe', which must be the cursor's stripe, held.
      */
-    CursorEntry* getEntry_inlock(const NamespaceString& nss, CursorId cursorId);
+    CursorEntry* getEntry_inlock(CursorEntryStripe& stripe,
+                                 const NamespaceString& nss,
+                                 CursorId cursorId);
 
     /**
      * De-registers the given cursor, and returns an owned pointer to the underlying
@@ -378,11 +396,30 @@ private:
      * If the given cursor is pinned, returns an error Status with code CursorInUse.  If the given
      * cursor is not registered, returns an error Status with code CursorNotFound.
      *
-     * Not thread-safe.
+     * Must be called with the mutex of 'stripe', which must be the cursor's stripe, held.
      */
-    StatusWith<std::unique_ptr<ClusterClientCursor>> detachCursor_inlock(const NamespaceString& nss,
+    StatusWith<std::unique_ptr<ClusterClientCursor>> detachCursor_inlock(CursorEntryStripe& stripe,
+                                                                         const NamespaceString& nss,
                                                                          CursorId cursorId);
 
+    /**
+     * Generates a new cursor id for a cursor on 'nss', and counts the cursor towards the
+     * namespace, creating its cursor id prefix if this is the namespace's first cursor.  The
+     * generated id may already be in use, in which case the caller must call releaseCursorId()
+     * and try again.
+     *
+     * Acquires '_namespaceMutex'.
+     */
+    CursorId allocateCursorId(const NamespaceString& nss);
+
+    /**
+     * Stops counting a cursor towards 'nss', and removes the namespace's cursor id prefix if it
+     * was the last one.  Undoes allocateCursorId().
+     *
+     * Acquires '_namespaceMutex'.  May be called with the mutex of a stripe held.
+     */
+    void releaseCursorId(const NamespaceString& nss);
+
     /**
      * CursorEntry is a moveable, non-copyable container for a single cursor.
      */
@@ -393,10 +430,12 @@ private:
         CursorEntry() = default;
 
         CursorEntry(std::unique_ptr<ClusterClientCursor> cursor,
+                    NamespaceString nss,
                     CursorType cursorType,
                     CursorLifetime cursorLifetime,
                     Date_t lastActive)
             : _cursor(std::move(cursor)),
+              _nss(std::move(nss)),
               _cursorType(cursorType),
               _cursorLifetime(cursorLifetime),
               _lastActive(lastActive) {
@@ -406,6 +445,10 @@ private:
         CursorEntry(CursorEntry&& other) = default;
         CursorEntry& operator=(CursorEntry&& other) = default;
 
+        const NamespaceString& getNamespace() const {
+            return _nss;
+        }
+
         bool getKillPending() const {
             return _killPending;
         }
@@ -453,6 +496,7 @@ private:
 
     private:
         std::unique_ptr<ClusterClientCursor> _cursor;
+        NamespaceString _nss;
         bool _killPending = false;
         CursorType _cursorType = CursorType::NamespaceNotSharded;
         CursorLifetime _cursorLifetime = CursorLifetime::Mortal;
@@ -460,32 +504,46 @@ private:
     };
 
     /**
-     * CursorEntryContainer is a moveable, non-copyable container for a set of cursors, where all
-     * contained cursors share the same 32-bit prefix of their cursor id.
+     * CursorEntryStripe holds the cursors whose ids map to it, and the lock which protects them.
      */
-    struct CursorEntryContainer {
-        MONGO_DISALLOW_COPYING(CursorEntryContainer);
+    struct CursorEntryStripe {
+        // Synchronizes access to 'entryMap' and to the entries in it.
+        mutable stdx::mutex mutex;
 
-        CursorEntryContainer(uint32_t containerPrefix) : containerPrefix(containerPrefix) {}
+        // Map from cursor id to cursor entry.
+        CursorEntryMap entryMap;
+    };
 
-        CursorEntryContainer(CursorEntryContainer&& other) = default;
-        CursorEntryContainer& operator=(CursorEntryContainer&& other) = default;
+    /**
+     * NamespaceEntry tracks the cursor id prefix shared by all cursors on a namespace.
+     */
+    struct NamespaceEntry {
+        NamespaceEntry(uint32_t containerPrefix) : containerPrefix(containerPrefix) {}
 
-        // Common cursor id prefix for all cursors in this container.
+        // Common cursor id prefix for all cursors on this namespace.
         uint32_t containerPrefix;
 
-        // Map from cursor id to cursor entry.
-        CursorEntryMap entryMap;
+        // Number of cursors on this namespace which are registered, or about to be.
+        size_t numCursors = 0;
     };
 
+    // Number of stripes the registered cursors are partitioned into.
+    static const size_t kNumStripes = 16;
+
     // Clock source.  Used when the 'last active' time for a cursor needs to be set/updated.  May be
     // concurrently accessed by multiple threads.
     ClockSource* _clockSource;
 
-    // Synchronizes access to all private state variables below.
-    mutable stdx::mutex _mutex;
+    // Set once shutdown() has been called.  Read under the mutex of a stripe before registering a
+    // cursor in it, so that a cursor can not be registered behind killAllCursors().
+    AtomicBool _inShutdown{false};
+
+    // The registered cursors.  A stripe's mutex may be held while acquiring '_namespaceMutex', but
+    // not the other way around, and at most one stripe's mutex is held at a time.
+    std::array<CursorEntryStripe, kNumStripes> _stripes;
 
-    bool _inShutdown{false};
+    // Synchronizes access to the private state variables below.
+    mutable stdx::mutex _namespaceMutex;
 
     // Randomness source.  Used for cursor id generation.
     PseudoRandom _pseudoRandom;
@@ -502,12 +560,12 @@ private:
     // when the last cursor on the given namespace is destroyed.
     std::unordered_map<uint32_t, NamespaceString> _cursorIdPrefixToNamespaceMap;
 
-    // Map from namespace to the CursorEntryContainer for that namespace.
+    // Map from namespace to the NamespaceEntry for that namespace.
     //
     // Entries are added when the first cursor on the given namespace is registered, and removed
     // when the last cursor on the given namespace is destroyed.
-    std::unordered_map<NamespaceString, CursorEntryContainer, NamespaceString::Hasher>
-        _namespaceToContainerMap;
+    std::unordered_map<NamespaceString, NamespaceEntry, NamespaceString::Hasher>
+        _namespaceToEntryMap;
 };
 
 }  // namespace
@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/query/cluster_cursor_manager.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/config.h"
+#include "mongo/s/query/cluster_client_cursor_mock.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/clock_source_mock.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace {
+
+// These tests measure the throughput of concurrent getMore-style cursor check-outs and check-ins.
+// It is not practical to run them on debug builds.
+#ifndef MONGO_CONFIG_DEBUG_BUILD
+
+const int kCursorsPerThread = 16;
+const int kCheckOutsPerThread = 200 * 1000;
+
+/**
+ * Has 'numThreads' threads each check out and check back in its own cursors, round robin, and logs
+ * the aggregate rate. If 'numNamespaces' is greater than one, the threads' cursors are spread over
+ * that many namespaces.
+ */
+void runCheckOutCheckIn(int numThreads, int numNamespaces) {
+    ClockSourceMock clockSource;
+    ClusterCursorManager manager(&clockSource);
+
+    std::vector<NamespaceString> namespaces;
+    for (int i = 0; i < numNamespaces; ++i) {
+        namespaces.emplace_back("test.collection" + std::to_string(i));
+    }
+
+    // Register all of the cursors up front, so that the timed section only checks cursors out and
+    // back in.
+    std::vector<std::vector<std::pair<NamespaceString, CursorId>>> threadCursors(numThreads);
+    for (int thread = 0; thread < numThreads; ++thread) {
+        for (int i = 0; i < kCursorsPerThread; ++i) {
+            const auto& nss = namespaces[(thread * kCursorsPerThread + i) % numNamespaces];
+            auto cursorId = unittest::assertGet(
+                manager.registerCursor(stdx::make_unique<ClusterClientCursorMock>(),
+                                       nss,
+                                       ClusterCursorManager::CursorType::NamespaceSharded,
+                                       ClusterCursorManager::CursorLifetime::Mortal));
+            threadCursors[thread].emplace_back(nss, cursorId);
+        }
+    }
+
+    Timer timer;
+
+    std::vector<stdx::thread> threads;
+    for (int thread = 0; thread < numThreads; ++thread) {
+        const auto* cursors = &threadCursors[thread];
+        threads.emplace_back([&manager, cursors]() {
+            for (int i = 0; i < kCheckOutsPerThread; ++i) {
+                const auto& cursor = (*cursors)[i % cursors->size()];
+                auto pinnedCursor = manager.checkOutCursor(cursor.first, cursor.second);
+                invariantOK(pinnedCursor.getStatus());
+                pinnedCursor.getValue().returnCursor(
+                    ClusterCursorManager::CursorState::NotExhausted);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const long long micros = std::max(timer.micros(), 1LL);
+    log() << numThreads << " threads on " << numNamespaces << " namespaces: "
+          << static_cast<long long>(numThreads) * kCheckOutsPerThread * 1000 * 1000 / micros
+          << " check-outs per second";
+
+    ASSERT_EQ(static_cast<size_t>(numThreads * kCursorsPerThread),
+              manager.stats().cursorsSharded);
+    ASSERT_EQ(0U, manager.stats().cursorsPinned);
+
+    manager.killAllCursors();
+    manager.reapZombieCursors();
+}
+
+TEST(ClusterCursorManagerPerf, CheckOutCheckInSameNamespace) {
+    for (int numThreads = 1; numThreads <= 32; numThreads *= 2) {
+        runCheckOutCheckIn(numThreads, 1);
+    }
+}
+
+TEST(ClusterCursorManagerPerf, CheckOutCheckInManyNamespaces) {
+    for (int numThreads = 1; numThreads <= 32; numThreads *= 2) {
+        runCheckOutCheckIn(numThreads, 64);
+    }
+}
+
+#endif  // MONGO_CONFIG_DEBUG_BUILD
+
+}  // namespace
+}  // namespace mongo
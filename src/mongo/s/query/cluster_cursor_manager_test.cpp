@@ -665,6 +665,38 @@ TEST_F(ClusterCursorManagerTest, GetNamespaceForCursorIdMultipleCursorsDifferent
     }
 }
 
+// Test that the namespace of a cursor is forgotten once the last cursor on it has been reaped, even
+// when that namespace's cursors are held in different stripes.
+TEST_F(ClusterCursorManagerTest, GetNamespaceForCursorIdAfterReapingManyCursors) {
+    const size_t numCursors = 100;
+    std::vector<CursorId> cursorIds(numCursors);
+    for (size_t i = 0; i < numCursors; ++i) {
+        cursorIds[i] = assertGet(
+            getManager()->registerCursor(allocateMockCursor(),
+                                         nss,
+                                         ClusterCursorManager::CursorType::NamespaceNotSharded,
+                                         ClusterCursorManager::CursorLifetime::Mortal));
+    }
+    ASSERT_EQ(numCursors, getManager()->stats().cursorsNotSharded);
+
+    // Kill and reap all but the last cursor. The namespace is still known.
+    for (size_t i = 0; i < numCursors - 1; ++i) {
+        ASSERT_OK(getManager()->killCursor(nss, cursorIds[i]));
+    }
+    getManager()->reapZombieCursors();
+    for (size_t i = 0; i < numCursors - 1; ++i) {
+        ASSERT(isMockCursorKilled(i));
+    }
+    ASSERT_FALSE(isMockCursorKilled(numCursors - 1));
+    ASSERT_EQ(1U, getManager()->stats().cursorsNotSharded);
+    ASSERT(getManager()->getNamespaceForCursorId(cursorIds[0]));
+
+    ASSERT_OK(getManager()->killCursor(nss, cursorIds[numCursors - 1]));
+    getManager()->reapZombieCursors();
+    ASSERT(isMockCursorKilled(numCursors - 1));
+    ASSERT_FALSE(getManager()->getNamespaceForCursorId(cursorIds[0]));
+}
+
 // Test that getting the namespace for an unknown cursor returns boost::none.
 TEST_F(ClusterCursorManagerTest, GetNamespaceForCursorIdUnknown) {
     boost::optional<NamespaceString> cursorNamespace = getManager()->getNamespaceForCursorId(5);
@@ -205,6 +205,21 @@ public:
     virtual void close() {
         Client::destroy();
     }
+
+    std::unique_ptr<SuspendedConnection> suspend() override {
+        return stdx::make_unique<SuspendedClient>(Client::releaseCurrent());
+    }
+
+    void resume(std::unique_ptr<SuspendedConnection> connection) override {
+        Client::setCurrent(std::move(static_cast<SuspendedClient*>(connection.get())->client));
+    }
+
+private:
+    struct SuspendedClient : public SuspendedConnection {
+        explicit SuspendedClient(ServiceContext::UniqueClient client) : client(std::move(client)) {}
+
+        ServiceContext::UniqueClient client;
+    };
 };
 
 DBClientBase* createDirectClient(OperationContext* txn) {
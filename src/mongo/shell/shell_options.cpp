@@ -42,6 +42,7 @@
 #include "mongo/client/sasl_client_authenticate.h"
 #include "mongo/config.h"
 #include "mongo/db/server_options.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/rpc/protocol.h"
 #include "mongo/shell/shell_utils.h"
 #include "mongo/util/log.h"
@@ -79,6 +80,12 @@ Status addMongoShellOptions(moe::OptionSection* options) {
 
     options->addOptionChaining("eval", "eval", moe::String, "evaluate javascript");
 
+    options->addOptionChaining("networkMessageCompressors",
+                               "networkMessageCompressors",
+                               moe::String,
+                               "comma-separated list of compressors to use for network messages, "
+                               "in order of preference");
+
     moe::OptionSection authenticationOptions("Authentication Options");
 
     authenticationOptions.addOptionChaining(
@@ -255,6 +262,18 @@ Status storeMongoShellOptions(const moe::Environment& params,
         shellGlobalParams.script = params["eval"].as<string>();
     }
 
+    if (params.count("networkMessageCompressors")) {
+        // Applied to the compressor registry, and validated, once startup options are stored.
+        const auto& parameters = ServerParameterSet::getGlobal()->getMap();
+        auto parameter = parameters.find("networkMessageCompressors");
+        invariant(parameter != parameters.end());
+        Status status =
+            parameter->second->setFromString(params["networkMessageCompressors"].as<string>());
+        if (!status.isOK()) {
+            return status;
+        }
+    }
+
     if (params.count("username")) {
         shellGlobalParams.username = params["username"].as<string>();
     }
@@ -33,6 +33,7 @@
 #include "mongo/config.h"
 #include "mongo/logger/log_severity.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor_manager.h"
 #include "mongo/util/net/sockaddr.h"
 #include "mongo/util/time_support.h"
 
@@ -76,6 +77,14 @@ public:
      */
     virtual bool recv(Message& m) = 0;
 
+    /**
+     * Reads, without blocking, as much of the next message as has arrived, for the next recv() to
+     * consume. Returns true if that recv() will not have to wait for the remote endpoint, and
+     * false if more of the message has yet to arrive. Ports which cannot read ahead, such as those
+     * of encrypted connections, return true.
+     */
+    virtual bool readAhead() = 0;
+
     /**
      * Sends a message as a reply to a received message.
      */
@@ -123,6 +132,11 @@ public:
      */
     virtual bool isStillConnected() const = 0;
 
+    /**
+     * The file descriptor of the underlying socket, or -1 if there is none.
+     */
+    virtual int rawFD() const = 0;
+
     /**
      * Point in time (in micro seconds) when this was created.
      */
@@ -186,6 +200,12 @@ public:
      * remoteHost - The hostname of the remote server.
      */
     virtual bool secure(SSLManagerInterface* ssl, const std::string& remoteHost) = 0;
+
+    /**
+     * The compression negotiated for this connection. Messages passed to say() are compressed with
+     * it and compressed messages returned by recv() are decompressed with it.
+     */
+    virtual MessageCompressorManager& getCompressorManager() = 0;
 };
 
 }  // namespace mongo
@@ -203,6 +203,11 @@ void ASIOMessagingPort::setTimeout(Milliseconds millis) {
 void ASIOMessagingPort::shutdown() {
     if (!_inShutdown.swap(true)) {
         if (_getSocket().native_handle() >= 0) {
+            // Shut the socket down before closing it, so that anything else waiting on the
+            // connection, such as a pooled service executor holding a duplicate of the
+            // descriptor, sees it end.
+            asio::error_code ec;
+            _getSocket().shutdown(asio::socket_base::shutdown_both, ec);
             _getSocket().close();
             _awaitingHandshake = true;
             _isEncrypted = false;
@@ -210,8 +215,23 @@ void ASIOMessagingPort::shutdown() {
     }
 }
 
+bool ASIOMessagingPort::readAhead() {
+    if (_isEncrypted) {
+        return true;
+    }
+    return _readAhead.fill(rawFD());
+}
+
 asio::error_code ASIOMessagingPort::_read(char* buf, std::size_t size) {
     invariant(buf);
+    const std::size_t readAhead = _readAhead.consume(buf, size);
+    _bytesIn += readAhead;
+    if (readAhead == size) {
+        return asio::error_code();
+    }
+    buf += readAhead;
+    size -= readAhead;
+
     if (_timeout) {
         _timer.expires_from_now(decltype(_timer)::duration(
             durationCount<Duration<decltype(_timer)::duration::period>>(*_timeout)));
@@ -380,6 +400,14 @@ bool ASIOMessagingPort::recv(Message& m) {
 
         guard.Dismiss();
         m.setData(md.view2ptr(), true);
+
+        Status status = _compressorManager.decompressMessage(&m);
+        if (!status.isOK()) {
+            LOG(_logLevel) << "recv(): failed to decompress message from " << remote() << ": "
+                           << status;
+            m.reset();
+            return false;
+        }
         return true;
 
     } catch (const asio::system_error& e) {
@@ -417,11 +445,16 @@ void ASIOMessagingPort::say(Message& toSend, int responseTo) {
     invariant(!toSend.empty());
     toSend.header().setId(nextMessageId());
     toSend.header().setResponseToMsgId(responseTo);
-    auto buf = toSend.buf();
+
+    Message compressed;
+    uassertStatusOK(_compressorManager.compressMessage(toSend, &compressed));
+    Message& msg = compressed.empty() ? toSend : compressed;
+
+    auto buf = msg.buf();
     if (buf) {
         send(buf, MsgData::ConstView(buf).getLen(), nullptr);
     } else {
-        send(toSend.dataBuffers(), nullptr);
+        send(msg.dataBuffers(), nullptr);
     }
 }
 
@@ -562,6 +595,10 @@ bool ASIOMessagingPort::isStillConnected() const {
     return _getSocket().is_open();
 }
 
+int ASIOMessagingPort::rawFD() const {
+    return const_cast<ASIOMessagingPort*>(this)->_getSocket().native_handle();
+}
+
 uint64_t ASIOMessagingPort::getSockCreationMicroSec() const {
     return _creationTime;
 }
@@ -38,6 +38,7 @@
 #include "mongo/util/net/abstract_message_port.h"
 #include "mongo/util/net/asio_ssl_context.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_read_ahead.h"
 #include "mongo/util/net/sockaddr.h"
 #include "mongo/util/time_support.h"
 
@@ -73,6 +74,8 @@ public:
 
     bool recv(Message& m) override;
 
+    bool readAhead() override;
+
     void reply(Message& received, Message& response, int32_t responseToMsgId) override;
     void reply(Message& received, Message& response) override;
 
@@ -93,6 +96,8 @@ public:
 
     bool isStillConnected() const override;
 
+    int rawFD() const override;
+
     uint64_t getSockCreationMicroSec() const override;
 
     void setLogLevel(logger::LogSeverity logLevel) override;
@@ -117,6 +122,10 @@ public:
 
     bool secure(SSLManagerInterface* ssl, const std::string& remoteHost) override;
 
+    MessageCompressorManager& getCompressorManager() override {
+        return _compressorManager;
+    }
+
     static void closeSockets(AbstractMessagingPort::Tag skipMask = kSkipAllMask);
 
 private:
@@ -148,6 +157,10 @@ private:
     long long _connectionId;
     AbstractMessagingPort::Tag _tag;
 
+    MessageCompressorManager _compressorManager;
+
+    MessageReadAhead _readAhead;
+
 #ifdef MONGO_CONFIG_SSL
     boost::optional<ASIOSSLContext> _context;
     asio::ssl::stream<asio::generic::stream_protocol::socket> _sslSock;
@@ -67,6 +67,7 @@ enum NetworkOp : int32_t {
     // dbCommandReply_DEPRECATED = 2009, //
     dbCommand = 2010,
     dbCommandReply = 2011,
+    dbCompressed = 2012, /* wraps any other message, compressed. See MessageCompressorManager. */
 };
 
 enum class LogicalOp {
@@ -132,6 +133,8 @@ inline const char* networkOpToString(NetworkOp networkOp) {
             return "command";
         case dbCommandReply:
             return "commandReply";
+        case dbCompressed:
+            return "compressed";
         default:
             int op = static_cast<int>(networkOp);
             massert(16141, str::stream() << "cannot translate opcode " << op, !op);
@@ -0,0 +1,307 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compressor_manager.h"
+
+#include <cstring>
+#include <vector>
+
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/util/builder.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+namespace {
+
+const char kCompressionField[] = "compression";
+
+// Between the message header and the compressed body: the opcode of the wrapped message, the size
+// of its body once decompressed, and the id of the compressor.
+const size_t kCompressedHeaderSize = sizeof(int32_t) + sizeof(int32_t) + sizeof(uint8_t);
+
+// Commands whose requests or replies carry credentials, or which run before compression is
+// negotiated. These are always sent uncompressed.
+const char* const kSensitiveCommands[] = {"isMaster",
+                                          "ismaster",
+                                          "saslStart",
+                                          "saslContinue",
+                                          "getnonce",
+                                          "authenticate",
+                                          "createUser",
+                                          "updateUser",
+                                          "copydbSaslStart",
+                                          "copydbgetnonce",
+                                          "copydb"};
+
+bool isSensitiveCommandName(StringData name) {
+    for (auto&& sensitive : kSensitiveCommands) {
+        if (name == sensitive) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads a null-terminated string starting at 'pos', advancing 'pos' past it. Returns false if the
+ * string is not terminated before 'end'.
+ */
+bool readCString(const char*& pos, const char* end, StringData* out) {
+    auto terminator = static_cast<const char*>(std::memchr(pos, '\0', end - pos));
+    if (!terminator) {
+        return false;
+    }
+    *out = StringData(pos, terminator - pos);
+    pos = terminator + 1;
+    return true;
+}
+
+/**
+ * Returns true if 'body', the body of a message with opcode 'op', is a command which must not be
+ * compressed. Messages which cannot be parsed are treated as sensitive.
+ */
+bool isSensitiveMessage(NetworkOp op, const char* body, const char* end) {
+    if (op == dbCommand) {
+        StringData database;
+        StringData commandName;
+        return !readCString(body, end, &database) || !readCString(body, end, &commandName) ||
+            isSensitiveCommandName(commandName);
+    }
+
+    if (op != dbQuery) {
+        return false;
+    }
+
+    // flags, ns, ntoskip, ntoreturn, then the query.
+    StringData ns;
+    body += sizeof(int32_t);
+    if (body > end || !readCString(body, end, &ns)) {
+        return true;
+    }
+    if (!ns.endsWith(".$cmd")) {
+        return false;
+    }
+    body += 2 * sizeof(int32_t);
+    if (body + sizeof(int32_t) > end) {
+        return true;
+    }
+    int32_t objSize = ConstDataView(body).read<LittleEndian<int32_t>>();
+    if (objSize < BSONObj().objsize() || objSize > end - body) {
+        return true;
+    }
+
+    BSONObj query(body);
+    BSONElement first = query.firstElement();
+    if ((first.fieldNameStringData() == "$query" || first.fieldNameStringData() == "query") &&
+        first.type() == Object) {
+        first = first.embeddedObject().firstElement();
+    }
+    return isSensitiveCommandName(first.fieldNameStringData());
+}
+
+}  // namespace
+
+MessageCompressorManager::MessageCompressorManager(MessageCompressorRegistry* registry)
+    : _registry(registry) {}
+
+void MessageCompressorManager::clientBegin(BSONObjBuilder* output) {
+    const auto& names = _registry->getSupportedCompressorNames();
+    if (names.empty()) {
+        return;
+    }
+    BSONArrayBuilder arr(output->subarrayStart(kCompressionField));
+    for (auto&& name : names) {
+        arr.append(name);
+    }
+}
+
+void MessageCompressorManager::clientFinish(const BSONObj& input) {
+    _outgoing = nullptr;
+    BSONElement elem = input[kCompressionField];
+    if (elem.type() != Array) {
+        return;
+    }
+    for (auto&& accepted : elem.Obj()) {
+        if (accepted.type() != String) {
+            continue;
+        }
+        if (auto compressor = _registry->getCompressor(accepted.valueStringData())) {
+            _outgoing = compressor;
+            return;
+        }
+    }
+}
+
+void MessageCompressorManager::serverNegotiate(const BSONObj& input,
+                                               BSONObjBuilder* output,
+                                               MessageCompressorRegistry* registry) {
+    BSONElement elem = input[kCompressionField];
+    if (elem.type() != Array) {
+        return;
+    }
+
+    std::vector<StringData> accepted;
+    for (auto&& offered : elem.Obj()) {
+        if (offered.type() == String && registry->getCompressor(offered.valueStringData())) {
+            accepted.push_back(offered.valueStringData());
+        }
+    }
+
+    BSONArrayBuilder arr(output->subarrayStart(kCompressionField));
+    for (auto&& name : accepted) {
+        arr.append(name);
+    }
+}
+
+Status MessageCompressorManager::compressMessage(const Message& msg, Message* compressed) {
+    invariant(compressed->empty());
+    if (!_outgoing && !_replyCompressor) {
+        return Status::OK();
+    }
+
+    // Messages built from several buffers are gathered into one before compressing.
+    std::vector<char> gathered;
+    const char* data;
+    if (msg.dataBuffers().empty()) {
+        data = msg.header().view2ptr();
+    } else {
+        gathered.reserve(msg.size());
+        for (auto&& buffer : msg.dataBuffers()) {
+            gathered.insert(gathered.end(), buffer.first, buffer.first + buffer.second);
+        }
+        data = gathered.data();
+    }
+
+    MsgData::ConstView original(data);
+    MessageCompressorBase* compressor = _outgoing;
+    if (!compressor && original.getResponseToMsgId() == _replyCompressorRequestId) {
+        compressor = _replyCompressor;
+    }
+    if (!compressor) {
+        return Status::OK();
+    }
+
+    const NetworkOp op = original.getNetworkOp();
+    const char* body = original.data();
+    const size_t bodySize = original.dataLen();
+    if (op == dbCompressed || isSensitiveMessage(op, body, body + bodySize)) {
+        return Status::OK();
+    }
+
+    const size_t headerSize = MsgData::MsgDataHeaderSize + kCompressedHeaderSize;
+    const size_t maxSize = headerSize + compressor->getMaxCompressedSize(bodySize);
+    char* buf = static_cast<char*>(mongoMalloc(maxSize));
+    Message out;
+    out.setData(buf, true);
+
+    MsgData::View outView(buf);
+    outView.setId(original.getId());
+    outView.setResponseToMsgId(original.getResponseToMsgId());
+    outView.setOperation(dbCompressed);
+
+    DataView extra(outView.data());
+    extra.write(tagLittleEndian<int32_t>(op));
+    extra.write(tagLittleEndian<int32_t>(bodySize), sizeof(int32_t));
+    extra.write(static_cast<uint8_t>(compressor->getId()), 2 * sizeof(int32_t));
+
+    auto swSize = compressor->compressData(ConstDataRange(body, bodySize),
+                                          DataRange(buf + headerSize, maxSize - headerSize));
+    if (!swSize.isOK()) {
+        return swSize.getStatus();
+    }
+
+    outView.setLen(headerSize + swSize.getValue());
+    *compressed = std::move(out);
+    return Status::OK();
+}
+
+Status MessageCompressorManager::decompressMessage(Message* msg) {
+    // Each reply is compressed only if the request it answers was, so forget the last request.
+    _replyCompressor = nullptr;
+    if (msg->operation() != dbCompressed) {
+        return Status::OK();
+    }
+
+    MsgData::ConstView input(msg->singleData().view2ptr());
+    if (input.dataLen() < static_cast<int>(kCompressedHeaderSize)) {
+        return Status(ErrorCodes::BadValue, "Compressed message is too short");
+    }
+
+    ConstDataView extra(input.data());
+    const int32_t originalOp = extra.read<LittleEndian<int32_t>>();
+    const int32_t uncompressedSize = extra.read<LittleEndian<int32_t>>(sizeof(int32_t));
+    const auto id = static_cast<MessageCompressorId>(extra.read<uint8_t>(2 * sizeof(int32_t)));
+
+    auto compressor = _registry->getCompressor(id);
+    if (!compressor) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Received message compressed with unsupported compressor "
+                                    << static_cast<int>(id));
+    }
+
+    if (uncompressedSize < 0 ||
+        static_cast<size_t>(uncompressedSize) + MsgData::MsgDataHeaderSize > MaxMessageSizeBytes) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Invalid uncompressed message size " << uncompressedSize);
+    }
+
+    const size_t outSize = MsgData::MsgDataHeaderSize + uncompressedSize;
+    char* buf = static_cast<char*>(mongoMalloc(outSize));
+    Message out;
+    out.setData(buf, true);
+
+    MsgData::View outView(buf);
+    outView.setLen(outSize);
+    outView.setId(input.getId());
+    outView.setResponseToMsgId(input.getResponseToMsgId());
+    outView.setOperation(originalOp);
+
+    auto swSize = compressor->decompressData(
+        ConstDataRange(input.data() + kCompressedHeaderSize,
+                       input.dataLen() - kCompressedHeaderSize),
+        DataRange(outView.data(), uncompressedSize));
+    if (!swSize.isOK()) {
+        return swSize.getStatus();
+    }
+
+    const char* body = outView.data();
+    if (!isSensitiveMessage(static_cast<NetworkOp>(originalOp), body, body + uncompressedSize)) {
+        _replyCompressor = compressor;
+        _replyCompressorRequestId = input.getId();
+    }
+    *msg = std::move(out);
+    return Status::OK();
+}
+
+}  // namespace mongo
@@ -0,0 +1,104 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/status.h"
+#include "mongo/util/net/message_compressor_registry.h"
+
+namespace mongo {
+
+class BSONObj;
+class BSONObjBuilder;
+class Message;
+
+/**
+ * Negotiates and applies compression for a single connection. A client offers the compressors it
+ * supports in its isMaster request with clientBegin(), and compresses every message it sends with
+ * the first compressor the server accepts once clientFinish() has seen the reply. A server answers
+ * the offer with serverNegotiate(), and decides for each reply on its own: a reply is compressed,
+ * with the compressor its request arrived in, only if that request was compressed and was not an
+ * authentication or handshake command. A peer which never compresses a message never receives a
+ * compressed one.
+ *
+ * Like the port which owns it, a MessageCompressorManager may only be used by one thread at a
+ * time.
+ */
+class MessageCompressorManager {
+    MONGO_DISALLOW_COPYING(MessageCompressorManager);
+
+public:
+    explicit MessageCompressorManager(
+        MessageCompressorRegistry* registry = &MessageCompressorRegistry::get());
+
+    /**
+     * Appends the supported compressors, in order of preference, to an outgoing isMaster request.
+     */
+    void clientBegin(BSONObjBuilder* output);
+
+    /**
+     * Reads the compressors accepted by the server from its isMaster reply and starts compressing
+     * outgoing messages with the first of them.
+     */
+    void clientFinish(const BSONObj& input);
+
+    /**
+     * Appends to an isMaster reply those compressors offered in the isMaster request 'input' which
+     * this process also supports, in the order the client listed them.
+     */
+    static void serverNegotiate(
+        const BSONObj& input,
+        BSONObjBuilder* output,
+        MessageCompressorRegistry* registry = &MessageCompressorRegistry::get());
+
+    /**
+     * Compresses 'msg' into 'compressed' if this connection compresses outgoing messages, or if
+     * 'msg' replies to the last request received and that request may be answered compressed.
+     * Leaves 'compressed' empty if 'msg' should be sent as is, either because neither applies or
+     * because 'msg' is an authentication or handshake command, which are never compressed.
+     */
+    Status compressMessage(const Message& msg, Message* compressed);
+
+    /**
+     * Replaces a dbCompressed message with the message it wraps, and leaves any other message
+     * unchanged. Replies to 'msg' are compressed with the same compressor only if it was
+     * compressed and is not an authentication or handshake command.
+     */
+    Status decompressMessage(Message* msg);
+
+private:
+    MessageCompressorRegistry* const _registry;
+    // The compressor negotiated by clientFinish(), used for every message sent.
+    MessageCompressorBase* _outgoing = nullptr;
+
+    // The compressor the last request received arrived in, if replies to it may be compressed.
+    MessageCompressorBase* _replyCompressor = nullptr;
+    int32_t _replyCompressorRequestId = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,244 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/util/builder.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor_manager.h"
+#include "mongo/util/net/message_compressor_registry.h"
+
+namespace mongo {
+namespace {
+
+Message buildQueryMessage(StringData ns, const BSONObj& query) {
+    BufBuilder builder;
+    builder.appendNum(0);
+    builder.appendStr(ns);
+    builder.appendNum(0);
+    builder.appendNum(-1);
+    query.appendSelfToBufBuilder(builder);
+
+    Message msg;
+    msg.setData(dbQuery, builder.buf(), builder.len());
+    msg.header().setId(1234);
+    msg.header().setResponseToMsgId(5678);
+    return msg;
+}
+
+/**
+ * Runs the isMaster handshake between 'client' and a server using 'serverRegistry', and returns
+ * the server's side of the reply.
+ */
+BSONObj negotiate(MessageCompressorManager* client, MessageCompressorRegistry* serverRegistry) {
+    BSONObjBuilder request;
+    request.append("isMaster", 1);
+    client->clientBegin(&request);
+
+    BSONObjBuilder reply;
+    MessageCompressorManager::serverNegotiate(request.obj(), &reply, serverRegistry);
+    BSONObj replyObj = reply.obj();
+    client->clientFinish(replyObj);
+    return replyObj;
+}
+
+void checkRoundTrip(const std::string& compressorName) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setSupportedCompressors(std::vector<std::string>{compressorName}));
+
+    MessageCompressorManager client(&registry);
+    MessageCompressorManager server(&registry);
+    negotiate(&client, &registry);
+
+    const std::string payload(10000, 'x');
+    Message original = buildQueryMessage("test.$cmd",
+                                         BSON("find"
+                                              << "coll"
+                                              << "filter"
+                                              << payload));
+
+    Message compressed;
+    ASSERT_OK(client.compressMessage(original, &compressed));
+    ASSERT_FALSE(compressed.empty());
+    ASSERT_EQUALS(dbCompressed, compressed.operation());
+    ASSERT_EQUALS(original.header().getId(), compressed.header().getId());
+    ASSERT_EQUALS(original.header().getResponseToMsgId(),
+                  compressed.header().getResponseToMsgId());
+    ASSERT_LESS_THAN(compressed.size(), original.size());
+
+    ASSERT_OK(server.decompressMessage(&compressed));
+    ASSERT_EQUALS(dbQuery, compressed.operation());
+    ASSERT_EQUALS(original.size(), compressed.size());
+    ASSERT_EQUALS(0, std::memcmp(original.buf(), compressed.buf(), original.size()));
+
+    // The server replies with the compressor the request arrived in.
+    Message reply = buildQueryMessage("test.coll", BSON("x" << payload));
+    reply.header().setResponseToMsgId(original.header().getId());
+    Message compressedReply;
+    ASSERT_OK(server.compressMessage(reply, &compressedReply));
+    ASSERT_FALSE(compressedReply.empty());
+
+    auto compressor = registry.getCompressor(compressorName);
+    ASSERT(compressor);
+    ASSERT_EQUALS(original.dataSize() + reply.dataSize(), compressor->getCompressorBytesIn());
+    ASSERT_EQUALS(original.dataSize(), compressor->getDecompressorBytesOut());
+}
+
+TEST(MessageCompressorManager, SnappyRoundTrip) {
+    checkRoundTrip("snappy");
+}
+
+TEST(MessageCompressorManager, ZlibRoundTrip) {
+    checkRoundTrip("zlib");
+}
+
+TEST(MessageCompressorManager, NegotiatesFirstCommonCompressorInClientOrder) {
+    MessageCompressorRegistry clientRegistry;
+    ASSERT_OK(clientRegistry.setSupportedCompressors("zlib,snappy"));
+    MessageCompressorRegistry serverRegistry;
+    ASSERT_OK(serverRegistry.setSupportedCompressors("snappy,zlib"));
+
+    MessageCompressorManager client(&clientRegistry);
+    BSONObj reply = negotiate(&client, &serverRegistry);
+    ASSERT_EQUALS(BSON("compression" << BSON_ARRAY("zlib"
+                                                   << "snappy")),
+                  reply);
+
+    Message compressed;
+    ASSERT_OK(client.compressMessage(buildQueryMessage("test.coll", BSONObj()), &compressed));
+    ASSERT_FALSE(compressed.empty());
+    ASSERT_EQUALS(static_cast<char>(MessageCompressorId::kZlib),
+                  compressed.singleData().data()[2 * sizeof(int32_t)]);
+}
+
+TEST(MessageCompressorManager, NoCompressionWithoutCommonCompressor) {
+    MessageCompressorRegistry clientRegistry;
+    ASSERT_OK(clientRegistry.setSupportedCompressors("snappy"));
+    MessageCompressorRegistry serverRegistry;
+    ASSERT_OK(serverRegistry.setSupportedCompressors("zlib"));
+
+    MessageCompressorManager client(&clientRegistry);
+    negotiate(&client, &serverRegistry);
+
+    Message compressed;
+    ASSERT_OK(client.compressMessage(buildQueryMessage("test.coll", BSONObj()), &compressed));
+    ASSERT_TRUE(compressed.empty());
+}
+
+TEST(MessageCompressorManager, ServerIgnoresRequestWithoutCompression) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setSupportedCompressors("snappy"));
+
+    BSONObjBuilder reply;
+    MessageCompressorManager::serverNegotiate(BSON("isMaster" << 1), &reply, &registry);
+    ASSERT_EQUALS(BSONObj(), reply.obj());
+}
+
+TEST(MessageCompressorManager, SensitiveCommandsAreNotCompressed) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setSupportedCompressors("snappy"));
+    MessageCompressorManager client(&registry);
+    negotiate(&client, &registry);
+
+    for (auto&& query : {BSON("saslStart" << 1), BSON("isMaster" << 1),
+                         BSON("$query" << BSON("authenticate" << 1)),
+                         BSON("createUser"
+                              << "user")}) {
+        Message compressed;
+        ASSERT_OK(client.compressMessage(buildQueryMessage("admin.$cmd", query), &compressed));
+        ASSERT_TRUE(compressed.empty());
+    }
+
+    // The same names are ordinary fields outside of commands.
+    Message compressed;
+    ASSERT_OK(client.compressMessage(buildQueryMessage("admin.coll", BSON("saslStart" << 1)),
+                                     &compressed));
+    ASSERT_FALSE(compressed.empty());
+}
+
+TEST(MessageCompressorManager, ServerCompressesOnlyRepliesToCompressedRequests) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setSupportedCompressors("snappy"));
+    MessageCompressorManager client(&registry);
+    MessageCompressorManager server(&registry);
+    negotiate(&client, &registry);
+
+    Message request = buildQueryMessage("test.coll", BSONObj());
+    Message compressedRequest;
+    ASSERT_OK(client.compressMessage(request, &compressedRequest));
+    ASSERT_OK(server.decompressMessage(&compressedRequest));
+
+    Message reply = buildQueryMessage("test.coll", BSONObj());
+    reply.header().setResponseToMsgId(request.header().getId() + 1);
+    Message compressedReply;
+    ASSERT_OK(server.compressMessage(reply, &compressedReply));
+    ASSERT_TRUE(compressedReply.empty());
+
+    // An uncompressed request is answered uncompressed, even after a compressed one.
+    Message uncompressedRequest = buildQueryMessage("test.coll", BSONObj());
+    ASSERT_OK(server.decompressMessage(&uncompressedRequest));
+    reply.header().setResponseToMsgId(uncompressedRequest.header().getId());
+    ASSERT_OK(server.compressMessage(reply, &compressedReply));
+    ASSERT_TRUE(compressedReply.empty());
+}
+
+TEST(MessageCompressorManager, RejectsUnsupportedCompressor) {
+    MessageCompressorRegistry clientRegistry;
+    ASSERT_OK(clientRegistry.setSupportedCompressors("snappy"));
+    MessageCompressorManager client(&clientRegistry);
+    negotiate(&client, &clientRegistry);
+
+    Message compressed;
+    ASSERT_OK(client.compressMessage(buildQueryMessage("test.coll", BSONObj()), &compressed));
+
+    MessageCompressorRegistry serverRegistry;
+    ASSERT_OK(serverRegistry.setSupportedCompressors("zlib"));
+    MessageCompressorManager server(&serverRegistry);
+    ASSERT_NOT_OK(server.decompressMessage(&compressed));
+}
+
+TEST(MessageCompressorRegistry, RejectsUnknownCompressor) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setSupportedCompressors("snappy"));
+    ASSERT_NOT_OK(registry.setSupportedCompressors("snappy,lz4"));
+    ASSERT_EQUALS(1U, registry.getSupportedCompressorNames().size());
+    ASSERT_EQUALS("snappy", registry.getSupportedCompressorNames().front());
+
+    ASSERT_OK(registry.setSupportedCompressors("disabled"));
+    ASSERT_TRUE(registry.getSupportedCompressorNames().empty());
+    ASSERT(!registry.getCompressor(MessageCompressorId::kSnappy));
+}
+
+}  // namespace
+}  // namespace mongo
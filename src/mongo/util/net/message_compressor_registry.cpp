@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compressor_registry.h"
+
+#include <algorithm>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include "mongo/base/init.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/util/net/message_compressor_snappy.h"
+#include "mongo/util/net/message_compressor_zlib.h"
+
+namespace mongo {
+
+namespace {
+
+const char kDisabledCompressors[] = "disabled";
+
+// The compressors this process offers to, and accepts from, its peers in isMaster, in order of
+// preference, e.g. "snappy,zlib".
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(networkMessageCompressors,
+                                      std::string,
+                                      kDisabledCompressors);
+
+MONGO_INITIALIZER_WITH_PREREQUISITES(NetworkMessageCompressors, ("EndStartupOptionStorage"))
+(InitializerContext*) {
+    return MessageCompressorRegistry::get().setSupportedCompressors(networkMessageCompressors);
+}
+
+}  // namespace
+
+MessageCompressorRegistry::MessageCompressorRegistry() {
+    _compressors.push_back(stdx::make_unique<SnappyMessageCompressor>());
+    _compressors.push_back(stdx::make_unique<ZlibMessageCompressor>());
+    _supportedById.fill(nullptr);
+}
+
+MessageCompressorRegistry& MessageCompressorRegistry::get() {
+    static MessageCompressorRegistry registry;
+    return registry;
+}
+
+Status MessageCompressorRegistry::setSupportedCompressors(const std::vector<std::string>& names) {
+    std::array<MessageCompressorBase*, 256> supportedById;
+    supportedById.fill(nullptr);
+
+    for (auto&& name : names) {
+        auto it = std::find_if(_compressors.begin(), _compressors.end(), [&](const auto& c) {
+            return c->getName() == name;
+        });
+        if (it == _compressors.end()) {
+            return Status(ErrorCodes::BadValue, "Unknown network message compressor: " + name);
+        }
+        supportedById[static_cast<uint8_t>((*it)->getId())] = it->get();
+    }
+
+    _supportedNames = names;
+    _supportedById = supportedById;
+    return Status::OK();
+}
+
+Status MessageCompressorRegistry::setSupportedCompressors(const std::string& commaSeparatedNames) {
+    std::vector<std::string> names;
+    if (!commaSeparatedNames.empty() && commaSeparatedNames != kDisabledCompressors) {
+        boost::split(names, commaSeparatedNames, boost::is_any_of(","));
+    }
+    return setSupportedCompressors(names);
+}
+
+MessageCompressorBase* MessageCompressorRegistry::getCompressor(MessageCompressorId id) const {
+    return _supportedById[static_cast<uint8_t>(id)];
+}
+
+MessageCompressorBase* MessageCompressorRegistry::getCompressor(StringData name) const {
+    for (auto&& compressor : _supportedById) {
+        if (compressor && compressor->getName() == name) {
+            return compressor;
+        }
+    }
+    return nullptr;
+}
+
+void MessageCompressorRegistry::appendStats(BSONObjBuilder* builder) const {
+    for (auto&& name : _supportedNames) {
+        auto compressor = getCompressor(name);
+        BSONObjBuilder compressorBuilder(builder->subobjStart(name));
+        {
+            BSONObjBuilder sub(compressorBuilder.subobjStart("compressor"));
+            sub.append("bytesIn", static_cast<long long>(compressor->getCompressorBytesIn()));
+            sub.append("bytesOut", static_cast<long long>(compressor->getCompressorBytesOut()));
+        }
+        {
+            BSONObjBuilder sub(compressorBuilder.subobjStart("decompressor"));
+            sub.append("bytesIn", static_cast<long long>(compressor->getDecompressorBytesIn()));
+            sub.append("bytesOut", static_cast<long long>(compressor->getDecompressorBytesOut()));
+        }
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,98 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/base/string_data.h"
+#include "mongo/util/net/message_compressor_base.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * Owns the compressors which this process may use to compress messages on the wire, and records
+ * which of them it is configured to negotiate with its peers.
+ */
+class MessageCompressorRegistry {
+    MONGO_DISALLOW_COPYING(MessageCompressorRegistry);
+
+public:
+    /**
+     * Constructs a registry holding every compressor built into the server, none of which are
+     * supported until setSupportedCompressors() is called.
+     */
+    MessageCompressorRegistry();
+
+    /**
+     * The registry used by every connection in this process.
+     */
+    static MessageCompressorRegistry& get();
+
+    /**
+     * Sets the compressors, by name, which this process negotiates, in order of preference. Fails
+     * without changing anything if a name is not that of a registered compressor. Not safe to call
+     * while connections may be negotiating compression.
+     */
+    Status setSupportedCompressors(const std::vector<std::string>& names);
+
+    /**
+     * Parses a comma-separated list of compressor names, as passed to networkMessageCompressors,
+     * and calls setSupportedCompressors(). "disabled" or the empty string disables compression.
+     */
+    Status setSupportedCompressors(const std::string& commaSeparatedNames);
+
+    const std::vector<std::string>& getSupportedCompressorNames() const {
+        return _supportedNames;
+    }
+
+    /**
+     * Returns the supported compressor with the given id or name, or nullptr if there is none.
+     */
+    MessageCompressorBase* getCompressor(MessageCompressorId id) const;
+    MessageCompressorBase* getCompressor(StringData name) const;
+
+    /**
+     * Appends the byte counters of every supported compressor, keyed by name, to 'builder'.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+private:
+    std::vector<std::unique_ptr<MessageCompressorBase>> _compressors;
+    std::vector<std::string> _supportedNames;
+    std::array<MessageCompressorBase*, 256> _supportedById;
+};
+
+}  // namespace mongo
@@ -0,0 +1,86 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compressor_zlib.h"
+
+#include <zlib.h>
+
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+ZlibMessageCompressor::ZlibMessageCompressor()
+    : MessageCompressorBase(MessageCompressorId::kZlib, "zlib") {}
+
+std::size_t ZlibMessageCompressor::getMaxCompressedSize(std::size_t inputSize) {
+    return ::compressBound(inputSize);
+}
+
+StatusWith<std::size_t> ZlibMessageCompressor::compressData(ConstDataRange input,
+                                                            DataRange output) {
+    uLongf outLength = output.length();
+    int ret = ::compress2(reinterpret_cast<Bytef*>(const_cast<char*>(output.data())),
+                          &outLength,
+                          reinterpret_cast<const Bytef*>(input.data()),
+                          input.length(),
+                          Z_DEFAULT_COMPRESSION);
+
+    if (ret != Z_OK) {
+        return Status(ErrorCodes::ZLibError, str::stream() << "compress2 failed with " << ret);
+    }
+
+    counterHitCompress(input.length(), outLength);
+    return {outLength};
+}
+
+StatusWith<std::size_t> ZlibMessageCompressor::decompressData(ConstDataRange input,
+                                                              DataRange output) {
+    uLongf outLength = output.length();
+    int ret = ::uncompress(reinterpret_cast<Bytef*>(const_cast<char*>(output.data())),
+                           &outLength,
+                           reinterpret_cast<const Bytef*>(input.data()),
+                           input.length());
+
+    if (ret != Z_OK) {
+        return Status(ErrorCodes::ZLibError, str::stream() << "uncompress failed with " << ret);
+    }
+
+    if (outLength != output.length()) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "zlib data decompressed to " << outLength
+                                    << " bytes, expected "
+                                    << output.length());
+    }
+
+    counterHitDecompress(input.length(), outLength);
+    return {outLength};
+}
+
+}  // namespace mongo
@@ -132,7 +132,7 @@ bool MessagingPort::recv(Message& m) {
 #endif
         MSGHEADER::Value header;
         int headerLen = sizeof(MSGHEADER::Value);
-        _psock->recv((char*)&header, headerLen);
+        _recv((char*)&header, headerLen);
         int len = header.constView().getMessageLength();
 
         if (len == 542393671) {
@@ -191,10 +191,17 @@ bool MessagingPort::recv(Message& m) {
         memcpy(md.view2ptr(), &header, headerLen);
         int left = len - headerLen;
 
-        _psock->recv(md.data(), left);
+        _recv(md.data(), left);
 
         guard.Dismiss();
         m.setData(md.view2ptr(), true);
+
+        Status status = _compressorManager.decompressMessage(&m);
+        if (!status.isOK()) {
+            LOG(0) << "recv(): failed to decompress message from " << remote() << ": " << status;
+            m.reset();
+            return false;
+        }
         return true;
 
     } catch (const SocketException& e) {
@@ -207,6 +214,18 @@ bool MessagingPort::recv(Message& m) {
     }
 }
 
+bool MessagingPort::readAhead() {
+    return _readAhead.fill(rawFD());
+}
+
+void MessagingPort::_recv(char* buf, int len) {
+    const int readAhead = static_cast<int>(_readAhead.consume(buf, len));
+    _readAheadBytesIn += readAhead;
+    if (readAhead < len) {
+        _psock->recv(buf + readAhead, len - readAhead);
+    }
+}
+
 void MessagingPort::reply(Message& received, Message& response) {
     say(/*received.from, */ response, received.header().getId());
 }
@@ -231,11 +250,16 @@ void MessagingPort::say(Message& toSend, int responseTo) {
     verify(!toSend.empty());
     toSend.header().setId(nextMessageId());
     toSend.header().setResponseToMsgId(responseTo);
-    auto buf = toSend.buf();
+
+    Message compressed;
+    uassertStatusOK(_compressorManager.compressMessage(toSend, &compressed));
+    Message& msg = compressed.empty() ? toSend : compressed;
+
+    auto buf = msg.buf();
     if (buf) {
         send(buf, MsgData::ConstView(buf).getLen(), "say");
     } else {
-        send(toSend.dataBuffers(), "say");
+        send(msg.dataBuffers(), "say");
     }
 }
 
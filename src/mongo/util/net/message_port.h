@@ -34,6 +34,7 @@
 #include "mongo/config.h"
 #include "mongo/util/net/abstract_message_port.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_read_ahead.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
@@ -61,6 +62,7 @@ public:
        also, the Message data will go out of scope on the subsequent recv call.
     */
     bool recv(Message& m) override;
+    bool readAhead() override;
     void reply(Message& received, Message& response, int32_t responseToMsgId) override;
     void reply(Message& received, Message& response) override;
     bool call(Message& toSend, Message& response) override;
@@ -90,10 +92,11 @@ public:
 
     void clearCounters() override {
         _psock->clearCounters();
+        _readAheadBytesIn = 0;
     }
 
     long long getBytesIn() const override {
-        return _psock->getBytesIn();
+        return _psock->getBytesIn() + _readAheadBytesIn;
     }
 
     long long getBytesOut() const override {
@@ -131,17 +134,37 @@ public:
         return _psock->isStillConnected();
     }
 
+    int rawFD() const override {
+        return _psock->rawFD();
+    }
+
     uint64_t getSockCreationMicroSec() const override {
         return _psock->getSockCreationMicroSec();
     }
 
+    MessageCompressorManager& getCompressorManager() override {
+        return _compressorManager;
+    }
+
 private:
+    /**
+     * Reads 'len' bytes into 'buf', first from '_readAhead' and then from the socket.
+     */
+    void _recv(char* buf, int len);
+
     // this is the parsed version of remote
     HostAndPort _remoteParsed;
     std::string _x509SubjectName;
     long long _connectionId;
     AbstractMessagingPort::Tag _tag;
     std::shared_ptr<Socket> _psock;
+    MessageCompressorManager _compressorManager;
+
+    MessageReadAhead _readAhead;
+
+    // Bytes consumed from '_readAhead' since the counters were cleared, which the socket does not
+    // count.
+    long long _readAheadBytesIn = 0;
 
 
 public:
@@ -51,6 +51,10 @@ bool MessagingPortMock::recv(Message& m) {
     return true;
 }
 
+bool MessagingPortMock::readAhead() {
+    return true;
+}
+
 void MessagingPortMock::reply(Message& received, Message& response, int32_t responseToMsgId) {}
 void MessagingPortMock::reply(Message& received, Message& response) {}
 
@@ -83,6 +87,14 @@ bool MessagingPortMock::isStillConnected() const {
     return true;
 }
 
+int MessagingPortMock::rawFD() const {
+    return -1;
+}
+
+MessageCompressorManager& MessagingPortMock::getCompressorManager() {
+    return _compressorManager;
+}
+
 void MessagingPortMock::setLogLevel(logger::LogSeverity logLevel) {}
 
 void MessagingPortMock::clearCounters() {}
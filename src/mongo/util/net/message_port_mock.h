@@ -51,6 +51,8 @@ public:
 
     bool recv(Message& m) override;
 
+    bool readAhead() override;
+
     void reply(Message& received, Message& response, int32_t responseToMsgId) override;
     void reply(Message& received, Message& response) override;
 
@@ -68,6 +70,8 @@ public:
 
     bool isStillConnected() const override;
 
+    int rawFD() const override;
+
     void setLogLevel(logger::LogSeverity logLevel) override;
 
     void clearCounters() override;
@@ -92,10 +96,13 @@ public:
 
     bool secure(SSLManagerInterface* ssl, const std::string& remoteHost) override;
 
+    MessageCompressorManager& getCompressorManager() override;
+
     void setRemote(const HostAndPort& remote);
 
 private:
     HostAndPort _remote;
+    MessageCompressorManager _compressorManager;
 };
 
 }  // namespace mongo
@@ -47,10 +47,50 @@ MONGO_INITIALIZER(messagePortImpl)(InitializerContext*) {
     return Status::OK();
 }
 
+const char kServiceExecutorSynchronous[] = "synchronous";
+const char kServiceExecutorPooled[] = "pooled";
+
+// "synchronous" runs each connection on a thread of its own. "pooled" waits for requests on all
+// connections with a single reactor and runs each request on a bounded pool of worker threads.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(serviceExecutor, std::string, kServiceExecutorSynchronous);
+
+// The most worker threads the pooled service executor runs requests on. A request which waits on
+// another client, such as a write waiting for fsyncUnlock, holds its worker while it waits.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(serviceExecutorMaxThreads, int, 256);
+
+MONGO_INITIALIZER(serviceExecutor)(InitializerContext*) {
+    if ((serviceExecutor != kServiceExecutorSynchronous) &&
+        (serviceExecutor != kServiceExecutorPooled)) {
+        return Status(ErrorCodes::BadValue, "unsupported service executor: " + serviceExecutor);
+    }
+#ifdef _WIN32
+    if (serviceExecutor == kServiceExecutorPooled) {
+        return Status(ErrorCodes::BadValue,
+                      "the pooled service executor is not supported on Windows");
+    }
+#endif
+    if (serviceExecutorMaxThreads < 1) {
+        return Status(ErrorCodes::BadValue, "serviceExecutorMaxThreads must be at least 1");
+    }
+    return Status::OK();
+}
+
 }  // namespace
 
 bool isMessagePortImplASIO() {
     return messagePortImpl == kMessagePortImplASIO;
 }
 
+bool isServiceExecutorPooled() {
+    return serviceExecutor == kServiceExecutorPooled;
+}
+
+std::string getServiceExecutorName() {
+    return serviceExecutor;
+}
+
+int getServiceExecutorMaxThreads() {
+    return serviceExecutorMaxThreads;
+}
+
 }  // namespace mongo
@@ -28,8 +28,20 @@
 
 #pragma once
 
+#include <string>
+
 namespace mongo {
 
 bool isMessagePortImplASIO();
 
+/**
+ * Returns true if the server runs requests from all connections on a bounded pool of threads,
+ * rather than running each connection on a thread of its own.
+ */
+bool isServiceExecutorPooled();
+
+std::string getServiceExecutorName();
+
+int getServiceExecutorMaxThreads();
+
 }  // namespace mongo
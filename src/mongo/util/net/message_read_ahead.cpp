@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2016 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_read_ahead.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+#include "mongo/util/net/message.h"
+
+namespace mongo {
+
+bool MessageReadAhead::fill(int fd) {
+#ifdef _WIN32
+    return true;
+#else
+    if (_consumed == _buffer.size()) {
+        _buffer.clear();
+        _consumed = 0;
+    } else if (_consumed > 0) {
+        _buffer.erase(_buffer.begin(), _buffer.begin() + _consumed);
+        _consumed = 0;
+    }
+
+    const std::size_t headerLen = sizeof(MSGHEADER::Value);
+    while (true) {
+        std::size_t wanted = headerLen;
+        if (_buffer.size() >= headerLen) {
+            const int32_t len = MsgData::ConstView(_buffer.data()).getLen();
+            if (static_cast<std::size_t>(len) < headerLen ||
+                static_cast<std::size_t>(len) > MaxMessageSizeBytes) {
+                // recv() rejects the message as soon as it reads the header.
+                return true;
+            }
+            wanted = len;
+        }
+        if (_buffer.size() >= wanted) {
+            return true;
+        }
+
+        const std::size_t buffered = _buffer.size();
+        _buffer.resize(wanted);
+        const ssize_t received =
+            ::recv(fd, _buffer.data() + buffered, wanted - buffered, MSG_DONTWAIT);
+        _buffer.resize(buffered + std::max<ssize_t>(received, 0));
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return false;
+        }
+        if (received <= 0) {
+            // recv() finds the closed or failed socket once it has consumed the buffered bytes.
+            return true;
+        }
+    }
+#endif
+}
+
+std::size_t MessageReadAhead::consume(char* buf, std::size_t size) {
+    const std::size_t n = std::min(size, _buffer.size() - _consumed);
+    if (n > 0) {
+        std::memcpy(buf, _buffer.data() + _consumed, n);
+        _consumed += n;
+    }
+    if (_consumed == _buffer.size()) {
+        _buffer.clear();
+        _consumed = 0;
+    }
+    return n;
+}
+
+}  // namespace mongo
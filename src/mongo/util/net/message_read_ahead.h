@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2016 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mongo {
+
+/**
+ * Bytes of a connection's next incoming message which its messaging port has read from the
+ * socket, without blocking, before recv() was called. recv() consumes them before it reads from
+ * the socket itself.
+ *
+ * This lets a server wait for a whole request to arrive before it gives the connection a thread
+ * to run on, so that a client which sends part of a request and then stalls cannot hold a thread.
+ */
+class MessageReadAhead {
+public:
+    /**
+     * Reads from 'fd', without blocking, until a whole message has been buffered. Returns true if
+     * recv() can now return without waiting for the remote endpoint: a whole message has been
+     * buffered, or a header which recv() will reject, or the socket has been closed or has failed.
+     * Returns false if the rest of the message has not yet arrived.
+     *
+     * 'fd' must not be an encrypted connection, whose bytes the port must decrypt as it reads them.
+     */
+    bool fill(int fd);
+
+    /**
+     * Moves up to 'size' buffered bytes to 'buf', and returns how many were moved.
+     */
+    std::size_t consume(char* buf, std::size_t size);
+
+private:
+    std::vector<char> _buffer;
+
+    // How many bytes at the front of '_buffer' have already been consumed.
+    std::size_t _consumed = 0;
+};
+
+}  // namespace mongo
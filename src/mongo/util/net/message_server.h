@@ -36,10 +36,20 @@
 
 #include "mongo/platform/basic.h"
 
+#include <memory>
+
 namespace mongo {
 
 class MessageHandler {
 public:
+    /**
+     * Per-connection state which suspend() detached from a thread, for resume() to reattach.
+     */
+    class SuspendedConnection {
+    public:
+        virtual ~SuspendedConnection() = default;
+    };
+
     virtual ~MessageHandler() {}
 
     /**
@@ -58,6 +68,24 @@ public:
      * connected() method) is no longer valid.
      */
     virtual void close() = 0;
+
+    /**
+     * Detaches the state set up by connected() for the connection running on the current thread,
+     * so that its next message can be processed on a different thread. Returns nullptr if the
+     * handler's state cannot be moved between threads, in which case the connection stays on a
+     * thread of its own.
+     *
+     * Only called by servers which run connections on a shared pool of threads.
+     */
+    virtual std::unique_ptr<SuspendedConnection> suspend() {
+        return nullptr;
+    }
+
+    /**
+     * Reattaches 'connection', which was returned by suspend(), to the current thread before the
+     * connection's next call to process() or close().
+     */
+    virtual void resume(std::unique_ptr<SuspendedConnection> connection) {}
 };
 
 class MessageServer {
@@ -31,9 +31,17 @@
 
 #include "mongo/platform/basic.h"
 
+#include <deque>
+#include <limits>
 #include <memory>
 #include <system_error>
 
+#ifndef _WIN32
+#include <asio.hpp>
+#include <asio/steady_timer.hpp>
+#include <unistd.h>
+#endif
+
 #include "mongo/base/disallow_copying.h"
 #include "mongo/config.h"
 #include "mongo/db/lasterror.h"
@@ -44,6 +52,7 @@
 #include "mongo/stdx/thread.h"
 #include "mongo/util/concurrency/synchronization.h"
 #include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/exit.h"
@@ -52,11 +61,13 @@
 #include "mongo/util/net/abstract_message_port.h"
 #include "mongo/util/net/listen.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port_startup_param.h"
 #include "mongo/util/net/message_server.h"
 #include "mongo/util/net/socket_exception.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/quick_exit.h"
 #include "mongo/util/scopeguard.h"
+#include "mongo/util/time_support.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
 #include <sys/resource.h>
@@ -75,6 +86,344 @@ namespace {
 
 using MessagingPortWithHandler = std::pair<AbstractMessagingPort*, std::shared_ptr<MessageHandler>>;
 
+using SessionState = ServiceExecutorCounter::SessionState;
+
+#ifndef _WIN32
+/**
+ * Runs connections on a bounded pool of worker threads, instead of on a thread per connection.
+ *
+ * Between requests a connection is idle, and a single reactor thread waits, using ASIO, for the
+ * socket of any idle connection to become readable. The reactor reads what has arrived without
+ * blocking, with AbstractMessagingPort::readAhead(), and once the whole request has arrived the
+ * connection is queued to run on the worker pool. There its request is processed and answered,
+ * after which it goes back to waiting in the reactor. So a client which stalls part way through
+ * sending a request holds no worker. The MessageHandler's per-connection state moves between
+ * threads with MessageHandler::suspend() and resume().
+ *
+ * Requests may block for a long time, waiting on locks, on awaitData cursors or on other requests.
+ * If no worker takes a queued connection for a whole starvation check interval, every worker may
+ * be blocked on work which the queued connections would do, so the queued connections are run on
+ * overflow threads instead. Overflow threads exit soon after they become idle.
+ *
+ * The reactor waits on a duplicate of each connection's file descriptor, so that the connection
+ * is never closed while the reactor is watching it. Closing a MessagingPort shuts its socket down
+ * first, which wakes the reactor and ends the connection.
+ */
+class PooledSessionRunner {
+    MONGO_DISALLOW_COPYING(PooledSessionRunner);
+
+public:
+    explicit PooledSessionRunner(int maxThreads)
+        : _workers(makeWorkerPoolOptions(maxThreads)),
+          _overflowWorkers(makeOverflowPoolOptions()),
+          _reactorWork(_reactor),
+          _starvationTimer(_reactor) {
+        _workers.startup();
+        _overflowWorkers.startup();
+        _scheduleStarvationCheck();
+        _reactorThread = stdx::thread([this] {
+            setThreadName("sessionReactor");
+            _reactor.run();
+        });
+    }
+
+    ~PooledSessionRunner() {
+        _reactor.stop();
+        _reactorThread.join();
+        _workers.shutdown();
+        _overflowWorkers.shutdown();
+        _workers.join();
+        _overflowWorkers.join();
+    }
+
+    /**
+     * Starts running the connection on 'mp', for which the caller has acquired a ticket from
+     * Listener::globalTicketHolder. Returns false, leaving the connection and its ticket to the
+     * caller, if the connection cannot be watched by the reactor.
+     */
+    bool startSession(AbstractMessagingPort* mp, std::shared_ptr<MessageHandler> handler) {
+        const int fd = mp->rawFD();
+        if (fd < 0) {
+            return false;
+        }
+
+        const int watchedFd = ::dup(fd);
+        if (watchedFd < 0) {
+            return false;
+        }
+
+        auto session = std::make_shared<Session>(mp, std::move(handler), _reactor);
+        session->descriptor.assign(watchedFd);
+
+        // The connection runs at once, to call MessageHandler::connected().
+        serviceExecutorCounter.changeState(SessionState::kNone, SessionState::kQueued);
+        _schedule(std::move(session));
+        return true;
+    }
+
+private:
+    struct Session {
+        Session(AbstractMessagingPort* mp,
+                std::shared_ptr<MessageHandler> handler,
+                asio::io_service& reactor)
+            : port(mp), handler(std::move(handler)), descriptor(reactor) {}
+
+        AbstractMessagingPort* const port;
+        const std::shared_ptr<MessageHandler> handler;
+
+        // A duplicate of the port's file descriptor, on which the reactor waits for requests.
+        asio::posix::stream_descriptor descriptor;
+
+        // Set while the connection is not running on a worker, after connected() has been called.
+        std::unique_ptr<MessageHandler::SuspendedConnection> suspended;
+
+        bool connected = false;
+        Message message;
+    };
+
+    // How often the reactor checks whether queued connections are starved of workers.
+    static constexpr Milliseconds kStarvationCheckInterval{100};
+
+    static ThreadPool::Options makeWorkerPoolOptions(int maxThreads) {
+        ThreadPool::Options options;
+        options.poolName = "ServiceExecutor";
+        options.threadNamePrefix = "worker-";
+        options.minThreads = 1;
+        options.maxThreads = maxThreads;
+        return options;
+    }
+
+    static ThreadPool::Options makeOverflowPoolOptions() {
+        ThreadPool::Options options;
+        options.poolName = "ServiceExecutorOverflow";
+        options.threadNamePrefix = "overflowWorker-";
+        options.minThreads = 0;
+        // Each connection holds at most one thread, so the connection limit bounds this pool.
+        options.maxThreads = std::numeric_limits<size_t>::max();
+        options.maxIdleThreadAge = Seconds{1};
+        return options;
+    }
+
+    /**
+     * Queues 'session', which has been counted as queued, to run on the worker pool.
+     */
+    void _schedule(std::shared_ptr<Session> session) {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _queued.push_back(std::move(session));
+        }
+
+        Status status = _workers.schedule([this] { _runNext(); });
+        if (!status.isOK()) {
+            // The pool only refuses work once it is shutting down.
+            if (auto next = _popQueued()) {
+                serviceExecutorCounter.changeState(SessionState::kQueued, SessionState::kRunning);
+                _endSession(next.get());
+            }
+        }
+    }
+
+    /**
+     * Removes and returns the longest queued session, or nullptr if none is queued.
+     */
+    std::shared_ptr<Session> _popQueued() {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_queued.empty()) {
+            return nullptr;
+        }
+        auto session = std::move(_queued.front());
+        _queued.pop_front();
+        ++_dequeued;
+        return session;
+    }
+
+    /**
+     * Runs the longest queued session, if an overflow thread has not already taken it.
+     */
+    void _runNext() {
+        if (auto session = _popQueued()) {
+            _run(std::move(session));
+        }
+    }
+
+    void _scheduleStarvationCheck() {
+        _starvationTimer.expires_from_now(decltype(_starvationTimer)::duration(
+            durationCount<Duration<decltype(_starvationTimer)::duration::period>>(
+                kStarvationCheckInterval)));
+        _starvationTimer.async_wait([this](const asio::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            _checkForStarvation();
+            _scheduleStarvationCheck();
+        });
+    }
+
+    /**
+     * Runs the queued sessions on overflow threads if no worker has taken a queued session since
+     * the last check.
+     */
+    void _checkForStarvation() {
+        size_t starved = 0;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (!_queued.empty() && _dequeued == _dequeuedAtLastCheck) {
+                starved = _queued.size();
+            }
+            _dequeuedAtLastCheck = _dequeued;
+        }
+
+        if (starved > 0) {
+            LOG(1) << "No service executor worker became free for " << kStarvationCheckInterval
+                   << ", running " << starved << " queued connections on overflow threads";
+            serviceExecutorCounter.noteOverflow(starved);
+        }
+        for (size_t i = 0; i < starved; ++i) {
+            // The pool only refuses work once it is shutting down. The sessions then stay queued
+            // for the workers to end.
+            Status status = _overflowWorkers.schedule([this] { _runNext(); });
+            if (!status.isOK()) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Runs the next request of 'session' on the current worker, and then returns the session to
+     * the reactor to wait for the request after that.
+     */
+    void _run(std::shared_ptr<Session> session) {
+        serviceExecutorCounter.changeState(SessionState::kQueued, SessionState::kRunning);
+
+        bool keepRunning = _runRequest(session.get());
+        while (keepRunning) {
+            session->suspended = session->handler->suspend();
+            if (session->suspended) {
+                serviceExecutorCounter.changeState(SessionState::kRunning, SessionState::kIdle);
+                _waitForRequest(std::move(session));
+                return;
+            }
+
+            // The handler cannot move this connection to another thread, so the connection keeps
+            // this worker until it ends.
+            keepRunning = _runRequest(session.get());
+        }
+
+        _endSession(session.get());
+    }
+
+    /**
+     * Connects 'session' if this is the first time it runs, and otherwise reads and processes its
+     * next request. Returns false if the connection should be closed.
+     */
+    bool _runRequest(Session* session) {
+        auto mp = session->port;
+        try {
+            if (!session->connected) {
+                mp->setLogLevel(logger::LogSeverity::Debug(1));
+                session->handler->connected(mp);
+                session->connected = true;
+                return true;
+            }
+
+            if (session->suspended) {
+                session->handler->resume(std::move(session->suspended));
+            }
+            if (inShutdown()) {
+                return false;
+            }
+
+            Message& m = session->message;
+            m.reset();
+            mp->clearCounters();
+
+            if (!mp->recv(m)) {
+                if (!serverGlobalParams.quiet) {
+                    int conns = Listener::globalTicketHolder.used() - 1;
+                    const char* word = (conns == 1 ? " connection" : " connections");
+                    log() << "end connection " << mp->remote().toString() << " (" << conns << word
+                          << " now open)";
+                }
+                return false;
+            }
+
+            session->handler->process(m, mp);
+            networkCounter.hit(mp->getBytesIn(), mp->getBytesOut());
+            return true;
+        } catch (AssertionException& e) {
+            log() << "AssertionException handling request, closing client connection: " << e;
+        } catch (SocketException& e) {
+            log() << "SocketException handling request, closing client connection: " << e;
+        } catch (const DBException& e) {
+            log() << "DBException handling request, closing client connection: " << e;
+        } catch (std::exception& e) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating";
+            quickExit(EXIT_UNCAUGHT);
+        }
+        return false;
+    }
+
+    /**
+     * Hands 'session', which has been counted as idle, to the reactor until its next request has
+     * fully arrived. Errors on the socket are left for the worker to find when it reads the
+     * request.
+     */
+    void _waitForRequest(std::shared_ptr<Session> session) {
+        auto& descriptor = session->descriptor;
+        descriptor.async_wait(asio::posix::descriptor_base::wait_read,
+                              [this, session](const asio::error_code& ec) {
+                                  if (!ec && !session->port->readAhead()) {
+                                      _waitForRequest(std::move(session));
+                                      return;
+                                  }
+                                  serviceExecutorCounter.changeState(SessionState::kIdle,
+                                                                     SessionState::kQueued);
+                                  _schedule(session);
+                              });
+    }
+
+    /**
+     * Closes 'session', which has been counted as running, and releases its ticket.
+     */
+    void _endSession(Session* session) {
+        if (session->suspended) {
+            session->handler->resume(std::move(session->suspended));
+        }
+        if (session->connected) {
+            session->handler->close();
+        }
+        session->port->shutdown();
+
+        asio::error_code ec;
+        session->descriptor.close(ec);
+
+        Listener::globalTicketHolder.release();
+        serviceExecutorCounter.changeState(SessionState::kRunning, SessionState::kNone);
+    }
+
+    ThreadPool _workers;
+    ThreadPool _overflowWorkers;
+
+    asio::io_service _reactor;
+    asio::io_service::work _reactorWork;
+    asio::steady_timer _starvationTimer;
+    stdx::thread _reactorThread;
+
+    stdx::mutex _mutex;
+
+    // Sessions whose requests have arrived, in the order they arrived. Each has a task to run it
+    // scheduled on '_workers', which does nothing if an overflow thread has run it already.
+    std::deque<std::shared_ptr<Session>> _queued;
+
+    // How many sessions have been taken from '_queued', in total and as of the last starvation
+    // check.
+    uint64_t _dequeued = 0;
+    uint64_t _dequeuedAtLastCheck = 0;
+};
+
+constexpr Milliseconds PooledSessionRunner::kStarvationCheckInterval;
+#endif  // _WIN32
+
 }  // namespace
 
 class PortMessageServer : public MessageServer, public Listener {
@@ -86,7 +435,15 @@ public:
      * @param handler the handler to use.
      */
     PortMessageServer(const MessageServer::Options& opts, std::shared_ptr<MessageHandler> handler)
-        : Listener("", opts.ipList, opts.port), _handler(std::move(handler)) {}
+        : Listener("", opts.ipList, opts.port), _handler(std::move(handler)) {
+#ifndef _WIN32
+        if (isServiceExecutorPooled()) {
+            _pooledRunner = stdx::make_unique<PooledSessionRunner>(getServiceExecutorMaxThreads());
+        }
+#endif
+        const int maxThreads = isServiceExecutorPooled() ? getServiceExecutorMaxThreads() : 0;
+        serviceExecutorCounter.setExecutor(getServiceExecutorName(), maxThreads);
+    }
 
     virtual void accepted(AbstractMessagingPort* mp) {
         ScopeGuard sleepAfterClosingPort = MakeGuard(sleepmillis, 2);
@@ -98,6 +455,15 @@ public:
             return;
         }
 
+#ifndef _WIN32
+        // SSL connections may hold decrypted requests which the reactor cannot see, so they are
+        // always run on a thread of their own.
+        if (_pooledRunner && !isSSLEnabled() && _pooledRunner->startSession(mp, _handler)) {
+            sleepAfterClosingPort.Dismiss();
+            return;
+        }
+#endif
+
         try {
 #ifndef __linux__  // TODO: consider making this ifdef _WIN32
             {
@@ -164,8 +530,21 @@ public:
     }
 
 private:
+    static bool isSSLEnabled() {
+#ifdef MONGO_CONFIG_SSL
+        return getSSLManager() != nullptr;
+#else
+        return false;
+#endif
+    }
+
     const std::shared_ptr<MessageHandler> _handler;
 
+#ifndef _WIN32
+    // Set if connections are run on a pool of threads rather than a thread each.
+    std::unique_ptr<PooledSessionRunner> _pooledRunner;
+#endif
+
     /**
      * Handles incoming messages from a given socket.
      *
@@ -41,6 +41,7 @@
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/concurrency/synchronization.h"
 #include "mongo/util/fail_point_service.h"
+#include "mongo/util/net/message_port.h"
 #include "mongo/util/net/socket_exception.h"
 
 namespace {
@@ -344,4 +345,37 @@ TEST_F(SocketFailPointTest, TestFailedRecvsDontRecv) {
 }
 
 
+#ifndef _WIN32
+TEST(MessagingPortReadAheadTest, RecvReturnsTheMessageReadAhead) {
+    SocketPair sp = socketPair(SOCK_STREAM);
+    ASSERT_TRUE(sp.first);
+    ASSERT_TRUE(sp.second);
+    MessagingPort port(sp.first);
+
+    Message toSend;
+    toSend.setData(dbMsg, "a request which arrives in two parts");
+    const int len = toSend.size();
+    const int firstPart = len / 2;
+
+    ASSERT_FALSE(port.readAhead());
+    sp.second->send(toSend.buf(), firstPart, "first part");
+    ASSERT_FALSE(port.readAhead());
+    sp.second->send(toSend.buf() + firstPart, len - firstPart, "second part");
+    ASSERT_TRUE(port.readAhead());
+
+    port.clearCounters();
+    Message received;
+    ASSERT_TRUE(port.recv(received));
+    ASSERT_EQUALS(len, received.size());
+    ASSERT_EQUALS(0, memcmp(toSend.buf(), received.buf(), len));
+    ASSERT_EQUALS(len, port.getBytesIn());
+
+    // A closed connection needs no more data for recv() to return.
+    sp.second->close();
+    ASSERT_TRUE(port.readAhead());
+    Message afterClose;
+    ASSERT_FALSE(port.recv(afterClose));
+}
+#endif
+
 }  // namespace
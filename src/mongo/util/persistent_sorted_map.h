@@ -0,0 +1,443 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mongo {
+
+/**
+ * An ordered map with the interface of std::map, whose copies share their entries.
+ *
+ * Entries are kept in sorted blocks of at most kMaxBlockSize entries each, and the map itself is
+ * an ordered table of pointers to its blocks. Copying a map only copies that table, so the copy
+ * shares every block with the original. A shared block is copied the first time a map which holds
+ * it modifies it, so modifying a copy costs time and memory proportional to the number of blocks
+ * modified rather than to the size of the map.
+ *
+ * Since entries may be shared, they cannot be modified through iterators, which are all const.
+ * Like those of a std::vector, iterators are invalidated by any modification of the map.
+ *
+ * Copies of a map may be used concurrently by different threads, but a single map has the same
+ * thread-safety as a std::map.
+ */
+template <typename Key, typename T, typename Compare = std::less<Key>>
+class PersistentSortedMap {
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using size_type = std::size_t;
+    using key_compare = Compare;
+
+    // A non-empty, sorted run of entries. Blocks are never modified while they are shared.
+    using Block = std::vector<value_type>;
+
+    static const size_type kMaxBlockSize = 128;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename PersistentSortedMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return (*_map->_blocks[_block])[_pos];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        const_iterator& operator++() {
+            if (++_pos == _map->_blocks[_block]->size()) {
+                ++_block;
+                _pos = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        const_iterator& operator--() {
+            if (_pos == 0) {
+                --_block;
+                _pos = _map->_blocks[_block]->size() - 1;
+            } else {
+                --_pos;
+            }
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return _block == other._block && _pos == other._pos;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class PersistentSortedMap;
+
+        const_iterator(const PersistentSortedMap* map, size_type block, size_type pos)
+            : _map(map), _block(block), _pos(pos) {}
+
+        const PersistentSortedMap* _map = nullptr;
+        size_type _block = 0;
+        size_type _pos = 0;
+    };
+
+    using iterator = const_iterator;
+
+    PersistentSortedMap() = default;
+
+    PersistentSortedMap(const PersistentSortedMap& other)
+        : _blocks(other._blocks),
+          _size(other._size),
+          _bytesCopied(_blocks.size() * sizeof(BlockPtr)),
+          _compare(other._compare) {}
+
+    PersistentSortedMap(PersistentSortedMap&& other) {
+        swap(other);
+    }
+
+    PersistentSortedMap& operator=(const PersistentSortedMap& other) {
+        PersistentSortedMap(other).swap(*this);
+        return *this;
+    }
+
+    PersistentSortedMap& operator=(PersistentSortedMap&& other) {
+        PersistentSortedMap(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, _blocks.size(), 0);
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    size_type size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /**
+     * Returns the first entry whose key is not less than 'key'.
+     */
+    const_iterator lower_bound(const Key& key) const {
+        const auto block =
+            std::partition_point(_blocks.begin(), _blocks.end(), [&](const BlockPtr& b) {
+                return _compare(b->back().first, key);
+            });
+        if (block == _blocks.end()) {
+            return end();
+        }
+
+        const auto pos = std::partition_point((*block)->begin(),
+                                              (*block)->end(),
+                                              [&](const value_type& entry) {
+                                                  return _compare(entry.first, key);
+                                              });
+        return const_iterator(this, block - _blocks.begin(), pos - (*block)->begin());
+    }
+
+    /**
+     * Returns the first entry whose key is greater than 'key'.
+     */
+    const_iterator upper_bound(const Key& key) const {
+        const auto block =
+            std::partition_point(_blocks.begin(), _blocks.end(), [&](const BlockPtr& b) {
+                return !_compare(key, b->back().first);
+            });
+        if (block == _blocks.end()) {
+            return end();
+        }
+
+        const auto pos = std::partition_point((*block)->begin(),
+                                              (*block)->end(),
+                                              [&](const value_type& entry) {
+                                                  return !_compare(key, entry.first);
+                                              });
+        return const_iterator(this, block - _blocks.begin(), pos - (*block)->begin());
+    }
+
+    const_iterator find(const Key& key) const {
+        const const_iterator it = lower_bound(key);
+        if (it != end() && !_compare(key, it->first)) {
+            return it;
+        }
+        return end();
+    }
+
+    size_type count(const Key& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    /**
+     * Inserts 'value' unless an entry with an equivalent key is already present. Returns the
+     * position of the entry with that key, and whether 'value' was inserted.
+     */
+    std::pair<const_iterator, bool> insert(value_type value) {
+        const const_iterator it = lower_bound(value.first);
+        if (it != end() && !_compare(value.first, it->first)) {
+            return {it, false};
+        }
+
+        if (_blocks.empty()) {
+            _blocks.push_back(std::make_shared<Block>());
+        }
+
+        size_type blockIndex = it._block;
+        size_type pos = it._pos;
+        if (blockIndex == _blocks.size()) {
+            blockIndex = _blocks.size() - 1;
+            pos = _blocks.back()->size();
+        }
+
+        Block& block = _mutableBlock(blockIndex);
+        block.insert(block.begin() + pos, std::move(value));
+        ++_size;
+
+        if (block.size() > kMaxBlockSize) {
+            // Maps are often built in key order, so when appending to the last block, start a new
+            // block instead of leaving two half-full blocks behind.
+            const bool isAppend = (blockIndex == _blocks.size() - 1 && pos == block.size() - 1);
+            const size_type splitPos = isAppend ? pos : block.size() / 2;
+
+            auto newBlock =
+                std::make_shared<Block>(std::make_move_iterator(block.begin() + splitPos),
+                                        std::make_move_iterator(block.end()));
+            block.erase(block.begin() + splitPos, block.end());
+            _blocks.insert(_blocks.begin() + blockIndex + 1, std::move(newBlock));
+
+            if (pos >= splitPos) {
+                ++blockIndex;
+                pos -= splitPos;
+            }
+        }
+
+        return {const_iterator(this, blockIndex, pos), true};
+    }
+
+    /**
+     * Returns a reference to the value mapped to 'key', inserting a default-constructed value if
+     * there is none. The reference is invalidated by any modification of the map.
+     */
+    T& operator[](const Key& key) {
+        const const_iterator it = insert(value_type(key, T())).first;
+        return _mutableBlock(it._block)[it._pos].second;
+    }
+
+    /**
+     * Removes the entries in [first, last) and returns the position of the entry which followed
+     * them.
+     */
+    const_iterator erase(const_iterator first, const_iterator last) {
+        if (first == last) {
+            return last;
+        }
+
+        boost::optional<Key> nextKey;
+        if (last != end()) {
+            nextKey = last->first;
+        }
+
+        // Work from the back, so that removing blocks does not move those yet to be visited.
+        if (first._block == last._block) {
+            _eraseFromBlock(first._block, first._pos, last._pos);
+        } else {
+            if (last._pos > 0) {
+                _eraseFromBlock(last._block, 0, last._pos);
+            }
+            for (size_type i = first._block + 1; i < last._block; ++i) {
+                _size -= _blocks[i]->size();
+            }
+            _blocks.erase(_blocks.begin() + first._block + 1, _blocks.begin() + last._block);
+            _eraseFromBlock(first._block, first._pos, _blocks[first._block]->size());
+        }
+
+        if (!_blocks.empty()) {
+            _mergeIfSmall(std::min(first._block, _blocks.size() - 1));
+        }
+
+        return nextKey ? lower_bound(*nextKey) : end();
+    }
+
+    const_iterator erase(const_iterator pos) {
+        return erase(pos, std::next(pos));
+    }
+
+    size_type erase(const Key& key) {
+        const const_iterator it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    void clear() {
+        _blocks.clear();
+        _size = 0;
+    }
+
+    void swap(PersistentSortedMap& other) {
+        using std::swap;
+        swap(_blocks, other._blocks);
+        swap(_size, other._size);
+        swap(_bytesCopied, other._bytesCopied);
+        swap(_compare, other._compare);
+    }
+
+    /**
+     * Access to the blocks of the map, in key order, for structures derived from the map which
+     * want to share work between copies of it. A block returned here is never modified, and stays
+     * alive for as long as the caller holds on to it.
+     */
+    size_type numBlocks() const {
+        return _blocks.size();
+    }
+
+    std::shared_ptr<const Block> getBlock(size_type i) const {
+        return _blocks[i];
+    }
+
+    /**
+     * Returns the approximate number of bytes copied by this map since it was created: the table
+     * of blocks if it was copied from another map, and every shared block it had to copy before
+     * modifying it. The keys and values themselves are copied, not deep-copied.
+     */
+    size_type bytesCopied() const {
+        return _bytesCopied;
+    }
+
+private:
+    using BlockPtr = std::shared_ptr<Block>;
+
+    static const size_type kMinBlockSize = kMaxBlockSize / 4;
+
+    /**
+     * Returns block 'i' for modification, first copying it if it is shared.
+     */
+    Block& _mutableBlock(size_type i) {
+        if (_blocks[i].use_count() > 1) {
+            _blocks[i] = std::make_shared<Block>(*_blocks[i]);
+            _bytesCopied += _blocks[i]->size() * sizeof(value_type);
+        }
+        return *_blocks[i];
+    }
+
+    /**
+     * Removes the entries in positions [from, to) of block 'i', and the block itself if that
+     * leaves it empty.
+     */
+    void _eraseFromBlock(size_type i, size_type from, size_type to) {
+        _size -= to - from;
+
+        if (from == 0 && to == _blocks[i]->size()) {
+            _blocks.erase(_blocks.begin() + i);
+            return;
+        }
+
+        Block& block = _mutableBlock(i);
+        block.erase(block.begin() + from, block.begin() + to);
+    }
+
+    /**
+     * Merges block 'i' into one of its neighbours if it has become small and they fit in a block.
+     */
+    void _mergeIfSmall(size_type i) {
+        if (_blocks[i]->size() >= kMinBlockSize) {
+            return;
+        }
+
+        if (i > 0 && _blocks[i - 1]->size() + _blocks[i]->size() <= kMaxBlockSize) {
+            --i;
+        } else if (i + 1 == _blocks.size() ||
+                   _blocks[i]->size() + _blocks[i + 1]->size() > kMaxBlockSize) {
+            return;
+        }
+
+        const BlockPtr next = _blocks[i + 1];
+        Block& block = _mutableBlock(i);
+        block.insert(block.end(), next->begin(), next->end());
+        _blocks.erase(_blocks.begin() + i + 1);
+    }
+
+    std::vector<BlockPtr> _blocks;
+    size_type _size = 0;
+    size_type _bytesCopied = 0;
+    Compare _compare;
+};
+
+template <typename Key, typename T, typename Compare>
+const typename PersistentSortedMap<Key, T, Compare>::size_type
+    PersistentSortedMap<Key, T, Compare>::kMaxBlockSize;
+
+template <typename Key, typename T, typename Compare>
+const typename PersistentSortedMap<Key, T, Compare>::size_type
+    PersistentSortedMap<Key, T, Compare>::kMinBlockSize;
+
+}  // namespace mongo
@@ -0,0 +1,226 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <map>
+
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/persistent_sorted_map.h"
+
+namespace mongo {
+namespace {
+
+using IntMap = PersistentSortedMap<int, int>;
+
+const size_t kBlockSize = IntMap::kMaxBlockSize;
+
+void assertSameContents(const std::map<int, int>& expected, const IntMap& actual) {
+    ASSERT_EQUALS(expected.size(), actual.size());
+    ASSERT_EQUALS(expected.empty(), actual.empty());
+
+    auto expectedIt = expected.begin();
+    for (auto it = actual.begin(); it != actual.end(); ++it, ++expectedIt) {
+        ASSERT_EQUALS(expectedIt->first, it->first);
+        ASSERT_EQUALS(expectedIt->second, it->second);
+    }
+
+    // Iterate backwards too.
+    auto expectedRit = expected.rbegin();
+    for (auto it = actual.end(); it != actual.begin(); ++expectedRit) {
+        --it;
+        ASSERT_EQUALS(expectedRit->first, it->first);
+    }
+}
+
+IntMap makeMap(int numEntries) {
+    IntMap map;
+    for (int i = 0; i < numEntries; ++i) {
+        map[i * 2] = i;
+    }
+    return map;
+}
+
+TEST(PersistentSortedMapTest, EmptyMap) {
+    IntMap map;
+    ASSERT(map.empty());
+    ASSERT(map.begin() == map.end());
+    ASSERT(map.find(1) == map.end());
+    ASSERT(map.lower_bound(1) == map.end());
+    ASSERT(map.upper_bound(1) == map.end());
+    ASSERT_EQUALS(0U, map.erase(1));
+}
+
+TEST(PersistentSortedMapTest, InsertDoesNotReplace) {
+    IntMap map;
+    ASSERT(map.insert(std::make_pair(1, 10)).second);
+
+    auto result = map.insert(std::make_pair(1, 20));
+    ASSERT_FALSE(result.second);
+    ASSERT_EQUALS(10, result.first->second);
+
+    map[1] = 30;
+    ASSERT_EQUALS(30, map.find(1)->second);
+    ASSERT_EQUALS(1U, map.size());
+}
+
+TEST(PersistentSortedMapTest, BoundsAcrossBlocks) {
+    const int numEntries = kBlockSize * 5 + 3;
+    IntMap map = makeMap(numEntries);
+    ASSERT_GREATER_THAN(map.numBlocks(), 1U);
+
+    for (int key = -1; key <= numEntries * 2; ++key) {
+        auto lower = map.lower_bound(key);
+        auto upper = map.upper_bound(key);
+
+        const int expectedLower = key < 0 ? 0 : (key + 1) / 2 * 2;
+        const int expectedUpper = key < 0 ? 0 : key / 2 * 2 + 2;
+
+        if (expectedLower >= numEntries * 2) {
+            ASSERT(lower == map.end());
+        } else {
+            ASSERT_EQUALS(expectedLower, lower->first);
+        }
+
+        if (expectedUpper >= numEntries * 2) {
+            ASSERT(upper == map.end());
+        } else {
+            ASSERT_EQUALS(expectedUpper, upper->first);
+        }
+
+        ASSERT_EQUALS(key >= 0 && key % 2 == 0 && key < numEntries * 2 ? 1U : 0U, map.count(key));
+    }
+}
+
+TEST(PersistentSortedMapTest, EraseRangeAcrossBlocks) {
+    const int numEntries = kBlockSize * 6;
+    IntMap map = makeMap(numEntries);
+
+    std::map<int, int> expected;
+    for (auto&& entry : map) {
+        expected.insert(entry);
+    }
+
+    auto next = map.erase(map.lower_bound(100), map.lower_bound(900));
+    expected.erase(expected.lower_bound(100), expected.lower_bound(900));
+    ASSERT_EQUALS(900, next->first);
+    assertSameContents(expected, map);
+
+    next = map.erase(map.lower_bound(1000), map.end());
+    expected.erase(expected.lower_bound(1000), expected.end());
+    ASSERT(next == map.end());
+    assertSameContents(expected, map);
+
+    next = map.erase(map.begin());
+    expected.erase(expected.begin());
+    ASSERT_EQUALS(2, next->first);
+    assertSameContents(expected, map);
+
+    map.erase(map.begin(), map.end());
+    ASSERT(map.empty());
+    ASSERT_EQUALS(0U, map.numBlocks());
+}
+
+TEST(PersistentSortedMapTest, RandomOperationsMatchStdMap) {
+    PseudoRandom random(1);
+    IntMap map;
+    std::map<int, int> expected;
+
+    for (int i = 0; i < 20000; ++i) {
+        const int key = random.nextInt32(2000);
+        switch (random.nextInt32(4)) {
+            case 0:
+            case 1:
+                map.insert(std::make_pair(key, i));
+                expected.insert(std::make_pair(key, i));
+                break;
+            case 2:
+                ASSERT_EQUALS(expected.erase(key), map.erase(key));
+                break;
+            case 3: {
+                const int end = key + random.nextInt32(300);
+                map.erase(map.lower_bound(key), map.lower_bound(end));
+                expected.erase(expected.lower_bound(key), expected.lower_bound(end));
+                break;
+            }
+        }
+
+        if (i % 1000 == 0) {
+            assertSameContents(expected, map);
+        }
+    }
+
+    assertSameContents(expected, map);
+}
+
+TEST(PersistentSortedMapTest, CopiesShareBlocksUntilModified) {
+    const int numEntries = kBlockSize * 100;
+    const IntMap original = makeMap(numEntries);
+
+    IntMap copy(original);
+    ASSERT_EQUALS(original.numBlocks() * sizeof(std::shared_ptr<IntMap::Block>),
+                  copy.bytesCopied());
+
+    for (size_t i = 0; i < copy.numBlocks(); ++i) {
+        ASSERT(copy.getBlock(i) == original.getBlock(i));
+    }
+
+    // Modifying the copy only copies the block it modifies.
+    copy[10] = -1;
+    copy.erase(20);
+    ASSERT_EQUALS(original.numBlocks() * sizeof(std::shared_ptr<IntMap::Block>) +
+                      kBlockSize * sizeof(IntMap::value_type),
+                  copy.bytesCopied());
+    ASSERT_EQUALS(original.numBlocks(), copy.numBlocks());
+    ASSERT(copy.getBlock(0) != original.getBlock(0));
+    for (size_t i = 1; i < copy.numBlocks(); ++i) {
+        ASSERT(copy.getBlock(i) == original.getBlock(i));
+    }
+
+    // The original is unaffected.
+    ASSERT_EQUALS(5, original.find(10)->second);
+    ASSERT_EQUALS(10, original.find(20)->second);
+    ASSERT_EQUALS(static_cast<size_t>(numEntries), original.size());
+    ASSERT_EQUALS(-1, copy.find(10)->second);
+    ASSERT(copy.find(20) == copy.end());
+    ASSERT_EQUALS(static_cast<size_t>(numEntries - 1), copy.size());
+}
+
+TEST(PersistentSortedMapTest, HeldBlocksAreNotModified) {
+    IntMap map = makeMap(10);
+    auto block = map.getBlock(0);
+
+    map[1] = 1;
+    ASSERT_EQUALS(10U, block->size());
+    ASSERT(map.getBlock(0) != block);
+    ASSERT_EQUALS(11U, map.size());
+}
+
+}  // namespace
+}  // namespace mongo